@@ -54,6 +54,7 @@ enum spa_io_type {
 	SPA_IO_Position,	/**< position information in the graph, struct spa_io_position */
 	SPA_IO_RateMatch,	/**< rate matching between nodes, struct spa_io_rate_match */
 	SPA_IO_Memory,		/**< memory pointer, struct spa_io_memory */
+	SPA_IO_Meter,		/**< level metering results, struct spa_io_meter */
 };
 
 /**
@@ -283,6 +284,36 @@ struct spa_io_rate_match {
 	uint32_t padding[7];
 };
 
+/** the maximum number of channels in the meter io area */
+#define SPA_IO_METER_MAX_CHANNELS	64
+
+/** levels of one channel, all values are linear */
+struct spa_io_meter_channel {
+	float peak;			/**< highest absolute sample value */
+	float rms;			/**< root mean square of the samples */
+	float true_peak;		/**< highest absolute value of the 4x oversampled
+					  *  signal or 0.0 when not measured */
+	float padding;
+};
+
+/**
+ * Level metering.
+ *
+ * The node writes the levels of each channel at the end of every
+ * measurement window. Readers in other processes should read seq,
+ * copy the values and check that seq is even and did not change,
+ * retrying otherwise.
+ */
+struct spa_io_meter {
+	uint32_t seq;			/**< incremented before and after an update,
+					  *  odd while an update is in progress */
+	uint32_t n_channels;		/**< number of valid channels */
+	uint32_t window;		/**< size of the measured window in samples */
+	uint32_t padding[5];
+	uint64_t count;			/**< number of windows measured so far */
+	struct spa_io_meter_channel channels[SPA_IO_METER_MAX_CHANNELS];
+};
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
@@ -0,0 +1,45 @@
+/* Simple Plugin API
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_AUDIO_DITHER_H
+#define SPA_AUDIO_DITHER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** values of SPA_PROP_ditherType */
+enum spa_audio_dither_method {
+	SPA_AUDIO_DITHER_NONE,		/**< no dither, the samples are rounded */
+	SPA_AUDIO_DITHER_RECTANGULAR,	/**< 1 LSB uniform noise */
+	SPA_AUDIO_DITHER_TRIANGULAR,	/**< 2 LSB triangular (TPDF) noise */
+	SPA_AUDIO_DITHER_WANNAMAKER_3,	/**< TPDF with 3 tap noise shaping */
+	SPA_AUDIO_DITHER_LIPSHITZ_5,	/**< TPDF with 5 tap noise shaping */
+};
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* SPA_AUDIO_DITHER_H */
@@ -30,6 +30,8 @@ extern "C" {
 #endif
 
 #include <spa/param/audio/raw.h>
+#include <spa/param/audio/dither.h>
+#include <spa/param/audio/volume.h>
 
 #define SPA_TYPE_INFO_AudioFormat		SPA_TYPE_INFO_ENUM_BASE "AudioFormat"
 #define SPA_TYPE_INFO_AUDIO_FORMAT_BASE		SPA_TYPE_INFO_AudioFormat ":"
@@ -133,6 +135,27 @@ static const struct spa_type_info spa_type_audio_channel[] = {
 	{ 0, 0, NULL, NULL },
 };
 
+#define SPA_TYPE_INFO_AudioVolumeRampScale		SPA_TYPE_INFO_ENUM_BASE "AudioVolumeRampScale"
+#define SPA_TYPE_INFO_AUDIO_VOLUME_RAMP_SCALE_BASE	SPA_TYPE_INFO_AudioVolumeRampScale ":"
+
+static const struct spa_type_info spa_type_audio_volume_ramp_scale[] = {
+	{ SPA_AUDIO_VOLUME_RAMP_LINEAR, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_VOLUME_RAMP_SCALE_BASE "linear", NULL },
+	{ SPA_AUDIO_VOLUME_RAMP_LOG, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_VOLUME_RAMP_SCALE_BASE "log", NULL },
+	{ 0, 0, NULL, NULL },
+};
+
+#define SPA_TYPE_INFO_AudioDitherMethod		SPA_TYPE_INFO_ENUM_BASE "AudioDitherMethod"
+#define SPA_TYPE_INFO_AUDIO_DITHER_METHOD_BASE	SPA_TYPE_INFO_AudioDitherMethod ":"
+
+static const struct spa_type_info spa_type_audio_dither_method[] = {
+	{ SPA_AUDIO_DITHER_NONE, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_DITHER_METHOD_BASE "none", NULL },
+	{ SPA_AUDIO_DITHER_RECTANGULAR, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_DITHER_METHOD_BASE "rectangular", NULL },
+	{ SPA_AUDIO_DITHER_TRIANGULAR, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_DITHER_METHOD_BASE "triangular", NULL },
+	{ SPA_AUDIO_DITHER_WANNAMAKER_3, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_DITHER_METHOD_BASE "wannamaker3", NULL },
+	{ SPA_AUDIO_DITHER_LIPSHITZ_5, SPA_TYPE_Int, SPA_TYPE_INFO_AUDIO_DITHER_METHOD_BASE "lipshitz5", NULL },
+	{ 0, 0, NULL, NULL },
+};
+
 #ifdef __cplusplus
 }  /* extern "C" */
 #endif
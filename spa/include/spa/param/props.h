@@ -72,9 +72,14 @@ enum spa_prop {
 	SPA_PROP_volume,
 	SPA_PROP_mute,
 	SPA_PROP_patternType,
-	SPA_PROP_ditherType,
+	SPA_PROP_ditherType,		/**< dither of the conversion to integer
+					  *  samples (Id enum spa_audio_dither_method) */
 	SPA_PROP_truncate,
 	SPA_PROP_channelVolumes,
+	SPA_PROP_volumeRampSamples,	/**< length of a volume change in samples (Int) */
+	SPA_PROP_volumeRampScale,	/**< scale of a volume change (Id enum
+					  *  spa_audio_volume_ramp_scale) */
+	SPA_PROP_waveMode,		/**< how a test wave is produced (Int) */
 
 	SPA_PROP_START_Video	= 0x20000,	/**< video related properties */
 	SPA_PROP_brightness,
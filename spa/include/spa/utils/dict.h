@@ -84,7 +84,7 @@ static inline const struct spa_dict_item *spa_dict_lookup_item(const struct spa_
 			return item;
 	} else {
 		spa_dict_for_each(item, dict) {
-			if (!strcmp(item->key, key))
+			if (item->key == key || !strcmp(item->key, key))
 				return item;
 		}
 	}
@@ -62,6 +62,8 @@ extern "C" {
 					"audio.process.deinterleave"	/**< deinterleave raw audio channels */
 #define SPA_NAME_AUDIO_PROCESS_INTERLEAVE	\
 					"audio.process.interleave"	/**< interleave raw audio channels */
+#define SPA_NAME_AUDIO_PROCESS_METER	"audio.process.meter"		/**< measures the levels of raw audio
+									  *  and publishes them in an io area */
 
 
 /** audio convert combines some of the audio processing */
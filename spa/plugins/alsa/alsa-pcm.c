@@ -899,8 +899,10 @@ push_frames(struct state *state,
 			spa_memcpy(d[0].data, src, l0);
 			if (l1 > 0)
 				spa_memcpy(SPA_MEMBER(d[0].data, l0, void), my_areas[0].addr, l1);
+			d[0].chunk->flags = 0;
 		} else {
 			memset(d[0].data, 0, n_bytes);
+			d[0].chunk->flags = SPA_CHUNK_FLAG_EMPTY;
 		}
 
 		d[0].chunk->offset = 0;
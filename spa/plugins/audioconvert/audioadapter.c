@@ -42,6 +42,8 @@
 
 #define NAME "audioadapter"
 
+#define MAX_PORTS	128
+
 /** \cond */
 
 struct impl {
@@ -65,6 +67,9 @@ struct impl {
 	struct spa_node *convert;
 	struct spa_hook convert_listener;
 	uint32_t convert_flags;
+	uint64_t convert_ports[2][MAX_PORTS / 64];	/* announced converter ports */
+
+	struct spa_audio_info_raw passthrough_info;	/* follower format without converter */
 
 	uint32_t n_buffers;
 	struct spa_buffer **buffers;
@@ -80,6 +85,7 @@ struct impl {
 	struct spa_callbacks callbacks;
 
 	unsigned int add_listener:1;
+	unsigned int allow_passthrough:1;
 	unsigned int use_converter:1;
 	unsigned int have_format:1;
 	unsigned int started:1;
@@ -367,6 +373,192 @@ static int configure_format(struct impl *this, uint32_t flags, const struct spa_
 	return res;
 }
 
+static const struct spa_node_events follower_node_events;
+
+/* The follower can be linked to the graph without the converter when its
+ * port can carry the samples of a DSP port as they are: mono float at the
+ * rate of the port config. */
+static bool can_passthrough(struct impl *this, const struct spa_pod *param)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = { 0 };
+	struct spa_pod *format = NULL, *filter;
+	struct spa_audio_info info = { 0 };
+	struct spa_audio_info_raw raw;
+	enum spa_direction dir;
+	enum spa_param_port_config_mode mode;
+	uint32_t state = 0;
+	int monitor = false;
+
+	if (!this->allow_passthrough)
+		return false;
+
+	if (spa_pod_parse_object(param,
+			SPA_TYPE_OBJECT_ParamPortConfig, NULL,
+			SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(&dir),
+			SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(&mode),
+			SPA_PARAM_PORT_CONFIG_monitor,		SPA_POD_OPT_Bool(&monitor),
+			SPA_PARAM_PORT_CONFIG_format,		SPA_POD_OPT_Pod(&format)) < 0)
+		return false;
+
+	if (dir != this->direction || mode != SPA_PARAM_PORT_CONFIG_MODE_dsp ||
+	    monitor || format == NULL)
+		return false;
+
+	if (spa_format_parse(format, &info.media_type, &info.media_subtype) < 0 ||
+	    info.media_type != SPA_MEDIA_TYPE_audio ||
+	    info.media_subtype != SPA_MEDIA_SUBTYPE_raw ||
+	    spa_format_audio_raw_parse(format, &info.info.raw) < 0)
+		return false;
+
+	if (info.info.raw.channels != 1 || info.info.raw.rate == 0)
+		return false;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	filter = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
+		SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
+		SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+		SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(3,
+						SPA_AUDIO_FORMAT_F32P,
+						SPA_AUDIO_FORMAT_F32P,
+						SPA_AUDIO_FORMAT_F32),
+		SPA_FORMAT_AUDIO_rate,     SPA_POD_Int(info.info.raw.rate),
+		SPA_FORMAT_AUDIO_channels, SPA_POD_Int(1));
+
+	if (spa_node_port_enum_params_sync(this->follower,
+				this->direction, 0,
+				SPA_PARAM_EnumFormat, &state,
+				filter, &format, &b) != 1)
+		return false;
+
+	spa_pod_fixate(format);
+
+	spa_zero(raw);
+	if (spa_format_audio_raw_parse(format, &raw) < 0)
+		return false;
+
+	raw.flags = info.info.raw.flags;
+	raw.position[0] = info.info.raw.position[0];
+	this->passthrough_info = raw;
+
+	return true;
+}
+
+/* Switch between linking the follower through the converter and exposing
+ * the follower port directly. The ports of the old configuration are
+ * removed and the new ones announced. */
+static void set_passthrough(struct impl *this, bool passthrough)
+{
+	struct spa_hook l;
+	uint32_t i, d;
+
+	if (this->use_converter == !passthrough)
+		return;
+
+	spa_log_info(this->log, NAME " %p: %s converter", this,
+			passthrough ? "bypass" : "use");
+
+	if (passthrough) {
+		configure_format(this, 0, NULL);
+
+		for (d = 0; d < 2; d++) {
+			for (i = 0; i < MAX_PORTS; i++) {
+				if (this->convert_ports[d][i / 64] & (1ULL << (i % 64)))
+					spa_node_emit_port_info(&this->hooks, d, i, NULL);
+			}
+		}
+		this->use_converter = false;
+		this->target = this->follower;
+
+		/* the graph configures the io of the follower port now */
+		spa_node_port_set_io(this->follower, this->direction, 0,
+				SPA_IO_RateMatch, NULL, 0);
+		spa_node_port_set_io(this->follower, this->direction, 0,
+				SPA_IO_Buffers, NULL, 0);
+
+		spa_zero(l);
+		spa_node_add_listener(this->follower, &l, &follower_node_events, this);
+		spa_hook_remove(&l);
+	} else {
+		spa_node_port_set_param(this->follower, this->direction, 0,
+				SPA_PARAM_Format, 0, NULL);
+		spa_node_emit_port_info(&this->hooks, this->direction, 0, NULL);
+
+		this->use_converter = true;
+		this->target = this->convert;
+		this->have_format = false;
+		this->n_buffers = 0;
+
+		link_io(this);
+	}
+}
+
+/* without the converter, the follower port is announced as a DSP port and
+ * its raw format is only seen by the follower */
+static int passthrough_enum_params(struct impl *this, int seq, uint32_t id,
+		uint32_t start, uint32_t num, const struct spa_pod *filter)
+{
+	struct spa_audio_info_dsp info = SPA_AUDIO_INFO_DSP_INIT(.format = SPA_AUDIO_FORMAT_DSP_F32);
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+
+	if (id == SPA_PARAM_Format && !this->have_format)
+		return -EIO;
+	if (start > 0)
+		return 0;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_dsp_build(&b, id, &info);
+
+	result.id = id;
+	result.index = 0;
+	result.next = 1;
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		return 0;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	return 0;
+}
+
+static int passthrough_set_format(struct impl *this, uint32_t flags,
+		const struct spa_pod *format)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = { 0 };
+	struct spa_audio_info info = { 0 };
+	int res;
+
+	if (format != NULL) {
+		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0)
+			return res;
+		if (info.media_type != SPA_MEDIA_TYPE_audio ||
+		    info.media_subtype != SPA_MEDIA_SUBTYPE_dsp)
+			return -EINVAL;
+		if (spa_format_audio_dsp_parse(format, &info.info.dsp) < 0)
+			return -EINVAL;
+		if (info.info.dsp.format != SPA_AUDIO_FORMAT_DSP_F32)
+			return -EINVAL;
+
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		format = spa_format_audio_raw_build(&b, SPA_PARAM_Format,
+				&this->passthrough_info);
+	}
+
+	if ((res = spa_node_port_set_param(this->follower,
+					   this->direction, 0,
+					   SPA_PARAM_Format, flags,
+					   format)) < 0)
+		return res;
+
+	this->have_format = format != NULL;
+
+	return res;
+}
+
 static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 			       const struct spa_pod *param)
 {
@@ -397,6 +589,11 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	case SPA_PARAM_PortConfig:
 		if (this->started)
 			return -EIO;
+		if (param == NULL)
+			return -EINVAL;
+
+		set_passthrough(this, can_passthrough(this, param));
+
 		if (this->target != this->follower) {
 			if ((res = spa_node_set_param(this->target, id, flags, param)) < 0)
 				return res;
@@ -404,10 +601,10 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 		break;
 
 	case SPA_PARAM_Props:
-		if (this->target != this->follower) {
-			if ((res = spa_node_set_param(this->target, id, flags, param)) < 0)
-				return res;
-		}
+		/* also without the converter so that it has the right
+		 * volume when we fall back to it */
+		if ((res = spa_node_set_param(this->convert, id, flags, param)) < 0)
+			return res;
 		break;
 	default:
 		res = -ENOTSUP;
@@ -494,14 +691,17 @@ static int impl_node_send_command(void *object, const struct spa_command *comman
 
 	switch (SPA_NODE_COMMAND_ID(command)) {
 	case SPA_NODE_COMMAND_Start:
-		if ((res = negotiate_format(this)) < 0)
-			return res;
-		if ((res = negotiate_buffers(this)) < 0)
-			return res;
+		if (this->use_converter) {
+			if ((res = negotiate_format(this)) < 0)
+				return res;
+			if ((res = negotiate_buffers(this)) < 0)
+				return res;
+		}
 		this->started = true;
 		break;
 	case SPA_NODE_COMMAND_Suspend:
-		configure_format(this, 0, NULL);
+		if (this->use_converter)
+			configure_format(this, 0, NULL);
 		/* fallthrough */
 	case SPA_NODE_COMMAND_Pause:
 		this->started = false;
@@ -563,6 +763,15 @@ static void convert_port_info(void *data,
 			port_id--;
 	}
 
+	if (port_id < MAX_PORTS) {
+		if (info)
+			this->convert_ports[direction][port_id / 64] |= 1ULL << (port_id % 64);
+		else
+			this->convert_ports[direction][port_id / 64] &= ~(1ULL << (port_id % 64));
+	}
+	if (!this->use_converter)
+		return;
+
 	spa_log_trace(this->log, NAME" %p: port info %d:%d", this,
 			direction, port_id);
 
@@ -613,6 +822,9 @@ static void follower_port_info(void *data,
 	struct impl *this = data;
 	uint32_t i;
 
+	if (info == NULL)
+		goto done;
+
 	for (i = 0; i < info->n_params; i++) {
 		uint32_t idx = SPA_ID_INVALID;
 
@@ -628,6 +840,9 @@ static void follower_port_info(void *data,
 	}
 	if (!this->add_listener)
 		emit_node_info(this, false);
+done:
+	if (!this->use_converter && direction == this->direction)
+		spa_node_emit_port_info(&this->hooks, direction, port_id, info);
 }
 
 static const struct spa_node_events follower_node_events = {
@@ -644,7 +859,7 @@ static int follower_ready(void *data, int status)
 
 	this->master = true;
 
-	if (this->direction == SPA_DIRECTION_OUTPUT)
+	if (this->direction == SPA_DIRECTION_OUTPUT && this->use_converter)
 		status = spa_node_process(this->convert);
 
 	return spa_node_call_ready(&this->callbacks, status);
@@ -775,6 +990,10 @@ impl_node_port_enum_params(void *object, int seq,
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 	spa_return_val_if_fail(num != 0, -EINVAL);
 
+	if (!this->use_converter && direction == this->direction &&
+	    (id == SPA_PARAM_EnumFormat || id == SPA_PARAM_Format))
+		return passthrough_enum_params(this, seq, id, start, num, filter);
+
 	if (direction != this->direction)
 		port_id++;
 
@@ -797,6 +1016,10 @@ impl_node_port_set_param(void *object,
 
 	spa_log_debug(this->log, " %d %d %d %d", port_id, id, direction, this->direction);
 
+	if (!this->use_converter && direction == this->direction &&
+	    id == SPA_PARAM_Format)
+		return passthrough_set_format(this, flags, param);
+
 	if (direction != this->direction)
 		port_id++;
 
@@ -1017,6 +1240,9 @@ impl_init(const struct spa_handle_factory *factory,
 	if (this->cpu)
 		this->max_align = spa_cpu_get_max_align(this->cpu);
 
+	if ((str = spa_dict_lookup(info, "audio.adapt.passthrough")) != NULL)
+		this->allow_passthrough = strcmp(str, "true") == 0 || atoi(str) == 1;
+
 	spa_hook_list_init(&this->hooks);
 
 	this->node.iface = SPA_INTERFACE_INIT(
@@ -42,8 +42,18 @@
 #include <spa/debug/pod.h>
 #include <spa/debug/types.h>
 
+#include "stage.h"
+
 #define NAME "audioconvert"
 
+#define MAX_NODES	8
+
+/* size of each of the scratch areas used between fused stages. Small enough
+ * so that the data of a block stays in the cache while it goes through the
+ * stages. */
+#define FUSE_SCRATCH	(16 * 1024)
+#define FUSE_MAX_BLOCK	1024
+
 struct buffer {
 	struct spa_list link;
 #define BUFFER_FLAG_OUT		(1 << 0)
@@ -84,7 +94,8 @@ struct impl {
 	int n_links;
 	struct link links[8];
 	int n_nodes;
-	struct spa_node *nodes[8];
+	struct spa_node *nodes[MAX_NODES];
+	struct stage *stages[MAX_NODES];
 
 	enum spa_param_port_config_mode mode[2];
 	bool fmt_removing[2];
@@ -111,6 +122,10 @@ struct impl {
 
 	unsigned int started:1;
 	unsigned int add_listener:1;
+	unsigned int fused:1;
+
+	uint32_t map[MAX_NODES][STAGE_MAX_DATAS];
+	uint8_t scratch[2][FUSE_SCRATCH] SPA_ALIGNED(64);
 };
 
 #define IS_MONITOR_PORT(this,dir,port_id) (dir == SPA_DIRECTION_OUTPUT && port_id > 0 &&	\
@@ -257,6 +272,56 @@ static int negotiate_link_format(struct impl *this, struct link *link)
 	return 0;
 }
 
+static struct stage *find_stage(struct impl *this, struct spa_node *node)
+{
+	struct spa_handle *handle;
+	void *iface;
+
+	if (node == this->convert_in)
+		handle = this->hnd_convert_in;
+	else if (node == this->channelmix)
+		handle = this->hnd_channelmix;
+	else if (node == this->resample)
+		handle = this->hnd_resample;
+	else if (node == this->convert_out)
+		handle = this->hnd_convert_out;
+	else
+		return NULL;
+
+	if (spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_AudioConvertStage, &iface) < 0)
+		return NULL;
+
+	return iface;
+}
+
+static void setup_stages(struct impl *this)
+{
+	int i;
+
+	for (i = 0; i < this->n_nodes; i++) {
+		struct stage *s = this->fused ? find_stage(this, this->nodes[i]) : NULL;
+		if (s != NULL) {
+			s->enabled = true;
+			s->pending = false;
+		}
+		this->stages[i] = s;
+	}
+}
+
+static void clean_stages(struct impl *this)
+{
+	int i;
+
+	for (i = 0; i < this->n_nodes; i++) {
+		struct stage *s = this->stages[i];
+		if (s != NULL) {
+			s->enabled = false;
+			s->pending = false;
+		}
+		this->stages[i] = NULL;
+	}
+}
+
 static int setup_convert(struct impl *this)
 {
 	int i, j, res;
@@ -280,6 +345,8 @@ static int setup_convert(struct impl *this)
 	make_link(this, this->nodes[1], 0, this->nodes[2], 0, 2);
 	make_link(this, this->nodes[2], 0, this->nodes[3], 0, 1);
 
+	setup_stages(this);
+
 	for (i = 0, j = this->n_links - 1; j >= i; i++, j--) {
 		spa_log_debug(this->log, "negotiate %d", i);
 		if ((res = negotiate_link_format(this, &this->links[i])) < 0)
@@ -393,6 +460,8 @@ static void clean_convert(struct impl *this)
 
 	spa_log_debug(this->log, NAME " %p: %d", this, this->n_links);
 
+	clean_stages(this);
+
 	for (i = 0; i < this->n_links; i++)
 		clean_link(this, &this->links[i]);
 	this->n_links = 0;
@@ -774,6 +843,8 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	}
 	case SPA_PARAM_Props:
 	{
+		/* the dither is applied when packing the output */
+		spa_node_set_param(this->convert_out, id, flags, param);
 		res = spa_node_set_param(this->channelmix, id, flags, param);
 		break;
 	}
@@ -1057,6 +1128,106 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return spa_node_port_reuse_buffer(target, port_id, buffer_id);
 }
 
+/* check that stage b reads what stage a writes, possibly in a different
+ * plane order, and remember in map where each input plane of b comes from */
+static bool stage_follows(const struct stage *a, const struct stage *b, uint32_t *map)
+{
+	uint32_t i, j;
+
+	if (a->n_samples != b->n_samples ||
+	    a->dst_stride != b->src_stride)
+		return false;
+
+	for (i = 0; i < b->n_src; i++) {
+		for (j = 0; j < a->n_dst; j++) {
+			if (b->src[i] == a->dst[j])
+				break;
+		}
+		if (j == a->n_dst)
+			return false;
+		map[i] = j;
+	}
+	return true;
+}
+
+static void run_stages(struct impl *this, uint32_t start, struct stage **stages, uint32_t n_stages)
+{
+	const void *src[STAGE_MAX_DATAS];
+	void *dst[STAGE_MAX_DATAS];
+	uint32_t i, j, n_samples, block, offs, chunk;
+	struct stage *s;
+
+	if (n_stages == 1) {
+		s = stages[0];
+		s->process(s->data, s->dst, s->src, s->n_samples);
+		return;
+	}
+
+	n_samples = stages[0]->n_samples;
+
+	/* the largest block for which all intermediate results fit in
+	 * the scratch area */
+	block = FUSE_MAX_BLOCK;
+	for (i = 0; i < n_stages - 1; i++) {
+		s = stages[i];
+		block = SPA_MIN(block, FUSE_SCRATCH / (s->n_dst * s->dst_stride));
+	}
+	block = SPA_MAX(block & ~15u, 1u);
+
+	spa_log_trace_fp(this->log, NAME " %p: fused %d stages, %d samples in blocks of %d",
+			this, n_stages, n_samples, block);
+
+	for (offs = 0; offs < n_samples; offs += chunk) {
+		chunk = SPA_MIN(block, n_samples - offs);
+
+		for (i = 0; i < n_stages; i++) {
+			uint8_t *in = this->scratch[(i + 1) & 1];
+			uint8_t *out = this->scratch[i & 1];
+
+			s = stages[i];
+
+			for (j = 0; j < s->n_src; j++) {
+				if (i == 0)
+					src[j] = SPA_MEMBER(s->src[j], offs * s->src_stride, void);
+				else
+					src[j] = in + this->map[start + i][j] * block * s->src_stride;
+			}
+			for (j = 0; j < s->n_dst; j++) {
+				if (i == n_stages - 1)
+					dst[j] = SPA_MEMBER(s->dst[j], offs * s->dst_stride, void);
+				else
+					dst[j] = out + j * block * s->dst_stride;
+			}
+			s->process(s->data, dst, src, chunk);
+		}
+	}
+}
+
+/* run the recorded conversions, fusing stages that feed each other */
+static void flush_stages(struct impl *this)
+{
+	struct stage *chain[MAX_NODES];
+	uint32_t i, n_chain = 0, start = 0;
+
+	for (i = 0; i < (uint32_t)this->n_nodes; i++) {
+		struct stage *s = this->stages[i];
+
+		if (s == NULL || !s->pending)
+			continue;
+		s->pending = false;
+
+		if (n_chain > 0 &&
+		    !stage_follows(chain[n_chain - 1], s, this->map[start + n_chain])) {
+			run_stages(this, start, chain, n_chain);
+			start += n_chain;
+			n_chain = 0;
+		}
+		chain[n_chain++] = s;
+	}
+	if (n_chain > 0)
+		run_stages(this, start, chain, n_chain);
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -1071,11 +1242,18 @@ static int impl_node_process(void *object)
 		res = SPA_STATUS_OK;
 		ready = 0;
 		for (i = 0; i < this->n_nodes; i++) {
+			/* nodes that don't defer need the data of the
+			 * previous nodes */
+			if (this->stages[i] == NULL || !stage_defer(this->stages[i]))
+				flush_stages(this);
+
 			r = spa_node_process(this->nodes[i]);
 			spa_log_trace_fp(this->log, NAME " %p: process %d %d: %s",
 					this, i, r, r < 0 ? spa_strerror(r) : "ok");
-			if (r < 0)
+			if (r < 0) {
+				flush_stages(this);
 				return r;
+			}
 
 			if (r & SPA_STATUS_HAVE_DATA)
 				ready++;
@@ -1085,6 +1263,7 @@ static int impl_node_process(void *object)
 			if (i == this->n_nodes-1)
 				res |= r & SPA_STATUS_HAVE_DATA;
 		}
+		flush_stages(this);
 		if (res & SPA_STATUS_HAVE_DATA)
 			break;
 		if (ready == 0)
@@ -1184,6 +1363,7 @@ impl_init(const struct spa_handle_factory *factory,
 	struct impl *this;
 	size_t size;
 	void *iface;
+	const char *str;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -1199,6 +1379,10 @@ impl_init(const struct spa_handle_factory *factory,
 	if (this->cpu)
 		this->max_align = spa_cpu_get_max_align(this->cpu);
 
+	this->fused = true;
+	if (info != NULL && (str = spa_dict_lookup(info, "audioconvert.fused")) != NULL)
+		this->fused = strcmp(str, "true") == 0 || atoi(str) == 1;
+
 	this->node.iface = SPA_INTERFACE_INIT(
 			SPA_TYPE_INTERFACE_Node,
 			SPA_VERSION_NODE,
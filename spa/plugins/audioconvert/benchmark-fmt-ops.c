@@ -50,7 +50,7 @@ static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int channel_counts[] = { 1, 2, 4, 6, 8, 11 };
 
-#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 60
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 70
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -65,7 +65,13 @@ static void run_test1(const char *name, const char *impl, bool in_packed, bool o
 	uint64_t count, t1, t2;
 	struct convert conv;
 
+	spa_zero(conv);
 	conv.n_channels = n_channels;
+	/* for the dither functions, triangular with lipshitz noise shaping */
+	conv.method = DITHER_METHOD_TRIANGULAR;
+	init_noise(&conv);
+	conv.ns = lipshitz_5;
+	conv.n_ns = SPA_N_ELEMENTS(lipshitz_5);
 
 	for (j = 0; j < n_channels; j++) {
 		ip[j] = &samp_in[j * n_samples * 4];
@@ -106,6 +112,17 @@ static void run_test(const char *name, const char *impl, bool in_packed, bool ou
 	}
 }
 
+static void run_test_channels(const char *name, const char *impl, bool in_packed, bool out_packed,
+		convert_func_t func, int n_channels)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		run_test1(name, impl, in_packed, out_packed, func, n_channels,
+			(sample_sizes[i] + (n_channels -1)) / n_channels);
+	}
+}
+
 static void test_f32_u8(void)
 {
 	run_test("test_f32_u8", "c", true, true, conv_f32_to_u8_c);
@@ -127,10 +144,30 @@ static void test_f32_s16(void)
 	run_test("test_f32d_s16", "c", false, true, conv_f32d_to_s16_c);
 #if defined (HAVE_SSE2)
 	run_test("test_f32d_s16", "sse2", false, true, conv_f32d_to_s16_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s16", "avx2", false, true, conv_f32d_to_s16_avx2);
+	run_test_channels("test_f32d_s16", "avx2_2", false, true, conv_f32d_to_s16_2_avx2, 2);
+#endif
+#if defined (HAVE_AVX512)
+	run_test_channels("test_f32d_s16", "avx512_2", false, true, conv_f32d_to_s16_2_avx512, 2);
 #endif
 	run_test("test_f32_s16d", "c", true, false, conv_f32_to_s16d_c);
 }
 
+static void test_f32_s16_dither(void)
+{
+	run_test("test_f32d_s16", "c_dither", false, true, conv_f32d_to_s16_dither_c);
+	run_test("test_f32d_s16", "c_shaped", false, true, conv_f32d_to_s16_shaped_c);
+#if defined (HAVE_SSE2)
+	run_test("test_f32d_s16", "sse2_dither", false, true, conv_f32d_to_s16_dither_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s16", "avx2_dither", false, true, conv_f32d_to_s16_dither_avx2);
+	run_test_channels("test_f32d_s16", "avx2_2_dither", false, true, conv_f32d_to_s16_dither_2_avx2, 2);
+#endif
+}
+
 static void test_s16_f32(void)
 {
 	run_test("test_s16_f32", "c", true, true, conv_s16_to_f32_c);
@@ -138,6 +175,14 @@ static void test_s16_f32(void)
 	run_test("test_s16_f32d", "c", true, false, conv_s16_to_f32d_c);
 #if defined (HAVE_SSE2)
 	run_test("test_s16_f32d", "sse2", true, false, conv_s16_to_f32d_sse2);
+	run_test_channels("test_s16_f32d", "sse2_2", true, false, conv_s16_to_f32d_2_sse2, 2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s16_f32d", "avx2", true, false, conv_s16_to_f32d_avx2);
+	run_test_channels("test_s16_f32d", "avx2_2", true, false, conv_s16_to_f32d_2_avx2, 2);
+#endif
+#if defined (HAVE_AVX512)
+	run_test_channels("test_s16_f32d", "avx512_2", true, false, conv_s16_to_f32d_2_avx512, 2);
 #endif
 }
 
@@ -147,6 +192,12 @@ static void test_f32_s32(void)
 	run_test("test_f32d_s32", "c", false, true, conv_f32d_to_s32_c);
 #if defined (HAVE_SSE2)
 	run_test("test_f32d_s32", "sse2", false, true, conv_f32d_to_s32_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s32", "avx2", false, true, conv_f32d_to_s32_avx2);
+#endif
+#if defined (HAVE_AVX512)
+	run_test_channels("test_f32d_s32", "avx512_2", false, true, conv_f32d_to_s32_2_avx512, 2);
 #endif
 	run_test("test_f32_s32d", "c", true, false, conv_f32_to_s32d_c);
 }
@@ -156,13 +207,27 @@ static void test_s32_f32(void)
 	run_test("test_s32_f32", "c", true, true, conv_s32_to_f32_c);
 	run_test("test_s32d_f32", "c", false, true, conv_s32d_to_f32_c);
 	run_test("test_s32_f32d", "c", true, false, conv_s32_to_f32d_c);
+#if defined (HAVE_SSE2)
+	run_test("test_s32_f32d", "sse2", true, false, conv_s32_to_f32d_sse2);
+#endif
+#if defined (HAVE_AVX2)
+	run_test("test_s32_f32d", "avx2", true, false, conv_s32_to_f32d_avx2);
+#endif
+#if defined (HAVE_AVX512)
+	run_test_channels("test_s32_f32d", "avx512_2", true, false, conv_s32_to_f32d_2_avx512, 2);
+#endif
 }
 
 static void test_f32_s24(void)
 {
 	run_test("test_f32_s24", "c", true, true, conv_f32_to_s24_c);
 	run_test("test_f32d_s24", "c", false, true, conv_f32d_to_s24_c);
+	run_test("test_f32d_s24", "c_dither", false, true, conv_f32d_to_s24_dither_c);
+	run_test("test_f32d_s24", "c_shaped", false, true, conv_f32d_to_s24_shaped_c);
 	run_test("test_f32_s24d", "c", true, false, conv_f32_to_s24d_c);
+#if defined (HAVE_AVX2)
+	run_test("test_f32d_s24", "avx2", false, true, conv_f32d_to_s24_avx2);
+#endif
 }
 
 static void test_s24_f32(void)
@@ -179,6 +244,9 @@ static void test_s24_f32(void)
 #if defined (HAVE_SSE41)
 	run_test("test_s24_f32d", "sse41", true, false, conv_s24_to_f32d_sse41);
 #endif
+#if defined (HAVE_AVX2)
+	run_test("test_s24_f32d", "avx2", true, false, conv_s24_to_f32d_avx2);
+#endif
 }
 
 static void test_f32_s24_32(void)
@@ -201,6 +269,12 @@ static void test_interleave(void)
 	run_test("test_interleave_16", "c", false, true, conv_interleave_16_c);
 	run_test("test_interleave_24", "c", false, true, conv_interleave_24_c);
 	run_test("test_interleave_32", "c", false, true, conv_interleave_32_c);
+#if defined (HAVE_AVX2)
+	run_test("test_interleave_32", "avx2", false, true, conv_interleave_32_avx2);
+#endif
+#if defined (HAVE_AVX512)
+	run_test_channels("test_interleave_32", "avx512_2", false, true, conv_interleave_32_2_avx512, 2);
+#endif
 }
 
 static void test_deinterleave(void)
@@ -209,6 +283,12 @@ static void test_deinterleave(void)
 	run_test("test_deinterleave_16", "c", true, false, conv_deinterleave_16_c);
 	run_test("test_deinterleave_24", "c", true, false, conv_deinterleave_24_c);
 	run_test("test_deinterleave_32", "c", true, false, conv_deinterleave_32_c);
+#if defined (HAVE_AVX2)
+	run_test("test_deinterleave_32", "avx2", true, false, conv_deinterleave_32_avx2);
+#endif
+#if defined (HAVE_AVX512)
+	run_test_channels("test_deinterleave_32", "avx512_2", true, false, conv_deinterleave_32_2_avx512, 2);
+#endif
 }
 
 static int compare_func(const void *_a, const void *_b)
@@ -229,6 +309,7 @@ int main(int argc, char *argv[])
 	test_f32_u8();
 	test_u8_f32();
 	test_f32_s16();
+	test_f32_s16_dither();
 	test_s16_f32();
 	test_f32_s32();
 	test_s32_f32();
@@ -42,6 +42,7 @@ struct stats {
 	uint32_t out_rate;
 	uint32_t n_samples;
 	uint32_t n_channels;
+	double rate;
 	uint64_t perf;
 	const char *name;
 	const char *impl;
@@ -53,12 +54,15 @@ static float samp_out[MAX_SAMPLES * MAX_CHANNELS];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int in_rates[] = { 44100, 44100, 48000, 96000, 22050, 96000 };
 static const int out_rates[] = { 44100, 48000, 44100, 48000, 48000, 44100 };
+/* the adaptive rate used for rate matching around the nominal rate */
+static const double rates[] = { 1.0, 0.99, 1.01 };
 
 
-#define MAX_RESAMPLER	5
+#define MAX_RESAMPLER	6
 #define MAX_SIZES	SPA_N_ELEMENTS(sample_sizes)
 #define MAX_RATES	SPA_N_ELEMENTS(in_rates)
-#define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES
+#define MAX_ADAPT	SPA_N_ELEMENTS(rates)
+#define MAX_RESULTS	MAX_RESAMPLER * MAX_SIZES * MAX_RATES * MAX_ADAPT
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -97,6 +101,7 @@ static void run_test1(const char *name, const char *impl, struct resample *r, in
 		.out_rate = r->o_rate,
 		.n_samples = n_samples,
 		.n_channels = r->channels,
+		.rate = r->rate,
 		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
 		.name = name,
 		.impl = impl
@@ -105,9 +110,13 @@ static void run_test1(const char *name, const char *impl, struct resample *r, in
 
 static void run_test(const char *name, const char *impl, struct resample *r)
 {
-	size_t i;
-	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++)
-		run_test1(name, impl, r, sample_sizes[i]);
+	size_t i, j;
+	for (j = 0; j < SPA_N_ELEMENTS(rates); j++) {
+		r->rate = rates[j];
+		resample_update_rate(r, rates[j]);
+		for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++)
+			run_test1(name, impl, r, sample_sizes[i]);
+	}
 }
 
 static int compare_func(const void *_a, const void *_b)
@@ -119,6 +128,7 @@ static int compare_func(const void *_a, const void *_b)
 	if ((diff = a->out_rate - b->out_rate) != 0) return diff;
 	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
 	if ((diff = a->n_channels - b->n_channels) != 0) return diff;
+	if (a->rate != b->rate) return a->rate < b->rate ? -1 : 1;
 	if ((diff = b->perf - a->perf) != 0) return diff;
 	return 0;
 }
@@ -178,14 +188,27 @@ int main(int argc, char *argv[])
 		resample_free(&r);
 	}
 #endif
+#if defined (HAVE_AVX512)
+	for (i = 0; i < SPA_N_ELEMENTS(in_rates); i++) {
+		spa_zero(r);
+		r.channels = 2;
+		r.cpu_flags = SPA_CPU_FLAG_AVX512;
+		r.i_rate = in_rates[i];
+		r.o_rate = out_rates[i];
+		r.quality = RESAMPLE_DEFAULT_QUALITY;
+		impl_native_init(&r);
+		run_test("native", "avx512", &r);
+		resample_free(&r);
+	}
+#endif
 
 	qsort(results, n_results, sizeof(struct stats), compare_func);
 
 	for (i = 0; i < n_results; i++) {
 		struct stats *s = &results[i];
-		fprintf(stderr, "%-12."PRIu64" \t%-16.16s %s \t%d->%d samples %d, channels %d\n",
+		fprintf(stderr, "%-12."PRIu64" \t%-16.16s %s \t%d->%d rate %.2f samples %d, channels %d\n",
 				s->perf, s->name, s->impl, s->in_rate, s->out_rate,
-				s->n_samples, s->n_channels);
+				s->rate, s->n_samples, s->n_channels);
 	}
 	return 0;
 }
@@ -0,0 +1,302 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "channelmix-ops.h"
+
+#include <arm_neon.h>
+
+void channelmix_copy_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for (i = 0; i < n_dst; i++)
+			spa_memcpy(d[i], s[i], n_samples * sizeof(float));
+	}
+	else {
+		unrolled = n_samples & ~15;
+
+		for (i = 0; i < n_dst; i++) {
+			float *di = d[i];
+			const float *si = s[i];
+			const float32x4_t vol = vdupq_n_f32(mix->matrix[i][i]);
+
+			for(n = 0; n < unrolled; n += 16) {
+				vst1q_f32(&di[n+ 0], vmulq_f32(vld1q_f32(&si[n+ 0]), vol));
+				vst1q_f32(&di[n+ 4], vmulq_f32(vld1q_f32(&si[n+ 4]), vol));
+				vst1q_f32(&di[n+ 8], vmulq_f32(vld1q_f32(&si[n+ 8]), vol));
+				vst1q_f32(&di[n+12], vmulq_f32(vld1q_f32(&si[n+12]), vol));
+			}
+			for(; n < n_samples; n++)
+				di[n] = si[n] * mix->matrix[i][i];
+		}
+	}
+}
+
+void
+channelmix_f32_2_4_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float m2 = mix->matrix[2][0], m3 = mix->matrix[3][1];
+	const float32x4_t v0 = vdupq_n_f32(m0);
+	const float32x4_t v1 = vdupq_n_f32(m1);
+	const float32x4_t v2 = vdupq_n_f32(m2);
+	const float32x4_t v3 = vdupq_n_f32(m3);
+	float32x4_t in;
+	const float *sFL = s[0], *sFR = s[1];
+	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
+
+	unrolled = n_samples & ~3;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for(n = 0; n < unrolled; n += 4) {
+			in = vld1q_f32(&sFL[n]);
+			vst1q_f32(&dFL[n], in);
+			vst1q_f32(&dRL[n], in);
+			in = vld1q_f32(&sFR[n]);
+			vst1q_f32(&dFR[n], in);
+			vst1q_f32(&dRR[n], in);
+		}
+		for(; n < n_samples; n++) {
+			dFL[n] = dRL[n] = sFL[n];
+			dFR[n] = dRR[n] = sFR[n];
+		}
+	}
+	else if (m0 == m2 && m1 == m3) {
+		for(n = 0; n < unrolled; n += 4) {
+			in = vmulq_f32(vld1q_f32(&sFL[n]), v0);
+			vst1q_f32(&dFL[n], in);
+			vst1q_f32(&dRL[n], in);
+			in = vmulq_f32(vld1q_f32(&sFR[n]), v1);
+			vst1q_f32(&dFR[n], in);
+			vst1q_f32(&dRR[n], in);
+		}
+		for(; n < n_samples; n++) {
+			dFL[n] = dRL[n] = sFL[n] * m0;
+			dFR[n] = dRR[n] = sFR[n] * m1;
+		}
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			in = vld1q_f32(&sFL[n]);
+			vst1q_f32(&dFL[n], vmulq_f32(in, v0));
+			vst1q_f32(&dRL[n], vmulq_f32(in, v2));
+			in = vld1q_f32(&sFR[n]);
+			vst1q_f32(&dFR[n], vmulq_f32(in, v1));
+			vst1q_f32(&dRR[n], vmulq_f32(in, v3));
+		}
+		for(; n < n_samples; n++) {
+			dFL[n] = sFL[n] * m0;
+			dFR[n] = sFR[n] * m1;
+			dRL[n] = sFL[n] * m2;
+			dRR[n] = sFR[n] * m3;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR */
+void
+channelmix_f32_5p1_2_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float clev = mix->matrix[2][0], llev = mix->matrix[3][0];
+	const float slev0 = mix->matrix[4][0], slev1 = mix->matrix[4][1];
+	const float32x4_t v0 = vdupq_n_f32(m0);
+	const float32x4_t v1 = vdupq_n_f32(m1);
+	const float32x4_t vclev = vdupq_n_f32(clev);
+	const float32x4_t vllev = vdupq_n_f32(llev);
+	const float32x4_t vslev0 = vdupq_n_f32(slev0);
+	const float32x4_t vslev1 = vdupq_n_f32(slev1);
+	float32x4_t in, ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1];
+
+	unrolled = n_samples & ~3;
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vmulq_f32(vld1q_f32(&sFC[n]), vclev);
+			ctr = vmlaq_f32(ctr, vld1q_f32(&sLFE[n]), vllev);
+			in = vmulq_f32(vld1q_f32(&sSL[n]), vslev0);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vld1q_f32(&sFL[n]));
+			vst1q_f32(&dFL[n], in);
+			in = vmulq_f32(vld1q_f32(&sSR[n]), vslev1);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vld1q_f32(&sFR[n]));
+			vst1q_f32(&dFR[n], in);
+		}
+		for(; n < n_samples; n++) {
+			const float c = sFC[n] * clev + sLFE[n] * llev;
+			dFL[n] = sSL[n] * slev0 + c + sFL[n];
+			dFR[n] = sSR[n] * slev1 + c + sFR[n];
+		}
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vmulq_f32(vld1q_f32(&sFC[n]), vclev);
+			ctr = vmlaq_f32(ctr, vld1q_f32(&sLFE[n]), vllev);
+			in = vmulq_f32(vld1q_f32(&sSL[n]), vslev0);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vld1q_f32(&sFL[n]));
+			vst1q_f32(&dFL[n], vmulq_f32(in, v0));
+			in = vmulq_f32(vld1q_f32(&sSR[n]), vslev1);
+			in = vaddq_f32(in, ctr);
+			in = vaddq_f32(in, vld1q_f32(&sFR[n]));
+			vst1q_f32(&dFR[n], vmulq_f32(in, v1));
+		}
+		for(; n < n_samples; n++) {
+			const float c = sFC[n] * clev + sLFE[n] * llev;
+			dFL[n] = (sSL[n] * slev0 + c + sFL[n]) * m0;
+			dFR[n] = (sSR[n] * slev1 + c + sFR[n]) * m1;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_5p1_3p1_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float m2 = mix->matrix[2][2], m3 = mix->matrix[3][3];
+	const float slev0 = mix->matrix[0][4], slev1 = mix->matrix[1][5];
+	const float32x4_t v0 = vdupq_n_f32(m0);
+	const float32x4_t v1 = vdupq_n_f32(m1);
+	const float32x4_t v2 = vdupq_n_f32(m2);
+	const float32x4_t v3 = vdupq_n_f32(m3);
+	const float32x4_t vslev0 = vdupq_n_f32(slev0);
+	const float32x4_t vslev1 = vdupq_n_f32(slev1);
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1], *dFC = d[2], *dLFE = d[3];
+
+	unrolled = n_samples & ~3;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			vst1q_f32(&dFL[n], vmlaq_f32(vmulq_f32(vld1q_f32(&sFL[n]), v0),
+						vld1q_f32(&sSL[n]), vslev0));
+			vst1q_f32(&dFR[n], vmlaq_f32(vmulq_f32(vld1q_f32(&sFR[n]), v1),
+						vld1q_f32(&sSR[n]), vslev1));
+			vst1q_f32(&dFC[n], vmulq_f32(vld1q_f32(&sFC[n]), v2));
+			vst1q_f32(&dLFE[n], vmulq_f32(vld1q_f32(&sLFE[n]), v3));
+		}
+		for(; n < n_samples; n++) {
+			dFL[n] = sFL[n] * m0 + sSL[n] * slev0;
+			dFR[n] = sFR[n] * m1 + sSR[n] * slev1;
+			dFC[n] = sFC[n] * m2;
+			dLFE[n] = sLFE[n] * m3;
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR -> FL+FR+RL+RR*/
+void
+channelmix_f32_5p1_4_neon(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float clev = mix->matrix[2][2], llev = mix->matrix[3][3];
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float32x4_t vclev = vdupq_n_f32(clev);
+	const float32x4_t vllev = vdupq_n_f32(llev);
+	const float32x4_t v0 = vdupq_n_f32(m0);
+	const float32x4_t v1 = vdupq_n_f32(m1);
+	float32x4_t ctr;
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
+	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
+
+	unrolled = n_samples & ~3;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vmulq_f32(vld1q_f32(&sFC[n]), vclev);
+			ctr = vmlaq_f32(ctr, vld1q_f32(&sLFE[n]), vllev);
+			vst1q_f32(&dFL[n], vaddq_f32(vld1q_f32(&sFL[n]), ctr));
+			vst1q_f32(&dFR[n], vaddq_f32(vld1q_f32(&sFR[n]), ctr));
+			vst1q_f32(&dRL[n], vld1q_f32(&sSL[n]));
+			vst1q_f32(&dRR[n], vld1q_f32(&sSR[n]));
+		}
+		for(; n < n_samples; n++) {
+			const float c = sFC[n] * clev + sLFE[n] * llev;
+			dFL[n] = sFL[n] + c;
+			dFR[n] = sFR[n] + c;
+			dRL[n] = sSL[n];
+			dRR[n] = sSR[n];
+		}
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = vmulq_f32(vld1q_f32(&sFC[n]), vclev);
+			ctr = vmlaq_f32(ctr, vld1q_f32(&sLFE[n]), vllev);
+			vst1q_f32(&dFL[n], vmulq_f32(vaddq_f32(vld1q_f32(&sFL[n]), ctr), v0));
+			vst1q_f32(&dFR[n], vmulq_f32(vaddq_f32(vld1q_f32(&sFR[n]), ctr), v1));
+			vst1q_f32(&dRL[n], vmulq_f32(vld1q_f32(&sSL[n]), v0));
+			vst1q_f32(&dRR[n], vmulq_f32(vld1q_f32(&sSR[n]), v1));
+		}
+		for(; n < n_samples; n++) {
+			const float c = sFC[n] * clev + sLFE[n] * llev;
+			dFL[n] = (sFL[n] + c) * m0;
+			dFR[n] = (sFR[n] + c) * m1;
+			dRL[n] = sSL[n] * m0;
+			dRR[n] = sSR[n] * m1;
+		}
+	}
+}
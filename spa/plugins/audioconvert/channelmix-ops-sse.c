@@ -77,8 +77,12 @@ channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRI
 	uint32_t i, n, unrolled;
 	float **d = (float **)dst;
 	const float **s = (const float **)src;
-	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
-	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const float m0 = mix->matrix[0][0], m1 = mix->matrix[1][1];
+	const float m2 = mix->matrix[2][0], m3 = mix->matrix[3][1];
+	const __m128 v0 = _mm_set1_ps(m0);
+	const __m128 v1 = _mm_set1_ps(m1);
+	const __m128 v2 = _mm_set1_ps(m2);
+	const __m128 v3 = _mm_set1_ps(m3);
 	__m128 in;
 	const float *sFL = s[0], *sFR = s[1];
 	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
@@ -115,7 +119,7 @@ channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRI
 			_mm_store_ss(&dRR[n], in);
 		}
 	}
-	else {
+	else if (m0 == m2 && m1 == m3) {
 		for(n = 0; n < unrolled; n += 4) {
 			in = _mm_mul_ps(_mm_load_ps(&sFL[n]), v0);
 			_mm_store_ps(&dFL[n], in);
@@ -133,6 +137,24 @@ channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRI
 			_mm_store_ss(&dRR[n], in);
 		}
 	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			in = _mm_load_ps(&sFL[n]);
+			_mm_store_ps(&dFL[n], _mm_mul_ps(in, v0));
+			_mm_store_ps(&dRL[n], _mm_mul_ps(in, v2));
+			in = _mm_load_ps(&sFR[n]);
+			_mm_store_ps(&dFR[n], _mm_mul_ps(in, v1));
+			_mm_store_ps(&dRR[n], _mm_mul_ps(in, v3));
+		}
+		for(; n < n_samples; n++) {
+			in = _mm_load_ss(&sFL[n]);
+			_mm_store_ss(&dFL[n], _mm_mul_ss(in, v0));
+			_mm_store_ss(&dRL[n], _mm_mul_ss(in, v2));
+			in = _mm_load_ss(&sFR[n]);
+			_mm_store_ss(&dFR[n], _mm_mul_ss(in, v1));
+			_mm_store_ss(&dRR[n], _mm_mul_ss(in, v3));
+		}
+	}
 }
 
 /* FL+FR+FC+LFE+SL+SR -> FL+FR */
@@ -376,3 +398,510 @@ channelmix_f32_5p1_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_REST
 		}
 	}
 }
+
+static inline bool channels_aligned(uint32_t n_chan, const void **ch)
+{
+	uint32_t i;
+	for (i = 0; i < n_chan; i++)
+		if (!SPA_IS_ALIGNED(ch[i], 16))
+			return false;
+	return true;
+}
+
+/* Generic matrix. Only the non-zero coefficients of each output are used,
+ * so sparse matrices, as made for most layouts, are cheap. The sum is done
+ * in the same order as the C version. */
+void
+channelmix_f32_n_m_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, j, n, n_j, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const float *sj[SPA_AUDIO_MAX_CHANNELS];
+	__m128 vj[SPA_AUDIO_MAX_CHANNELS], sum[2];
+
+	for (i = 0; i < n_dst; i++) {
+		float *di = d[i];
+		bool aligned = SPA_IS_ALIGNED(di, 16);
+
+		for (j = 0, n_j = 0; j < n_src; j++) {
+			const float v = mix->matrix[i][j];
+			if (v == 0.0f)
+				continue;
+			sj[n_j] = s[j];
+			vj[n_j++] = _mm_set1_ps(v);
+			aligned &= SPA_IS_ALIGNED(s[j], 16);
+		}
+		if (n_j == 0) {
+			memset(di, 0, n_samples * sizeof(float));
+			continue;
+		}
+		if (n_j == 1 && _mm_cvtss_f32(vj[0]) == 1.0f) {
+			spa_memcpy(di, sj[0], n_samples * sizeof(float));
+			continue;
+		}
+
+		unrolled = aligned ? n_samples & ~7 : 0;
+
+		for (n = 0; n < unrolled; n += 8) {
+			sum[0] = _mm_mul_ps(_mm_load_ps(&sj[0][n]), vj[0]);
+			sum[1] = _mm_mul_ps(_mm_load_ps(&sj[0][n+4]), vj[0]);
+			for (j = 1; j < n_j; j++) {
+				sum[0] = _mm_add_ps(sum[0], _mm_mul_ps(_mm_load_ps(&sj[j][n]), vj[j]));
+				sum[1] = _mm_add_ps(sum[1], _mm_mul_ps(_mm_load_ps(&sj[j][n+4]), vj[j]));
+			}
+			_mm_store_ps(&di[n], sum[0]);
+			_mm_store_ps(&di[n+4], sum[1]);
+		}
+		for (; n < n_samples; n++) {
+			sum[0] = _mm_mul_ss(_mm_load_ss(&sj[0][n]), vj[0]);
+			for (j = 1; j < n_j; j++)
+				sum[0] = _mm_add_ss(sum[0], _mm_mul_ss(_mm_load_ss(&sj[j][n]), vj[j]));
+			_mm_store_ss(&di[n], sum[0]);
+		}
+	}
+}
+
+void
+channelmix_f32_1_2_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[1][0]);
+	const float *sM = s[0];
+	float *dFL = d[0], *dFR = d[1];
+	__m128 in;
+
+	if (SPA_IS_ALIGNED(sM, 16) &&
+	    SPA_IS_ALIGNED(dFL, 16) &&
+	    SPA_IS_ALIGNED(dFR, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		spa_memcpy(dFL, sM, n_samples * sizeof(float));
+		spa_memcpy(dFR, sM, n_samples * sizeof(float));
+	}
+	else if (mix->equal) {
+		for(n = 0; n < unrolled; n += 4) {
+			in = _mm_mul_ps(_mm_load_ps(&sM[n]), v0);
+			_mm_store_ps(&dFL[n], in);
+			_mm_store_ps(&dFR[n], in);
+		}
+		for(; n < n_samples; n++) {
+			in = _mm_mul_ss(_mm_load_ss(&sM[n]), v0);
+			_mm_store_ss(&dFL[n], in);
+			_mm_store_ss(&dFR[n], in);
+		}
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			in = _mm_load_ps(&sM[n]);
+			_mm_store_ps(&dFL[n], _mm_mul_ps(in, v0));
+			_mm_store_ps(&dFR[n], _mm_mul_ps(in, v1));
+		}
+		for(; n < n_samples; n++) {
+			in = _mm_load_ss(&sM[n]);
+			_mm_store_ss(&dFL[n], _mm_mul_ss(in, v0));
+			_mm_store_ss(&dFR[n], _mm_mul_ss(in, v1));
+		}
+	}
+}
+
+void
+channelmix_f32_2_1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[0][1]);
+	const float *sFL = s[0], *sFR = s[1];
+	float *dM = d[0];
+
+	if (SPA_IS_ALIGNED(sFL, 16) &&
+	    SPA_IS_ALIGNED(sFR, 16) &&
+	    SPA_IS_ALIGNED(dM, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		memset(dM, 0, n_samples * sizeof(float));
+	}
+	else if (mix->equal) {
+		for(n = 0; n < unrolled; n += 4)
+			_mm_store_ps(&dM[n], _mm_mul_ps(
+					_mm_add_ps(_mm_load_ps(&sFL[n]), _mm_load_ps(&sFR[n])), v0));
+		for(; n < n_samples; n++)
+			_mm_store_ss(&dM[n], _mm_mul_ss(
+					_mm_add_ss(_mm_load_ss(&sFL[n]), _mm_load_ss(&sFR[n])), v0));
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4)
+			_mm_store_ps(&dM[n], _mm_add_ps(
+					_mm_mul_ps(_mm_load_ps(&sFL[n]), v0),
+					_mm_mul_ps(_mm_load_ps(&sFR[n]), v1)));
+		for(; n < n_samples; n++)
+			_mm_store_ss(&dM[n], _mm_add_ss(
+					_mm_mul_ss(_mm_load_ss(&sFL[n]), v0),
+					_mm_mul_ss(_mm_load_ss(&sFR[n]), v1)));
+	}
+}
+
+/* FL+FR+RL+RR -> M and FL+FR+FC+LFE -> M, the LFE is only used when all
+ * channels have the same level */
+static inline void
+channelmix_f32_4_1_impl_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples,
+		bool use_s3)
+{
+	uint32_t n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[0][1]);
+	const __m128 v2 = _mm_set1_ps(mix->matrix[0][2]);
+	const __m128 v3 = _mm_set1_ps(mix->matrix[0][3]);
+	const float *s0 = s[0], *s1 = s[1], *s2 = s[2], *s3 = s[3];
+	float *dM = d[0];
+	__m128 sum;
+
+	if (channels_aligned(n_src, (const void **)src) &&
+	    SPA_IS_ALIGNED(dM, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		memset(dM, 0, n_samples * sizeof(float));
+	}
+	else if (mix->equal) {
+		for(n = 0; n < unrolled; n += 4) {
+			sum = _mm_add_ps(_mm_load_ps(&s0[n]), _mm_load_ps(&s1[n]));
+			sum = _mm_add_ps(sum, _mm_load_ps(&s2[n]));
+			sum = _mm_add_ps(sum, _mm_load_ps(&s3[n]));
+			_mm_store_ps(&dM[n], _mm_mul_ps(sum, v0));
+		}
+		for(; n < n_samples; n++) {
+			sum = _mm_add_ss(_mm_load_ss(&s0[n]), _mm_load_ss(&s1[n]));
+			sum = _mm_add_ss(sum, _mm_load_ss(&s2[n]));
+			sum = _mm_add_ss(sum, _mm_load_ss(&s3[n]));
+			_mm_store_ss(&dM[n], _mm_mul_ss(sum, v0));
+		}
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			sum = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&s0[n]), v0),
+					_mm_mul_ps(_mm_load_ps(&s1[n]), v1));
+			sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&s2[n]), v2));
+			if (use_s3)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_load_ps(&s3[n]), v3));
+			_mm_store_ps(&dM[n], sum);
+		}
+		for(; n < n_samples; n++) {
+			sum = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&s0[n]), v0),
+					_mm_mul_ss(_mm_load_ss(&s1[n]), v1));
+			sum = _mm_add_ss(sum, _mm_mul_ss(_mm_load_ss(&s2[n]), v2));
+			if (use_s3)
+				sum = _mm_add_ss(sum, _mm_mul_ss(_mm_load_ss(&s3[n]), v3));
+			_mm_store_ss(&dM[n], sum);
+		}
+	}
+}
+
+void
+channelmix_f32_4_1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	channelmix_f32_4_1_impl_sse(mix, n_dst, dst, n_src, src, n_samples, true);
+}
+
+void
+channelmix_f32_3p1_1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	channelmix_f32_4_1_impl_sse(mix, n_dst, dst, n_src, src, n_samples, false);
+}
+
+/* FL+FR -> FL+FR+FC+LFE and FL+FR -> FL+FR+FC+LFE+SL+SR */
+static inline void
+channelmix_f32_2_3p1_impl_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples,
+		bool surround)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **)dst;
+	const float **s = (const float **)src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const __m128 v4 = _mm_set1_ps(surround ? mix->matrix[4][0] : 0.0f);
+	const __m128 v5 = _mm_set1_ps(surround ? mix->matrix[5][1] : 0.0f);
+	const __m128 half = _mm_set1_ps(0.5f), zero = _mm_setzero_ps();
+	const float *sFL = s[0], *sFR = s[1];
+	float *dFL = d[0], *dFR = d[1], *dFC = d[2], *dLFE = d[3];
+	float *dSL = surround ? d[4] : NULL, *dSR = surround ? d[5] : NULL;
+	__m128 l, r;
+
+	if (channels_aligned(n_src, (const void **)src) &&
+	    channels_aligned(n_dst, (const void **)dst))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else if (mix->norm) {
+		for(n = 0; n < unrolled; n += 4) {
+			l = _mm_load_ps(&sFL[n]);
+			r = _mm_load_ps(&sFR[n]);
+			_mm_store_ps(&dFL[n], l);
+			_mm_store_ps(&dFR[n], r);
+			_mm_store_ps(&dFC[n], _mm_mul_ps(_mm_add_ps(l, r), half));
+			_mm_store_ps(&dLFE[n], zero);
+			if (surround) {
+				_mm_store_ps(&dSL[n], l);
+				_mm_store_ps(&dSR[n], r);
+			}
+		}
+		for(; n < n_samples; n++) {
+			l = _mm_load_ss(&sFL[n]);
+			r = _mm_load_ss(&sFR[n]);
+			_mm_store_ss(&dFL[n], l);
+			_mm_store_ss(&dFR[n], r);
+			_mm_store_ss(&dFC[n], _mm_mul_ss(_mm_add_ss(l, r), half));
+			_mm_store_ss(&dLFE[n], zero);
+			if (surround) {
+				_mm_store_ss(&dSL[n], l);
+				_mm_store_ss(&dSR[n], r);
+			}
+		}
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			l = _mm_load_ps(&sFL[n]);
+			r = _mm_load_ps(&sFR[n]);
+			if (surround) {
+				_mm_store_ps(&dSL[n], _mm_mul_ps(l, v4));
+				_mm_store_ps(&dSR[n], _mm_mul_ps(r, v5));
+			}
+			l = _mm_mul_ps(l, v0);
+			r = _mm_mul_ps(r, v1);
+			_mm_store_ps(&dFL[n], l);
+			_mm_store_ps(&dFR[n], r);
+			_mm_store_ps(&dFC[n], _mm_mul_ps(_mm_add_ps(l, r), half));
+			_mm_store_ps(&dLFE[n], zero);
+		}
+		for(; n < n_samples; n++) {
+			l = _mm_load_ss(&sFL[n]);
+			r = _mm_load_ss(&sFR[n]);
+			if (surround) {
+				_mm_store_ss(&dSL[n], _mm_mul_ss(l, v4));
+				_mm_store_ss(&dSR[n], _mm_mul_ss(r, v5));
+			}
+			l = _mm_mul_ss(l, v0);
+			r = _mm_mul_ss(r, v1);
+			_mm_store_ss(&dFL[n], l);
+			_mm_store_ss(&dFR[n], r);
+			_mm_store_ss(&dFC[n], _mm_mul_ss(_mm_add_ss(l, r), half));
+			_mm_store_ss(&dLFE[n], zero);
+		}
+	}
+}
+
+void
+channelmix_f32_2_3p1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	channelmix_f32_2_3p1_impl_sse(mix, n_dst, dst, n_src, src, n_samples, false);
+}
+
+void
+channelmix_f32_2_5p1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	channelmix_f32_2_3p1_impl_sse(mix, n_dst, dst, n_src, src, n_samples, true);
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR */
+void
+channelmix_f32_7p1_2_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const __m128 clev = _mm_set1_ps((mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f);
+	const __m128 llev = _mm_set1_ps((mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f);
+	const __m128 slev0 = _mm_set1_ps(mix->matrix[0][4]);
+	const __m128 slev1 = _mm_set1_ps(mix->matrix[1][5]);
+	const __m128 rlev0 = _mm_set1_ps(mix->matrix[0][6]);
+	const __m128 rlev1 = _mm_set1_ps(mix->matrix[1][7]);
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1];
+	__m128 ctr, in;
+
+	if (channels_aligned(n_src, (const void **)src) &&
+	    SPA_IS_ALIGNED(dFL, 16) &&
+	    SPA_IS_ALIGNED(dFR, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		memset(dFL, 0, n_samples * sizeof(float));
+		memset(dFR, 0, n_samples * sizeof(float));
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFC[n]), clev),
+					_mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
+			in = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFL[n]), v0), ctr);
+			in = _mm_add_ps(in, _mm_mul_ps(_mm_load_ps(&sSL[n]), slev0));
+			in = _mm_add_ps(in, _mm_mul_ps(_mm_load_ps(&sRL[n]), rlev0));
+			_mm_store_ps(&dFL[n], in);
+			in = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFR[n]), v1), ctr);
+			in = _mm_add_ps(in, _mm_mul_ps(_mm_load_ps(&sSR[n]), slev1));
+			in = _mm_add_ps(in, _mm_mul_ps(_mm_load_ps(&sRR[n]), rlev1));
+			_mm_store_ps(&dFR[n], in);
+		}
+		for(; n < n_samples; n++) {
+			ctr = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFC[n]), clev),
+					_mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
+			in = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFL[n]), v0), ctr);
+			in = _mm_add_ss(in, _mm_mul_ss(_mm_load_ss(&sSL[n]), slev0));
+			in = _mm_add_ss(in, _mm_mul_ss(_mm_load_ss(&sRL[n]), rlev0));
+			_mm_store_ss(&dFL[n], in);
+			in = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFR[n]), v1), ctr);
+			in = _mm_add_ss(in, _mm_mul_ss(_mm_load_ss(&sSR[n]), slev1));
+			in = _mm_add_ss(in, _mm_mul_ss(_mm_load_ss(&sRR[n]), rlev1));
+			_mm_store_ss(&dFR[n], in);
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+FC+LFE*/
+void
+channelmix_f32_7p1_3p1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const __m128 v2 = _mm_set1_ps(mix->matrix[2][2]);
+	const __m128 v3 = _mm_set1_ps(mix->matrix[3][3]);
+	const __m128 v4 = _mm_set1_ps((mix->matrix[0][4] + mix->matrix[0][6]) * 0.5f);
+	const __m128 v5 = _mm_set1_ps((mix->matrix[1][5] + mix->matrix[1][6]) * 0.5f);
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1], *dFC = d[2], *dLFE = d[3];
+
+	if (channels_aligned(n_src, (const void **)src) &&
+	    channels_aligned(n_dst, (const void **)dst))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			_mm_store_ps(&dFL[n], _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFL[n]), v0),
+					_mm_mul_ps(_mm_add_ps(_mm_load_ps(&sSL[n]),
+							_mm_load_ps(&sRL[n])), v4)));
+			_mm_store_ps(&dFR[n], _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFR[n]), v1),
+					_mm_mul_ps(_mm_add_ps(_mm_load_ps(&sSR[n]),
+							_mm_load_ps(&sRR[n])), v5)));
+			_mm_store_ps(&dFC[n], _mm_mul_ps(_mm_load_ps(&sFC[n]), v2));
+			_mm_store_ps(&dLFE[n], _mm_mul_ps(_mm_load_ps(&sLFE[n]), v3));
+		}
+		for(; n < n_samples; n++) {
+			_mm_store_ss(&dFL[n], _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFL[n]), v0),
+					_mm_mul_ss(_mm_add_ss(_mm_load_ss(&sSL[n]),
+							_mm_load_ss(&sRL[n])), v4)));
+			_mm_store_ss(&dFR[n], _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFR[n]), v1),
+					_mm_mul_ss(_mm_add_ss(_mm_load_ss(&sSR[n]),
+							_mm_load_ss(&sRR[n])), v5)));
+			_mm_store_ss(&dFC[n], _mm_mul_ss(_mm_load_ss(&sFC[n]), v2));
+			_mm_store_ss(&dLFE[n], _mm_mul_ss(_mm_load_ss(&sLFE[n]), v3));
+		}
+	}
+}
+
+/* FL+FR+FC+LFE+SL+SR+RL+RR -> FL+FR+RL+RR*/
+void
+channelmix_f32_7p1_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+{
+	uint32_t i, n, unrolled;
+	float **d = (float **) dst;
+	const float **s = (const float **) src;
+	const __m128 v0 = _mm_set1_ps(mix->matrix[0][0]);
+	const __m128 v1 = _mm_set1_ps(mix->matrix[1][1]);
+	const __m128 clev = _mm_set1_ps((mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f);
+	const __m128 llev = _mm_set1_ps((mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f);
+	const __m128 slev0 = _mm_set1_ps(mix->matrix[0][4]);
+	const __m128 slev1 = _mm_set1_ps(mix->matrix[1][5]);
+	const __m128 rlev0 = _mm_set1_ps(mix->matrix[0][6]);
+	const __m128 rlev1 = _mm_set1_ps(mix->matrix[1][7]);
+	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3];
+	const float *sSL = s[4], *sSR = s[5], *sRL = s[6], *sRR = s[7];
+	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
+	__m128 ctr, sl, sr;
+
+	if (channels_aligned(n_src, (const void **)src) &&
+	    channels_aligned(n_dst, (const void **)dst))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	if (mix->zero) {
+		for (i = 0; i < n_dst; i++)
+			memset(d[i], 0, n_samples * sizeof(float));
+	}
+	else {
+		for(n = 0; n < unrolled; n += 4) {
+			ctr = _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sFC[n]), clev),
+					_mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
+			sl = _mm_mul_ps(_mm_load_ps(&sSL[n]), slev0);
+			sr = _mm_mul_ps(_mm_load_ps(&sSR[n]), slev1);
+			_mm_store_ps(&dFL[n], _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_load_ps(&sFL[n]), v0), ctr), sl));
+			_mm_store_ps(&dFR[n], _mm_add_ps(_mm_add_ps(
+					_mm_mul_ps(_mm_load_ps(&sFR[n]), v1), ctr), sr));
+			_mm_store_ps(&dRL[n], _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sRL[n]), rlev0), sl));
+			_mm_store_ps(&dRR[n], _mm_add_ps(_mm_mul_ps(_mm_load_ps(&sRR[n]), rlev1), sr));
+		}
+		for(; n < n_samples; n++) {
+			ctr = _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sFC[n]), clev),
+					_mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
+			sl = _mm_mul_ss(_mm_load_ss(&sSL[n]), slev0);
+			sr = _mm_mul_ss(_mm_load_ss(&sSR[n]), slev1);
+			_mm_store_ss(&dFL[n], _mm_add_ss(_mm_add_ss(
+					_mm_mul_ss(_mm_load_ss(&sFL[n]), v0), ctr), sl));
+			_mm_store_ss(&dFR[n], _mm_add_ss(_mm_add_ss(
+					_mm_mul_ss(_mm_load_ss(&sFR[n]), v1), ctr), sr));
+			_mm_store_ss(&dRL[n], _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sRL[n]), rlev0), sl));
+			_mm_store_ss(&dRR[n], _mm_add_ss(_mm_mul_ss(_mm_load_ss(&sRR[n]), rlev1), sr));
+		}
+	}
+}
@@ -40,6 +40,7 @@
 #include <spa/debug/types.h>
 
 #include "channelmix-ops.h"
+#include "stage.h"
 
 #define NAME "channelmix"
 
@@ -123,6 +124,7 @@ struct impl {
 	struct port out_port;
 
 	struct channelmix mix;
+	struct stage stage;
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
 	uint32_t cpu_flags;
@@ -254,6 +256,14 @@ static int setup_convert(struct impl *this,
 	return 0;
 }
 
+static void stage_process(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	struct impl *this = data;
+	channelmix_process(&this->mix, this->mix.dst_chan, dst,
+			this->mix.src_chan, src, n_samples);
+}
+
 static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
@@ -888,22 +898,36 @@ static int impl_node_process(void *object)
 		const void *src_datas[n_src_datas];
 		void *dst_datas[n_dst_datas];
 		bool is_passthrough;
+		uint32_t flags = SPA_CHUNK_FLAG_EMPTY;
 
 		is_passthrough = this->is_passthrough && this->mix.identity;
 
 		n_samples = sb->datas[0].chunk->size / inport->stride;
 
-		for (i = 0; i < n_src_datas; i++)
+		for (i = 0; i < n_src_datas; i++) {
 			src_datas[i] = sb->datas[i].data;
+			flags &= sb->datas[i].chunk->flags;
+		}
 		for (i = 0; i < n_dst_datas; i++) {
 			dst_datas[i] = is_passthrough ? (void*)src_datas[i] : dbuf->datas[i];
 			db->datas[i].data = dst_datas[i];
 			db->datas[i].chunk->size = n_samples * outport->stride;
+			db->datas[i].chunk->flags = flags;
 		}
 
-		if (!is_passthrough)
-			channelmix_process(&this->mix, n_dst_datas, dst_datas,
-				    n_src_datas, src_datas, n_samples);
+		if (!is_passthrough && flags) {
+			/* silence in, silence out, no need to look at the input */
+			for (i = 0; i < n_dst_datas; i++)
+				memset(dst_datas[i], 0, n_samples * outport->stride);
+		}
+		else if (!is_passthrough) {
+			if (stage_defer(&this->stage))
+				stage_record(&this->stage, n_dst_datas, dst_datas,
+						n_src_datas, src_datas, n_samples);
+			else
+				channelmix_process(&this->mix, n_dst_datas, dst_datas,
+					    n_src_datas, src_datas, n_samples);
+		}
 	}
 
 	outio->status = SPA_STATUS_HAVE_DATA;
@@ -944,6 +968,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, SPA_TYPE_INTERFACE_AudioConvertStage) == 0)
+		*interface = &this->stage;
 	else
 		return -ENOENT;
 
@@ -1002,6 +1028,12 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.n_params = 2;
 	props_reset(&this->props);
 
+	this->stage.process = stage_process;
+	this->stage.data = this;
+	this->stage.src_stride = sizeof(float);
+	this->stage.dst_stride = sizeof(float);
+	this->stage.can_defer = true;
+
 	port = GET_OUT_PORT(this, 0);
 	port->direction = SPA_DIRECTION_OUTPUT;
 	port->id = 0;
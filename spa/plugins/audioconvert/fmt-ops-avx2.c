@@ -0,0 +1,1271 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "fmt-ops.h"
+
+#include <immintrin.h>
+
+/* All loads and stores are unaligned, the planar buffers we get are
+ * usually aligned but the unaligned instructions cost nothing extra
+ * in that case and we don't need a scalar fallback otherwise.
+ *
+ * The float to int conversions clamp and truncate like the C versions
+ * so that the results are identical. */
+
+static inline __m256i frame_index(uint32_t n_channels)
+{
+	return _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+			_mm256_set1_epi32(n_channels));
+}
+
+/* transpose the 4x4 matrix in each lane, with frames in the rows this gives
+ * the channels with frames 0-3 in the low lane and 4-7 in the high lane */
+static inline void transpose_ps(__m256 v[4])
+{
+	__m256 t[4];
+
+	t[0] = _mm256_unpacklo_ps(v[0], v[1]);
+	t[1] = _mm256_unpackhi_ps(v[0], v[1]);
+	t[2] = _mm256_unpacklo_ps(v[2], v[3]);
+	t[3] = _mm256_unpackhi_ps(v[2], v[3]);
+
+	v[0] = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t[0]), _mm256_castps_pd(t[2])));
+	v[1] = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t[0]), _mm256_castps_pd(t[2])));
+	v[2] = _mm256_castpd_ps(_mm256_unpacklo_pd(_mm256_castps_pd(t[1]), _mm256_castps_pd(t[3])));
+	v[3] = _mm256_castpd_ps(_mm256_unpackhi_pd(_mm256_castps_pd(t[1]), _mm256_castps_pd(t[3])));
+}
+
+static inline void transpose_epi32(__m256i v[4])
+{
+	__m256i t[4];
+
+	t[0] = _mm256_unpacklo_epi32(v[0], v[1]);
+	t[1] = _mm256_unpackhi_epi32(v[0], v[1]);
+	t[2] = _mm256_unpacklo_epi32(v[2], v[3]);
+	t[3] = _mm256_unpackhi_epi32(v[2], v[3]);
+
+	v[0] = _mm256_unpacklo_epi64(t[0], t[2]);
+	v[1] = _mm256_unpackhi_epi64(t[0], t[2]);
+	v[2] = _mm256_unpacklo_epi64(t[1], t[3]);
+	v[3] = _mm256_unpackhi_epi64(t[1], t[3]);
+}
+
+/* split 8 interleaved stereo frames in a and b into 8 left and 8 right */
+static inline void deinterleave_2_ps(__m256 *a, __m256 *b)
+{
+	__m256 l, r;
+
+	/* l0 l1 l4 l5 | l2 l3 l6 l7 */
+	l = _mm256_shuffle_ps(*a, *b, _MM_SHUFFLE(2, 0, 2, 0));
+	r = _mm256_shuffle_ps(*a, *b, _MM_SHUFFLE(3, 1, 3, 1));
+
+	*a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(l), _MM_SHUFFLE(3, 1, 2, 0)));
+	*b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(r), _MM_SHUFFLE(3, 1, 2, 0)));
+}
+
+/* expand the 4 packed 24 bits samples at lo and hi to 32 bits, the sample
+ * bits end up in the upper 24 bits. This reads 16 bytes from each pointer */
+static inline __m256i load_s24_avx2(const uint8_t *lo, const uint8_t *hi)
+{
+	const __m256i mask = _mm256_setr_epi8(
+			-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11,
+			-1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11);
+	return _mm256_shuffle_epi8(_mm256_loadu2_m128i((__m128i*)hi, (__m128i*)lo), mask);
+}
+
+static inline __m256 clamp_ps(__m256 v)
+{
+	return _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-1.0f)),
+			_mm256_set1_ps(1.0f));
+}
+
+static inline __m256i f32_to_s16_avx2(__m256 v)
+{
+	return _mm256_cvttps_epi32(_mm256_mul_ps(clamp_ps(v), _mm256_set1_ps(S16_SCALE)));
+}
+
+static inline __m256i f32_to_s24_avx2(__m256 v)
+{
+	return _mm256_cvttps_epi32(_mm256_mul_ps(clamp_ps(v), _mm256_set1_ps(S24_SCALE)));
+}
+
+static void
+conv_s16_to_f32d_1_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S16_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_cvtepi16_epi32(_mm_loadu_si128((__m128i*)&s[n]));
+		out = _mm256_mul_ps(_mm256_cvtepi32_ps(in), factor);
+		_mm256_storeu_ps(&d0[n], out);
+	}
+	for(; n < n_samples; n++)
+		d0[n] = S16_TO_F32(s[n]);
+}
+
+/* gathers the 32 bits that end with the sample so that the last sample of
+ * the buffer can be read without going past the end. Only valid for
+ * channels > 0 */
+static void
+conv_s16_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in, idx = frame_index(n_channels);
+	__m256 out, factor = _mm256_set1_ps(1.0f / S16_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32((const int*)(s - 1), idx, 2);
+		in = _mm256_srai_epi32(in, 16);
+		out = _mm256_mul_ps(_mm256_cvtepi32_ps(in), factor);
+		_mm256_storeu_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s16_to_f32d_2s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m256i in, t[2], idx = frame_index(n_channels);
+	__m256 out[2], factor = _mm256_set1_ps(1.0f / S16_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32((const int*)s, idx, 2);
+
+		t[0] = _mm256_srai_epi32(_mm256_slli_epi32(in, 16), 16);
+		t[1] = _mm256_srai_epi32(in, 16);
+
+		out[0] = _mm256_mul_ps(_mm256_cvtepi32_ps(t[0]), factor);
+		out[1] = _mm256_mul_ps(_mm256_cvtepi32_ps(t[1]), factor);
+
+		_mm256_storeu_ps(&d0[n], out[0]);
+		_mm256_storeu_ps(&d1[n], out[1]);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s16_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, i, unrolled;
+	__m128i t;
+	__m256 out[4], factor = _mm256_set1_ps(1.0f / S16_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		for (i = 0; i < 4; i++) {
+			t = _mm_loadl_epi64((__m128i*)&s[i*n_channels]);
+			t = _mm_castpd_si128(_mm_loadh_pd(_mm_castsi128_pd(t),
+						(double*)&s[(i+4)*n_channels]));
+			out[i] = _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(t));
+		}
+		transpose_ps(out);
+
+		_mm256_storeu_ps(&d0[n], _mm256_mul_ps(out[0], factor));
+		_mm256_storeu_ps(&d1[n], _mm256_mul_ps(out[1], factor));
+		_mm256_storeu_ps(&d2[n], _mm256_mul_ps(out[2], factor));
+		_mm256_storeu_ps(&d3[n], _mm256_mul_ps(out[3], factor));
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		d2[n] = S16_TO_F32(s[2]);
+		d3[n] = S16_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 1) {
+		conv_s16_to_f32d_1_avx2(conv, dst, s, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_s16_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_s16_to_f32d_2s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s16_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+void
+conv_s16_to_f32d_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m256i in, t[2];
+	__m256 out[2], factor = _mm256_set1_ps(1.0f / S16_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_loadu_si256((__m256i*)s);
+
+		t[0] = _mm256_srai_epi32(_mm256_slli_epi32(in, 16), 16);
+		t[1] = _mm256_srai_epi32(in, 16);
+
+		out[0] = _mm256_mul_ps(_mm256_cvtepi32_ps(t[0]), factor);
+		out[1] = _mm256_mul_ps(_mm256_cvtepi32_ps(t[1]), factor);
+
+		_mm256_storeu_ps(&d0[n], out[0]);
+		_mm256_storeu_ps(&d1[n], out[1]);
+		s += 16;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		s += 2;
+	}
+}
+
+/* the s24 gathers read one byte past the sample, the last frame is always
+ * done in the scalar loop so that we never read past the end */
+static void
+conv_s24_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in, idx = frame_index(3 * n_channels);
+	__m256 out, factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	unrolled = n_samples > 0 ? (n_samples - 1) & ~7 : 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32((const int*)s, idx, 1);
+		in = _mm256_srai_epi32(_mm256_slli_epi32(in, 8), 8);
+		out = _mm256_mul_ps(_mm256_cvtepi32_ps(in), factor);
+		_mm256_storeu_ps(&d0[n], out);
+		s += 24 * n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24(s));
+		s += 3 * n_channels;
+	}
+}
+
+static void
+conv_s24_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled, stride = 3 * n_channels;
+	__m256i in[4];
+	__m256 factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	unrolled = n_samples > 0 ? (n_samples - 1) & ~7 : 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = load_s24_avx2(&s[0*stride], &s[4*stride]);
+		in[1] = load_s24_avx2(&s[1*stride], &s[5*stride]);
+		in[2] = load_s24_avx2(&s[2*stride], &s[6*stride]);
+		in[3] = load_s24_avx2(&s[3*stride], &s[7*stride]);
+
+		transpose_epi32(in);
+
+		in[0] = _mm256_srai_epi32(in[0], 8);
+		in[1] = _mm256_srai_epi32(in[1], 8);
+		in[2] = _mm256_srai_epi32(in[2], 8);
+		in[3] = _mm256_srai_epi32(in[3], 8);
+
+		_mm256_storeu_ps(&d0[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[0]), factor));
+		_mm256_storeu_ps(&d1[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[1]), factor));
+		_mm256_storeu_ps(&d2[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[2]), factor));
+		_mm256_storeu_ps(&d3[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[3]), factor));
+
+		s += 8 * stride;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24(s));
+		d1[n] = S24_TO_F32(read_s24(s+3));
+		d2[n] = S24_TO_F32(read_s24(s+6));
+		d3[n] = S24_TO_F32(read_s24(s+9));
+		s += stride;
+	}
+}
+
+static void
+conv_s24_to_f32d_2_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m256 in[2], factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	unrolled = n_samples > 0 ? (n_samples - 1) & ~7 : 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_cvtepi32_ps(_mm256_srai_epi32(load_s24_avx2(&s[0], &s[12]), 8));
+		in[1] = _mm256_cvtepi32_ps(_mm256_srai_epi32(load_s24_avx2(&s[24], &s[36]), 8));
+
+		deinterleave_2_ps(&in[0], &in[1]);
+
+		_mm256_storeu_ps(&d0[n], _mm256_mul_ps(in[0], factor));
+		_mm256_storeu_ps(&d1[n], _mm256_mul_ps(in[1], factor));
+		s += 48;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(read_s24(s));
+		d1[n] = S24_TO_F32(read_s24(s+3));
+		s += 6;
+	}
+}
+
+void
+conv_s24_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int8_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 2) {
+		conv_s24_to_f32d_2_avx2(conv, dst, s, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24_to_f32d_4s_avx2(conv, &dst[i], &s[3*i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24_to_f32d_1s_avx2(conv, &dst[i], &s[3*i], n_channels, n_samples);
+}
+
+static void
+conv_s32_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in, idx = frame_index(n_channels);
+	__m256 out, factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32((const int*)s, idx, 4);
+		in = _mm256_srai_epi32(in, 8);
+		out = _mm256_mul_ps(_mm256_cvtepi32_ps(in), factor);
+		_mm256_storeu_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256i in[4];
+	__m256 factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_loadu2_m128i((__m128i*)&s[4*n_channels], (__m128i*)&s[0*n_channels]);
+		in[1] = _mm256_loadu2_m128i((__m128i*)&s[5*n_channels], (__m128i*)&s[1*n_channels]);
+		in[2] = _mm256_loadu2_m128i((__m128i*)&s[6*n_channels], (__m128i*)&s[2*n_channels]);
+		in[3] = _mm256_loadu2_m128i((__m128i*)&s[7*n_channels], (__m128i*)&s[3*n_channels]);
+
+		transpose_epi32(in);
+
+		in[0] = _mm256_srai_epi32(in[0], 8);
+		in[1] = _mm256_srai_epi32(in[1], 8);
+		in[2] = _mm256_srai_epi32(in[2], 8);
+		in[3] = _mm256_srai_epi32(in[3], 8);
+
+		_mm256_storeu_ps(&d0[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[0]), factor));
+		_mm256_storeu_ps(&d1[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[1]), factor));
+		_mm256_storeu_ps(&d2[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[2]), factor));
+		_mm256_storeu_ps(&d3[n], _mm256_mul_ps(_mm256_cvtepi32_ps(in[3]), factor));
+
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		d1[n] = S32_TO_F32(s[1]);
+		d2[n] = S32_TO_F32(s[2]);
+		d3[n] = S32_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32_to_f32d_2_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m256 in[2], factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_loadu_si256((__m256i*)&s[0]), 8));
+		in[1] = _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_loadu_si256((__m256i*)&s[8]), 8));
+
+		deinterleave_2_ps(&in[0], &in[1]);
+
+		_mm256_storeu_ps(&d0[n], _mm256_mul_ps(in[0], factor));
+		_mm256_storeu_ps(&d1[n], _mm256_mul_ps(in[1], factor));
+		s += 16;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		d1[n] = S32_TO_F32(s[1]);
+		s += 2;
+	}
+}
+
+void
+conv_s32_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 2) {
+		conv_s32_to_f32d_2_avx2(conv, dst, s, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, i, unrolled;
+	int32_t t[8];
+	__m256i out;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out = f32_to_s24_avx2(_mm256_loadu_ps(&s0[n]));
+		out = _mm256_slli_epi32(out, 8);
+		_mm256_storeu_si256((__m256i*)t, out);
+		for (i = 0; i < 8; i++)
+			d[i*n_channels] = t[i];
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S32(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_2s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256i out[2], t[2];
+	__m128i lo, hi;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out[0] = f32_to_s24_avx2(_mm256_loadu_ps(&s0[n]));
+		out[1] = f32_to_s24_avx2(_mm256_loadu_ps(&s1[n]));
+
+		out[0] = _mm256_slli_epi32(out[0], 8);
+		out[1] = _mm256_slli_epi32(out[1], 8);
+
+		t[0] = _mm256_unpacklo_epi32(out[0], out[1]);
+		t[1] = _mm256_unpackhi_epi32(out[0], out[1]);
+
+		lo = _mm256_castsi256_si128(t[0]);
+		hi = _mm256_castsi256_si128(t[1]);
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), lo);
+		_mm_storeh_pd((double*)(d + 1*n_channels), _mm_castsi128_pd(lo));
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), hi);
+		_mm_storeh_pd((double*)(d + 3*n_channels), _mm_castsi128_pd(hi));
+
+		lo = _mm256_extracti128_si256(t[0], 1);
+		hi = _mm256_extracti128_si256(t[1], 1);
+		_mm_storel_epi64((__m128i*)(d + 4*n_channels), lo);
+		_mm_storeh_pd((double*)(d + 5*n_channels), _mm_castsi128_pd(lo));
+		_mm_storel_epi64((__m128i*)(d + 6*n_channels), hi);
+		_mm_storeh_pd((double*)(d + 7*n_channels), _mm_castsi128_pd(hi));
+
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32(s0[n]);
+		d[1] = F32_TO_S32(s1[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256i out[4];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out[0] = f32_to_s24_avx2(_mm256_loadu_ps(&s0[n]));
+		out[1] = f32_to_s24_avx2(_mm256_loadu_ps(&s1[n]));
+		out[2] = f32_to_s24_avx2(_mm256_loadu_ps(&s2[n]));
+		out[3] = f32_to_s24_avx2(_mm256_loadu_ps(&s3[n]));
+
+		out[0] = _mm256_slli_epi32(out[0], 8);
+		out[1] = _mm256_slli_epi32(out[1], 8);
+		out[2] = _mm256_slli_epi32(out[2], 8);
+		out[3] = _mm256_slli_epi32(out[3], 8);
+
+		transpose_epi32(out);
+
+		_mm_storeu_si128((__m128i*)(d + 0*n_channels), _mm256_castsi256_si128(out[0]));
+		_mm_storeu_si128((__m128i*)(d + 1*n_channels), _mm256_castsi256_si128(out[1]));
+		_mm_storeu_si128((__m128i*)(d + 2*n_channels), _mm256_castsi256_si128(out[2]));
+		_mm_storeu_si128((__m128i*)(d + 3*n_channels), _mm256_castsi256_si128(out[3]));
+		_mm_storeu_si128((__m128i*)(d + 4*n_channels), _mm256_extracti128_si256(out[0], 1));
+		_mm_storeu_si128((__m128i*)(d + 5*n_channels), _mm256_extracti128_si256(out[1], 1));
+		_mm_storeu_si128((__m128i*)(d + 6*n_channels), _mm256_extracti128_si256(out[2], 1));
+		_mm_storeu_si128((__m128i*)(d + 7*n_channels), _mm256_extracti128_si256(out[3], 1));
+
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32(s0[n]);
+		d[1] = F32_TO_S32(s1[n]);
+		d[2] = F32_TO_S32(s2[n]);
+		d[3] = F32_TO_S32(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s32_2s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	uint8_t *d = dst;
+	uint32_t n, i, unrolled;
+	int32_t t[4][8];
+
+	unrolled = n_samples & ~7;
+
+	/* there is no cheap way to store packed 24 bits, convert in vectors
+	 * and write the samples one by one */
+	for(n = 0; n < unrolled; n += 8) {
+		_mm256_storeu_si256((__m256i*)t[0], f32_to_s24_avx2(_mm256_loadu_ps(&s0[n])));
+		_mm256_storeu_si256((__m256i*)t[1], f32_to_s24_avx2(_mm256_loadu_ps(&s1[n])));
+		_mm256_storeu_si256((__m256i*)t[2], f32_to_s24_avx2(_mm256_loadu_ps(&s2[n])));
+		_mm256_storeu_si256((__m256i*)t[3], f32_to_s24_avx2(_mm256_loadu_ps(&s3[n])));
+
+		for (i = 0; i < 8; i++) {
+			write_s24(d + 0, t[0][i]);
+			write_s24(d + 3, t[1][i]);
+			write_s24(d + 6, t[2][i]);
+			write_s24(d + 9, t[3][i]);
+			d += 3 * n_channels;
+		}
+	}
+	for(; n < n_samples; n++) {
+		write_s24(d + 0, F32_TO_S24(s0[n]));
+		write_s24(d + 3, F32_TO_S24(s1[n]));
+		write_s24(d + 6, F32_TO_S24(s2[n]));
+		write_s24(d + 9, F32_TO_S24(s3[n]));
+		d += 3 * n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	uint8_t *d = dst;
+	uint32_t n, i, unrolled;
+	int32_t t[8];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		_mm256_storeu_si256((__m256i*)t, f32_to_s24_avx2(_mm256_loadu_ps(&s0[n])));
+		for (i = 0; i < 8; i++) {
+			write_s24(d, t[i]);
+			d += 3 * n_channels;
+		}
+	}
+	for(; n < n_samples; n++) {
+		write_s24(d, F32_TO_S24(s0[n]));
+		d += 3 * n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_4s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_1s_avx2(conv, &d[3*i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s16_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int16_t *d = dst;
+	uint32_t n, i, unrolled;
+	int32_t t[8];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		_mm256_storeu_si256((__m256i*)t, f32_to_s16_avx2(_mm256_loadu_ps(&s0[n])));
+		for (i = 0; i < 8; i++)
+			d[i*n_channels] = t[i];
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S16(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_2s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256i out[2], t;
+	__m128i lo, hi;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out[0] = f32_to_s16_avx2(_mm256_loadu_ps(&s0[n]));
+		out[1] = f32_to_s16_avx2(_mm256_loadu_ps(&s1[n]));
+
+		/* a0-3 b0-3 | a4-7 b4-7 -> a0 b0 a1 b1 .. | a4 b4 .. */
+		t = _mm256_packs_epi32(out[0], out[1]);
+		t = _mm256_unpacklo_epi16(t, _mm256_unpackhi_epi64(t, t));
+
+		lo = _mm256_castsi256_si128(t);
+		hi = _mm256_extracti128_si256(t, 1);
+		*((int32_t*)(d + 0*n_channels)) = _mm_extract_epi32(lo, 0);
+		*((int32_t*)(d + 1*n_channels)) = _mm_extract_epi32(lo, 1);
+		*((int32_t*)(d + 2*n_channels)) = _mm_extract_epi32(lo, 2);
+		*((int32_t*)(d + 3*n_channels)) = _mm_extract_epi32(lo, 3);
+		*((int32_t*)(d + 4*n_channels)) = _mm_extract_epi32(hi, 0);
+		*((int32_t*)(d + 5*n_channels)) = _mm_extract_epi32(hi, 1);
+		*((int32_t*)(d + 6*n_channels)) = _mm_extract_epi32(hi, 2);
+		*((int32_t*)(d + 7*n_channels)) = _mm_extract_epi32(hi, 3);
+
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	__m256i out[4], t[2];
+	__m128i lo, hi;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out[0] = f32_to_s16_avx2(_mm256_loadu_ps(&s0[n]));
+		out[1] = f32_to_s16_avx2(_mm256_loadu_ps(&s1[n]));
+		out[2] = f32_to_s16_avx2(_mm256_loadu_ps(&s2[n]));
+		out[3] = f32_to_s16_avx2(_mm256_loadu_ps(&s3[n]));
+
+		t[0] = _mm256_packs_epi32(out[0], out[2]);
+		t[1] = _mm256_packs_epi32(out[1], out[3]);
+
+		out[0] = _mm256_unpacklo_epi16(t[0], t[1]);
+		out[1] = _mm256_unpackhi_epi16(t[0], t[1]);
+		t[0] = _mm256_unpacklo_epi32(out[0], out[1]);
+		t[1] = _mm256_unpackhi_epi32(out[0], out[1]);
+
+		lo = _mm256_castsi256_si128(t[0]);
+		hi = _mm256_castsi256_si128(t[1]);
+		_mm_storel_epi64((__m128i*)(d + 0*n_channels), lo);
+		_mm_storeh_pd((double*)(d + 1*n_channels), _mm_castsi128_pd(lo));
+		_mm_storel_epi64((__m128i*)(d + 2*n_channels), hi);
+		_mm_storeh_pd((double*)(d + 3*n_channels), _mm_castsi128_pd(hi));
+
+		lo = _mm256_extracti128_si256(t[0], 1);
+		hi = _mm256_extracti128_si256(t[1], 1);
+		_mm_storel_epi64((__m128i*)(d + 4*n_channels), lo);
+		_mm_storeh_pd((double*)(d + 5*n_channels), _mm_castsi128_pd(lo));
+		_mm_storel_epi64((__m128i*)(d + 6*n_channels), hi);
+		_mm_storeh_pd((double*)(d + 7*n_channels), _mm_castsi128_pd(hi));
+
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d[2] = F32_TO_S16(s2[n]);
+		d[3] = F32_TO_S16(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_2s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+void
+conv_f32d_to_s16_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int16_t *d = dst[0];
+	uint32_t n, unrolled;
+	__m256i out[2], t;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out[0] = f32_to_s16_avx2(_mm256_loadu_ps(&s0[n]));
+		out[1] = f32_to_s16_avx2(_mm256_loadu_ps(&s1[n]));
+
+		t = _mm256_packs_epi32(out[0], out[1]);
+		t = _mm256_unpacklo_epi16(t, _mm256_unpackhi_epi64(t, t));
+
+		_mm256_storeu_si256((__m256i*)d, t);
+		d += 16;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d += 2;
+	}
+}
+
+static void
+conv_deinterleave_32_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i idx = frame_index(n_channels);
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		_mm256_storeu_ps(&d0[n], _mm256_i32gather_ps(s, idx, 4));
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		s += n_channels;
+	}
+}
+
+static void
+conv_deinterleave_32_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256 in[4];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_loadu2_m128(&s[4*n_channels], &s[0*n_channels]);
+		in[1] = _mm256_loadu2_m128(&s[5*n_channels], &s[1*n_channels]);
+		in[2] = _mm256_loadu2_m128(&s[6*n_channels], &s[2*n_channels]);
+		in[3] = _mm256_loadu2_m128(&s[7*n_channels], &s[3*n_channels]);
+
+		transpose_ps(in);
+
+		_mm256_storeu_ps(&d0[n], in[0]);
+		_mm256_storeu_ps(&d1[n], in[1]);
+		_mm256_storeu_ps(&d2[n], in[2]);
+		_mm256_storeu_ps(&d3[n], in[3]);
+
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		d2[n] = s[2];
+		d3[n] = s[3];
+		s += n_channels;
+	}
+}
+
+static void
+conv_deinterleave_32_2_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m256 in[2];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_loadu_ps(&s[0]);
+		in[1] = _mm256_loadu_ps(&s[8]);
+
+		deinterleave_2_ps(&in[0], &in[1]);
+
+		_mm256_storeu_ps(&d0[n], in[0]);
+		_mm256_storeu_ps(&d1[n], in[1]);
+		s += 16;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		s += 2;
+	}
+}
+
+void
+conv_deinterleave_32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 2) {
+		conv_deinterleave_32_2_avx2(conv, dst, s, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_deinterleave_32_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_deinterleave_32_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_interleave_32_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	float *d = dst;
+	uint32_t n;
+
+	for(n = 0; n < n_samples; n++) {
+		*d = s0[n];
+		d += n_channels;
+	}
+}
+
+static void
+conv_interleave_32_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	float *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_loadu_ps(&s0[n]);
+		in[1] = _mm256_loadu_ps(&s1[n]);
+		in[2] = _mm256_loadu_ps(&s2[n]);
+		in[3] = _mm256_loadu_ps(&s3[n]);
+
+		transpose_ps(in);
+
+		_mm256_storeu2_m128(&d[4*n_channels], &d[0*n_channels], in[0]);
+		_mm256_storeu2_m128(&d[5*n_channels], &d[1*n_channels], in[1]);
+		_mm256_storeu2_m128(&d[6*n_channels], &d[2*n_channels], in[2]);
+		_mm256_storeu2_m128(&d[7*n_channels], &d[3*n_channels], in[3]);
+
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+static void
+conv_interleave_32_2_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	float *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[2], t[2];
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_loadu_ps(&s0[n]);
+		in[1] = _mm256_loadu_ps(&s1[n]);
+
+		/* l0 r0 l1 r1 | l4 r4 l5 r5 and l2 r2 l3 r3 | l6 r6 l7 r7 */
+		t[0] = _mm256_unpacklo_ps(in[0], in[1]);
+		t[1] = _mm256_unpackhi_ps(in[0], in[1]);
+
+		_mm256_storeu_ps(&d[0], _mm256_permute2f128_ps(t[0], t[1], 0x20));
+		_mm256_storeu_ps(&d[8], _mm256_permute2f128_ps(t[0], t[1], 0x31));
+		d += 16;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d += 2;
+	}
+}
+
+void
+conv_interleave_32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	float *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 2) {
+		conv_interleave_32_2_avx2(conv, d, src, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_interleave_32_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_interleave_32_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+/* unlike the plain conversion this rounds, like F32_TO_S16_D. The input
+ * is clamped before the noise is added and the result is clamped again. */
+static inline __m256i f32_to_s16_dither_avx2(__m256 v, const float *noise)
+{
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-1.0f)), _mm256_set1_ps(1.0f));
+	v = _mm256_add_ps(_mm256_mul_ps(v, _mm256_set1_ps(S16_SCALE)), _mm256_loadu_ps(noise));
+	v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-S16_MAX_F)), _mm256_set1_ps(S16_MAX_F));
+	return _mm256_cvtps_epi32(v);
+}
+
+/* F32_TO_S16_D without the call to lrintf() that would make the compiler
+ * spill the noise pointers in the unrolled loop */
+static inline int16_t f32_to_s16_dither_ss(float v, float noise)
+{
+	__m128 x = _mm_min_ss(_mm_max_ss(_mm_set_ss(v), _mm_set_ss(-1.0f)), _mm_set_ss(1.0f));
+	x = _mm_add_ss(_mm_mul_ss(x, _mm_set_ss(S16_SCALE)), _mm_set_ss(noise));
+	x = _mm_min_ss(_mm_max_ss(x, _mm_set_ss(-S16_MAX_F)), _mm_set_ss(S16_MAX_F));
+	return _mm_cvtss_si32(x);
+}
+
+static void
+conv_f32d_to_s16_dither_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *n0;
+	int16_t *d = dst;
+	uint32_t n, i, chunk, unrolled;
+	int32_t t[8];
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		unrolled = chunk & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			_mm256_storeu_si256((__m256i*)t,
+					f32_to_s16_dither_avx2(_mm256_loadu_ps(&s0[n]), &n0[n]));
+			for (i = 0; i < 8; i++)
+				d[i*n_channels] = t[i];
+			d += 8*n_channels;
+		}
+		for(; n < chunk; n++) {
+			*d = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d += n_channels;
+		}
+		s0 += chunk;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_2s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1], *n0, *n1;
+	int16_t *d = dst;
+	uint32_t n, chunk, unrolled;
+	__m256i out[2], t;
+	__m128i lo, hi;
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		n1 = dither_noise(conv);
+		unrolled = chunk & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			out[0] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s0[n]), &n0[n]);
+			out[1] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s1[n]), &n1[n]);
+
+			t = _mm256_packs_epi32(out[0], out[1]);
+			t = _mm256_unpacklo_epi16(t, _mm256_unpackhi_epi64(t, t));
+
+			lo = _mm256_castsi256_si128(t);
+			hi = _mm256_extracti128_si256(t, 1);
+			*((int32_t*)(d + 0*n_channels)) = _mm_extract_epi32(lo, 0);
+			*((int32_t*)(d + 1*n_channels)) = _mm_extract_epi32(lo, 1);
+			*((int32_t*)(d + 2*n_channels)) = _mm_extract_epi32(lo, 2);
+			*((int32_t*)(d + 3*n_channels)) = _mm_extract_epi32(lo, 3);
+			*((int32_t*)(d + 4*n_channels)) = _mm_extract_epi32(hi, 0);
+			*((int32_t*)(d + 5*n_channels)) = _mm_extract_epi32(hi, 1);
+			*((int32_t*)(d + 6*n_channels)) = _mm_extract_epi32(hi, 2);
+			*((int32_t*)(d + 7*n_channels)) = _mm_extract_epi32(hi, 3);
+
+			d += 8*n_channels;
+		}
+		for(; n < chunk; n++) {
+			d[0] = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d[1] = f32_to_s16_dither_ss(s1[n], n1[n]);
+			d += n_channels;
+		}
+		s0 += chunk;
+		s1 += chunk;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	const float *n0, *n1, *n2, *n3;
+	int16_t *d = dst;
+	uint32_t n, chunk, unrolled;
+	__m256i out[4], t[2];
+	__m128i lo, hi;
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		n1 = dither_noise(conv);
+		n2 = dither_noise(conv);
+		n3 = dither_noise(conv);
+		unrolled = chunk & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			out[0] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s0[n]), &n0[n]);
+			out[1] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s1[n]), &n1[n]);
+			out[2] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s2[n]), &n2[n]);
+			out[3] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s3[n]), &n3[n]);
+
+			t[0] = _mm256_packs_epi32(out[0], out[2]);
+			t[1] = _mm256_packs_epi32(out[1], out[3]);
+
+			out[0] = _mm256_unpacklo_epi16(t[0], t[1]);
+			out[1] = _mm256_unpackhi_epi16(t[0], t[1]);
+			t[0] = _mm256_unpacklo_epi32(out[0], out[1]);
+			t[1] = _mm256_unpackhi_epi32(out[0], out[1]);
+
+			lo = _mm256_castsi256_si128(t[0]);
+			hi = _mm256_castsi256_si128(t[1]);
+			_mm_storel_epi64((__m128i*)(d + 0*n_channels), lo);
+			_mm_storeh_pd((double*)(d + 1*n_channels), _mm_castsi128_pd(lo));
+			_mm_storel_epi64((__m128i*)(d + 2*n_channels), hi);
+			_mm_storeh_pd((double*)(d + 3*n_channels), _mm_castsi128_pd(hi));
+
+			lo = _mm256_extracti128_si256(t[0], 1);
+			hi = _mm256_extracti128_si256(t[1], 1);
+			_mm_storel_epi64((__m128i*)(d + 4*n_channels), lo);
+			_mm_storeh_pd((double*)(d + 5*n_channels), _mm_castsi128_pd(lo));
+			_mm_storel_epi64((__m128i*)(d + 6*n_channels), hi);
+			_mm_storeh_pd((double*)(d + 7*n_channels), _mm_castsi128_pd(hi));
+
+			d += 8*n_channels;
+		}
+		for(; n < chunk; n++) {
+			d[0] = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d[1] = f32_to_s16_dither_ss(s1[n], n1[n]);
+			d[2] = f32_to_s16_dither_ss(s2[n], n2[n]);
+			d[3] = f32_to_s16_dither_ss(s3[n], n3[n]);
+			d += n_channels;
+		}
+		s0 += chunk;
+		s1 += chunk;
+		s2 += chunk;
+		s3 += chunk;
+	}
+}
+
+void
+conv_f32d_to_s16_dither_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_dither_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_dither_2s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_dither_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+void
+conv_f32d_to_s16_dither_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *n0, *n1;
+	int16_t *d = dst[0];
+	uint32_t n, chunk, unrolled;
+	__m256i out[2], t;
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		n1 = dither_noise(conv);
+		unrolled = chunk & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			out[0] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s0[n]), &n0[n]);
+			out[1] = f32_to_s16_dither_avx2(_mm256_loadu_ps(&s1[n]), &n1[n]);
+
+			t = _mm256_packs_epi32(out[0], out[1]);
+			t = _mm256_unpacklo_epi16(t, _mm256_unpackhi_epi64(t, t));
+
+			_mm256_storeu_si256((__m256i*)d, t);
+			d += 16;
+		}
+		for(; n < chunk; n++) {
+			d[0] = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d[1] = f32_to_s16_dither_ss(s1[n], n1[n]);
+			d += 2;
+		}
+		s0 += chunk;
+		s1 += chunk;
+	}
+}
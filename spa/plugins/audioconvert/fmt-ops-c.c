@@ -814,3 +814,113 @@ conv_interleave_32_c(struct convert *conv, void * SPA_RESTRICT dst[], const void
 			*d++ = s[i][j];
 	}
 }
+
+void
+conv_f32d_to_s16_dither_c(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i, j, k, chunk, n_channels = conv->n_channels;
+
+	for (i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+
+		for (j = 0; j < n_samples;) {
+			const float *noise = dither_noise(conv);
+
+			chunk = SPA_MIN(n_samples - j, NOISE_CHUNK);
+			for (k = 0; k < chunk; k++, j++)
+				d[j * n_channels + i] = F32_TO_S16_D(s[j], noise[k]);
+		}
+	}
+}
+
+void
+conv_f32d_to_s24_dither_c(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i, j, k, chunk, n_channels = conv->n_channels;
+
+	for (i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+
+		for (j = 0; j < n_samples;) {
+			const float *noise = dither_noise(conv);
+
+			chunk = SPA_MIN(n_samples - j, NOISE_CHUNK);
+			for (k = 0; k < chunk; k++, j++)
+				write_s24(&d[(j * n_channels + i) * 3], F32_TO_S24_D(s[j], noise[k]));
+		}
+	}
+}
+
+/* error feedback quantizer, the errors of the previous samples are filtered
+ * with the shaping coefficients and subtracted from the input. This moves
+ * the quantization noise to the frequencies where the ear is least
+ * sensitive. */
+static inline void
+shaped_channel(struct convert *conv, struct shaper *sh, int32_t *q, const float *s,
+		const float *noise, uint32_t n_samples, float scale, int32_t min, int32_t max)
+{
+	const float *ns = conv->ns;
+	uint32_t j, n, n_ns = conv->n_ns, idx = sh->idx;
+
+	for (j = 0; j < n_samples; j++) {
+		float x = SPA_CLAMP(s[j], -1.0f, 1.0f) * scale;
+		int32_t v;
+
+		for (n = 0; n < n_ns; n++)
+			x -= ns[n] * sh->e[idx + n];
+
+		v = lrintf(x + noise[j]);
+
+		idx = (idx - 1) & NS_MASK;
+		sh->e[idx] = sh->e[idx + NS_MAX] = v - x;
+
+		q[j] = SPA_CLAMP(v, min, max);
+	}
+	sh->idx = idx;
+}
+
+void
+conv_f32d_to_s16_shaped_c(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i, j, k, chunk, n_channels = conv->n_channels;
+	int32_t q[NOISE_CHUNK];
+
+	for (i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+
+		for (j = 0; j < n_samples; j += chunk) {
+			chunk = SPA_MIN(n_samples - j, NOISE_CHUNK);
+			shaped_channel(conv, &conv->shaper[i], q, &s[j], dither_noise(conv),
+					chunk, S16_SCALE, S16_MIN, S16_MAX);
+			for (k = 0; k < chunk; k++)
+				d[(j + k) * n_channels + i] = q[k];
+		}
+	}
+}
+
+void
+conv_f32d_to_s24_shaped_c(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint8_t *d = dst[0];
+	uint32_t i, j, k, chunk, n_channels = conv->n_channels;
+	int32_t q[NOISE_CHUNK];
+
+	for (i = 0; i < n_channels; i++) {
+		const float *s = src[i];
+
+		for (j = 0; j < n_samples; j += chunk) {
+			chunk = SPA_MIN(n_samples - j, NOISE_CHUNK);
+			shaped_channel(conv, &conv->shaper[i], q, &s[j], dither_noise(conv),
+					chunk, S24_SCALE, S24_MIN, S24_MAX);
+			for (k = 0; k < chunk; k++)
+				write_s24(&d[((j + k) * n_channels + i) * 3], q[k]);
+		}
+	}
+}
@@ -0,0 +1,590 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "fmt-ops.h"
+
+#include <arm_neon.h>
+
+/* NEON has no alignment requirements for vld1/vst1 so, unlike the SSE
+ * versions, all functions use the vector loop for any pointer. The
+ * float to integer conversions truncate like the C versions. */
+
+static inline void transpose_f32(float32x4_t v[4])
+{
+	float32x4x2_t t0 = vtrnq_f32(v[0], v[1]);
+	float32x4x2_t t1 = vtrnq_f32(v[2], v[3]);
+
+	v[0] = vcombine_f32(vget_low_f32(t0.val[0]), vget_low_f32(t1.val[0]));
+	v[1] = vcombine_f32(vget_low_f32(t0.val[1]), vget_low_f32(t1.val[1]));
+	v[2] = vcombine_f32(vget_high_f32(t0.val[0]), vget_high_f32(t1.val[0]));
+	v[3] = vcombine_f32(vget_high_f32(t0.val[1]), vget_high_f32(t1.val[1]));
+}
+
+static inline float32x4_t clamp_f32(float32x4_t v)
+{
+	return vminq_f32(vmaxq_f32(v, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+}
+
+static inline int32x4_t f32_to_s16_neon(float32x4_t v)
+{
+	return vcvtq_s32_f32(vmulq_f32(clamp_f32(v), vdupq_n_f32(S16_SCALE)));
+}
+
+static inline int32x4_t f32_to_s32_neon(float32x4_t v)
+{
+	return vshlq_n_s32(vcvtq_s32_f32(vmulq_f32(clamp_f32(v), vdupq_n_f32(S24_SCALE))), 8);
+}
+
+static inline float32x4_t s16_to_f32_neon(int16x4_t v)
+{
+	return vmulq_f32(vcvtq_f32_s32(vmovl_s16(v)), vdupq_n_f32(1.0f / S16_SCALE));
+}
+
+static inline float32x4_t s32_to_f32_neon(int32x4_t v)
+{
+	return vmulq_f32(vcvtq_f32_s32(vshrq_n_s32(v, 8)), vdupq_n_f32(1.0f / S24_SCALE));
+}
+
+static void
+conv_s16_to_f32d_4s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1], *d2 = d[2], *d3 = d[3];
+	uint32_t n, unrolled;
+	float32x4_t out[4];
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out[0] = s16_to_f32_neon(vld1_s16(&s[0*n_channels]));
+		out[1] = s16_to_f32_neon(vld1_s16(&s[1*n_channels]));
+		out[2] = s16_to_f32_neon(vld1_s16(&s[2*n_channels]));
+		out[3] = s16_to_f32_neon(vld1_s16(&s[3*n_channels]));
+
+		transpose_f32(out);
+
+		vst1q_f32(&d0[n], out[0]);
+		vst1q_f32(&d1[n], out[1]);
+		vst1q_f32(&d2[n], out[2]);
+		vst1q_f32(&d3[n], out[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		d2[n] = S16_TO_F32(s[2]);
+		d3[n] = S16_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s16_to_f32d_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0];
+	uint32_t n, unrolled;
+	int16x4_t in = vdup_n_s16(0);
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vld1_lane_s16(&s[0*n_channels], in, 0);
+		in = vld1_lane_s16(&s[1*n_channels], in, 1);
+		in = vld1_lane_s16(&s[2*n_channels], in, 2);
+		in = vld1_lane_s16(&s[3*n_channels], in, 3);
+		vst1q_f32(&d0[n], s16_to_f32_neon(in));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16_to_f32d_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s16_to_f32d_4s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s16_to_f32d_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+void
+conv_s16_to_f32d_2_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1];
+	uint32_t n, unrolled;
+	int16x8x2_t in;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = vld2q_s16(s);
+
+		vst1q_f32(&d0[n + 0], s16_to_f32_neon(vget_low_s16(in.val[0])));
+		vst1q_f32(&d0[n + 4], s16_to_f32_neon(vget_high_s16(in.val[0])));
+		vst1q_f32(&d1[n + 0], s16_to_f32_neon(vget_low_s16(in.val[1])));
+		vst1q_f32(&d1[n + 4], s16_to_f32_neon(vget_high_s16(in.val[1])));
+		s += 16;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		s += 2;
+	}
+}
+
+static void
+conv_s32_to_f32d_4s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1], *d2 = d[2], *d3 = d[3];
+	uint32_t n, unrolled;
+	float32x4_t out[4];
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out[0] = s32_to_f32_neon(vld1q_s32(&s[0*n_channels]));
+		out[1] = s32_to_f32_neon(vld1q_s32(&s[1*n_channels]));
+		out[2] = s32_to_f32_neon(vld1q_s32(&s[2*n_channels]));
+		out[3] = s32_to_f32_neon(vld1q_s32(&s[3*n_channels]));
+
+		transpose_f32(out);
+
+		vst1q_f32(&d0[n], out[0]);
+		vst1q_f32(&d1[n], out[1]);
+		vst1q_f32(&d2[n], out[2]);
+		vst1q_f32(&d3[n], out[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		d1[n] = S32_TO_F32(s[1]);
+		d2[n] = S32_TO_F32(s[2]);
+		d3[n] = S32_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32_to_f32d_2s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0], *d1 = d[1];
+	uint32_t n, unrolled;
+	int32x4x2_t in;
+
+	/* only used for stereo, the frames are contiguous */
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vld2q_s32(s);
+		vst1q_f32(&d0[n], s32_to_f32_neon(in.val[0]));
+		vst1q_f32(&d1[n], s32_to_f32_neon(in.val[1]));
+		s += 8;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		d1[n] = S32_TO_F32(s[1]);
+		s += 2;
+	}
+}
+
+static void
+conv_s32_to_f32d_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float **d = (float **) dst;
+	float *d0 = d[0];
+	uint32_t n, unrolled;
+	int32x4_t in = vdupq_n_s32(0);
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vld1q_lane_s32(&s[0*n_channels], in, 0);
+		in = vld1q_lane_s32(&s[1*n_channels], in, 1);
+		in = vld1q_lane_s32(&s[2*n_channels], in, 2);
+		in = vld1q_lane_s32(&s[3*n_channels], in, 3);
+		vst1q_f32(&d0[n], s32_to_f32_neon(in));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s32_to_f32d_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 2) {
+		conv_s32_to_f32d_2s_neon(conv, dst, s, n_channels, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32_to_f32d_4s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32_to_f32d_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s16_4s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	float32x4_t in[4];
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = vld1q_f32(&s0[n]);
+		in[1] = vld1q_f32(&s1[n]);
+		in[2] = vld1q_f32(&s2[n]);
+		in[3] = vld1q_f32(&s3[n]);
+
+		transpose_f32(in);
+
+		vst1_s16(&d[0*n_channels], vmovn_s32(f32_to_s16_neon(in[0])));
+		vst1_s16(&d[1*n_channels], vmovn_s32(f32_to_s16_neon(in[1])));
+		vst1_s16(&d[2*n_channels], vmovn_s32(f32_to_s16_neon(in[2])));
+		vst1_s16(&d[3*n_channels], vmovn_s32(f32_to_s16_neon(in[3])));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d[2] = F32_TO_S16(s2[n]);
+		d[3] = F32_TO_S16(s3[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int16_t *d = dst;
+	uint32_t n, unrolled;
+	int16x4_t out;
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out = vmovn_s32(f32_to_s16_neon(vld1q_f32(&s0[n])));
+		vst1_lane_s16(&d[0*n_channels], out, 0);
+		vst1_lane_s16(&d[1*n_channels], out, 1);
+		vst1_lane_s16(&d[2*n_channels], out, 2);
+		vst1_lane_s16(&d[3*n_channels], out, 3);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_4s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+void
+conv_f32d_to_s16_2_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int16_t *d = dst[0];
+	uint32_t n, unrolled;
+	int16x8x2_t out;
+
+	unrolled = n_samples & ~7;
+
+	for(n = 0; n < unrolled; n += 8) {
+		out.val[0] = vcombine_s16(
+				vmovn_s32(f32_to_s16_neon(vld1q_f32(&s0[n + 0]))),
+				vmovn_s32(f32_to_s16_neon(vld1q_f32(&s0[n + 4]))));
+		out.val[1] = vcombine_s16(
+				vmovn_s32(f32_to_s16_neon(vld1q_f32(&s1[n + 0]))),
+				vmovn_s32(f32_to_s16_neon(vld1q_f32(&s1[n + 4]))));
+		vst2q_s16(d, out);
+		d += 16;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d += 2;
+	}
+}
+
+static void
+conv_f32d_to_s32_4s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	float32x4_t in[4];
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = vld1q_f32(&s0[n]);
+		in[1] = vld1q_f32(&s1[n]);
+		in[2] = vld1q_f32(&s2[n]);
+		in[3] = vld1q_f32(&s3[n]);
+
+		transpose_f32(in);
+
+		vst1q_s32(&d[0*n_channels], f32_to_s32_neon(in[0]));
+		vst1q_s32(&d[1*n_channels], f32_to_s32_neon(in[1]));
+		vst1q_s32(&d[2*n_channels], f32_to_s32_neon(in[2]));
+		vst1q_s32(&d[3*n_channels], f32_to_s32_neon(in[3]));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32(s0[n]);
+		d[1] = F32_TO_S32(s1[n]);
+		d[2] = F32_TO_S32(s2[n]);
+		d[3] = F32_TO_S32(s3[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_2s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	int32x4x2_t out;
+
+	/* only used for stereo, the frames are contiguous */
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out.val[0] = f32_to_s32_neon(vld1q_f32(&s0[n]));
+		out.val[1] = f32_to_s32_neon(vld1q_f32(&s1[n]));
+		vst2q_s32(d, out);
+		d += 8;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32(s0[n]);
+		d[1] = F32_TO_S32(s1[n]);
+		d += 2;
+	}
+}
+
+static void
+conv_f32d_to_s32_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	int32x4_t out;
+
+	unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out = f32_to_s32_neon(vld1q_f32(&s0[n]));
+		vst1q_lane_s32(&d[0*n_channels], out, 0);
+		vst1q_lane_s32(&d[1*n_channels], out, 1);
+		vst1q_lane_s32(&d[2*n_channels], out, 2);
+		vst1q_lane_s32(&d[3*n_channels], out, 3);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32(s0[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	if (n_channels == 2) {
+		conv_f32d_to_s32_2s_neon(conv, d, src, n_channels, n_samples);
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32_4s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+void
+conv_deinterleave_32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s = src[0];
+	float **d = (float **) dst;
+	uint32_t i = 0, n, unrolled, n_channels = conv->n_channels;
+
+	unrolled = n_samples & ~3;
+
+	if (n_channels == 2) {
+		float32x4x2_t in;
+		for(n = 0; n < unrolled; n += 4) {
+			in = vld2q_f32(&s[2*n]);
+			vst1q_f32(&d[0][n], in.val[0]);
+			vst1q_f32(&d[1][n], in.val[1]);
+		}
+		for(; n < n_samples; n++) {
+			d[0][n] = s[2*n + 0];
+			d[1][n] = s[2*n + 1];
+		}
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4) {
+		const float *si = &s[i];
+		float32x4_t in[4];
+
+		for(n = 0; n < unrolled; n += 4) {
+			in[0] = vld1q_f32(&si[0*n_channels]);
+			in[1] = vld1q_f32(&si[1*n_channels]);
+			in[2] = vld1q_f32(&si[2*n_channels]);
+			in[3] = vld1q_f32(&si[3*n_channels]);
+
+			transpose_f32(in);
+
+			vst1q_f32(&d[i+0][n], in[0]);
+			vst1q_f32(&d[i+1][n], in[1]);
+			vst1q_f32(&d[i+2][n], in[2]);
+			vst1q_f32(&d[i+3][n], in[3]);
+			si += 4*n_channels;
+		}
+		for(; n < n_samples; n++) {
+			d[i+0][n] = si[0];
+			d[i+1][n] = si[1];
+			d[i+2][n] = si[2];
+			d[i+3][n] = si[3];
+			si += n_channels;
+		}
+	}
+	for(; i < n_channels; i++) {
+		const float *si = &s[i];
+		for(n = 0; n < n_samples; n++) {
+			d[i][n] = *si;
+			si += n_channels;
+		}
+	}
+}
+
+void
+conv_interleave_32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float **s = (const float **) src;
+	float *d = dst[0];
+	uint32_t i = 0, n, unrolled, n_channels = conv->n_channels;
+
+	unrolled = n_samples & ~3;
+
+	if (n_channels == 2) {
+		float32x4x2_t out;
+		for(n = 0; n < unrolled; n += 4) {
+			out.val[0] = vld1q_f32(&s[0][n]);
+			out.val[1] = vld1q_f32(&s[1][n]);
+			vst2q_f32(&d[2*n], out);
+		}
+		for(; n < n_samples; n++) {
+			d[2*n + 0] = s[0][n];
+			d[2*n + 1] = s[1][n];
+		}
+		return;
+	}
+	for(; i + 3 < n_channels; i += 4) {
+		float *di = &d[i];
+		float32x4_t in[4];
+
+		for(n = 0; n < unrolled; n += 4) {
+			in[0] = vld1q_f32(&s[i+0][n]);
+			in[1] = vld1q_f32(&s[i+1][n]);
+			in[2] = vld1q_f32(&s[i+2][n]);
+			in[3] = vld1q_f32(&s[i+3][n]);
+
+			transpose_f32(in);
+
+			vst1q_f32(&di[0*n_channels], in[0]);
+			vst1q_f32(&di[1*n_channels], in[1]);
+			vst1q_f32(&di[2*n_channels], in[2]);
+			vst1q_f32(&di[3*n_channels], in[3]);
+			di += 4*n_channels;
+		}
+		for(; n < n_samples; n++) {
+			di[0] = s[i+0][n];
+			di[1] = s[i+1][n];
+			di[2] = s[i+2][n];
+			di[3] = s[i+3][n];
+			di += n_channels;
+		}
+	}
+	for(; i < n_channels; i++) {
+		float *di = &d[i];
+		for(n = 0; n < n_samples; n++) {
+			*di = s[i][n];
+			di += n_channels;
+		}
+	}
+}
@@ -724,3 +724,177 @@ conv_f32d_to_s16_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const voi
 	for(; i < n_channels; i++)
 		conv_f32d_to_s16_1s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
 }
+
+/* like F32_TO_S16_D, the input is clamped before the noise is added and
+ * the result is clamped again */
+static inline __m128i f32_to_s16_dither_sse2(__m128 v, const float *noise)
+{
+	__m128 int_max = _mm_set1_ps(S16_MAX_F);
+	__m128 int_min = _mm_sub_ps(_mm_setzero_ps(), int_max);
+
+	v = _mm_min_ps(_mm_set1_ps(1.0f), _mm_max_ps(v, _mm_set1_ps(-1.0f)));
+	v = _mm_add_ps(_mm_mul_ps(v, int_max), _mm_loadu_ps(noise));
+	v = _mm_min_ps(int_max, _mm_max_ps(v, int_min));
+	return _mm_cvtps_epi32(v);
+}
+
+/* F32_TO_S16_D without the call to lrintf() that would make the compiler
+ * spill the noise pointers in the unrolled loop */
+static inline int16_t f32_to_s16_dither_ss(float v, float noise)
+{
+	__m128 x = _mm_min_ss(_mm_max_ss(_mm_set_ss(v), _mm_set_ss(-1.0f)), _mm_set_ss(1.0f));
+	x = _mm_add_ss(_mm_mul_ss(x, _mm_set_ss(S16_SCALE)), _mm_set_ss(noise));
+	x = _mm_min_ss(_mm_max_ss(x, _mm_set_ss(-S16_MAX_F)), _mm_set_ss(S16_MAX_F));
+	return _mm_cvtss_si32(x);
+}
+
+static void
+conv_f32d_to_s16_dither_1s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *n0;
+	int16_t *d = dst;
+	uint32_t n, chunk, unrolled;
+	__m128i out[2];
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		unrolled = chunk & ~7;
+
+		for(n = 0; n < unrolled; n += 8) {
+			out[0] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s0[n]), &n0[n]);
+			out[1] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s0[n+4]), &n0[n+4]);
+			out[0] = _mm_packs_epi32(out[0], out[1]);
+
+			d[0*n_channels] = _mm_extract_epi16(out[0], 0);
+			d[1*n_channels] = _mm_extract_epi16(out[0], 1);
+			d[2*n_channels] = _mm_extract_epi16(out[0], 2);
+			d[3*n_channels] = _mm_extract_epi16(out[0], 3);
+			d[4*n_channels] = _mm_extract_epi16(out[0], 4);
+			d[5*n_channels] = _mm_extract_epi16(out[0], 5);
+			d[6*n_channels] = _mm_extract_epi16(out[0], 6);
+			d[7*n_channels] = _mm_extract_epi16(out[0], 7);
+			d += 8*n_channels;
+		}
+		for(; n < chunk; n++) {
+			*d = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d += n_channels;
+		}
+		s0 += chunk;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_2s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1], *n0, *n1;
+	int16_t *d = dst;
+	uint32_t n, chunk, unrolled;
+	__m128i out[4], t[2];
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		n1 = dither_noise(conv);
+		unrolled = chunk & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			t[0] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s0[n]), &n0[n]);
+			t[1] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s1[n]), &n1[n]);
+
+			t[0] = _mm_packs_epi32(t[0], t[0]);
+			t[1] = _mm_packs_epi32(t[1], t[1]);
+
+			out[0] = _mm_unpacklo_epi16(t[0], t[1]);
+			out[1] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(0, 3, 2, 1));
+			out[2] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(1, 0, 3, 2));
+			out[3] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(2, 1, 0, 3));
+
+			*((int32_t*)(d + 0*n_channels)) = _mm_cvtsi128_si32(out[0]);
+			*((int32_t*)(d + 1*n_channels)) = _mm_cvtsi128_si32(out[1]);
+			*((int32_t*)(d + 2*n_channels)) = _mm_cvtsi128_si32(out[2]);
+			*((int32_t*)(d + 3*n_channels)) = _mm_cvtsi128_si32(out[3]);
+			d += 4*n_channels;
+		}
+		for(; n < chunk; n++) {
+			d[0] = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d[1] = f32_to_s16_dither_ss(s1[n], n1[n]);
+			d += n_channels;
+		}
+		s0 += chunk;
+		s1 += chunk;
+	}
+}
+
+static void
+conv_f32d_to_s16_dither_4s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	struct convert *conv = data;
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	const float *n0, *n1, *n2, *n3;
+	int16_t *d = dst;
+	uint32_t n, chunk, unrolled;
+	__m128i out[4], t[4];
+
+	for(; n_samples > 0; n_samples -= chunk) {
+		chunk = SPA_MIN(n_samples, NOISE_CHUNK);
+		n0 = dither_noise(conv);
+		n1 = dither_noise(conv);
+		n2 = dither_noise(conv);
+		n3 = dither_noise(conv);
+		unrolled = chunk & ~3;
+
+		for(n = 0; n < unrolled; n += 4) {
+			t[0] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s0[n]), &n0[n]);
+			t[1] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s1[n]), &n1[n]);
+			t[2] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s2[n]), &n2[n]);
+			t[3] = f32_to_s16_dither_sse2(_mm_loadu_ps(&s3[n]), &n3[n]);
+
+			t[0] = _mm_packs_epi32(t[0], t[2]);
+			t[1] = _mm_packs_epi32(t[1], t[3]);
+
+			out[0] = _mm_unpacklo_epi16(t[0], t[1]);
+			out[1] = _mm_unpackhi_epi16(t[0], t[1]);
+			out[2] = _mm_unpacklo_epi32(out[0], out[1]);
+			out[3] = _mm_unpackhi_epi32(out[0], out[1]);
+
+			_mm_storel_pi((__m64*)(d + 0*n_channels), (__m128)out[2]);
+			_mm_storeh_pi((__m64*)(d + 1*n_channels), (__m128)out[2]);
+			_mm_storel_pi((__m64*)(d + 2*n_channels), (__m128)out[3]);
+			_mm_storeh_pi((__m64*)(d + 3*n_channels), (__m128)out[3]);
+
+			d += 4*n_channels;
+		}
+		for(; n < chunk; n++) {
+			d[0] = f32_to_s16_dither_ss(s0[n], n0[n]);
+			d[1] = f32_to_s16_dither_ss(s1[n], n1[n]);
+			d[2] = f32_to_s16_dither_ss(s2[n], n2[n]);
+			d[3] = f32_to_s16_dither_ss(s3[n], n3[n]);
+			d += n_channels;
+		}
+		s0 += chunk;
+		s1 += chunk;
+		s2 += chunk;
+		s3 += chunk;
+	}
+}
+
+void
+conv_f32d_to_s16_dither_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s16_dither_4s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_dither_2s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_dither_1s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+}
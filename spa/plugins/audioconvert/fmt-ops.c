@@ -55,20 +55,52 @@ static struct conv_info conv_table[] =
 
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s16_to_f32_c },
 	{ SPA_AUDIO_FORMAT_S16P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s16d_to_f32d_c },
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_AVX512, conv_s16_to_f32d_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_AVX2, conv_s16_to_f32d_2_avx2 },
+	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s16_to_f32d_avx2 },
+#endif
 #if defined (HAVE_SSE2)
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_SSE2, conv_s16_to_f32d_2_sse2 },
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE2, conv_s16_to_f32d_sse2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_NEON, conv_s16_to_f32d_2_neon },
+	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_s16_to_f32d_neon },
 #endif
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s16_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_S16P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s16d_to_f32_c },
 
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_copy32d_c },
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_AVX512, conv_deinterleave_32_2_avx512 },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 2, SPA_CPU_FLAG_AVX512, conv_interleave_32_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_deinterleave_32_avx2 },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX2, conv_interleave_32_avx2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_deinterleave_32_neon },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_NEON, conv_interleave_32_neon },
+#endif
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_deinterleave_32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_interleave_32_c },
 
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_AVX512, conv_s32_to_f32d_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s32_to_f32d_avx2 },
+#endif
 #if defined (HAVE_SSE2)
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE2, conv_s32_to_f32d_sse2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_s32_to_f32d_neon },
 #endif
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s32_to_f32_c },
 	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s32d_to_f32d_c },
@@ -77,6 +109,9 @@ static struct conv_info conv_table[] =
 
 	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s24_to_f32_c },
 	{ SPA_AUDIO_FORMAT_S24P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s24d_to_f32d_c },
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s24_to_f32d_avx2 },
+#endif
 #if defined (HAVE_SSSE3)
 //	{ SPA_AUDIO_FORMAT_S24, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSSE3, conv_s24_to_f32d_ssse3 },
 #endif
@@ -105,22 +140,45 @@ static struct conv_info conv_table[] =
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S16, 0, 0, conv_f32_to_s16_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16P, 0, 0, conv_f32d_to_s16d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S16P, 0, 0, conv_f32_to_s16d_c },
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 2, SPA_CPU_FLAG_AVX512, conv_f32d_to_s16_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 2, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_2_avx2 },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_avx2 },
+#endif
 #if defined (HAVE_SSE2)
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_SSE2, conv_f32d_to_s16_sse2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 2, SPA_CPU_FLAG_NEON, conv_f32d_to_s16_2_neon },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_NEON, conv_f32d_to_s16_neon },
 #endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, 0, conv_f32d_to_s16_c },
 
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S32, 0, 0, conv_f32_to_s32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_f32d_to_s32d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_f32_to_s32d_c },
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 2, SPA_CPU_FLAG_AVX512, conv_f32d_to_s32_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s32_avx2 },
+#endif
 #if defined (HAVE_SSE2)
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_SSE2, conv_f32d_to_s32_sse2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_NEON, conv_f32d_to_s32_neon },
 #endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, 0, conv_f32d_to_s32_c },
 
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24, 0, 0, conv_f32_to_s24_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24P, 0, 0, conv_f32d_to_s24d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24P, 0, 0, conv_f32_to_s24d_c },
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s24_avx2 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, 0, conv_f32d_to_s24_c },
 
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_f32_to_s24_32_c },
@@ -143,6 +201,18 @@ static struct conv_info conv_table[] =
 	/* s32 */
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_copy32d_c },
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 2, SPA_CPU_FLAG_AVX512, conv_deinterleave_32_2_avx512 },
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 2, SPA_CPU_FLAG_AVX512, conv_interleave_32_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, SPA_CPU_FLAG_AVX2, conv_deinterleave_32_avx2 },
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_AVX2, conv_interleave_32_avx2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, SPA_CPU_FLAG_NEON, conv_deinterleave_32_neon },
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_NEON, conv_interleave_32_neon },
+#endif
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_deinterleave_32_c },
 	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, 0, conv_interleave_32_c },
 
@@ -155,28 +225,91 @@ static struct conv_info conv_table[] =
 	/* s24_32 */
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_copy32d_c },
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 2, SPA_CPU_FLAG_AVX512, conv_deinterleave_32_2_avx512 },
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 2, SPA_CPU_FLAG_AVX512, conv_interleave_32_2_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, SPA_CPU_FLAG_AVX2, conv_deinterleave_32_avx2 },
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_AVX2, conv_interleave_32_avx2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, SPA_CPU_FLAG_NEON, conv_deinterleave_32_neon },
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_NEON, conv_interleave_32_neon },
+#endif
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_deinterleave_32_c },
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_interleave_32_c },
 };
 
+/* rectangular and triangular dither */
+static struct conv_info dither_table[] =
+{
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 2, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_dither_2_avx2 },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_dither_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_SSE2, conv_f32d_to_s16_dither_sse2 },
+#endif
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, 0, conv_f32d_to_s16_dither_c },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, 0, conv_f32d_to_s24_dither_c },
+};
+
+/* triangular dither with noise shaping */
+static struct conv_info shaped_table[] =
+{
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, 0, conv_f32d_to_s16_shaped_c },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24, 0, 0, conv_f32d_to_s24_shaped_c },
+};
+
+/* noise shaping filters, designed for 44.1kHz and usable at 48kHz */
+static const float wannamaker_3[] = { 1.623f, -0.982f, 0.109f };
+static const float lipshitz_5[] = { 2.033f, -2.165f, 1.959f, -1.590f, 0.6149f };
+
+/* fill the noise table with uniform noise of 1 LSB or triangular noise of
+ * 2 LSB, made from the sum of two uniform values. The average is removed so
+ * that the dither does not add an offset. */
+static void init_noise(struct convert *conv)
+{
+	uint32_t i, r;
+	float v, sum = 0.0f;
+
+	conv->random = 0x9e3779b9u;
+
+	for (i = 0; i < NOISE_SIZE; i++) {
+		r = dither_random(&conv->random);
+		v = (int32_t)(r << 16) >> 16;
+		if (conv->method != DITHER_METHOD_RECTANGULAR)
+			v += (int32_t)r >> 16;
+		conv->noise[i] = v * (1.0f / 65536.0f);
+		sum += conv->noise[i];
+	}
+	for (i = 0; i < NOISE_SIZE; i++)
+		conv->noise[i] -= sum / NOISE_SIZE;
+	for (i = 0; i < NOISE_CHUNK; i++)
+		conv->noise[NOISE_SIZE + i] = conv->noise[i];
+}
+
 #define MATCH_CHAN(a,b)		((a) == 0 || (a) == (b))
 #define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
 
-static const struct conv_info *find_conv_info(uint32_t src_fmt, uint32_t dst_fmt,
-		uint32_t n_channels, uint32_t cpu_flags)
+static const struct conv_info *find_info(const struct conv_info *table, size_t n_table,
+		uint32_t src_fmt, uint32_t dst_fmt, uint32_t n_channels, uint32_t cpu_flags)
 {
 	size_t i;
 
-	for (i = 0; i < SPA_N_ELEMENTS(conv_table); i++) {
-		if (conv_table[i].src_fmt == src_fmt &&
-		    conv_table[i].dst_fmt == dst_fmt &&
-		    MATCH_CHAN(conv_table[i].n_channels, n_channels) &&
-		    MATCH_CPU_FLAGS(conv_table[i].cpu_flags, cpu_flags))
-			return &conv_table[i];
+	for (i = 0; i < n_table; i++) {
+		if (table[i].src_fmt == src_fmt &&
+		    table[i].dst_fmt == dst_fmt &&
+		    MATCH_CHAN(table[i].n_channels, n_channels) &&
+		    MATCH_CPU_FLAGS(table[i].cpu_flags, cpu_flags))
+			return &table[i];
 	}
 	return NULL;
 }
 
+#define find_conv_info(table,...)	find_info(table, SPA_N_ELEMENTS(table), __VA_ARGS__)
+
 static void impl_convert_free(struct convert *conv)
 {
 	conv->process = NULL;
@@ -184,12 +317,49 @@ static void impl_convert_free(struct convert *conv)
 
 int convert_init(struct convert *conv)
 {
-	const struct conv_info *info;
-
-	info = find_conv_info(conv->src_fmt, conv->dst_fmt, conv->n_channels, conv->cpu_flags);
+	const struct conv_info *info = NULL;
+
+	/* the shaper keeps the error history of each channel */
+	if (conv->method >= DITHER_METHOD_WANNAMAKER_3 && conv->n_channels > MAX_NS)
+		conv->method = DITHER_METHOD_TRIANGULAR;
+
+	if (conv->method >= DITHER_METHOD_WANNAMAKER_3)
+		info = find_conv_info(shaped_table, conv->src_fmt, conv->dst_fmt,
+				conv->n_channels, conv->cpu_flags);
+	if (info == NULL && conv->method != DITHER_METHOD_NONE) {
+		if (conv->method >= DITHER_METHOD_WANNAMAKER_3)
+			conv->method = DITHER_METHOD_TRIANGULAR;
+		info = find_conv_info(dither_table, conv->src_fmt, conv->dst_fmt,
+				conv->n_channels, conv->cpu_flags);
+	}
+	if (info == NULL) {
+		/* only the conversions to 16 and 24 bits are dithered */
+		conv->method = DITHER_METHOD_NONE;
+		info = find_conv_info(conv_table, conv->src_fmt, conv->dst_fmt,
+				conv->n_channels, conv->cpu_flags);
+	}
 	if (info == NULL)
 		return -ENOTSUP;
 
+	if (conv->method != DITHER_METHOD_NONE)
+		init_noise(conv);
+
+	switch (conv->method) {
+	case DITHER_METHOD_WANNAMAKER_3:
+		conv->ns = wannamaker_3;
+		conv->n_ns = SPA_N_ELEMENTS(wannamaker_3);
+		break;
+	case DITHER_METHOD_LIPSHITZ_5:
+		conv->ns = lipshitz_5;
+		conv->n_ns = SPA_N_ELEMENTS(lipshitz_5);
+		break;
+	default:
+		conv->ns = NULL;
+		conv->n_ns = 0;
+		break;
+	}
+	memset(conv->shaper, 0, sizeof(conv->shaper));
+
 	conv->is_passthrough = conv->src_fmt == conv->dst_fmt;
 	conv->cpu_flags = info->cpu_flags;
 	conv->process = info->process;
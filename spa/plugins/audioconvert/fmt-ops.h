@@ -25,6 +25,7 @@
 #include <math.h>
 
 #include <spa/utils/defs.h>
+#include <spa/param/audio/dither.h>
 
 #define U8_MIN		0
 #define U8_MAX		255
@@ -101,18 +102,49 @@ static inline void write_s24s(void *dst, int32_t val)
 #endif
 }
 
+/* with dither d in LSB units, rounds to the nearest value */
+#define F32_TO_S16_D(v,d)	(int16_t)SPA_CLAMP(lrintf(SPA_CLAMP(v, -1.0f, 1.0f) * S16_SCALE + (d)), S16_MIN, S16_MAX)
+#define F32_TO_S24_D(v,d)	(int32_t)SPA_CLAMP(lrintf(SPA_CLAMP(v, -1.0f, 1.0f) * S24_SCALE + (d)), S24_MIN, S24_MAX)
+
+enum dither_method {
+	DITHER_METHOD_NONE = SPA_AUDIO_DITHER_NONE,
+	DITHER_METHOD_RECTANGULAR = SPA_AUDIO_DITHER_RECTANGULAR,	/* 1 LSB uniform noise */
+	DITHER_METHOD_TRIANGULAR = SPA_AUDIO_DITHER_TRIANGULAR,		/* 2 LSB triangular (TPDF) noise */
+	DITHER_METHOD_WANNAMAKER_3 = SPA_AUDIO_DITHER_WANNAMAKER_3,	/* TPDF with 3 tap noise shaping */
+	DITHER_METHOD_LIPSHITZ_5 = SPA_AUDIO_DITHER_LIPSHITZ_5,		/* TPDF with 5 tap noise shaping */
+};
+
 #define MAX_NS	64
+#define NS_MAX	8
+#define NS_MASK	(NS_MAX - 1)
+
+/* quantization error history of one channel. Every error is stored twice
+ * so that the last n_ns errors can always be read from e[idx] onwards. */
+struct shaper {
+	float e[NS_MAX * 2];
+	uint32_t idx;
+};
+
+#define NOISE_SIZE	4096
+#define NOISE_CHUNK	512u
 
 struct convert {
 	uint32_t src_fmt;
 	uint32_t dst_fmt;
 	uint32_t n_channels;
 	uint32_t cpu_flags;
+	uint32_t method;
 
 	unsigned int is_passthrough:1;
-	float ns_data[MAX_NS];
-	uint32_t ns_idx;
-	uint32_t ns_size;
+
+	/* NOISE_SIZE values of dither noise in LSB units followed by a copy
+	 * of the first NOISE_CHUNK values, so that a chunk of noise can be
+	 * read from any offset in the table */
+	float noise[NOISE_SIZE + NOISE_CHUNK];
+	uint32_t random;
+	const float *ns;
+	uint32_t n_ns;
+	struct shaper shaper[MAX_NS];
 
 	void (*process) (struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
 			uint32_t n_samples);
@@ -121,6 +153,25 @@ struct convert {
 
 int convert_init(struct convert *conv);
 
+/* xorshift32 */
+static inline uint32_t dither_random(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* NOISE_CHUNK values of noise from a random place in the table. Generating
+ * the noise for each sample costs more than the conversion itself, reading
+ * it at a new offset for every chunk and channel is almost free and still
+ * uncorrelated between the channels. */
+static inline const float *dither_noise(struct convert *conv)
+{
+	return &conv->noise[dither_random(&conv->random) & (NOISE_SIZE - 1)];
+}
+
 #define convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
 #define convert_free(conv)		(conv)->free(conv)
 
@@ -185,6 +236,10 @@ DEFINE_FUNCTION(interleave_8, c);
 DEFINE_FUNCTION(interleave_16, c);
 DEFINE_FUNCTION(interleave_24, c);
 DEFINE_FUNCTION(interleave_32, c);
+DEFINE_FUNCTION(f32d_to_s16_dither, c);
+DEFINE_FUNCTION(f32d_to_s24_dither, c);
+DEFINE_FUNCTION(f32d_to_s16_shaped, c);
+DEFINE_FUNCTION(f32d_to_s24_shaped, c);
 
 #if defined(HAVE_SSE2)
 DEFINE_FUNCTION(s16_to_f32d_2, sse2);
@@ -193,11 +248,44 @@ DEFINE_FUNCTION(s24_to_f32d, sse2);
 DEFINE_FUNCTION(s32_to_f32d, sse2);
 DEFINE_FUNCTION(f32d_to_s32, sse2);
 DEFINE_FUNCTION(f32d_to_s16, sse2);
+DEFINE_FUNCTION(f32d_to_s16_dither, sse2);
 #endif
 #if defined(HAVE_SSSE3)
 DEFINE_FUNCTION(s24_to_f32d, ssse3);
 #endif
 #if defined(HAVE_SSE41)
 DEFINE_FUNCTION(s24_to_f32d, sse41);
+#endif
+#if defined(HAVE_NEON)
+DEFINE_FUNCTION(s16_to_f32d_2, neon);
+DEFINE_FUNCTION(s16_to_f32d, neon);
+DEFINE_FUNCTION(s32_to_f32d, neon);
+DEFINE_FUNCTION(f32d_to_s16_2, neon);
+DEFINE_FUNCTION(f32d_to_s16, neon);
+DEFINE_FUNCTION(f32d_to_s32, neon);
+DEFINE_FUNCTION(deinterleave_32, neon);
+DEFINE_FUNCTION(interleave_32, neon);
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(s16_to_f32d_2, avx2);
+DEFINE_FUNCTION(s16_to_f32d, avx2);
+DEFINE_FUNCTION(s24_to_f32d, avx2);
+DEFINE_FUNCTION(s32_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_s16_2, avx2);
+DEFINE_FUNCTION(f32d_to_s16, avx2);
+DEFINE_FUNCTION(f32d_to_s16_dither_2, avx2);
+DEFINE_FUNCTION(f32d_to_s16_dither, avx2);
+DEFINE_FUNCTION(f32d_to_s24, avx2);
+DEFINE_FUNCTION(f32d_to_s32, avx2);
+DEFINE_FUNCTION(deinterleave_32, avx2);
+DEFINE_FUNCTION(interleave_32, avx2);
+#endif
+#if defined(HAVE_AVX512)
+DEFINE_FUNCTION(s16_to_f32d_2, avx512);
+DEFINE_FUNCTION(s32_to_f32d_2, avx512);
+DEFINE_FUNCTION(f32d_to_s16_2, avx512);
+DEFINE_FUNCTION(f32d_to_s32_2, avx512);
+DEFINE_FUNCTION(deinterleave_32_2, avx512);
+DEFINE_FUNCTION(interleave_32_2, avx512);
 
 #endif
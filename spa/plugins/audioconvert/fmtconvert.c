@@ -30,6 +30,7 @@
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/cpu.h>
+#include <spa/support/loop.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
 #include <spa/node/node.h>
@@ -42,6 +43,7 @@
 #include <spa/debug/format.h>
 
 #include "fmt-ops.h"
+#include "stage.h"
 
 #define NAME "fmtconvert"
 
@@ -55,19 +57,39 @@
 #define MAX_PORTS	128
 
 #define PROP_DEFAULT_TRUNCATE	false
-#define PROP_DEFAULT_DITHER	0
+#define PROP_DEFAULT_DITHER	DITHER_METHOD_TRIANGULAR
 
 struct impl;
 
 struct props {
 	bool truncate;
 	uint32_t dither;
+	unsigned int dither_set:1;
 };
 
 static void props_reset(struct props *props)
 {
 	props->truncate = PROP_DEFAULT_TRUNCATE;
 	props->dither = PROP_DEFAULT_DITHER;
+	props->dither_set = false;
+}
+
+static const char * const dither_methods[] = {
+	[DITHER_METHOD_NONE] = "none",
+	[DITHER_METHOD_RECTANGULAR] = "rectangular",
+	[DITHER_METHOD_TRIANGULAR] = "triangular",
+	[DITHER_METHOD_WANNAMAKER_3] = "wannamaker3",
+	[DITHER_METHOD_LIPSHITZ_5] = "lipshitz5",
+};
+
+static int dither_method_from_label(const char *label)
+{
+	uint32_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(dither_methods); i++) {
+		if (strcmp(label, dither_methods[i]) == 0)
+			return i;
+	}
+	return -EINVAL;
 }
 
 struct buffer {
@@ -108,6 +130,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_loop *data_loop;
 
 	struct spa_io_position *io_position;
 
@@ -124,6 +147,7 @@ struct impl {
 
 	uint32_t cpu_flags;
 	struct convert conv;
+	struct stage stage;
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
 };
@@ -142,6 +166,15 @@ static int can_convert(const struct spa_audio_info *info1, const struct spa_audi
 	return 1;
 }
 
+/* the default dither is only useful for 16 bits, the noise floor of
+ * 24 bits is below that of the DAC */
+static uint32_t dither_method(struct impl *this)
+{
+	if (this->conv.dst_fmt == SPA_AUDIO_FORMAT_S16 || this->props.dither_set)
+		return this->props.dither;
+	return DITHER_METHOD_NONE;
+}
+
 static int setup_convert(struct impl *this)
 {
 	uint32_t src_fmt, dst_fmt;
@@ -190,18 +223,29 @@ static int setup_convert(struct impl *this)
 	this->conv.dst_fmt = dst_fmt;
 	this->conv.n_channels = outformat.info.raw.channels;
 	this->conv.cpu_flags = this->cpu_flags;
+	this->conv.method = dither_method(this);
 
 	if ((res = convert_init(&this->conv)) < 0)
 		return res;
 
-	spa_log_debug(this->log, NAME " %p: got converter features %08x:%08x", this,
-			this->cpu_flags, this->conv.cpu_flags);
+	spa_log_debug(this->log, NAME " %p: got converter features %08x:%08x dither %s", this,
+			this->cpu_flags, this->conv.cpu_flags, dither_methods[this->conv.method]);
 
 	this->is_passthrough = this->conv.is_passthrough;
 
+	this->stage.src_stride = inport->stride;
+	this->stage.dst_stride = outport->stride;
+
 	return 0;
 }
 
+static void stage_process(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	struct impl *this = data;
+	convert_process(&this->conv, dst, src, n_samples);
+}
+
 static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
@@ -209,10 +253,74 @@ static int impl_node_enum_params(void *object, int seq,
 	return -ENOTSUP;
 }
 
+/* the converter is only touched from the data loop */
+static int do_update_dither(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	uint32_t method = *(const uint32_t *)data;
+	int res;
+
+	this->conv.cpu_flags = this->cpu_flags;
+	this->conv.method = method;
+	if ((res = convert_init(&this->conv)) < 0)
+		return res;
+
+	spa_log_debug(this->log, NAME " %p: dither %s", this,
+			dither_methods[this->conv.method]);
+	return 0;
+}
+
+static int apply_props(struct impl *this, const struct spa_pod *param)
+{
+	struct spa_pod_prop *prop;
+	struct spa_pod_object *obj = (struct spa_pod_object *) param;
+	struct props *p = &this->props;
+	uint32_t method;
+	bool changed = false;
+
+	SPA_POD_OBJECT_FOREACH(obj, prop) {
+		switch (prop->key) {
+		case SPA_PROP_ditherType:
+			if (spa_pod_get_id(&prop->value, &method) != 0)
+				break;
+			if (method >= SPA_N_ELEMENTS(dither_methods)) {
+				spa_log_warn(this->log, NAME " %p: unknown dither method %u",
+						this, method);
+				break;
+			}
+			p->dither = method;
+			p->dither_set = true;
+			changed = true;
+			break;
+		default:
+			break;
+		}
+	}
+	if (!changed || this->conv.process == NULL)
+		return 0;
+
+	method = dither_method(this);
+	if (this->data_loop)
+		return spa_loop_invoke(this->data_loop, do_update_dither,
+				SPA_ID_INVALID, &method, sizeof(method), true, this);
+	return do_update_dither(NULL, false, SPA_ID_INVALID,
+			&method, sizeof(method), this);
+}
+
 static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 			       const struct spa_pod *param)
 {
-	return -ENOTSUP;
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	switch (id) {
+	case SPA_PARAM_Props:
+		return apply_props(this, param);
+	default:
+		return -ENOTSUP;
+	}
 }
 
 static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
@@ -818,7 +926,7 @@ static int impl_node_process(void *object)
 	void **dst_datas;
 	uint32_t i, n_src_datas, n_dst_datas;
 	int res = 0;
-	uint32_t n_samples, size, maxsize, offs;
+	uint32_t n_samples, size, maxsize, offs, flags;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -859,10 +967,12 @@ static int impl_node_process(void *object)
 	src_datas = alloca(sizeof(void*) * n_src_datas);
 
 	size = UINT32_MAX;
+	flags = SPA_CHUNK_FLAG_EMPTY;
 	for (i = 0; i < n_src_datas; i++) {
 		offs = SPA_MIN(inb->datas[i].chunk->offset, inb->datas[i].maxsize);
 		size = SPA_MIN(size, SPA_MIN(inb->datas[i].maxsize - offs, inb->datas[i].chunk->size));
 		src_datas[i] = SPA_MEMBER(inb->datas[i].data, offs, void);
+		flags &= inb->datas[i].chunk->flags;
 	}
 	n_samples = size / inport->stride;
 
@@ -885,10 +995,16 @@ static int impl_node_process(void *object)
 		outb->datas[this->remap[i]].data = dst_datas[i];
 		outb->datas[i].chunk->offset = 0;
 		outb->datas[i].chunk->size = n_samples * outport->stride;
+		outb->datas[i].chunk->flags = flags;
 	}
 
-	if (!this->is_passthrough)
-		convert_process(&this->conv, dst_datas, src_datas, n_samples);
+	if (!this->is_passthrough) {
+		if (stage_defer(&this->stage))
+			stage_record(&this->stage, n_dst_datas, dst_datas,
+					n_src_datas, src_datas, n_samples);
+		else
+			convert_process(&this->conv, dst_datas, src_datas, n_samples);
+	}
 
 	inio->status = SPA_STATUS_NEED_DATA;
 	res |= SPA_STATUS_NEED_DATA;
@@ -929,6 +1045,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, SPA_TYPE_INTERFACE_AudioConvertStage) == 0)
+		*interface = &this->stage;
 	else
 		return -ENOENT;
 
@@ -980,6 +1098,7 @@ impl_init(const struct spa_handle_factory *factory,
 	  uint32_t n_support)
 {
 	struct impl *this;
+	const char *str;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -991,6 +1110,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 
 	if (this->cpu)
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
@@ -1008,6 +1128,21 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.n_params = 0;
 	props_reset(&this->props);
 
+	/* the initial dither method, it can be changed with SPA_PROP_ditherType */
+	if (info != NULL && (str = spa_dict_lookup(info, "dither.method")) != NULL) {
+		int method = dither_method_from_label(str);
+		if (method < 0)
+			spa_log_warn(this->log, NAME " %p: unknown dither method '%s'", this, str);
+		else {
+			this->props.dither = method;
+			this->props.dither_set = true;
+		}
+	}
+
+	this->stage.process = stage_process;
+	this->stage.data = this;
+	this->stage.can_defer = true;
+
 	init_port(this, SPA_DIRECTION_OUTPUT, 0);
 	init_port(this, SPA_DIRECTION_INPUT, 0);
 
@@ -945,7 +945,7 @@ static int impl_node_process(void *object)
 	struct impl *this = object;
 	struct port *outport;
 	struct spa_io_buffers *outio;
-	uint32_t i, maxsize, n_samples;
+	uint32_t i, maxsize, n_samples, flags;
 	struct spa_data *sd, *dd;
 	struct buffer *sbuf, *dbuf;
 	uint32_t n_src_datas, n_dst_datas;
@@ -978,6 +978,7 @@ static int impl_node_process(void *object)
 
 	/* produce more output if possible */
 	n_src_datas = 0;
+	flags = SPA_CHUNK_FLAG_EMPTY;
 	for (i = 0; i < this->port_count; i++) {
 		struct port *inport = GET_IN_PORT(this, i);
 
@@ -991,6 +992,7 @@ static int impl_node_process(void *object)
 		src_datas[n_src_datas++] = SPA_MEMBER(sd->data, sd->chunk->offset, void);
 
 		n_samples = SPA_MIN(n_samples, sd->chunk->size / inport->stride);
+		flags &= sd->chunk->flags;
 
 		spa_log_trace_fp(this->log, NAME " %p: %d %d %d %p", this,
 				sd->chunk->size, maxsize, n_samples, src_datas[i]);
@@ -1006,6 +1008,7 @@ static int impl_node_process(void *object)
 		dbuf->buf->datas[i].data = dst_datas[i];
 		dbuf->buf->datas[i].chunk->offset = 0;
 		dbuf->buf->datas[i].chunk->size = n_samples * outport->stride;
+		dbuf->buf->datas[i].chunk->flags = flags;
 		spa_log_trace_fp(this->log, NAME " %p %p %d", this, dst_datas[i],
 				n_samples * outport->stride);
 	}
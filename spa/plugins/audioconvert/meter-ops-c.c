@@ -0,0 +1,60 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "meter-ops.h"
+
+static inline void peak_rms_c(const float * SPA_RESTRICT s, uint32_t n_samples,
+		float *peak, double *sum)
+{
+	uint32_t n;
+	float p = *peak, t = 0.0f;
+
+	for (n = 0; n < n_samples; n++) {
+		p = SPA_MAX(p, fabsf(s[n]));
+		t += s[n] * s[n];
+	}
+	*peak = p;
+	*sum += t;
+}
+
+static inline float true_peak_c(struct meter *m, const float * SPA_RESTRICT s,
+		uint32_t n_samples, float tp)
+{
+	uint32_t n, i, j;
+
+	for (n = 0; n < n_samples; n++) {
+		const float *x = &s[n];
+		float v[METER_TP_PHASES] = { 0.0f, };
+
+		for (i = 0; i < METER_TP_TAPS; i++)
+			for (j = 0; j < METER_TP_PHASES; j++)
+				v[j] += *(x - i) * m->taps[i][j];
+		for (j = 0; j < METER_TP_PHASES; j++)
+			tp = SPA_MAX(tp, fabsf(v[j]));
+	}
+	return tp;
+}
+
+MAKE_METER(c);
+MAKE_METER_TP(c);
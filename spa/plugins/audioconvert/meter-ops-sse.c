@@ -0,0 +1,109 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "meter-ops.h"
+
+#include <xmmintrin.h>
+
+static inline float hmax_ps(__m128 val)
+{
+	__m128 t = _mm_movehl_ps(val, val);
+	t = _mm_max_ps(t, val);
+	val = _mm_shuffle_ps(t, t, 0x55);
+	val = _mm_max_ss(t, val);
+	return _mm_cvtss_f32(val);
+}
+
+static inline float hsum_ps(__m128 val)
+{
+	__m128 t = _mm_movehl_ps(val, val);
+	t = _mm_add_ps(t, val);
+	val = _mm_shuffle_ps(t, t, 0x55);
+	val = _mm_add_ss(t, val);
+	return _mm_cvtss_f32(val);
+}
+
+static inline void peak_rms_sse(const float * SPA_RESTRICT s, uint32_t n_samples,
+		float *peak, double *sum)
+{
+	uint32_t n, unrolled = n_samples & ~7;
+	__m128 sign = _mm_set1_ps(-0.0f), in[2];
+	__m128 max[2] = { _mm_set1_ps(*peak), _mm_setzero_ps() };
+	__m128 sq[2] = { _mm_setzero_ps(), _mm_setzero_ps() };
+	float p, t;
+
+	for (n = 0; n < unrolled; n += 8) {
+		in[0] = _mm_loadu_ps(&s[n + 0]);
+		in[1] = _mm_loadu_ps(&s[n + 4]);
+		sq[0] = _mm_add_ps(sq[0], _mm_mul_ps(in[0], in[0]));
+		sq[1] = _mm_add_ps(sq[1], _mm_mul_ps(in[1], in[1]));
+		max[0] = _mm_max_ps(max[0], _mm_andnot_ps(sign, in[0]));
+		max[1] = _mm_max_ps(max[1], _mm_andnot_ps(sign, in[1]));
+	}
+	p = hmax_ps(_mm_max_ps(max[0], max[1]));
+	t = hsum_ps(_mm_add_ps(sq[0], sq[1]));
+	for (; n < n_samples; n++) {
+		p = SPA_MAX(p, fabsf(s[n]));
+		t += s[n] * s[n];
+	}
+	*peak = p;
+	*sum += t;
+}
+
+/* 4 consecutive samples are interpolated at a time, with an accumulator
+ * for each phase */
+static inline float true_peak_sse(struct meter *m, const float * SPA_RESTRICT s,
+		uint32_t n_samples, float tp)
+{
+	uint32_t n, i, j, unrolled = n_samples & ~3;
+	__m128 sign = _mm_set1_ps(-0.0f), max = _mm_set1_ps(tp), in, v[METER_TP_PHASES];
+
+	for (n = 0; n < unrolled; n += 4) {
+		const float *x = &s[n];
+
+		for (j = 0; j < METER_TP_PHASES; j++)
+			v[j] = _mm_setzero_ps();
+		for (i = 0; i < METER_TP_TAPS; i++) {
+			in = _mm_loadu_ps(x - i);
+			for (j = 0; j < METER_TP_PHASES; j++)
+				v[j] = _mm_add_ps(v[j], _mm_mul_ps(in,
+							_mm_load1_ps(&m->taps[i][j])));
+		}
+		for (j = 0; j < METER_TP_PHASES; j++)
+			max = _mm_max_ps(max, _mm_andnot_ps(sign, v[j]));
+	}
+	for (; n < n_samples; n++) {
+		const float *x = &s[n];
+		__m128 t = _mm_setzero_ps();
+
+		for (i = 0; i < METER_TP_TAPS; i++)
+			t = _mm_add_ps(t, _mm_mul_ps(_mm_load1_ps(x - i),
+						_mm_load_ps(m->taps[i])));
+		max = _mm_max_ps(max, _mm_andnot_ps(sign, t));
+	}
+	return hmax_ps(max);
+}
+
+MAKE_METER(sse);
+MAKE_METER_TP(sse);
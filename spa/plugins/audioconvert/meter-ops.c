@@ -0,0 +1,145 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <errno.h>
+
+#include <spa/support/cpu.h>
+#include <spa/support/log.h>
+#include <spa/utils/defs.h>
+
+#include "meter-ops.h"
+
+typedef void (*meter_func_t) (struct meter *m, uint32_t n_src,
+		const void * SPA_RESTRICT src[n_src], uint32_t n_samples);
+
+static const struct meter_info {
+	meter_func_t process;
+	uint32_t options;
+	uint32_t cpu_flags;
+} meter_table[] =
+{
+#if defined (HAVE_AVX2)
+	{ meter_f32_tp_avx2, METER_OPTION_TRUE_PEAK, SPA_CPU_FLAG_AVX2 },
+	{ meter_f32_avx2, 0, SPA_CPU_FLAG_AVX2 },
+#endif
+#if defined (HAVE_SSE)
+	{ meter_f32_tp_sse, METER_OPTION_TRUE_PEAK, SPA_CPU_FLAG_SSE },
+	{ meter_f32_sse, 0, SPA_CPU_FLAG_SSE },
+#endif
+	{ meter_f32_tp_c, METER_OPTION_TRUE_PEAK, 0 },
+	{ meter_f32_c, 0, 0 },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct meter_info *find_meter_info(uint32_t options, uint32_t cpu_flags)
+{
+	size_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(meter_table); i++) {
+		if (!MATCH_CPU_FLAGS(meter_table[i].cpu_flags, cpu_flags))
+			continue;
+		if (meter_table[i].options == (options & METER_OPTION_TRUE_PEAK))
+			return &meter_table[i];
+	}
+	return NULL;
+}
+
+static inline double blackman(double x, double n_taps)
+{
+	double w = 2.0 * M_PI / n_taps;
+	x += n_taps / 2.0;
+	return 0.42 - 0.5 * cos(x * w) + 0.08 * cos(2.0 * x * w);
+}
+
+static inline double sinc(double x)
+{
+	if (x == 0.0)
+		return 1.0;
+	x *= M_PI;
+	return sin(x) / x;
+}
+
+/* phase p interpolates the sample at p/METER_TP_PHASES after the input
+ * sample METER_TP_TAPS/2-1 back in time, phase 0 passes that sample
+ * unmodified. */
+static void build_taps(struct meter *m)
+{
+	uint32_t i, j;
+	double half = METER_TP_TAPS / 2.0;
+
+	for (j = 0; j < METER_TP_PHASES; j++) {
+		double sum = 0.0;
+
+		for (i = 0; i < METER_TP_TAPS; i++) {
+			double x = (double)i - (half - 1.0) + (double)j / METER_TP_PHASES;
+			double v = 0.0;
+
+			if (fabs(x) < half)
+				v = sinc(x) * blackman(x, 2.0 * half);
+			m->taps[i][j] = v;
+			sum += v;
+		}
+		for (i = 0; i < METER_TP_TAPS; i++)
+			m->taps[i][j] /= sum;
+	}
+}
+
+static void impl_meter_reset(struct meter *m)
+{
+	m->n_samples = 0;
+	memset(m->peak, 0, sizeof(m->peak));
+	memset(m->true_peak, 0, sizeof(m->true_peak));
+	memset(m->sum, 0, sizeof(m->sum));
+}
+
+static void impl_meter_free(struct meter *m)
+{
+	m->process = NULL;
+}
+
+int meter_init(struct meter *m)
+{
+	const struct meter_info *info;
+
+	if (m->channels > SPA_AUDIO_MAX_CHANNELS)
+		return -EINVAL;
+
+	info = find_meter_info(m->options, m->cpu_flags);
+	if (info == NULL)
+		return -ENOTSUP;
+
+	m->process = info->process;
+	m->reset = impl_meter_reset;
+	m->free = impl_meter_free;
+	m->cpu_flags = info->cpu_flags;
+
+	build_taps(m);
+	memset(m->hist, 0, sizeof(m->hist));
+	impl_meter_reset(m);
+
+	return 0;
+}
@@ -0,0 +1,132 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+#include <spa/param/audio/raw.h>
+
+/* true peak is measured by 4x oversampling with a 4 phase polyphase
+ * filter of METER_TP_TAPS taps per phase */
+#define METER_TP_PHASES	4
+#define METER_TP_TAPS	12
+
+struct meter {
+	uint32_t channels;
+	uint32_t cpu_flags;
+#define METER_OPTION_TRUE_PEAK	(1<<0)
+	uint32_t options;
+
+	struct spa_log *log;
+
+	void (*process) (struct meter *m, uint32_t n_src,
+			const void * SPA_RESTRICT src[n_src], uint32_t n_samples);
+	void (*reset) (struct meter *m);
+	void (*free) (struct meter *m);
+
+	/* accumulated over the current window */
+	uint32_t n_samples;
+	float peak[SPA_AUDIO_MAX_CHANNELS];
+	float true_peak[SPA_AUDIO_MAX_CHANNELS];
+	double sum[SPA_AUDIO_MAX_CHANNELS];
+
+	/* filter taps, interleaved per tap for the phases */
+	float taps[METER_TP_TAPS][METER_TP_PHASES] SPA_ALIGNED(16);
+	/* the last METER_TP_TAPS-1 samples of each channel, followed by
+	 * room to stitch them to the start of the next block */
+	float hist[SPA_AUDIO_MAX_CHANNELS][METER_TP_TAPS * 2] SPA_ALIGNED(16);
+};
+
+int meter_init(struct meter *m);
+
+/** the rms of a channel over the current window */
+static inline float meter_rms(struct meter *m, uint32_t channel)
+{
+	return m->n_samples ? (float)sqrt(m->sum[channel] / m->n_samples) : 0.0f;
+}
+
+#define meter_process(m,...)	(m)->process(m, __VA_ARGS__)
+#define meter_reset(m)		(m)->reset(m)
+#define meter_free(m)		(m)->free(m)
+
+#define DEFINE_FUNCTION(name,arch)					\
+void meter_##name##_##arch(struct meter *m, uint32_t n_src,		\
+		const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
+
+/* The kernels accumulate the squares of a block in float and only add
+ * the block result to the double precision window sum. A block is at
+ * most one graph cycle so the float sum does not lose precision.
+ *
+ * arch needs to provide peak_rms_##arch() and true_peak_##arch(). The
+ * latter reads METER_TP_TAPS-1 samples before its input, for the first
+ * samples of a block those come from the history. */
+#define MAKE_METER(arch)						\
+DEFINE_FUNCTION(f32,arch)						\
+{									\
+	uint32_t c;							\
+	for (c = 0; c < n_src; c++)					\
+		peak_rms_##arch(src[c], n_samples,			\
+				&m->peak[c], &m->sum[c]);		\
+	m->n_samples += n_samples;					\
+}
+
+#define MAKE_METER_TP(arch)						\
+DEFINE_FUNCTION(f32_tp,arch)						\
+{									\
+	uint32_t c, n_head, n_hist = METER_TP_TAPS - 1;			\
+	for (c = 0; c < n_src; c++) {					\
+		const float *s = src[c];				\
+		float *h = m->hist[c], tp = m->true_peak[c];		\
+									\
+		peak_rms_##arch(s, n_samples, &m->peak[c], &m->sum[c]);\
+									\
+		n_head = SPA_MIN(n_samples, n_hist);			\
+		memcpy(&h[n_hist], s, n_head * sizeof(float));		\
+		tp = true_peak_##arch(m, &h[n_hist], n_head, tp);	\
+		tp = true_peak_##arch(m, &s[n_head],			\
+				n_samples - n_head, tp);		\
+		m->true_peak[c] = tp;					\
+									\
+		if (n_samples >= n_hist)				\
+			memcpy(h, &s[n_samples - n_hist],		\
+					n_hist * sizeof(float));	\
+		else							\
+			memmove(h, &h[n_samples],			\
+					n_hist * sizeof(float));	\
+	}								\
+	m->n_samples += n_samples;					\
+}
+
+DEFINE_FUNCTION(f32, c);
+DEFINE_FUNCTION(f32_tp, c);
+
+#if defined (HAVE_SSE)
+DEFINE_FUNCTION(f32, sse);
+DEFINE_FUNCTION(f32_tp, sse);
+#endif
+#if defined (HAVE_AVX2)
+DEFINE_FUNCTION(f32, avx2);
+DEFINE_FUNCTION(f32_tp, avx2);
+#endif
@@ -33,6 +33,7 @@ extern const struct spa_handle_factory spa_resample_factory;
 extern const struct spa_handle_factory spa_splitter_factory;
 extern const struct spa_handle_factory spa_merger_factory;
 extern const struct spa_handle_factory spa_audioadapter_factory;
+extern const struct spa_handle_factory spa_meter_factory;
 
 SPA_EXPORT
 int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t *index)
@@ -62,6 +63,9 @@ int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t
 	case 6:
 		*factory = &spa_audioadapter_factory;
 		break;
+	case 7:
+		*factory = &spa_meter_factory;
+		break;
 	default:
 		return 0;
 	}
@@ -0,0 +1,207 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "resample-native-impl.h"
+
+#include <immintrin.h>
+
+/* n_taps is a multiple of 8, the last block of 16 is loaded with a mask
+ * when it is not complete. The filter is 64 byte aligned so the taps can
+ * use aligned loads. */
+static inline __mmask16 tail_mask(uint32_t remain)
+{
+	return remain >= 16 ? 0xffff : 0x00ff;
+}
+
+static inline void inner_product_avx512(float *d, const float * SPA_RESTRICT s,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	__m512 sy[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() };
+	uint32_t i = 0, n_taps32 = n_taps & ~31;
+
+	for (; i < n_taps32; i += 32) {
+		sy[0] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i + 0),
+				_mm512_load_ps(taps + i + 0), sy[0]);
+		sy[1] = _mm512_fmadd_ps(_mm512_loadu_ps(s + i + 16),
+				_mm512_load_ps(taps + i + 16), sy[1]);
+	}
+	for (; i < n_taps; i += 16) {
+		__mmask16 m = tail_mask(n_taps - i);
+		sy[0] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, s + i),
+				_mm512_maskz_load_ps(m, taps + i), sy[0]);
+	}
+	*d = _mm512_reduce_add_ps(_mm512_add_ps(sy[0], sy[1]));
+}
+
+/* two channels at the same position share the tap loads */
+static inline void inner_product2_avx512(float *d0, float *d1,
+		const float * SPA_RESTRICT s0, const float * SPA_RESTRICT s1,
+		const float * SPA_RESTRICT taps, uint32_t n_taps)
+{
+	__m512 sy[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() }, t;
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 16) {
+		__mmask16 m = tail_mask(n_taps - i);
+		t = _mm512_maskz_load_ps(m, taps + i);
+		sy[0] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, s0 + i), t, sy[0]);
+		sy[1] = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(m, s1 + i), t, sy[1]);
+	}
+	*d0 = _mm512_reduce_add_ps(sy[0]);
+	*d1 = _mm512_reduce_add_ps(sy[1]);
+}
+
+static inline void inner_product_ip_avx512(float *d, const float * SPA_RESTRICT s,
+	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
+	uint32_t n_taps)
+{
+	__m512 sy[2] = { _mm512_setzero_ps(), _mm512_setzero_ps() }, ty;
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 16) {
+		__mmask16 m = tail_mask(n_taps - i);
+		ty = _mm512_maskz_loadu_ps(m, s + i);
+		sy[0] = _mm512_fmadd_ps(ty, _mm512_maskz_load_ps(m, t0 + i), sy[0]);
+		sy[1] = _mm512_fmadd_ps(ty, _mm512_maskz_load_ps(m, t1 + i), sy[1]);
+	}
+	sy[1] = _mm512_mul_ps(_mm512_sub_ps(sy[1], sy[0]), _mm512_set1_ps(x));
+	*d = _mm512_reduce_add_ps(_mm512_add_ps(sy[0], sy[1]));
+}
+
+static inline void inner_product2_ip_avx512(float *d0, float *d1,
+	const float * SPA_RESTRICT s0, const float * SPA_RESTRICT s1,
+	const float * SPA_RESTRICT t0, const float * SPA_RESTRICT t1, float x,
+	uint32_t n_taps)
+{
+	__m512 sy[4] = { _mm512_setzero_ps(), _mm512_setzero_ps(),
+		_mm512_setzero_ps(), _mm512_setzero_ps() }, ta, tb, ty;
+	uint32_t i;
+
+	for (i = 0; i < n_taps; i += 16) {
+		__mmask16 m = tail_mask(n_taps - i);
+		ta = _mm512_maskz_load_ps(m, t0 + i);
+		tb = _mm512_maskz_load_ps(m, t1 + i);
+		ty = _mm512_maskz_loadu_ps(m, s0 + i);
+		sy[0] = _mm512_fmadd_ps(ty, ta, sy[0]);
+		sy[1] = _mm512_fmadd_ps(ty, tb, sy[1]);
+		ty = _mm512_maskz_loadu_ps(m, s1 + i);
+		sy[2] = _mm512_fmadd_ps(ty, ta, sy[2]);
+		sy[3] = _mm512_fmadd_ps(ty, tb, sy[3]);
+	}
+	ty = _mm512_set1_ps(x);
+	sy[1] = _mm512_fmadd_ps(_mm512_sub_ps(sy[1], sy[0]), ty, sy[0]);
+	sy[3] = _mm512_fmadd_ps(_mm512_sub_ps(sy[3], sy[2]), ty, sy[2]);
+	*d0 = _mm512_reduce_add_ps(sy[1]);
+	*d1 = _mm512_reduce_add_ps(sy[3]);
+}
+
+/* Unlike the generic resamplers, the AVX-512 ones walk the output samples
+ * in the outer loop and all channels in the inner loop. The phase is
+ * computed once per output sample and the taps are still in the cache
+ * for the next channels. Channels are processed in pairs that share the
+ * tap loads. */
+DEFINE_RESAMPLER(full,avx512)
+{
+	struct native_data *data = r->data;
+	uint32_t n_taps = data->n_taps, stride = data->filter_stride_os;
+	uint32_t index, phase, n_phases = data->out_rate;
+	uint32_t c, o, olen = *out_len, ilen = *in_len;
+	uint32_t inc = data->inc, frac = data->frac, channels = r->channels;
+	const float **s = (const float **)src;
+	float **d = (float **)dst;
+
+	if (channels == 0)
+		return;
+
+	index = ioffs;
+	phase = data->phase;
+
+	for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {
+		const float *taps = &data->filter[phase * stride];
+
+		for (c = 0; c + 1 < channels; c += 2)
+			inner_product2_avx512(&d[c][o], &d[c+1][o],
+					&s[c][index], &s[c+1][index], taps, n_taps);
+		if (c < channels)
+			inner_product_avx512(&d[c][o], &s[c][index], taps, n_taps);
+
+		index += inc;
+		phase += frac;
+		if (phase >= n_phases) {
+			phase -= n_phases;
+			index += 1;
+		}
+	}
+	*in_len = index;
+	*out_len = o;
+	data->phase = phase;
+}
+
+DEFINE_RESAMPLER(inter,avx512)
+{
+	struct native_data *data = r->data;
+	uint32_t index, phase, stride = data->filter_stride;
+	uint32_t n_phases = data->n_phases, out_rate = data->out_rate;
+	uint32_t n_taps = data->n_taps;
+	uint32_t c, o, olen = *out_len, ilen = *in_len;
+	uint32_t inc = data->inc, frac = data->frac, channels = r->channels;
+	const float **s = (const float **)src;
+	float **d = (float **)dst;
+
+	if (channels == 0)
+		return;
+
+	index = ioffs;
+	phase = data->phase;
+
+	for (o = ooffs; o < olen && index + n_taps <= ilen; o++) {
+		const float *t0, *t1;
+		float ph, x;
+		uint32_t offset;
+
+		ph = (float)phase * n_phases / out_rate;
+		offset = floor(ph);
+		x = ph - (float)offset;
+
+		t0 = &data->filter[(offset + 0) * stride];
+		t1 = &data->filter[(offset + 1) * stride];
+
+		for (c = 0; c + 1 < channels; c += 2)
+			inner_product2_ip_avx512(&d[c][o], &d[c+1][o],
+					&s[c][index], &s[c+1][index], t0, t1, x, n_taps);
+		if (c < channels)
+			inner_product_ip_avx512(&d[c][o], &s[c][index], t0, t1, x, n_taps);
+
+		index += inc;
+		phase += frac;
+		if (phase >= out_rate) {
+			phase -= out_rate;
+			index += 1;
+		}
+	}
+	*in_len = index;
+	*out_len = o;
+	data->phase = phase;
+}
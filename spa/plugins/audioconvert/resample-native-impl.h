@@ -28,6 +28,8 @@
 
 #include "resample.h"
 
+struct native_filter;
+
 typedef void (*resample_func_t)(struct resample *r,
         const void * SPA_RESTRICT src[], uint32_t ioffs, uint32_t *in_len,
         void * SPA_RESTRICT dst[], uint32_t ooffs, uint32_t *out_len);
@@ -43,11 +45,13 @@ struct native_data {
 	uint32_t frac;
 	uint32_t filter_stride;
 	uint32_t filter_stride_os;
+	uint32_t delay;
 	uint32_t hist;
 	float **history;
 	resample_func_t func;
 	float *filter;
 	float *hist_mem;
+	struct native_filter *shared;
 };
 
 #define DEFINE_RESAMPLER(type,arch)						\
@@ -59,7 +63,7 @@ void do_resample_##type##_##arch(struct resample *r,				\
 DEFINE_RESAMPLER(copy,arch)							\
 {										\
 	struct native_data *data = r->data;					\
-	uint32_t index, n_taps = data->n_taps, n_taps2 = n_taps/2;		\
+	uint32_t index, n_taps = data->n_taps, offs = n_taps - data->delay;	\
 	uint32_t c, olen = *out_len, ilen = *in_len;				\
 										\
 	if (r->channels == 0)							\
@@ -72,7 +76,7 @@ DEFINE_RESAMPLER(copy,arch)							\
 		for (c = 0; c < r->channels; c++) {				\
 			const float *s = src[c];				\
 			float *d = dst[c];					\
-			spa_memcpy(&d[ooffs], &s[index + n_taps2],		\
+			spa_memcpy(&d[ooffs], &s[index + offs],			\
 					to_copy * sizeof(float));		\
 		}								\
 		index += to_copy;						\
@@ -179,7 +183,15 @@ DEFINE_RESAMPLER(inter,sse);
 DEFINE_RESAMPLER(full,ssse3);
 DEFINE_RESAMPLER(inter,ssse3);
 #endif
+#if defined (HAVE_NEON)
+DEFINE_RESAMPLER(full,neon);
+DEFINE_RESAMPLER(inter,neon);
+#endif
 #if defined (HAVE_AVX) && defined(HAVE_FMA)
 DEFINE_RESAMPLER(full,avx);
 DEFINE_RESAMPLER(inter,avx);
 #endif
+#if defined (HAVE_AVX512)
+DEFINE_RESAMPLER(full,avx512);
+DEFINE_RESAMPLER(inter,avx512);
+#endif
@@ -22,6 +22,11 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <errno.h>
+#include <pthread.h>
+
+#include <spa/utils/list.h>
+
 #include "resample-native-impl.h"
 
 struct quality {
@@ -77,9 +82,247 @@ static int build_filter(float *taps, uint32_t stride, uint32_t n_taps, uint32_t
 	return 0;
 }
 
+static void fft(double *re, double *im, uint32_t n, bool inverse)
+{
+	uint32_t i, j, k, len, bit;
+
+	for (i = 1, j = 0; i < n; i++) {
+		for (bit = n >> 1; j & bit; bit >>= 1)
+			j ^= bit;
+		j ^= bit;
+		if (i < j) {
+			SPA_SWAP(re[i], re[j]);
+			SPA_SWAP(im[i], im[j]);
+		}
+	}
+	for (len = 2; len <= n; len <<= 1) {
+		double a = (inverse ? 2.0 : -2.0) * M_PI / len;
+		double wr = cos(a), wi = sin(a);
+
+		for (i = 0; i < n; i += len) {
+			double cr = 1.0, ci = 0.0, t;
+
+			for (k = 0; k < len / 2; k++) {
+				uint32_t p = i + k, q = p + len / 2;
+				double tr = re[q] * cr - im[q] * ci;
+				double ti = re[q] * ci + im[q] * cr;
+
+				re[q] = re[p] - tr;
+				im[q] = im[p] - ti;
+				re[p] += tr;
+				im[p] += ti;
+
+				t = cr * wr - ci * wi;
+				ci = cr * wi + ci * wr;
+				cr = t;
+			}
+		}
+	}
+	if (inverse) {
+		for (i = 0; i < n; i++) {
+			re[i] /= n;
+			im[i] /= n;
+		}
+	}
+}
+
+/* largest FFT used to make the minimum phase filter */
+#define MAX_MIN_PHASE_FFT	(1u << 22)
+
+/* Make the minimum phase version of the prototype filter with the cepstral
+ * method. It has the same magnitude response as the linear phase filter but
+ * most of the energy is in the first taps so the delay is much shorter.
+ * The filter is stored reversed, the newest sample is in the last tap. The
+ * delay in input samples is the group delay at DC. */
+static int build_filter_min_phase(float *taps, uint32_t stride, uint32_t n_taps,
+		uint32_t n_phases, double cutoff, uint32_t *delay)
+{
+	uint32_t i, j, n, len = n_taps * n_phases + 1;
+	double *re, *im, num = 0.0, den = 0.0;
+
+	for (n = 1; n < 4 * len; n <<= 1);
+	if (n > MAX_MIN_PHASE_FFT)
+		return -ENOTSUP;
+
+	if ((re = calloc(2 * n, sizeof(double))) == NULL)
+		return -errno;
+	im = re + n;
+
+	for (i = 0; i < len; i++) {
+		double t = (double) i / (double) n_phases - n_taps / 2.0;
+		re[i] = cutoff * sinc(fabs(t) * cutoff) * blackman(t, n_taps);
+	}
+
+	/* real cepstrum of the log magnitude, the floor keeps the zeros of the
+	 * stopband finite */
+	fft(re, im, n, false);
+	for (i = 0; i < n; i++) {
+		re[i] = log(SPA_MAX(hypot(re[i], im[i]), 1e-9));
+		im[i] = 0.0;
+	}
+	fft(re, im, n, true);
+
+	/* fold the anti-causal part onto the causal part */
+	for (i = 1; i < n / 2; i++)
+		re[i] *= 2.0;
+	for (i = n / 2 + 1; i < n; i++)
+		re[i] = 0.0;
+	for (i = 0; i < n; i++)
+		im[i] = 0.0;
+
+	fft(re, im, n, false);
+	for (i = 0; i < n; i++) {
+		double e = exp(re[i]);
+		re[i] = e * cos(im[i]);
+		im[i] = e * sin(im[i]);
+	}
+	fft(re, im, n, true);
+
+	for (i = 0; i < len; i++) {
+		num += i * re[i];
+		den += re[i];
+	}
+	*delay = SPA_CLAMP((uint32_t)lrint(num / den / n_phases), 1u, n_taps / 2);
+
+	for (i = 0; i <= n_phases; i++)
+		for (j = 0; j < n_taps; j++)
+			taps[i * stride + j] = re[(n_taps - 1 - j) * n_phases + i];
+
+	free(re);
+	return 0;
+}
+
+/* The filter only depends on the reduced rates and the quality. It is
+ * built once and shared by all resamplers in the process that use the
+ * same parameters. */
+struct native_filter {
+	struct spa_list link;
+	uint32_t ref;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	int quality;
+	bool minimum_phase;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	uint32_t stride;
+	uint32_t oversample;
+	uint32_t delay;
+	float *taps;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	struct spa_list filters;
+} filter_cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.filters = { &filter_cache.filters, &filter_cache.filters },
+};
+
+/* find a filter in the cache and take a reference, called with the lock */
+static struct native_filter *filter_find(uint32_t in_rate, uint32_t out_rate, int quality,
+		bool minimum_phase)
+{
+	struct native_filter *f;
+
+	spa_list_for_each(f, &filter_cache.filters, link) {
+		if (f->in_rate == in_rate && f->out_rate == out_rate &&
+		    f->quality == quality && f->minimum_phase == minimum_phase) {
+			f->ref++;
+			return f;
+		}
+	}
+	return NULL;
+}
+
+static struct native_filter *filter_ref(uint32_t in_rate, uint32_t out_rate, int quality,
+		bool minimum_phase)
+{
+	const struct quality *q = &blackman_qualities[quality];
+	struct native_filter *f, *found;
+	double scale;
+	uint32_t n_taps, n_phases, stride, oversample;
+	int res;
+
+	pthread_mutex_lock(&filter_cache.lock);
+	f = filter_find(in_rate, out_rate, quality, minimum_phase);
+	pthread_mutex_unlock(&filter_cache.lock);
+	if (f != NULL)
+		return f;
+
+	/* building a minimum phase filter can take tens of milliseconds, do
+	 * it without the lock so that other resamplers are not blocked */
+	scale = SPA_MIN(q->cutoff * out_rate / in_rate, 1.0);
+	/* multiple of 8 taps to ease simd optimizations */
+	n_taps = SPA_ROUND_UP_N((uint32_t)ceil(q->n_taps / scale), 8);
+
+	/* try to get at least 256 phases so that interpolation is
+	 * accurate enough when activated */
+	n_phases = out_rate;
+	oversample = (255 + n_phases) / n_phases;
+	n_phases *= oversample;
+
+	stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
+
+	f = malloc(sizeof(struct native_filter) + stride * (n_phases + 1) + 64);
+	if (f == NULL)
+		return NULL;
+
+	f->ref = 1;
+	f->in_rate = in_rate;
+	f->out_rate = out_rate;
+	f->quality = quality;
+	f->minimum_phase = minimum_phase;
+	f->n_taps = n_taps;
+	f->n_phases = n_phases;
+	f->stride = stride / sizeof(float);
+	f->oversample = oversample;
+	f->taps = SPA_MEMBER_ALIGN(f, sizeof(struct native_filter), 64, float);
+
+	if (minimum_phase) {
+		res = build_filter_min_phase(f->taps, f->stride, n_taps, n_phases,
+				scale, &f->delay);
+		if (res < 0) {
+			free(f);
+			errno = -res;
+			return NULL;
+		}
+	} else {
+		build_filter(f->taps, f->stride, n_taps, n_phases, scale);
+		f->delay = n_taps / 2;
+	}
+
+	/* another resampler may have added the same filter in the meantime */
+	pthread_mutex_lock(&filter_cache.lock);
+	found = filter_find(in_rate, out_rate, quality, minimum_phase);
+	if (found == NULL)
+		spa_list_append(&filter_cache.filters, &f->link);
+	pthread_mutex_unlock(&filter_cache.lock);
+
+	if (found != NULL) {
+		free(f);
+		f = found;
+	}
+	return f;
+}
+
+static void filter_unref(struct native_filter *f)
+{
+	pthread_mutex_lock(&filter_cache.lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		free(f);
+	}
+	pthread_mutex_unlock(&filter_cache.lock);
+}
+
 static void impl_native_free(struct resample *r)
 {
-	free(r->data);
+	struct native_data *d = r->data;
+
+	if (d == NULL)
+		return;
+	filter_unref(d->shared);
+	free(d);
 	r->data = NULL;
 }
 
@@ -135,6 +378,14 @@ static void impl_native_update_rate(struct resample *r, double rate)
 #if defined(HAVE_AVX) && defined(HAVE_FMA)
 		if (SPA_FLAG_IS_SET(r->cpu_flags, SPA_CPU_FLAG_AVX | SPA_CPU_FLAG_FMA3))
 			data->func = is_full ? do_resample_full_avx : do_resample_inter_avx;
+#endif
+#if defined (HAVE_AVX512)
+		if (SPA_FLAG_IS_SET(r->cpu_flags, SPA_CPU_FLAG_AVX512))
+			data->func = is_full ? do_resample_full_avx512 : do_resample_inter_avx512;
+#endif
+#if defined (HAVE_NEON)
+		if (SPA_FLAG_IS_SET(r->cpu_flags, SPA_CPU_FLAG_NEON))
+			data->func = is_full ? do_resample_full_neon : do_resample_inter_neon;
 #endif
 	}
 }
@@ -246,23 +497,22 @@ static void impl_native_reset (struct resample *r)
 {
 	struct native_data *d = r->data;
 	memset(d->hist_mem, 0, r->channels * sizeof(float) * d->n_taps * 2);
-	d->hist = (d->n_taps / 2) - 1;
+	d->hist = d->n_taps - d->delay - 1;
 	d->phase = 0;
 }
 
 static uint32_t impl_native_delay (struct resample *r)
 {
 	struct native_data *d = r->data;
-	return d->n_taps / 2;
+	return d->delay;
 }
 
 static int impl_native_init(struct resample *r)
 {
 	struct native_data *d;
-	const struct quality *q;
-	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
-	uint32_t history_stride, history_size, oversample;
+	struct native_filter *f;
+	uint32_t c, in_rate, out_rate, gcd;
+	uint32_t history_stride, history_size;
 
 	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(blackman_qualities) - 1);
 	r->free = impl_native_free;
@@ -272,54 +522,52 @@ static int impl_native_init(struct resample *r)
 	r->reset = impl_native_reset;
 	r->delay = impl_native_delay;
 
-	q = &blackman_qualities[r->quality];
-
 	gcd = calc_gcd(r->i_rate, r->o_rate);
 
 	in_rate = r->i_rate / gcd;
 	out_rate = r->o_rate / gcd;
 
-	scale = SPA_MIN(q->cutoff * out_rate / in_rate, 1.0);
-	/* multiple of 8 taps to ease simd optimizations */
-	n_taps = SPA_ROUND_UP_N((uint32_t)ceil(q->n_taps / scale), 8);
-
-	/* try to get at least 256 phases so that interpolation is
-	 * accurate enough when activated */
-	n_phases = out_rate;
-	oversample = (255 + n_phases) / n_phases;
-	n_phases *= oversample;
+	f = filter_ref(in_rate, out_rate, r->quality,
+			SPA_FLAG_IS_SET(r->options, RESAMPLE_OPTION_MINIMUM_PHASE));
+	if (f == NULL && errno == ENOTSUP) {
+		spa_log_warn(r->log, "native %p: filter too large for minimum phase, "
+				"using linear phase", r);
+		f = filter_ref(in_rate, out_rate, r->quality, false);
+	}
+	if (f == NULL)
+		return -errno;
 
-	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
-	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
+	history_stride = SPA_ROUND_UP_N(2 * f->n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
 
 	d = malloc(sizeof(struct native_data) +
-			filter_size +
 			history_size +
 			(r->channels * sizeof(float*)) +
 			64);
 
-	if (d == NULL)
-		return -errno;
+	if (d == NULL) {
+		int res = -errno;
+		filter_unref(f);
+		return res;
+	}
 
 	r->data = d;
-	d->n_taps = n_taps;
-	d->n_phases = n_phases;
+	d->shared = f;
+	d->n_taps = f->n_taps;
+	d->n_phases = f->n_phases;
 	d->in_rate = in_rate;
 	d->out_rate = out_rate;
-	d->filter = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_MEMBER_ALIGN(d->filter, filter_size, 64, float);
+	d->filter = f->taps;
+	d->hist_mem = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
 	d->history = SPA_MEMBER(d->hist_mem, history_size, float*);
-	d->filter_stride = filter_stride / sizeof(float);
-	d->filter_stride_os = d->filter_stride * oversample;
+	d->filter_stride = f->stride;
+	d->filter_stride_os = f->stride * f->oversample;
+	d->delay = f->delay;
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_MEMBER(d->hist_mem, c * history_stride, float);
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
-
-	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d n_taps:%d n_phases:%d",
-			r, r->quality, in_rate, out_rate, n_taps, n_phases);
+	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d n_taps:%d n_phases:%d delay:%d",
+			r, r->quality, in_rate, out_rate, d->n_taps, d->n_phases, d->delay);
 
 	impl_native_reset(r);
 	impl_native_update_rate(r, 1.0);
@@ -39,6 +39,7 @@
 #include <spa/debug/types.h>
 
 #include "resample.h"
+#include "stage.h"
 
 #include "resample-peaks.h"
 #include "resample-native.h"
@@ -50,6 +51,7 @@
 
 #define MAX_SAMPLES	8192
 #define MAX_BUFFERS	32
+#define MAX_DATAS	32
 
 struct impl;
 
@@ -71,6 +73,7 @@ struct buffer {
 	struct spa_list link;
 	struct spa_buffer *outbuf;
 	struct spa_meta_header *h;
+	void *datas[MAX_DATAS];
 };
 
 struct port {
@@ -88,6 +91,7 @@ struct port {
 	uint32_t blocks;
 	uint32_t size;
 	unsigned int have_format:1;
+	unsigned int dynamic:1;		/**< all buffers have dynamic data */
 
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
@@ -121,8 +125,11 @@ struct impl {
 	int mode;
 	unsigned int started:1;
 	unsigned int peaks:1;
+	unsigned int is_passthrough:1;
+	unsigned int has_history:1;	/* the resampler holds input samples */
 
 	struct resample resample;
+	struct stage stage;
 };
 
 #define CHECK_PORT(this,d,id)		(id == 0)
@@ -170,9 +177,32 @@ static int setup_convert(struct impl *this,
 	else
 		err = impl_native_init(&this->resample);
 
+	this->is_passthrough = !this->peaks &&
+		this->resample.i_rate == this->resample.o_rate;
+	this->has_history = false;
+
 	return err;
 }
 
+/* Without a rate change the output buffers can point to the input and no
+ * samples need to be touched. This is what lets the stages around us be
+ * fused. A rate match that is not active or at rate 1.0 does not change
+ * the rate. Once the resampler ran, its history holds samples that would
+ * be lost, so we only pass through again after it is set up again. */
+static void update_passthrough(struct impl *this)
+{
+	struct port *outport = GET_OUT_PORT(this, 0);
+	struct spa_io_rate_match *rm = this->io_rate_match;
+
+	this->stage.can_defer = this->is_passthrough &&
+		this->props.rate == 1.0 &&
+		(rm == NULL || !SPA_FLAG_IS_SET(rm->flags, SPA_IO_RATE_MATCH_FLAG_ACTIVE) ||
+		 rm->rate == 1.0) &&
+		!this->has_history &&
+		outport->dynamic &&
+		outport->offset == 0;
+}
+
 static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
@@ -191,6 +221,7 @@ static int apply_props(struct impl *this, const struct spa_pod *param)
 		case SPA_PROP_rate:
 			if (spa_pod_get_double(&prop->value, &p->rate) == 0) {
 				resample_update_rate(&this->resample, p->rate);
+				update_passthrough(this);
 			}
 			break;
 		case SPA_PROP_quality:
@@ -492,7 +523,9 @@ static int clear_buffers(struct impl *this, struct port *port)
 	if (port->n_buffers > 0) {
 		spa_log_debug(this->log, NAME " %p: clear buffers %p", this, port);
 		port->n_buffers = 0;
+		port->dynamic = false;
 		spa_list_init(&port->queue);
+		update_passthrough(this);
 	}
 	return 0;
 }
@@ -537,6 +570,7 @@ static int port_set_format(void *object,
 		if (other->have_format) {
 			if ((res = setup_convert(this, direction, &info)) < 0)
 				return res;
+			update_passthrough(this);
 		}
 		port->format = info;
 		port->have_format = true;
@@ -598,6 +632,8 @@ impl_node_port_use_buffers(void *object,
 
 	clear_buffers(this, port);
 
+	port->dynamic = n_buffers > 0;
+
 	for (i = 0; i < n_buffers; i++) {
 		struct buffer *b;
 		struct spa_data *d = buffers[i]->datas;
@@ -620,6 +656,9 @@ impl_node_port_use_buffers(void *object,
 					      buffers[i]);
 				return -EINVAL;
 			}
+			if (!SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC))
+				port->dynamic = false;
+			b->datas[j] = d[j].data;
 		}
 
 		if (direction == SPA_DIRECTION_OUTPUT)
@@ -632,6 +671,8 @@ impl_node_port_use_buffers(void *object,
 	port->n_buffers = n_buffers;
 	port->size = size;
 
+	update_passthrough(this);
+
 	return 0;
 }
 
@@ -657,6 +698,7 @@ impl_node_port_set_io(void *object,
 		break;
 	case SPA_IO_RateMatch:
 		this->io_rate_match = data;
+		update_passthrough(this);
 		break;
 	default:
 		return -ENOENT;
@@ -719,6 +761,7 @@ static int impl_node_process(void *object)
 	void **dst_datas;
 	bool flush_out = false;
 	bool flush_in = false;
+	bool passthrough;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -796,10 +839,26 @@ static int impl_node_process(void *object)
 
 	for (i = 0; i < sb->n_datas; i++)
 		src_datas[i] = SPA_MEMBER(sb->datas[i].data, inport->offset, void);
-	for (i = 0; i < db->n_datas; i++)
-		dst_datas[i] = SPA_MEMBER(db->datas[i].data, outport->offset, void);
 
-	resample_process(&this->resample, src_datas, &in_len, dst_datas, &out_len);
+	/* decided before audioconvert ran the stages before us, a rate
+	 * change is picked up in the next cycle */
+	passthrough = stage_defer(&this->stage);
+
+	if (passthrough) {
+		/* the output points to the input, it can't be filled up
+		 * later so always flush it */
+		in_len = out_len = SPA_MIN(in_len, out_len);
+		for (i = 0; i < db->n_datas; i++)
+			db->datas[i].data = (void*)src_datas[i];
+		flush_out = true;
+	} else {
+		for (i = 0; i < db->n_datas; i++) {
+			db->datas[i].data = dbuf->datas[i];
+			dst_datas[i] = SPA_MEMBER(dbuf->datas[i], outport->offset, void);
+		}
+		resample_process(&this->resample, src_datas, &in_len, dst_datas, &out_len);
+		this->has_history = true;
+	}
 
 	spa_log_trace_fp(this->log, NAME " %p: in %d/%d %zd %d out %d/%d %zd %d max:%d",
 			this, pin_len, in_len, size / sizeof(float), inport->offset,
@@ -809,6 +868,11 @@ static int impl_node_process(void *object)
 	for (i = 0; i < db->n_datas; i++) {
 		db->datas[i].chunk->size = outport->offset + (out_len * sizeof(float));
 		db->datas[i].chunk->offset = 0;
+		/* the filter history makes the output of real resampling
+		 * non-silent for a while, only pass the flag when we
+		 * pass the data */
+		db->datas[i].chunk->flags = passthrough ?
+			sb->datas[i].chunk->flags & SPA_CHUNK_FLAG_EMPTY : 0;
 	}
 
 	inport->offset += in_len * sizeof(float);
@@ -836,9 +900,12 @@ static int impl_node_process(void *object)
 	}
 
 	if (this->io_rate_match) {
-		this->io_rate_match->delay = resample_delay(&this->resample);
-		this->io_rate_match->size = resample_in_len(&this->resample, max);
+		this->io_rate_match->delay = passthrough ? 0 : resample_delay(&this->resample);
+		this->io_rate_match->size = passthrough ? max :
+			resample_in_len(&this->resample, max);
 	}
+	update_passthrough(this);
+
 	return res;
 }
 
@@ -871,6 +938,8 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
 		*interface = &this->node;
+	else if (strcmp(type, SPA_TYPE_INTERFACE_AudioConvertStage) == 0)
+		*interface = &this->stage;
 	else
 		return -ENOENT;
 
@@ -929,6 +998,9 @@ impl_init(const struct spa_handle_factory *factory,
 			this->props.quality = atoi(str);
 		if ((str = spa_dict_lookup(info, "resample.peaks")) != NULL)
 			this->peaks = atoi(str);
+		if ((str = spa_dict_lookup(info, "resample.minimum-phase")) != NULL)
+			SPA_FLAG_UPDATE(this->resample.options,
+					RESAMPLE_OPTION_MINIMUM_PHASE, atoi(str));
 		if ((str = spa_dict_lookup(info, "factory.mode")) != NULL) {
 			if (strcmp(str, "split") == 0)
 				this->mode = MODE_SPLIT;
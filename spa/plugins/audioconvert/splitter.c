@@ -841,7 +841,7 @@ static int impl_node_process(void *object)
 	struct impl *this = object;
 	struct port *inport;
 	struct spa_io_buffers *inio;
-	uint32_t i, j, maxsize, n_samples;
+	uint32_t i, j, maxsize, n_samples, flags;
 	struct spa_data *sd, *dd;
 	struct buffer *sbuf, *dbuf;
 	uint32_t n_src_datas, n_dst_datas;
@@ -871,10 +871,12 @@ static int impl_node_process(void *object)
 	src_datas = alloca(sizeof(void*) * n_src_datas);
 
 	maxsize = INT_MAX;
+	flags = SPA_CHUNK_FLAG_EMPTY;
 	for (i = 0; i < n_src_datas; i++) {
 		src_datas[i] = SPA_MEMBER(sd[i].data,
 				sd[i].chunk->offset, void);
 		maxsize = SPA_MIN(sd[i].chunk->size, maxsize);
+		flags &= sd[i].chunk->flags;
 	}
 	n_samples = maxsize / inport->stride;
 
@@ -921,6 +923,7 @@ static int impl_node_process(void *object)
 			dd[j].data = dst_datas[n_dst_datas++];
 			dd[j].chunk->offset = 0;
 			dd[j].chunk->size = n_samples * outport->stride;
+			dd[j].chunk->flags = flags;
 		}
 
 		outio->status = SPA_STATUS_HAVE_DATA;
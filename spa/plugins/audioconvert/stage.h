@@ -0,0 +1,82 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef STAGE_H
+#define STAGE_H
+
+#include <spa/utils/defs.h>
+#include <spa/utils/type.h>
+#include <spa/param/audio/raw.h>
+
+/* Private interface of the fmtconvert, channelmix and resample nodes that
+ * lets audioconvert run their DSP fused.
+ *
+ * When enabled, a node still does all its buffer and io handling in
+ * process but only records the conversion it would do. audioconvert
+ * then runs the recorded conversions of consecutive nodes in small
+ * blocks, passing the intermediate data through a cache sized scratch
+ * area instead of the full size link buffers. */
+#define SPA_TYPE_INTERFACE_AudioConvertStage	SPA_TYPE_INFO_INTERFACE_BASE "AudioConvert:Stage"
+
+#define STAGE_MAX_DATAS	SPA_AUDIO_MAX_CHANNELS
+
+struct stage {
+	unsigned int enabled:1;		/**< set by audioconvert to defer processing */
+	unsigned int can_defer:1;	/**< set by the node when it can defer */
+	unsigned int pending:1;		/**< a conversion was recorded */
+
+	void (*process) (void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+			uint32_t n_samples);
+	void *data;
+
+	uint32_t n_src;
+	uint32_t n_dst;
+	uint32_t src_stride;		/**< bytes per sample in each src plane */
+	uint32_t dst_stride;		/**< bytes per sample in each dst plane */
+	uint32_t n_samples;
+	const void *src[STAGE_MAX_DATAS];
+	void *dst[STAGE_MAX_DATAS];
+};
+
+static inline bool stage_defer(struct stage *s)
+{
+	return s->enabled && s->can_defer;
+}
+
+static inline void stage_record(struct stage *s, uint32_t n_dst, void * const dst[],
+		uint32_t n_src, const void * const src[], uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_src; i++)
+		s->src[i] = src[i];
+	for (i = 0; i < n_dst; i++)
+		s->dst[i] = dst[i];
+	s->n_src = n_src;
+	s->n_dst = n_dst;
+	s->n_samples = n_samples;
+	s->pending = true;
+}
+
+#endif /* STAGE_H */
@@ -35,6 +35,7 @@
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/node/node.h>
+#include <spa/node/utils.h>
 #include <spa/debug/mem.h>
 #include <spa/support/log-impl.h>
 
@@ -62,12 +63,12 @@ static const struct spa_handle_factory *find_factory(const char *name)
 	return NULL;
 }
 
-static int setup_context(struct context *ctx)
+static int setup_context(struct context *ctx, bool passthrough)
 {
 	size_t size;
 	int res;
 	struct spa_support support[1];
-	struct spa_dict_item items[1];
+	struct spa_dict_item items[2];
 	const struct spa_handle_factory *factory;
 	char value[32];
 	void *iface;
@@ -103,10 +104,11 @@ static int setup_context(struct context *ctx)
 
 	snprintf(value, sizeof(value), "pointer:%p", ctx->follower_node);
 	items[0] = SPA_DICT_ITEM_INIT("audio.adapt.follower", value);
+	items[1] = SPA_DICT_ITEM_INIT("audio.adapt.passthrough", passthrough ? "true" : "false");
 
 	res = spa_handle_factory_init(factory,
 			ctx->adapter_handle,
-			&SPA_DICT_INIT(items, 1),
+			&SPA_DICT_INIT(items, 2),
 			support, 1);
 	spa_assert(res >= 0);
 
@@ -232,6 +234,117 @@ static int test_split_setup(struct context *ctx)
 	return 0;
 }
 
+struct port_count {
+	uint32_t n_ports;
+	uint32_t last_port;
+};
+
+static void port_info_count(void *data,
+		enum spa_direction direction, uint32_t port,
+		const struct spa_port_info *info)
+{
+	struct port_count *c = data;
+
+	spa_assert(direction == SPA_DIRECTION_OUTPUT);
+	if (info) {
+		c->n_ports++;
+		c->last_port = port;
+	}
+}
+
+static int set_port_config(struct context *ctx, uint32_t channels)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	struct spa_audio_info_raw info;
+
+	spa_zero(info);
+	info.format = SPA_AUDIO_FORMAT_F32P;
+	info.channels = channels;
+	info.rate = 48000;
+	info.position[0] = SPA_AUDIO_CHANNEL_FL;
+	info.position[1] = SPA_AUDIO_CHANNEL_FR;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	param = spa_pod_builder_add_object(&b,
+		SPA_TYPE_OBJECT_ParamPortConfig, SPA_PARAM_PortConfig,
+		SPA_PARAM_PORT_CONFIG_direction,	SPA_POD_Id(SPA_DIRECTION_OUTPUT),
+		SPA_PARAM_PORT_CONFIG_mode,		SPA_POD_Id(SPA_PARAM_PORT_CONFIG_MODE_dsp),
+		SPA_PARAM_PORT_CONFIG_format,		SPA_POD_Pod(param));
+
+	return spa_node_set_param(ctx->adapter_node, SPA_PARAM_PortConfig, 0, param);
+}
+
+static int test_passthrough(struct context *ctx)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	struct spa_audio_info info = { 0 };
+	struct spa_hook listener;
+	struct port_count count;
+	uint32_t state;
+	int res;
+	static const struct spa_node_events node_events = {
+		SPA_VERSION_NODE_EVENTS,
+		.port_info = port_info_count,
+	};
+
+	/* mono f32 can be linked to the follower directly */
+	res = set_port_config(ctx, 1);
+	spa_assert(res == 0);
+
+	spa_zero(count);
+	spa_zero(listener);
+	spa_node_add_listener(ctx->adapter_node, &listener, &node_events, &count);
+	spa_hook_remove(&listener);
+	spa_assert(count.n_ports == 1);
+	spa_assert(count.last_port == 0);
+
+	state = 0;
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	res = spa_node_port_enum_params_sync(ctx->adapter_node,
+			SPA_DIRECTION_OUTPUT, 0, SPA_PARAM_EnumFormat, &state,
+			NULL, &param, &b);
+	spa_assert(res == 1);
+	res = spa_format_parse(param, &info.media_type, &info.media_subtype);
+	spa_assert(res >= 0);
+	spa_assert(info.media_type == SPA_MEDIA_TYPE_audio);
+	spa_assert(info.media_subtype == SPA_MEDIA_SUBTYPE_dsp);
+
+	res = spa_node_port_set_param(ctx->adapter_node,
+			SPA_DIRECTION_OUTPUT, 0, SPA_PARAM_Format, 0, param);
+	spa_assert(res >= 0);
+
+	state = 0;
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	res = spa_node_port_enum_params_sync(ctx->follower_node,
+			SPA_DIRECTION_OUTPUT, 0, SPA_PARAM_Format, &state,
+			NULL, &param, &b);
+	spa_assert(res == 1);
+	res = spa_format_parse(param, &info.media_type, &info.media_subtype);
+	spa_assert(res >= 0);
+	spa_assert(info.media_subtype == SPA_MEDIA_SUBTYPE_raw);
+	res = spa_format_audio_raw_parse(param, &info.info.raw);
+	spa_assert(res >= 0);
+	spa_assert(info.info.raw.format == SPA_AUDIO_FORMAT_F32P);
+	spa_assert(info.info.raw.rate == 48000);
+	spa_assert(info.info.raw.channels == 1);
+
+	/* stereo needs the converter again */
+	res = set_port_config(ctx, 2);
+	spa_assert(res == 0);
+
+	spa_zero(count);
+	spa_zero(listener);
+	spa_node_add_listener(ctx->adapter_node, &listener, &node_events, &count);
+	spa_hook_remove(&listener);
+	spa_assert(count.n_ports == 2);
+
+	return 0;
+}
 
 int main(int argc, char *argv[])
 {
@@ -239,12 +352,20 @@ int main(int argc, char *argv[])
 
 	spa_zero(ctx);
 
-	setup_context(&ctx);
+	setup_context(&ctx, false);
 
 	test_init_state(&ctx);
 	test_split_setup(&ctx);
 
 	clean_context(&ctx);
 
+	spa_zero(ctx);
+
+	setup_context(&ctx, true);
+
+	test_passthrough(&ctx);
+
+	clean_context(&ctx);
+
 	return 0;
 }
@@ -28,13 +28,18 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 
 #include <spa/utils/names.h>
 #include <spa/support/plugin.h>
 #include <spa/param/param.h>
+#include <spa/param/props.h>
+#include <spa/param/audio/dither.h>
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/alloc.h>
 #include <spa/debug/mem.h>
 #include <spa/support/log-impl.h>
 
@@ -509,6 +514,221 @@ static int test_set_in_format2(struct context *ctx)
 	return 0;
 }
 
+static struct spa_buffer **alloc_buffer(uint32_t n_datas, uint32_t size)
+{
+	struct spa_data datas[n_datas];
+	uint32_t aligns[n_datas], i;
+	struct spa_buffer **buffers;
+
+	memset(datas, 0, sizeof(datas));
+	for (i = 0; i < n_datas; i++) {
+		datas[i].type = SPA_DATA_MemPtr;
+		datas[i].flags = SPA_DATA_FLAG_DYNAMIC;
+		datas[i].maxsize = size;
+		aligns[i] = 16;
+	}
+	buffers = spa_buffer_alloc_array(1, 0, 0, NULL, n_datas, datas, aligns);
+	spa_assert(buffers != NULL);
+	return buffers;
+}
+
+static void set_port_format(struct spa_node *node, enum spa_direction direction,
+		struct spa_audio_info_raw *info)
+{
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	int res;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, info);
+	res = spa_node_port_set_param(node, direction, 0, SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+}
+
+/* run one cycle of n_samples through a new audioconvert and return
+ * the output samples in dst, props are set after the formats */
+static uint32_t run_convert(bool fused, const struct spa_pod *props,
+		struct spa_audio_info_raw *in_info, uint32_t in_stride,
+		struct spa_audio_info_raw *out_info, uint32_t out_stride,
+		const void *src, uint32_t n_samples, void *dst, uint32_t max_samples)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	struct spa_node *node;
+	struct spa_support support[1];
+	struct spa_dict_item items[1];
+	struct spa_buffer **inbufs, **outbufs, *inbuf, *outbuf;
+	struct spa_io_buffers inio, outio;
+	void *iface;
+	uint32_t n_out;
+	int res;
+
+	support[0] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Log, &logger);
+	items[0] = SPA_DICT_ITEM_INIT("audioconvert.fused", fused ? "true" : "false");
+
+	factory = find_factory(SPA_NAME_AUDIO_CONVERT);
+	spa_assert(factory != NULL);
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	res = spa_handle_factory_init(factory, handle,
+			&SPA_DICT_INIT_ARRAY(items), support, 1);
+	spa_assert(res >= 0);
+	res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert(res >= 0);
+	node = iface;
+
+	set_port_format(node, SPA_DIRECTION_INPUT, in_info);
+	set_port_format(node, SPA_DIRECTION_OUTPUT, out_info);
+
+	if (props != NULL) {
+		res = spa_node_set_param(node, SPA_PARAM_Props, 0, props);
+		spa_assert(res == 0);
+	}
+
+	inbufs = alloc_buffer(1, n_samples * in_stride);
+	outbufs = alloc_buffer(1, max_samples * out_stride);
+	inbuf = inbufs[0];
+	outbuf = outbufs[0];
+
+	res = spa_node_port_use_buffers(node, SPA_DIRECTION_INPUT, 0, 0, inbufs, 1);
+	spa_assert(res == 0);
+	res = spa_node_port_use_buffers(node, SPA_DIRECTION_OUTPUT, 0, 0, outbufs, 1);
+	spa_assert(res == 0);
+
+	inio = SPA_IO_BUFFERS_INIT;
+	outio = SPA_IO_BUFFERS_INIT;
+	res = spa_node_port_set_io(node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_Buffers, &inio, sizeof(inio));
+	spa_assert(res == 0);
+	res = spa_node_port_set_io(node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_IO_Buffers, &outio, sizeof(outio));
+	spa_assert(res == 0);
+
+	res = spa_node_send_command(node,
+			&SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+	spa_assert(res == 0);
+
+	memcpy(inbuf->datas[0].data, src, n_samples * in_stride);
+	inbuf->datas[0].chunk->offset = 0;
+	inbuf->datas[0].chunk->size = n_samples * in_stride;
+	inio.status = SPA_STATUS_HAVE_DATA;
+	inio.buffer_id = 0;
+
+	res = spa_node_process(node);
+	spa_assert(res & SPA_STATUS_HAVE_DATA);
+	spa_assert(outio.status == SPA_STATUS_HAVE_DATA);
+	spa_assert(outio.buffer_id == 0);
+
+	n_out = outbuf->datas[0].chunk->size / out_stride;
+	spa_assert(n_out <= max_samples);
+	memcpy(dst, outbuf->datas[0].data, n_out * out_stride);
+
+	spa_handle_clear(handle);
+	free(handle);
+	free(inbufs);
+	free(outbufs);
+
+	return n_out;
+}
+
+static void test_fused(uint32_t in_rate, uint32_t out_rate)
+{
+	struct spa_audio_info_raw in_info, out_info;
+	uint32_t i, n_samples = 4000, n1, n2;
+	int16_t src[n_samples * 2];
+	int32_t dst1[n_samples], dst2[n_samples];
+
+	in_info = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_S16,
+		.rate = in_rate,
+		.channels = 2,
+		.position = { SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR, }
+	};
+	out_info = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_S32,
+		.rate = out_rate,
+		.channels = 1,
+		.position = { SPA_AUDIO_CHANNEL_MONO, }
+	};
+
+	for (i = 0; i < n_samples; i++) {
+		src[i * 2 + 0] = (int16_t)(sin(i * 0.01) * 16000);
+		src[i * 2 + 1] = (int16_t)(cos(i * 0.03) * 8000);
+	}
+
+	if (in_rate == out_rate) {
+		/* fused, the resampler passes the data through without the
+		 * delay of its filter, unfused it runs as a separate step */
+		n2 = run_convert(true, NULL, &in_info, 4, &out_info, 4, src, n_samples,
+				dst2, n_samples);
+		spa_assert(n2 == n_samples);
+		for (i = 0; i < n2; i++) {
+			/* stereo is downmixed to mono at -3dB */
+			float mix = (src[i * 2] + src[i * 2 + 1]) * (float)M_SQRT1_2 / 32767.0f;
+			spa_assert(fabsf(mix - dst2[i] / 2147483647.0f) < 0.0001f);
+		}
+		return;
+	}
+
+	/* the resampler only hands out a buffer once it is full, make the
+	 * output as large as the input so that one cycle produces it */
+	n1 = run_convert(false, NULL, &in_info, 4, &out_info, 4, src, n_samples,
+			dst1, n_samples);
+	n2 = run_convert(true, NULL, &in_info, 4, &out_info, 4, src, n_samples,
+			dst2, n_samples);
+
+	spa_assert(n1 > 0);
+	spa_assert(n1 == n2);
+	spa_assert(memcmp(dst1, dst2, n1 * sizeof(int32_t)) == 0);
+}
+
+/* the default dither of 16 bit output can be turned off with a prop */
+static void test_dither(void)
+{
+	struct spa_audio_info_raw in_info, out_info;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[256];
+	struct spa_pod *props;
+	uint32_t i, n_samples = 1024, n, n_exact;
+	float src[n_samples];
+	int16_t dst[n_samples];
+
+	in_info = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = 1,
+		.position = { SPA_AUDIO_CHANNEL_MONO, }
+	};
+	out_info = in_info;
+	out_info.format = SPA_AUDIO_FORMAT_S16;
+
+	/* a quarter LSB above 8192, rounded and truncated it is 8192 */
+	for (i = 0; i < n_samples; i++)
+		src[i] = 8192.25f / 32767.0f;
+
+	n = run_convert(true, NULL, &in_info, 4, &out_info, 2, src, n_samples,
+			dst, n_samples);
+	spa_assert(n == n_samples);
+	for (i = 0, n_exact = 0; i < n; i++) {
+		spa_assert(dst[i] >= 8190 && dst[i] <= 8194);
+		if (dst[i] == 8192)
+			n_exact++;
+	}
+	spa_assert(n_exact < n);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	props = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+			SPA_PROP_ditherType, SPA_POD_Id(SPA_AUDIO_DITHER_NONE));
+
+	n = run_convert(true, props, &in_info, 4, &out_info, 2, src, n_samples,
+			dst, n_samples);
+	spa_assert(n == n_samples);
+	for (i = 0; i < n; i++)
+		spa_assert(dst[i] == 8192);
+}
+
 int main(int argc, char *argv[])
 {
 	struct context ctx;
@@ -532,5 +752,9 @@ int main(int argc, char *argv[])
 
 	clean_context(&ctx);
 
+	test_fused(48000, 48000);
+	test_fused(44100, 48000);
+	test_dither();
+
 	return 0;
 }
@@ -35,6 +35,7 @@
 SPA_LOG_IMPL(logger);
 
 #include "channelmix-ops.c"
+#include "../test-cpu.h"
 static void dump_matrix(struct channelmix *mix)
 {
 	uint32_t i, j;
@@ -118,6 +119,141 @@ static void test_7p1_N(void)
 	test_mix(8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR), 2, _M(FL)|_M(FR), (float[]) { 0.5, 0.5 });
 }
 
+#define N_SAMPLES	251
+/* keep the channels aligned so that the SIMD loops are used */
+#define N_STRIDE	256
+
+static float samp_in[SPA_AUDIO_MAX_CHANNELS][N_STRIDE] SPA_ALIGNED(16);
+static float samp_out[2][SPA_AUDIO_MAX_CHANNELS][N_STRIDE] SPA_ALIGNED(16);
+
+static void run_process(uint32_t cpu_flags, uint32_t src_chan, uint64_t src_mask,
+		uint32_t dst_chan, uint64_t dst_mask, float volume,
+		float out[SPA_AUDIO_MAX_CHANNELS][N_STRIDE])
+{
+	struct channelmix mix;
+	float volumes[SPA_AUDIO_MAX_CHANNELS];
+	const void *src[SPA_AUDIO_MAX_CHANNELS];
+	void *dst[SPA_AUDIO_MAX_CHANNELS];
+	uint32_t i;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.dst_chan = dst_chan;
+	mix.src_mask = src_mask;
+	mix.dst_mask = dst_mask;
+	mix.cpu_flags = cpu_flags;
+	mix.log = &logger.log;
+
+	spa_assert(channelmix_init(&mix) == 0);
+
+	for (i = 0; i < src_chan; i++) {
+		volumes[i] = 1.0f;
+		src[i] = samp_in[i];
+	}
+	for (i = 0; i < dst_chan; i++)
+		dst[i] = out[i];
+
+	channelmix_set_volume(&mix, volume, false, src_chan, volumes);
+	channelmix_process(&mix, dst_chan, dst, src_chan, src, N_SAMPLES);
+
+	fprintf(stderr, "%d->%d volume %f cpu_flags %08x\n",
+			src_chan, dst_chan, volume, mix.cpu_flags);
+	channelmix_free(&mix);
+}
+
+/* the SIMD versions must produce the same result as the C version */
+static void test_process(void)
+{
+	static const struct {
+		uint32_t src_chan;
+		uint64_t src_mask;
+		uint32_t dst_chan;
+		uint64_t dst_mask;
+	} layouts[] = {
+		{ 2, _M(FL)|_M(FR), 2, _M(FL)|_M(FR) },
+		{ 8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR),
+		  8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR) },
+		{ 1, _M(MONO), 2, _M(FL)|_M(FR) },
+		{ 2, _M(FL)|_M(FR), 1, _M(MONO) },
+		{ 4, _M(FL)|_M(FR)|_M(RL)|_M(RR), 1, _M(MONO) },
+		{ 4, _M(FL)|_M(FR)|_M(LFE)|_M(FC), 1, _M(MONO) },
+		{ 2, _M(FL)|_M(FR), 4, _M(FL)|_M(FR)|_M(RL)|_M(RR) },
+		{ 2, _M(FL)|_M(FR), 4, _M(FL)|_M(FR)|_M(LFE)|_M(FC) },
+		{ 2, _M(FL)|_M(FR), 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR) },
+		{ 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 2, _M(FL)|_M(FR) },
+		{ 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 4, _M(FL)|_M(FR)|_M(RL)|_M(RR) },
+		{ 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 4, _M(FL)|_M(FR)|_M(LFE)|_M(FC) },
+		{ 8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR), 2, _M(FL)|_M(FR) },
+		{ 8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR),
+		  4, _M(FL)|_M(FR)|_M(RL)|_M(RR) },
+		{ 8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR),
+		  4, _M(FL)|_M(FR)|_M(LFE)|_M(FC) },
+		/* no special case, use the generic matrix */
+		{ 6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR), 1, _M(MONO) },
+		{ 8, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR),
+		  6, _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR) },
+		{ 3, _M(FL)|_M(FR)|_M(LFE), 5, _M(FL)|_M(FR)|_M(FC)|_M(SL)|_M(SR) },
+	};
+	static const float volumes[] = { 1.0f, 0.5f, 0.0f };
+	uint32_t cpu_flags = get_cpu_flags();
+	uint32_t i, j, c, n;
+
+	for (c = 0; c < SPA_AUDIO_MAX_CHANNELS; c++)
+		for (n = 0; n < N_SAMPLES; n++)
+			samp_in[c][n] = sinf(n * 0.05f + c) * 0.9f;
+
+	for (i = 0; i < SPA_N_ELEMENTS(layouts); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(volumes); j++) {
+			run_process(0, layouts[i].src_chan, layouts[i].src_mask,
+					layouts[i].dst_chan, layouts[i].dst_mask,
+					volumes[j], samp_out[0]);
+			run_process(cpu_flags, layouts[i].src_chan, layouts[i].src_mask,
+					layouts[i].dst_chan, layouts[i].dst_mask,
+					volumes[j], samp_out[1]);
+
+			for (c = 0; c < layouts[i].dst_chan; c++)
+				for (n = 0; n < N_SAMPLES; n++)
+					spa_assert(fabsf(samp_out[0][c][n] - samp_out[1][c][n]) < 1e-6f);
+		}
+	}
+}
+
+/* every rear channel of 7.1 ends up in its own side of the stereo downmix */
+static void test_7p1_2_sides(void)
+{
+	struct channelmix mix;
+	float volumes[8];
+	const void *src[8];
+	void *dst[2];
+	uint32_t c, n;
+
+	spa_zero(mix);
+	mix.src_chan = 8;
+	mix.dst_chan = 2;
+	mix.src_mask = _M(FL)|_M(FR)|_M(LFE)|_M(FC)|_M(SL)|_M(SR)|_M(RL)|_M(RR);
+	mix.dst_mask = _M(FL)|_M(FR);
+	mix.log = &logger.log;
+	spa_assert(channelmix_init(&mix) == 0);
+
+	for (c = 0; c < 8; c++) {
+		volumes[c] = 1.0f;
+		src[c] = samp_in[c];
+		for (n = 0; n < N_SAMPLES; n++)
+			samp_in[c][n] = c == 7 ? 1.0f : 0.0f;
+	}
+	dst[0] = samp_out[0][0];
+	dst[1] = samp_out[0][1];
+
+	channelmix_set_volume(&mix, 1.0f, false, 8, volumes);
+	channelmix_process(&mix, 2, dst, 8, src, N_SAMPLES);
+
+	for (n = 0; n < N_SAMPLES; n++) {
+		spa_assert(samp_out[0][0][n] == 0.0f);
+		spa_assert(samp_out[0][1][n] > 0.0f);
+	}
+	channelmix_free(&mix);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
@@ -128,6 +264,8 @@ int main(int argc, char *argv[])
 	test_4_N();
 	test_5p1_N();
 	test_7p1_N();
+	test_process();
+	test_7p1_2_sides();
 
 	return 0;
 }
@@ -32,35 +32,44 @@
 #include <spa/debug/mem.h>
 
 #include "fmt-ops.c"
+#include "../test-cpu.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
 
-static uint8_t samp_in[N_SAMPLES * 4];
-static uint8_t samp_out[N_SAMPLES * 4];
+static uint8_t samp_in[N_CHANNELS][N_SAMPLES * 4];
+static uint8_t samp_out[N_CHANNELS][N_SAMPLES * 4];
 static uint8_t temp_in[N_SAMPLES * N_CHANNELS * 4];
 static uint8_t temp_out[N_SAMPLES * N_CHANNELS * 4];
 
-static void run_test(const char *name,
+static const uint32_t channel_counts[] = { 1, 2, 3, 4, 5, 8, N_CHANNELS };
+
+static uint32_t cpu_flags;
+
+static void run_test1(const char *name,
 		const void *in, size_t in_size, const void *out, size_t out_size, size_t n_samples,
-		bool in_packed, bool out_packed, convert_func_t func)
+		bool in_packed, bool out_packed, convert_func_t func, uint32_t n_channels)
 {
 	const void *ip[N_CHANNELS];
 	void *tp[N_CHANNELS];
-	int i, j;
+	uint32_t i, j, k;
 	const uint8_t *in8 = in, *out8 = out;
 	struct convert conv;
 
-	conv.n_channels = N_CHANNELS;
+	conv.n_channels = n_channels;
 
-	for (j = 0; j < N_SAMPLES; j++) {
-		memcpy(&samp_in[j * in_size], &in8[(j % n_samples) * in_size], in_size);
-		memcpy(&samp_out[j * out_size], &out8[(j % n_samples) * out_size], out_size);
+	/* give every channel a different sequence so that swapped channels
+	 * are caught, channel j walks the table with step j / n_samples + 1
+	 * starting at j % n_samples */
+	for (j = 0; j < n_channels; j++) {
+		for (i = 0; i < N_SAMPLES; i++) {
+			k = ((j / n_samples + 1) * i + j) % n_samples;
+			memcpy(&samp_in[j][i * in_size], &in8[k * in_size], in_size);
+			memcpy(&samp_out[j][i * out_size], &out8[k * out_size], out_size);
+		}
+		ip[j] = samp_in[j];
 	}
 
-	for (j = 0; j < N_CHANNELS; j++)
-		ip[j] = samp_in;
-
 	if (in_packed) {
 		tp[0] = temp_in;
 		switch(in_size) {
@@ -84,28 +93,38 @@ static void run_test(const char *name,
 	}
 
 	spa_zero(temp_out);
-	for (j = 0; j < N_CHANNELS; j++)
+	for (j = 0; j < n_channels; j++)
 		tp[j] = &temp_out[j * N_SAMPLES * out_size];
 
 	func(&conv, tp, ip, N_SAMPLES);
 
-	fprintf(stderr, "test %s:\n", name);
+	fprintf(stderr, "test %s %d channels:\n", name, n_channels);
 	if (out_packed) {
-		const uint8_t *d = tp[0], *s = samp_out;
+		const uint8_t *d = tp[0];
 		for (i = 0; i < N_SAMPLES; i++) {
-			for (j = 0; j < N_CHANNELS; j++) {
-				spa_assert(memcmp(d, s, out_size) == 0);
+			for (j = 0; j < n_channels; j++) {
+				spa_assert(memcmp(d, &samp_out[j][i * out_size], out_size) == 0);
 				d += out_size;
 			}
-			s += out_size;
 		}
 	} else {
-		for (j = 0; j < N_CHANNELS; j++) {
-			spa_assert(memcmp(tp[j], samp_out, N_SAMPLES * out_size) == 0);
+		for (j = 0; j < n_channels; j++) {
+			spa_assert(memcmp(tp[j], samp_out[j], N_SAMPLES * out_size) == 0);
 		}
 	}
 }
 
+static void run_test(const char *name,
+		const void *in, size_t in_size, const void *out, size_t out_size, size_t n_samples,
+		bool in_packed, bool out_packed, convert_func_t func)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(channel_counts); i++)
+		run_test1(name, in, in_size, out, out_size, n_samples,
+				in_packed, out_packed, func, channel_counts[i]);
+}
+
 static void test_f32_u8(void)
 {
 	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
@@ -149,6 +168,27 @@ static void test_f32_s16(void)
 			true, false, conv_f32_to_s16d_c);
 	run_test("test_f32d_s16d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_s16d_c);
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32d_s16_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s16_neon);
+		run_test1("test_f32d_s16_2_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s16_2_neon, 2);
+	}
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s16_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s16_avx2);
+		run_test1("test_f32d_s16_2_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s16_2_avx2, 2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512)
+		run_test1("test_f32d_s16_2_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s16_2_avx512, 2);
+#endif
 }
 
 static void test_s16_f32(void)
@@ -164,6 +204,27 @@ static void test_s16_f32(void)
 			true, true, conv_s16_to_f32_c);
 	run_test("test_s16d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_s16d_to_f32d_c);
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s16_f32d_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s16_to_f32d_neon);
+		run_test1("test_s16_f32d_2_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s16_to_f32d_2_neon, 2);
+	}
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s16_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s16_to_f32d_avx2);
+		run_test1("test_s16_f32d_2_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s16_to_f32d_2_avx2, 2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512)
+		run_test1("test_s16_f32d_2_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s16_to_f32d_2_avx512, 2);
+#endif
 }
 
 static void test_f32_s32(void)
@@ -180,6 +241,21 @@ static void test_f32_s32(void)
 			true, false, conv_f32_to_s32d_c);
 	run_test("test_f32d_s32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_s32d_c);
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test("test_f32d_s32_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s32_neon);
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test("test_f32d_s32_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s32_avx2);
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512)
+		run_test1("test_f32d_s32_2_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				false, true, conv_f32d_to_s32_2_avx512, 2);
+#endif
 }
 
 static void test_s32_f32(void)
@@ -195,6 +271,21 @@ static void test_s32_f32(void)
 			true, true, conv_s32_to_f32_c);
 	run_test("test_s32d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_s32d_to_f32d_c);
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test("test_s32_f32d_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s32_to_f32d_neon);
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test("test_s32_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s32_to_f32d_avx2);
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512)
+		run_test1("test_s32_f32d_2_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s32_to_f32d_2_avx512, 2);
+#endif
 }
 
 static void test_f32_s24(void)
@@ -216,6 +307,11 @@ static void test_f32_s24(void)
 			true, false, conv_f32_to_s24d_c);
 	run_test("test_f32d_s24d", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
 			false, false, conv_f32d_to_s24d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test("test_f32d_s24_avx2", in, sizeof(in[0]), out, 3, SPA_N_ELEMENTS(in),
+				false, true, conv_f32d_to_s24_avx2);
+#endif
 }
 
 static void test_s24_f32(void)
@@ -237,6 +333,45 @@ static void test_s24_f32(void)
 			true, true, conv_s24_to_f32_c);
 	run_test("test_s24d_f32d", in, 3, out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_s24d_to_f32d_c);
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test("test_s24_f32d_avx2", in, 3, out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+				true, false, conv_s24_to_f32d_avx2);
+#endif
+}
+
+static void test_f32_f32(void)
+{
+	const float in[] = { 0.0f, 1.0f, -1.0f, 0.5f, -0.5f, 1.1f, -1.1f };
+
+	run_test("test_f32_f32d", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+			true, false, conv_deinterleave_32_c);
+	run_test("test_f32d_f32", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+			false, true, conv_interleave_32_c);
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32_f32d_neon", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+				true, false, conv_deinterleave_32_neon);
+		run_test("test_f32d_f32_neon", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+				false, true, conv_interleave_32_neon);
+	}
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32_f32d_avx2", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+				true, false, conv_deinterleave_32_avx2);
+		run_test("test_f32d_f32_avx2", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+				false, true, conv_interleave_32_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test1("test_f32_f32d_2_avx512", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+				true, false, conv_deinterleave_32_2_avx512, 2);
+		run_test1("test_f32d_f32_2_avx512", in, sizeof(in[0]), in, sizeof(in[0]), SPA_N_ELEMENTS(in),
+				false, true, conv_interleave_32_2_avx512, 2);
+	}
+#endif
 }
 
 static void test_f32_s24_32(void)
@@ -270,8 +405,253 @@ static void test_s24_32_f32(void)
 			false, false, conv_s24_32d_to_f32d_c);
 }
 
+#define N_DITHER	(1 << 16)
+#define DITHER_DC	1234.3f
+#define DITHER_LP	64
+
+struct dither_stats {
+	float mean;	/* of the error */
+	float var;	/* of the error */
+	float lp_var;	/* of the error averaged over DITHER_LP samples */
+	float max;	/* largest absolute error */
+};
+
+/* convert N_DITHER samples of in on every channel with a new converter,
+ * so that the noise is the same for every call. The conversion is done in
+ * odd sized blocks so that the unrolled loops and the tails of the SIMD
+ * versions are used. */
+static void dither_convert(uint32_t dst_fmt, uint32_t method, uint32_t n_channels,
+		uint32_t flags, convert_func_t func, const float *in, void *out)
+{
+	const void *ip[N_CHANNELS];
+	void *op[1];
+	struct convert conv;
+	uint32_t i, n, chunk, size = dst_fmt == SPA_AUDIO_FORMAT_S16 ? 2 : 3;
+
+	spa_zero(conv);
+	conv.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	conv.dst_fmt = dst_fmt;
+	conv.n_channels = n_channels;
+	conv.cpu_flags = flags;
+	conv.method = method;
+	spa_assert(convert_init(&conv) == 0);
+	spa_assert(conv.method == method);
+	conv.process = func;
+
+	for (n = 0; n < N_DITHER; n += chunk) {
+		chunk = SPA_MIN(1021u, N_DITHER - n);
+		for (i = 0; i < n_channels; i++)
+			ip[i] = &in[n];
+		op[0] = SPA_MEMBER(out, n * n_channels * size, void);
+		convert_process(&conv, op, ip, chunk);
+	}
+	convert_free(&conv);
+}
+
+/* convert a DC value that sits between two quantization steps and measure
+ * the error on every channel */
+static void run_dither(const char *name, uint32_t dst_fmt, uint32_t method,
+		uint32_t n_channels, uint32_t flags, convert_func_t func,
+		struct dither_stats *stats)
+{
+	static float in[N_DITHER];
+	static uint8_t out[N_DITHER * N_CHANNELS * 3];
+	uint32_t i, j, size = dst_fmt == SPA_AUDIO_FORMAT_S16 ? 2 : 3;
+	float scale = dst_fmt == SPA_AUDIO_FORMAT_S16 ? S16_SCALE : S24_SCALE;
+	double sum, sum2, lp_sum2, lp;
+
+	for (j = 0; j < N_DITHER; j++)
+		in[j] = DITHER_DC / scale;
+
+	dither_convert(dst_fmt, method, n_channels, flags, func, in, out);
+
+	spa_zero(*stats);
+	for (i = 0; i < n_channels; i++) {
+		sum = sum2 = lp_sum2 = lp = 0.0;
+		for (j = 0; j < N_DITHER; j++) {
+			const uint8_t *o = &out[(j * n_channels + i) * size];
+			int32_t v = size == 2 ? *(int16_t*)o : read_s24(o);
+			double err = v - DITHER_DC;
+
+			sum += err;
+			sum2 += err * err;
+			lp += err;
+			if ((j % DITHER_LP) == DITHER_LP - 1) {
+				lp_sum2 += lp * lp / DITHER_LP;
+				lp = 0.0;
+			}
+			stats->max = SPA_MAX(stats->max, (float)fabs(err));
+		}
+		stats->mean += sum / N_DITHER / n_channels;
+		stats->var += (sum2 / N_DITHER - (sum / N_DITHER) * (sum / N_DITHER)) / n_channels;
+		stats->lp_var += lp_sum2 / (N_DITHER / DITHER_LP) / n_channels;
+	}
+	fprintf(stderr, "test %s %d channels: mean %f var %f lp_var %f max %f\n",
+			name, n_channels, stats->mean, stats->var, stats->lp_var, stats->max);
+}
+
+static void check_dither(const char *name, uint32_t dst_fmt, uint32_t method,
+		uint32_t flags, convert_func_t func)
+{
+	static const uint32_t counts[] = { 1, 2, 3, 4, 7 };
+	struct dither_stats st, tpdf;
+	uint32_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(counts); i++) {
+		run_dither(name, dst_fmt, method, counts[i], flags, func, &st);
+
+		/* without dither the error would be a constant -0.3, the
+		 * dither makes the average output match the input */
+		spa_assert(fabsf(st.mean) < 0.02f);
+
+		switch (method) {
+		case DITHER_METHOD_RECTANGULAR:
+			/* the error power depends on the signal, 0.3 * 0.7 here */
+			spa_assert(st.var > 0.18f && st.var < 0.24f);
+			spa_assert(st.max <= 1.0f);
+			break;
+		case DITHER_METHOD_TRIANGULAR:
+			/* 2/12 of noise plus 1/12 of quantization error */
+			spa_assert(st.var > 0.21f && st.var < 0.29f);
+			spa_assert(st.lp_var > 0.15f && st.lp_var < 0.35f);
+			spa_assert(st.max <= 2.0f);
+			break;
+		default:
+			/* more noise in total but much less of it at the low
+			 * frequencies than with plain triangular dither */
+			run_dither("tpdf", dst_fmt, DITHER_METHOD_TRIANGULAR, counts[i],
+					0, dst_fmt == SPA_AUDIO_FORMAT_S16 ?
+					conv_f32d_to_s16_dither_c : conv_f32d_to_s24_dither_c, &tpdf);
+			spa_assert(st.var > tpdf.var);
+			spa_assert(st.lp_var < tpdf.lp_var * 0.5f);
+			spa_assert(st.max < 16.0f);
+			break;
+		}
+	}
+}
+
+static void run_dither_2(const char *name, uint32_t method, convert_func_t func)
+{
+	struct dither_stats st;
+
+	run_dither(name, SPA_AUDIO_FORMAT_S16, method, 2, cpu_flags, func, &st);
+	spa_assert(fabsf(st.mean) < 0.02f);
+	if (method == DITHER_METHOD_RECTANGULAR)
+		spa_assert(st.var > 0.18f && st.var < 0.24f);
+	else
+		spa_assert(st.var > 0.21f && st.var < 0.29f);
+}
+
+/* F32_TO_S16_D clamps the input before the noise is added. Samples beyond
+ * full scale must give the same output as full scale, the noise must not
+ * be lost in the clamping. A single channel uses the noise in the same
+ * order in all versions, that output must match the C version exactly. */
+static void check_dither_full_scale(const char *name, uint32_t method,
+		uint32_t n_channels, uint32_t flags, convert_func_t func)
+{
+	static float in[N_DITHER], clamped[N_DITHER];
+	static int16_t out[N_DITHER * N_CHANNELS], ref[N_DITHER * N_CHANNELS];
+	uint32_t j;
+
+	for (j = 0; j < N_DITHER; j++) {
+		/* full scale, beyond and just below it, for both signs */
+		in[j] = (j & 1 ? 1.0f : -1.0f) * (0.9999f + (j % 5) * 0.25f);
+		clamped[j] = SPA_CLAMP(in[j], -1.0f, 1.0f);
+	}
+
+	dither_convert(SPA_AUDIO_FORMAT_S16, method, n_channels, flags, func, in, out);
+	dither_convert(SPA_AUDIO_FORMAT_S16, method, n_channels, flags, func, clamped, ref);
+	spa_assert(memcmp(out, ref, N_DITHER * n_channels * sizeof(int16_t)) == 0);
+
+	if (n_channels == 1) {
+		dither_convert(SPA_AUDIO_FORMAT_S16, method, 1, 0,
+				conv_f32d_to_s16_dither_c, in, ref);
+		spa_assert(memcmp(out, ref, N_DITHER * sizeof(int16_t)) == 0);
+	}
+	fprintf(stderr, "test %s full scale %d channels\n", name, n_channels);
+}
+
+static void test_f32_s16_dither(void)
+{
+	static const uint32_t counts[] = { 1, 2, 3, 4, 7 };
+	uint32_t i, method;
+
+	for (method = DITHER_METHOD_RECTANGULAR; method <= DITHER_METHOD_TRIANGULAR; method++) {
+		check_dither("test_f32d_s16_dither", SPA_AUDIO_FORMAT_S16, method,
+				0, conv_f32d_to_s16_dither_c);
+		check_dither("test_f32d_s24_dither", SPA_AUDIO_FORMAT_S24, method,
+				0, conv_f32d_to_s24_dither_c);
+#if defined(HAVE_SSE2)
+		if (cpu_flags & SPA_CPU_FLAG_SSE2)
+			check_dither("test_f32d_s16_dither_sse2", SPA_AUDIO_FORMAT_S16, method,
+					SPA_CPU_FLAG_SSE2, conv_f32d_to_s16_dither_sse2);
+#endif
+#if defined(HAVE_AVX2)
+		if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+			check_dither("test_f32d_s16_dither_avx2", SPA_AUDIO_FORMAT_S16, method,
+					SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_dither_avx2);
+			run_dither_2("test_f32d_s16_dither_2_avx2", method,
+					conv_f32d_to_s16_dither_2_avx2);
+		}
+#endif
+		for (i = 0; i < SPA_N_ELEMENTS(counts); i++) {
+			check_dither_full_scale("test_f32d_s16_dither", method, counts[i],
+					0, conv_f32d_to_s16_dither_c);
+#if defined(HAVE_SSE2)
+			if (cpu_flags & SPA_CPU_FLAG_SSE2)
+				check_dither_full_scale("test_f32d_s16_dither_sse2", method,
+						counts[i], SPA_CPU_FLAG_SSE2,
+						conv_f32d_to_s16_dither_sse2);
+#endif
+#if defined(HAVE_AVX2)
+			if (cpu_flags & SPA_CPU_FLAG_AVX2)
+				check_dither_full_scale("test_f32d_s16_dither_avx2", method,
+						counts[i], SPA_CPU_FLAG_AVX2,
+						conv_f32d_to_s16_dither_avx2);
+#endif
+		}
+#if defined(HAVE_AVX2)
+		if (cpu_flags & SPA_CPU_FLAG_AVX2)
+			check_dither_full_scale("test_f32d_s16_dither_2_avx2", method, 2,
+					SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_dither_2_avx2);
+#endif
+	}
+	for (method = DITHER_METHOD_WANNAMAKER_3; method <= DITHER_METHOD_LIPSHITZ_5; method++) {
+		check_dither("test_f32d_s16_shaped", SPA_AUDIO_FORMAT_S16, method,
+				cpu_flags, conv_f32d_to_s16_shaped_c);
+		check_dither("test_f32d_s24_shaped", SPA_AUDIO_FORMAT_S24, method,
+				cpu_flags, conv_f32d_to_s24_shaped_c);
+	}
+}
+
+static void test_dither_fallback(void)
+{
+	struct convert conv;
+
+	/* no dither for formats that don't need it */
+	spa_zero(conv);
+	conv.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	conv.dst_fmt = SPA_AUDIO_FORMAT_S32;
+	conv.n_channels = 2;
+	conv.method = DITHER_METHOD_TRIANGULAR;
+	spa_assert(convert_init(&conv) == 0);
+	spa_assert(conv.method == DITHER_METHOD_NONE);
+	spa_assert(conv.process == conv_f32d_to_s32_c);
+
+	/* too many channels for the shaper */
+	spa_zero(conv);
+	conv.src_fmt = SPA_AUDIO_FORMAT_F32P;
+	conv.dst_fmt = SPA_AUDIO_FORMAT_S16;
+	conv.n_channels = MAX_NS + 1;
+	conv.method = DITHER_METHOD_LIPSHITZ_5;
+	spa_assert(convert_init(&conv) == 0);
+	spa_assert(conv.method == DITHER_METHOD_TRIANGULAR);
+	spa_assert(conv.process == conv_f32d_to_s16_dither_c);
+}
+
 int main(int argc, char *argv[])
 {
+	cpu_flags = get_cpu_flags();
 
 	test_f32_u8();
 	test_u8_f32();
@@ -281,7 +661,10 @@ int main(int argc, char *argv[])
 	test_s32_f32();
 	test_f32_s24();
 	test_s24_f32();
+	test_f32_f32();
 	test_f32_s24_32();
 	test_s24_32_f32();
+	test_f32_s16_dither();
+	test_dither_fallback();
 	return 0;
 }
@@ -0,0 +1,286 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+
+#include <spa/utils/names.h>
+#include <spa/support/plugin.h>
+#include <spa/support/cpu.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/alloc.h>
+#include <spa/support/log-impl.h>
+
+SPA_LOG_IMPL(logger);
+
+#include "meter-ops.c"
+#include "../test-cpu.h"
+
+#define N_SAMPLES	4801
+#define N_CHANNELS	3
+
+static float samples[N_CHANNELS][N_SAMPLES];
+
+/* channel c is a sine of amplitude 0.25 * (c + 1) at rate/4, sampled 45
+ * degrees off its peaks */
+static void fill_samples(void)
+{
+	static const float sine[4] = { M_SQRT1_2, M_SQRT1_2, -M_SQRT1_2, -M_SQRT1_2 };
+	uint32_t c, n;
+
+	for (c = 0; c < N_CHANNELS; c++)
+		for (n = 0; n < N_SAMPLES; n++)
+			samples[c][n] = 0.25f * (c + 1) * sine[n & 3];
+}
+
+static void run_meter(struct meter *m, uint32_t block)
+{
+	const void *src[N_CHANNELS];
+	uint32_t c, n, chunk;
+
+	for (n = 0; n < N_SAMPLES; n += chunk) {
+		chunk = SPA_MIN(block, N_SAMPLES - n);
+		for (c = 0; c < N_CHANNELS; c++)
+			src[c] = &samples[c][n];
+		meter_process(m, N_CHANNELS, src, chunk);
+	}
+	spa_assert(m->n_samples == N_SAMPLES);
+}
+
+static void test_levels(uint32_t cpu_flags, uint32_t options)
+{
+	struct meter m;
+	uint32_t c, block;
+	static const uint32_t blocks[] = { N_SAMPLES, 1024, 7, 3, 1 };
+
+	for (block = 0; block < SPA_N_ELEMENTS(blocks); block++) {
+		spa_zero(m);
+		m.channels = N_CHANNELS;
+		m.cpu_flags = cpu_flags;
+		m.options = options;
+		spa_assert(meter_init(&m) == 0);
+
+		fprintf(stderr, "cpu:%08x options:%08x block:%d\n",
+				m.cpu_flags, options, blocks[block]);
+
+		run_meter(&m, blocks[block]);
+
+		for (c = 0; c < N_CHANNELS; c++) {
+			float level = 0.25f * (c + 1);
+
+			spa_assert(fabsf(m.peak[c] - level * (float)M_SQRT1_2) < 1e-5f);
+			spa_assert(fabsf(meter_rms(&m, c) - level * (float)M_SQRT1_2) < 1e-4f);
+
+			if (options & METER_OPTION_TRUE_PEAK) {
+				fprintf(stderr, "%d: true peak %f level %f\n",
+						c, m.true_peak[c], level);
+				spa_assert(fabsf(m.true_peak[c] - level) < level * 0.01f);
+			}
+			else
+				spa_assert(m.true_peak[c] == 0.0f);
+		}
+		meter_free(&m);
+	}
+}
+
+static void test_taps(void)
+{
+	struct meter m;
+	uint32_t i, j;
+
+	spa_zero(m);
+	m.channels = 1;
+	m.options = METER_OPTION_TRUE_PEAK;
+	spa_assert(meter_init(&m) == 0);
+
+	for (j = 0; j < METER_TP_PHASES; j++) {
+		float sum = 0.0f;
+		for (i = 0; i < METER_TP_TAPS; i++)
+			sum += m.taps[i][j];
+		spa_assert(fabsf(sum - 1.0f) < 1e-6f);
+	}
+	/* phase 0 is the sample itself */
+	for (i = 0; i < METER_TP_TAPS; i++)
+		spa_assert(fabsf(m.taps[i][0] - (i == METER_TP_TAPS / 2 - 1 ? 1.0f : 0.0f)) < 1e-6f);
+}
+
+static const struct spa_handle_factory *find_factory(const char *name)
+{
+	uint32_t index = 0;
+	const struct spa_handle_factory *factory;
+
+	while (spa_handle_factory_enum(&factory, &index) == 1) {
+		if (strcmp(factory->name, name) == 0)
+			return factory;
+	}
+	return NULL;
+}
+
+static void test_node(void)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	struct spa_node *node;
+	struct spa_support support[1];
+	struct spa_dict_item items[2];
+	struct spa_pod_builder b = { 0 };
+	struct spa_data datas[N_CHANNELS];
+	struct spa_audio_info_raw info;
+	struct spa_io_buffers inio;
+	struct spa_buffer **buffers;
+	struct spa_pod *param;
+	uint32_t c, i, aligns[N_CHANNELS], cycle = 1024;
+	static struct spa_io_meter meter;
+	uint8_t buffer[1024];
+	void *iface;
+	int res;
+
+	support[0] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_Log, &logger);
+	items[0] = SPA_DICT_ITEM_INIT("meter.window", "20");
+	items[1] = SPA_DICT_ITEM_INIT("meter.true-peak", "1");
+
+	factory = find_factory(SPA_NAME_AUDIO_PROCESS_METER);
+	spa_assert(factory != NULL);
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	res = spa_handle_factory_init(factory, handle,
+			&SPA_DICT_INIT_ARRAY(items), support, 1);
+	spa_assert(res >= 0);
+	res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert(res >= 0);
+	node = iface;
+
+	spa_assert(spa_node_port_set_io(node, SPA_DIRECTION_OUTPUT, 0,
+				SPA_IO_Buffers, &inio, sizeof(inio)) == -EINVAL);
+	spa_assert(spa_node_set_io(node, SPA_IO_Meter, &meter, 16) == -EINVAL);
+
+	spa_zero(info);
+	info.format = SPA_AUDIO_FORMAT_F32P;
+	info.rate = 48000;
+	info.channels = N_CHANNELS;
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	res = spa_node_port_set_param(node, SPA_DIRECTION_INPUT, 0, SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+
+	memset(datas, 0, sizeof(datas));
+	for (c = 0; c < N_CHANNELS; c++) {
+		datas[c].type = SPA_DATA_MemPtr;
+		datas[c].maxsize = cycle * sizeof(float);
+		aligns[c] = 16;
+	}
+	buffers = spa_buffer_alloc_array(1, 0, 0, NULL, N_CHANNELS, datas, aligns);
+	spa_assert(buffers != NULL);
+
+	res = spa_node_port_use_buffers(node, SPA_DIRECTION_INPUT, 0, 0, buffers, 1);
+	spa_assert(res == 0);
+
+	inio = SPA_IO_BUFFERS_INIT;
+	res = spa_node_port_set_io(node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_Buffers, &inio, sizeof(inio));
+	spa_assert(res == 0);
+	res = spa_node_set_io(node, SPA_IO_Meter, &meter, sizeof(meter));
+	spa_assert(res == 0);
+
+	/* 20ms at 48000 is 960 samples, 4 cycles of 1024 samples
+	 * complete 4 windows */
+	for (i = 0; i < 4; i++) {
+		for (c = 0; c < N_CHANNELS; c++) {
+			memcpy(buffers[0]->datas[c].data, &samples[c][i * cycle],
+					cycle * sizeof(float));
+			buffers[0]->datas[c].chunk->offset = 0;
+			buffers[0]->datas[c].chunk->size = cycle * sizeof(float);
+		}
+		inio.status = SPA_STATUS_HAVE_DATA;
+		inio.buffer_id = 0;
+
+		res = spa_node_process(node);
+		spa_assert(res == SPA_STATUS_NEED_DATA);
+		spa_assert(inio.status == SPA_STATUS_NEED_DATA);
+	}
+	spa_assert(meter.count == 4);
+	spa_assert((meter.seq & 1) == 0);
+	spa_assert(meter.seq == 8);
+	spa_assert(meter.n_channels == N_CHANNELS);
+	spa_assert(meter.window == 960);
+
+	for (c = 0; c < N_CHANNELS; c++) {
+		float level = 0.25f * (c + 1);
+		struct spa_io_meter_channel *ch = &meter.channels[c];
+
+		fprintf(stderr, "%d: peak:%f rms:%f true-peak:%f\n",
+				c, ch->peak, ch->rms, ch->true_peak);
+		spa_assert(fabsf(ch->peak - level * (float)M_SQRT1_2) < 1e-5f);
+		spa_assert(fabsf(ch->rms - level * (float)M_SQRT1_2) < 1e-4f);
+		spa_assert(fabsf(ch->true_peak - level) < level * 0.01f);
+	}
+
+	/* a format with more channels than the buffers have datas only
+	 * meters the channels that are there */
+	info.channels = N_CHANNELS + 1;
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info);
+	res = spa_node_port_set_param(node, SPA_DIRECTION_INPUT, 0, SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+
+	inio.status = SPA_STATUS_HAVE_DATA;
+	inio.buffer_id = 0;
+	res = spa_node_process(node);
+	spa_assert(res == SPA_STATUS_NEED_DATA);
+
+	spa_handle_clear(handle);
+	free(handle);
+	free(buffers);
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t cpu_flags = get_cpu_flags();
+
+	logger.log.level = SPA_LOG_LEVEL_TRACE;
+
+	fill_samples();
+
+	test_taps();
+
+	test_levels(0, 0);
+	test_levels(0, METER_OPTION_TRUE_PEAK);
+	if (cpu_flags & SPA_CPU_FLAG_SSE) {
+		test_levels(SPA_CPU_FLAG_SSE, 0);
+		test_levels(SPA_CPU_FLAG_SSE, METER_OPTION_TRUE_PEAK);
+	}
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		test_levels(SPA_CPU_FLAG_AVX2, 0);
+		test_levels(SPA_CPU_FLAG_AVX2, METER_OPTION_TRUE_PEAK);
+	}
+
+	test_node();
+
+	return 0;
+}
@@ -36,6 +36,7 @@ SPA_LOG_IMPL(logger);
 
 #include "resample.h"
 #include "resample-native.h"
+#include "../test-cpu.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -76,6 +77,7 @@ static void test_native(void)
 	impl_native_init(&r);
 
 	feed_1(&r);
+	resample_free(&r);
 
 	spa_zero(r);
 	r.log = &logger.log;
@@ -86,10 +88,12 @@ static void test_native(void)
 	impl_native_init(&r);
 
 	feed_1(&r);
+	resample_free(&r);
 }
 
 static void pull_blocks(struct resample *r, uint32_t size)
 {
+	struct native_data *d = r->data;
 	uint32_t i;
 	float in[size];
 	float out[size];
@@ -111,7 +115,11 @@ static void pull_blocks(struct resample *r, uint32_t size)
 				in_len, pin_len, out_len, pout_len,
 				resample_in_len(r, size));
 
-		spa_assert(in_len == pin_len + (resample_delay(r) * 2));
+		/* the filter length stays in the history, for the linear
+		 * phase filter that is twice the delay */
+		spa_assert(in_len == pin_len + d->n_taps);
+		if (!SPA_FLAG_IS_SET(r->options, RESAMPLE_OPTION_MINIMUM_PHASE))
+			spa_assert(d->n_taps == resample_delay(r) * 2);
 		spa_assert(out_len == pout_len);
 	}
 }
@@ -129,6 +137,7 @@ static void test_in_len(void)
 	impl_native_init(&r);
 
 	pull_blocks(&r, 1024);
+	resample_free(&r);
 
 	spa_zero(r);
 	r.log = &logger.log;
@@ -139,6 +148,7 @@ static void test_in_len(void)
 	impl_native_init(&r);
 
 	pull_blocks(&r, 1024);
+	resample_free(&r);
 
 	spa_zero(r);
 	r.log = &logger.log;
@@ -149,6 +159,241 @@ static void test_in_len(void)
 	impl_native_init(&r);
 
 	pull_blocks(&r, 1024);
+	resample_free(&r);
+
+	spa_zero(r);
+	r.log = &logger.log;
+	r.channels = 1;
+	r.i_rate = 44100;
+	r.o_rate = 48000;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
+	r.options = RESAMPLE_OPTION_MINIMUM_PHASE;
+	impl_native_init(&r);
+
+	pull_blocks(&r, 1024);
+	resample_free(&r);
+}
+
+#define N_PROCESS_CHANNELS	3
+
+static uint32_t run_process(uint32_t cpu_flags, uint32_t i_rate, uint32_t o_rate,
+		double rate, float in[][1024], uint32_t in_len, float out[][2048], uint32_t out_len)
+{
+	struct resample r;
+	const void *src[N_PROCESS_CHANNELS];
+	void *dst[N_PROCESS_CHANNELS];
+	uint32_t c;
+
+	spa_zero(r);
+	r.log = &logger.log;
+	r.cpu_flags = cpu_flags;
+	r.channels = N_PROCESS_CHANNELS;
+	r.i_rate = i_rate;
+	r.o_rate = o_rate;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
+	impl_native_init(&r);
+	if (rate != 1.0)
+		resample_update_rate(&r, rate);
+
+	for (c = 0; c < N_PROCESS_CHANNELS; c++) {
+		src[c] = in[c];
+		dst[c] = out[c];
+	}
+	resample_process(&r, src, &in_len, dst, &out_len);
+	resample_free(&r);
+
+	return out_len;
+}
+
+/* the SIMD versions of the full and interpolating resampler must produce
+ * the same result as the C version, up to rounding. Use an odd number of
+ * channels for the versions that process channels in pairs and a rate
+ * that needs a number of taps that is not a multiple of 16. */
+static void test_process(void)
+{
+	static const struct {
+		uint32_t i_rate;
+		uint32_t o_rate;
+		double rate;
+	} tests[] = {
+		{ 44100, 48000, 1.0 },
+		{ 48000, 44100, 1.0 },
+		{ 32000, 48000, 1.0 },
+		{ 48000, 32000, 1.0 },
+		{ 44100, 48000, 1.001 },
+		{ 44100, 48000, 0.99 },
+		{ 48000, 48000, 0.999 },
+		{ 48000, 32000, 1.01 },
+	};
+	uint32_t cpu_flags = get_cpu_flags();
+	uint32_t i, c, n, len[2];
+	static float in[N_PROCESS_CHANNELS][1024], out[2][N_PROCESS_CHANNELS][2048];
+
+	for (c = 0; c < N_PROCESS_CHANNELS; c++)
+		for (n = 0; n < SPA_N_ELEMENTS(in[c]); n++)
+			in[c][n] = sinf(n * 0.1f * (c + 1)) * 0.9f;
+
+	for (i = 0; i < SPA_N_ELEMENTS(tests); i++) {
+		len[0] = run_process(0, tests[i].i_rate, tests[i].o_rate, tests[i].rate,
+				in, SPA_N_ELEMENTS(in[0]), out[0], SPA_N_ELEMENTS(out[0][0]));
+		len[1] = run_process(cpu_flags, tests[i].i_rate, tests[i].o_rate, tests[i].rate,
+				in, SPA_N_ELEMENTS(in[0]), out[1], SPA_N_ELEMENTS(out[1][0]));
+
+		fprintf(stderr, "%d->%d rate %f cpu_flags %08x: %d samples\n",
+				tests[i].i_rate, tests[i].o_rate, tests[i].rate, cpu_flags, len[0]);
+
+		spa_assert(len[0] == len[1]);
+		for (c = 0; c < N_PROCESS_CHANNELS; c++)
+			for (n = 0; n < len[0]; n++)
+				spa_assert(fabsf(out[0][c][n] - out[1][c][n]) < 1e-5f);
+	}
+}
+
+static void test_filter_cache(void)
+{
+	struct resample r[3];
+	struct native_data *d[3];
+	float *taps;
+	uint32_t i;
+
+	for (i = 0; i < 3; i++) {
+		spa_zero(r[i]);
+		r[i].log = &logger.log;
+		r[i].channels = i + 1;
+		r[i].i_rate = i == 1 ? 88200 : 44100;
+		r[i].o_rate = i == 1 ? 96000 : 48000;
+		r[i].quality = i == 2 ? 2 : RESAMPLE_DEFAULT_QUALITY;
+		spa_assert(impl_native_init(&r[i]) == 0);
+		d[i] = r[i].data;
+	}
+
+	/* same reduced rates and quality share the filter, a different
+	 * quality does not */
+	spa_assert(d[0]->shared == d[1]->shared);
+	spa_assert(d[0]->filter == d[1]->filter);
+	spa_assert(d[0]->shared->ref == 2);
+	spa_assert(d[2]->shared != d[0]->shared);
+	spa_assert(d[2]->shared->ref == 1);
+
+	/* the filter stays alive as long as one user remains */
+	taps = d[1]->filter;
+	resample_free(&r[0]);
+	spa_assert(d[1]->shared->ref == 1);
+	spa_assert(d[1]->filter == taps);
+
+	resample_free(&r[1]);
+	resample_free(&r[2]);
+	spa_assert(spa_list_is_empty(&filter_cache.filters));
+}
+
+#define N_RESPONSE	8192
+
+static uint32_t run_response(uint32_t options, uint32_t i_rate, uint32_t o_rate,
+		const float *in, float *out, uint32_t *delay)
+{
+	struct resample r;
+	const void *src[1] = { in };
+	void *dst[1] = { out };
+	uint32_t in_len = N_RESPONSE, out_len = N_RESPONSE;
+
+	spa_zero(r);
+	r.log = &logger.log;
+	r.channels = 1;
+	r.i_rate = i_rate;
+	r.o_rate = o_rate;
+	r.quality = RESAMPLE_DEFAULT_QUALITY;
+	r.options = options;
+	spa_assert(impl_native_init(&r) == 0);
+	*delay = resample_delay(&r);
+	resample_process(&r, src, &in_len, dst, &out_len);
+	resample_free(&r);
+
+	return out_len;
+}
+
+/* gain in dB of a sine of freq Hz, measured away from the edges */
+static double measure_gain(uint32_t options, uint32_t i_rate, uint32_t o_rate, double freq)
+{
+	static float in[N_RESPONSE], out[N_RESPONSE];
+	uint32_t n, len, delay;
+	double sum = 0.0;
+
+	for (n = 0; n < N_RESPONSE; n++)
+		in[n] = sin(2.0 * M_PI * freq * n / i_rate);
+
+	len = run_response(options, i_rate, o_rate, in, out, &delay);
+	spa_assert(len > 1024);
+
+	for (n = 512; n < len - 512; n++)
+		sum += out[n] * out[n];
+
+	return 10.0 * log10(sum / (len - 1024) * 2.0);
+}
+
+/* position of the centroid of the response to an impulse, in output samples */
+static double measure_centroid(uint32_t options, uint32_t i_rate, uint32_t o_rate,
+		uint32_t pos, uint32_t *delay)
+{
+	static float in[N_RESPONSE], out[N_RESPONSE];
+	uint32_t n, len;
+	double num = 0.0, den = 0.0;
+
+	spa_zero(in);
+	in[pos] = 1.0f;
+
+	len = run_response(options, i_rate, o_rate, in, out, delay);
+
+	for (n = 0; n < len; n++) {
+		num += (double)n * out[n];
+		den += out[n];
+	}
+	return num / den;
+}
+
+/* the minimum phase filter keeps the magnitude response of the linear
+ * phase filter. Its output stays aligned with the input and only the delay,
+ * the input needed after a sample before it can be output, is smaller */
+static void test_minimum_phase(void)
+{
+	static const struct {
+		uint32_t i_rate;
+		uint32_t o_rate;
+	} tests[] = {
+		{ 48000, 32000 },
+		{ 44100, 48000 },
+	};
+	uint32_t i, delay[2];
+	double pos, expected;
+
+	for (i = 0; i < SPA_N_ELEMENTS(tests); i++) {
+		uint32_t i_rate = tests[i].i_rate, o_rate = tests[i].o_rate;
+		double pass[2], stop[2];
+
+		expected = 3000.0 * o_rate / i_rate;
+
+		pos = measure_centroid(0, i_rate, o_rate, 3000, &delay[0]);
+		spa_assert(fabs(pos - expected) < 1.0);
+		pos = measure_centroid(RESAMPLE_OPTION_MINIMUM_PHASE, i_rate, o_rate, 3000, &delay[1]);
+		spa_assert(fabs(pos - expected) < 1.0);
+
+		pass[0] = measure_gain(0, i_rate, o_rate, 1000.0);
+		pass[1] = measure_gain(RESAMPLE_OPTION_MINIMUM_PHASE, i_rate, o_rate, 1000.0);
+		stop[0] = measure_gain(0, i_rate, o_rate, 20000.0);
+		stop[1] = measure_gain(RESAMPLE_OPTION_MINIMUM_PHASE, i_rate, o_rate, 20000.0);
+
+		fprintf(stderr, "%d->%d delay %d/%d pass %f/%f stop %f/%f\n",
+				i_rate, o_rate, delay[0], delay[1],
+				pass[0], pass[1], stop[0], stop[1]);
+
+		spa_assert(delay[1] * 3 < delay[0]);
+		spa_assert(fabs(pass[0]) < 0.1);
+		spa_assert(fabs(pass[1]) < 0.1);
+		if (o_rate < i_rate) {
+			/* 20kHz is above the output nyquist and must be removed */
+			spa_assert(stop[0] < -50.0);
+			spa_assert(stop[1] < -50.0);
+		}
+	}
 }
 
 int main(int argc, char *argv[])
@@ -157,6 +402,9 @@ int main(int argc, char *argv[])
 
 	test_native();
 	test_in_len();
+	test_process();
+	test_filter_cache();
+	test_minimum_phase();
 
 	return 0;
 }
@@ -25,12 +25,14 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/cpu.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
+#include <spa/utils/ringbuffer.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
 #include <spa/node/io.h>
@@ -44,7 +46,9 @@
 
 #define MAX_SAMPLES     8192
 #define MAX_BUFFERS     64
-#define MAX_PORTS       128
+#define MAX_PORTS       512
+
+#define DEFAULT_JITTER_LATENCY	256
 
 #define PORT_DEFAULT_VOLUME	1.0
 #define PORT_DEFAULT_MUTE	false
@@ -86,12 +90,28 @@ struct port {
 
 	unsigned int valid:1;
 	unsigned int have_format:1;
+	unsigned int priming:1;		/* jitter buffer is filling up to the latency */
 
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
 
 	struct spa_list queue;
 	size_t queued_bytes;
+
+	/* jitter buffer with MAX_SAMPLES of extra space after ring_size to
+	 * make reads that wrap around contiguous. ring_size is a power of two
+	 * so that the offsets stay valid when the ringbuffer index wraps. */
+	struct spa_ringbuffer ring;
+	uint8_t *ring_data;
+	uint32_t ring_size;
+};
+
+/* the input data of a port in the default mode, the data wraps around
+ * at maxsize */
+struct mix_input {
+	void *data;
+	uint32_t offset;
+	uint32_t maxsize;
 };
 
 struct impl {
@@ -104,6 +124,17 @@ struct impl {
 
 	struct mix_ops ops;
 
+	struct spa_io_position *position;
+
+	/* jitter buffer mode, inputs are copied into a ring per port so that
+	 * a late input does not stall the mix. The latencies are in samples. */
+	bool jitter;
+	uint32_t jitter_latency;
+	uint32_t jitter_max;
+	uint32_t quantum;
+	struct mix_input mix_in[MAX_PORTS];
+	const void *mix_src[MAX_PORTS];
+
 	uint64_t info_all;
 	struct spa_node_info info;
 	struct spa_param_info params[8];
@@ -112,22 +143,24 @@ struct impl {
 
 	uint32_t port_count;
 	uint32_t last_port;
-	struct port in_ports[MAX_PORTS];
+	struct port *in_ports[MAX_PORTS];
 	struct port out_ports[1];
 
 	bool have_format;
 	int n_formats;
 	struct spa_audio_info format;
+	uint32_t stride;
 	uint32_t bpf;
 
 	bool started;
 };
 
-#define CHECK_FREE_IN_PORT(this,d,p) ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && !this->in_ports[(p)].valid)
-#define CHECK_IN_PORT(this,d,p)      ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && this->in_ports[(p)].valid)
+#define PORT_VALID(p)                ((p) != NULL && (p)->valid)
+#define CHECK_FREE_IN_PORT(this,d,p) ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && !PORT_VALID(this->in_ports[(p)]))
+#define CHECK_IN_PORT(this,d,p)      ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && PORT_VALID(this->in_ports[(p)]))
 #define CHECK_OUT_PORT(this,d,p)     ((d) == SPA_DIRECTION_OUTPUT && (p) == 0)
 #define CHECK_PORT(this,d,p)         (CHECK_OUT_PORT(this,d,p) || CHECK_IN_PORT (this,d,p))
-#define GET_IN_PORT(this,p)          (&this->in_ports[p])
+#define GET_IN_PORT(this,p)          (this->in_ports[p])
 #define GET_OUT_PORT(this,p)         (&this->out_ports[p])
 #define GET_PORT(this,d,p)           (d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,p) : GET_OUT_PORT(this,p))
 
@@ -146,7 +179,18 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 
 static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
 {
-	return -ENOTSUP;
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	switch (id) {
+	case SPA_IO_Position:
+		this->position = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
 }
 
 static int impl_node_send_command(void *object, const struct spa_command *command)
@@ -206,7 +250,7 @@ static int impl_node_add_listener(void *object,
 	emit_node_info(this, true);
 	emit_port_info(this, GET_OUT_PORT(this, 0), true);
 	for (i = 0; i < this->last_port; i++) {
-		if (this->in_ports[i].valid)
+		if (PORT_VALID(this->in_ports[i]))
 			emit_port_info(this, GET_IN_PORT(this, i), true);
 	}
 
@@ -233,6 +277,12 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	spa_return_val_if_fail(CHECK_FREE_IN_PORT(this, direction, port_id), -EINVAL);
 
 	port = GET_IN_PORT(this, port_id);
+	if (port == NULL) {
+		port = calloc(1, sizeof(struct port));
+		if (port == NULL)
+			return -errno;
+		this->in_ports[port_id] = port;
+	}
 	port->valid = true;
 	port->direction = SPA_DIRECTION_INPUT;
 	port->id = port_id;
@@ -282,13 +332,14 @@ impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_
 		if (--this->n_formats == 0)
 			this->have_format = false;
 	}
+	free(port->ring_data);
 	spa_memzero(port, sizeof(struct port));
 
 	if (port_id == this->last_port + 1) {
 		int i;
 
 		for (i = this->last_port; i >= 0; i--)
-			if (GET_IN_PORT (this, i)->valid)
+			if (PORT_VALID(GET_IN_PORT(this, i)))
 				break;
 
 		this->last_port = i + 1;
@@ -322,10 +373,12 @@ static int port_enum_formats(void *object,
 				SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
 				SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 				SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-				SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Int(3,
+				SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Int(5,
 								SPA_AUDIO_FORMAT_S16,
 								SPA_AUDIO_FORMAT_S16,
-								SPA_AUDIO_FORMAT_F32),
+								SPA_AUDIO_FORMAT_S32,
+								SPA_AUDIO_FORMAT_F32,
+								SPA_AUDIO_FORMAT_F64),
 				SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(44100, 1, INT32_MAX),
 				SPA_FORMAT_AUDIO_channels, SPA_POD_CHOICE_RANGE_Int(2, 1, INT32_MAX));
 		}
@@ -434,6 +487,20 @@ impl_node_port_enum_params(void *object, int seq,
 	return 0;
 }
 
+static int calc_width(struct spa_audio_info *info)
+{
+	switch (info->info.raw.format) {
+	case SPA_AUDIO_FORMAT_S16P:
+	case SPA_AUDIO_FORMAT_S16:
+		return 2;
+	case SPA_AUDIO_FORMAT_F64P:
+	case SPA_AUDIO_FORMAT_F64:
+		return 8;
+	default:
+		return 4;
+	}
+}
+
 static int clear_buffers(struct impl *this, struct port *port)
 {
 	if (port->n_buffers > 0) {
@@ -444,6 +511,34 @@ static int clear_buffers(struct impl *this, struct port *port)
 	return 0;
 }
 
+static void reset_ring(struct port *port)
+{
+	spa_ringbuffer_init(&port->ring);
+	port->priming = true;
+}
+
+static int alloc_ring(struct impl *this, struct port *port)
+{
+	uint32_t size = 1, needed = (this->jitter_latency + this->jitter_max + MAX_SAMPLES) * this->bpf;
+	uint8_t *data;
+
+	if (!this->jitter || port->direction != SPA_DIRECTION_INPUT)
+		return 0;
+
+	while (size < needed)
+		size <<= 1;
+
+	if ((data = malloc(size + MAX_SAMPLES * this->bpf)) == NULL)
+		return -errno;
+
+	free(port->ring_data);
+	port->ring_data = data;
+	port->ring_size = size;
+	reset_ring(port);
+
+	return 0;
+}
+
 static int port_set_format(void *object,
 			   enum spa_direction direction,
 			   uint32_t port_id,
@@ -487,10 +582,14 @@ static int port_set_format(void *object,
 			if ((res = mix_ops_init(&this->ops)) < 0)
 				return res;
 
+			this->stride = calc_width(&info);
+			this->bpf = this->stride * info.info.raw.channels;
 			this->have_format = true;
 			this->format = info;
 		}
 		if (!port->have_format) {
+			if ((res = alloc_ring(this, port)) < 0)
+				return res;
 			this->n_formats++;
 			port->have_format = true;
 			spa_log_info(this->log, NAME " %p: set format on port %d", this, port_id);
@@ -574,6 +673,8 @@ impl_node_port_use_buffers(void *object,
 			*port->io = SPA_IO_BUFFERS_INIT;
 	}
 	port->n_buffers = n_buffers;
+	if (port->ring_data)
+		reset_ring(port);
 
 	return 0;
 }
@@ -626,75 +727,50 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return -ENOTSUP;
 }
 
-static inline void
-add_port_data(struct impl *this, void *out, size_t outsize, struct port *port, int layer)
+/* Take n_bytes from the first queued buffer of the port and give the
+ * buffer back when it is used up. Returns false when the data is silent. */
+static inline bool
+take_port_data(struct impl *this, struct port *port, size_t n_bytes, struct mix_input *in)
 {
-	size_t insize;
 	struct buffer *b;
-	uint32_t index, offset, len1, len2, maxsize;
 	struct spa_data *d;
-	void *data;
-	double volume = *port->io_volume;
-	bool mute = *port->io_mute;
-	const void *s0[2], *s1[2];
-	uint32_t n_src;
+	size_t insize;
+	bool audible;
 
 	b = spa_list_first(&port->queue, struct buffer, link);
 
 	d = b->outbuf->datas;
 
-	maxsize = d[0].maxsize;
-	data = d[0].data;
-
-	insize = SPA_MIN(d[0].chunk->size, maxsize);
-	outsize = SPA_MIN(outsize, insize);
+	in->data = d[0].data;
+	in->maxsize = d[0].maxsize;
+	insize = SPA_MIN(d[0].chunk->size, in->maxsize);
+	in->offset = (d[0].chunk->offset + (insize - port->queued_bytes)) % in->maxsize;
 
-	index = d[0].chunk->offset + (insize - port->queued_bytes);
-	offset = index % maxsize;
+	audible = !(*port->io_volume < 0.001 || *port->io_mute ||
+		    SPA_FLAG_IS_SET(d[0].chunk->flags, SPA_CHUNK_FLAG_EMPTY));
 
-	len1 = SPA_MIN(outsize, maxsize - offset);
-	len2 = outsize - len1;
-
-	n_src = 0;
-	if (layer > 0) {
-		s0[n_src] = out;
-		s1[n_src] = SPA_MEMBER(out, len1, void);
-		n_src++;
-	}
-	s0[n_src] = SPA_MEMBER(data, offset, void);
-	s1[n_src] = data;
-	n_src++;
-
-	if (volume < 0.001 || mute) {
-		/* silence, do nothing */
-	}
-	else {
-		mix_ops_process(&this->ops, out, s0, n_src, len1);
-		if (len2 > 0)
-			mix_ops_process(&this->ops, SPA_MEMBER(out, len1, void), s1, n_src, len2);
-	}
-	port->queued_bytes -= outsize;
+	port->queued_bytes -= n_bytes;
 
 	if (port->queued_bytes == 0) {
 		spa_log_trace(this->log, NAME " %p: return buffer %d on port %d %zd",
-			      this, b->id, port->id, outsize);
+			      this, b->id, port->id, n_bytes);
 		port->io->buffer_id = b->id;
 		spa_list_remove(&b->link);
 		b->outstanding = true;
 	} else {
 		spa_log_trace(this->log, NAME " %p: keeping buffer %d on port %d %zd %zd",
-			      this, b->id, port->id, port->queued_bytes, outsize);
+			      this, b->id, port->id, port->queued_bytes, n_bytes);
 	}
+	return audible;
 }
 
 static int mix_output(struct impl *this, size_t n_bytes)
 {
 	struct buffer *outbuf;
-	uint32_t i, layer;
+	uint32_t i, n_src, pos, len;
 	struct port *outport;
 	struct spa_io_buffers *outio;
 	struct spa_data *od;
-	uint32_t avail, index, maxsize, len1, len2, offset;
 
 	outport = GET_OUT_PORT(this, 0);
 	outio = outport->io;
@@ -709,23 +785,15 @@ static int mix_output(struct impl *this, size_t n_bytes)
 	outbuf->outstanding = true;
 
 	od = outbuf->outbuf->datas;
-	maxsize = od[0].maxsize;
-
-	avail = maxsize;
-	index = 0;
-	n_bytes = SPA_MIN(n_bytes, avail);
+	n_bytes = SPA_MIN(n_bytes, od[0].maxsize);
 
-	offset = index % maxsize;
-	len1 = SPA_MIN(n_bytes, maxsize - offset);
-	len2 = n_bytes - len1;
+	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd",
+		      this, outbuf->id, n_bytes);
 
-	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd %d %d %d",
-		      this, outbuf->id, n_bytes, offset, len1, len2);
-
-	for (layer = 0, i = 0; i < this->last_port; i++) {
+	for (n_src = 0, i = 0; i < this->last_port; i++) {
 		struct port *in_port = GET_IN_PORT(this, i);
 
-		if (in_port->io == NULL || in_port->n_buffers == 0)
+		if (in_port == NULL || in_port->io == NULL || in_port->n_buffers == 0)
 			continue;
 
 		if (in_port->queued_bytes == 0) {
@@ -733,15 +801,29 @@ static int mix_output(struct impl *this, size_t n_bytes)
 			continue;
 		}
 
-		add_port_data(this, SPA_MEMBER(od[0].data, offset, void), len1, in_port, layer);
-		if (len2 > 0)
-			add_port_data(this, od[0].data, len2, in_port, layer);
-		layer++;
+		if (take_port_data(this, in_port, n_bytes, &this->mix_in[n_src]))
+			n_src++;
 	}
 
-	od[0].chunk->offset = index;
+	/* mix all inputs in one go so that the kernels only saturate the
+	 * final sum, split where the data of an input wraps around */
+	for (pos = 0; pos < n_bytes; pos += len) {
+		len = n_bytes - pos;
+		for (i = 0; i < n_src; i++) {
+			struct mix_input *in = &this->mix_in[i];
+			uint32_t offset = (in->offset + pos) % in->maxsize;
+
+			len = SPA_MIN(len, in->maxsize - offset);
+			this->mix_src[i] = SPA_MEMBER(in->data, offset, void);
+		}
+		mix_ops_process(&this->ops, SPA_MEMBER(od[0].data, pos, void),
+				this->mix_src, n_src, len / this->stride);
+	}
+
+	od[0].chunk->offset = 0;
 	od[0].chunk->size = n_bytes;
 	od[0].chunk->stride = 0;
+	od[0].chunk->flags = n_src == 0 ? SPA_CHUNK_FLAG_EMPTY : 0;
 
 	outio->buffer_id = outbuf->id;
 	outio->status = SPA_STATUS_HAVE_DATA;
@@ -749,6 +831,181 @@ static int mix_output(struct impl *this, size_t n_bytes)
 	return SPA_STATUS_HAVE_DATA;
 }
 
+/* Copy the data of the input buffer into the jitter buffer of the port.
+ * Returns the number of bytes that were queued. */
+static uint32_t queue_jitter_data(struct impl *this, struct port *port, struct buffer *b)
+{
+	struct spa_data *d = b->outbuf->datas;
+	uint32_t index, maxsize, size, offset, len1;
+	int32_t filled;
+
+	maxsize = d[0].maxsize;
+	size = SPA_MIN(d[0].chunk->size, maxsize);
+	size = SPA_MIN(size, port->ring_size);
+	offset = d[0].chunk->offset % maxsize;
+
+	filled = spa_ringbuffer_get_write_index(&port->ring, &index);
+	if (filled + size > port->ring_size) {
+		uint32_t drop = filled + size - port->ring_size;
+
+		spa_log_warn(this->log, NAME " %p: overrun port %d, drop %u bytes",
+				this, port->id, drop);
+		spa_ringbuffer_read_update(&port->ring, index - filled + drop);
+	}
+
+	if (SPA_FLAG_IS_SET(d[0].chunk->flags, SPA_CHUNK_FLAG_EMPTY)) {
+		uint32_t o = index & (port->ring_size - 1);
+
+		len1 = SPA_MIN(size, port->ring_size - o);
+		memset(port->ring_data + o, 0, len1);
+		memset(port->ring_data, 0, size - len1);
+	} else {
+		len1 = SPA_MIN(size, maxsize - offset);
+		spa_ringbuffer_write_data(&port->ring, port->ring_data, port->ring_size,
+				index & (port->ring_size - 1), SPA_MEMBER(d[0].data, offset, void), len1);
+		if (size > len1)
+			spa_ringbuffer_write_data(&port->ring, port->ring_data, port->ring_size,
+					(index + len1) & (port->ring_size - 1), d[0].data, size - len1);
+	}
+	spa_ringbuffer_write_update(&port->ring, index + size);
+
+	return size;
+}
+
+/* Take quantum bytes from the jitter buffer of the port. Returns NULL when
+ * the port has nothing to mix yet. */
+static const void *dequeue_jitter_data(struct impl *this, struct port *port, uint32_t quantum)
+{
+	uint32_t index, offset, len, target, limit;
+	int32_t avail;
+	uint8_t *data;
+
+	target = this->jitter_latency * this->bpf + quantum;
+	limit = target + this->jitter_max * this->bpf;
+
+	avail = spa_ringbuffer_get_read_index(&port->ring, &index);
+	if (port->priming) {
+		if (avail < (int32_t) target)
+			return NULL;
+		port->priming = false;
+	}
+	if (avail > (int32_t) limit) {
+		/* producer runs ahead, drop the oldest samples to get back
+		 * to the target latency */
+		spa_log_debug(this->log, NAME " %p: port %d drop %u bytes",
+				this, port->id, avail - target);
+		index += avail - target;
+		avail = target;
+	}
+	if (avail <= 0) {
+		spa_log_warn(this->log, NAME " %p: underrun stream %d", this, port->id);
+		port->priming = true;
+		return NULL;
+	}
+
+	len = SPA_MIN((uint32_t) avail, quantum);
+	offset = index & (port->ring_size - 1);
+	data = port->ring_data + offset;
+
+	if (offset + len > port->ring_size)
+		memcpy(port->ring_data + port->ring_size, port->ring_data,
+				offset + len - port->ring_size);
+
+	if (len < quantum) {
+		/* insert silence and fill up to the latency again */
+		spa_log_warn(this->log, NAME " %p: underrun stream %d, insert %u bytes",
+				this, port->id, quantum - len);
+		memset(data + len, 0, quantum - len);
+		port->priming = true;
+	}
+	spa_ringbuffer_read_update(&port->ring, index + len);
+
+	return data;
+}
+
+static int mix_jitter(struct impl *this)
+{
+	struct port *outport = GET_OUT_PORT(this, 0);
+	struct spa_io_buffers *outio = outport->io;
+	struct buffer *outbuf;
+	struct spa_data *od;
+	uint32_t i, n_src, quantum = 0;
+
+	/* move new input into the jitter buffers and give the buffers back */
+	for (i = 0; i < this->last_port; i++) {
+		struct port *inport = GET_IN_PORT(this, i);
+		struct spa_io_buffers *inio;
+
+		if (inport == NULL || (inio = inport->io) == NULL ||
+		    inport->n_buffers == 0 || inport->ring_data == NULL)
+			continue;
+
+		if (inio->status == SPA_STATUS_HAVE_DATA &&
+		    inio->buffer_id < inport->n_buffers) {
+			struct buffer *b = &inport->buffers[inio->buffer_id];
+			uint32_t size = queue_jitter_data(this, inport, b);
+
+			if (size > 0 && (quantum == 0 || size < quantum))
+				quantum = size;
+		}
+		inio->status = SPA_STATUS_NEED_DATA;
+	}
+
+	/* without a clock, use the smallest input of this cycle, late inputs
+	 * catch up with bigger buffers, or the previous quantum when all
+	 * inputs are late */
+	if (this->position)
+		quantum = this->position->clock.duration * this->bpf;
+	else if (quantum == 0)
+		quantum = this->quantum;
+	quantum = SPA_MIN(quantum, MAX_SAMPLES * this->bpf);
+	this->quantum = quantum;
+
+	if (quantum == 0)
+		return SPA_STATUS_NEED_DATA;
+
+	if (spa_list_is_empty(&outport->queue)) {
+		spa_log_trace(this->log, NAME " %p: out of buffers", this);
+		return -EPIPE;
+	}
+
+	outbuf = spa_list_first(&outport->queue, struct buffer, link);
+	spa_list_remove(&outbuf->link);
+	outbuf->outstanding = true;
+
+	od = outbuf->outbuf->datas;
+	quantum = SPA_MIN(quantum, od[0].maxsize);
+	quantum -= quantum % this->bpf;
+
+	for (n_src = 0, i = 0; i < this->last_port; i++) {
+		struct port *inport = GET_IN_PORT(this, i);
+		const void *data;
+
+		if (inport == NULL || inport->io == NULL ||
+		    inport->n_buffers == 0 || inport->ring_data == NULL)
+			continue;
+
+		if ((data = dequeue_jitter_data(this, inport, quantum)) == NULL)
+			continue;
+
+		if (*inport->io_volume < 0.001 || *inport->io_mute)
+			continue;
+
+		this->mix_src[n_src++] = data;
+	}
+
+	mix_ops_process(&this->ops, od[0].data, this->mix_src, n_src, quantum / this->stride);
+
+	od[0].chunk->offset = 0;
+	od[0].chunk->size = quantum;
+	od[0].chunk->stride = 0;
+	od[0].chunk->flags = n_src == 0 ? SPA_CHUNK_FLAG_EMPTY : 0;
+
+	outio->buffer_id = outbuf->id;
+
+	return SPA_STATUS_HAVE_DATA;
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
@@ -774,13 +1031,34 @@ static int impl_node_process(void *object)
 		outio->buffer_id = SPA_ID_INVALID;
 	}
 
+	if (this->jitter) {
+		outio->status = mix_jitter(this);
+		goto done;
+	}
+
 	/* produce more output if possible */
 	for (i = 0; i < this->last_port; i++) {
 		struct port *inport = GET_IN_PORT(this, i);
+		struct spa_io_buffers *inio;
 
-		if (inport->io == NULL || inport->n_buffers == 0)
+		if (inport == NULL || (inio = inport->io) == NULL || inport->n_buffers == 0)
 			continue;
 
+		if (inport->queued_bytes == 0 &&
+		    inio->status == SPA_STATUS_HAVE_DATA &&
+		    inio->buffer_id < inport->n_buffers) {
+			struct buffer *b = &inport->buffers[inio->buffer_id];
+			struct spa_data *d = b->outbuf->datas;
+
+			b->outstanding = false;
+			inio->status = SPA_STATUS_OK;
+			spa_list_append(&inport->queue, &b->link);
+			inport->queued_bytes = SPA_MIN(d[0].chunk->size, d[0].maxsize);
+
+			spa_log_trace(this->log, NAME " %p: queue buffer %d on port %d %zd",
+				      this, b->id, i, inport->queued_bytes);
+		}
+
 		if (inport->queued_bytes < min_queued)
 			min_queued = inport->queued_bytes;
 	}
@@ -792,7 +1070,7 @@ static int impl_node_process(void *object)
 			struct port *inport = GET_IN_PORT(this, i);
 			struct spa_io_buffers *inio;
 
-			if ((inio = inport->io) == NULL || inport->n_buffers == 0)
+			if (inport == NULL || (inio = inport->io) == NULL || inport->n_buffers == 0)
 				continue;
 
 			spa_log_trace(this->log, NAME " %p: port %d queued %zd, res %d", this,
@@ -846,11 +1124,18 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 static int impl_clear(struct spa_handle *handle)
 {
 	struct impl *this;
+	uint32_t i;
 
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
 
 	this = (struct impl *) handle;
 
+	for (i = 0; i < MAX_PORTS; i++) {
+		if (this->in_ports[i])
+			free(this->in_ports[i]->ring_data);
+		free(this->in_ports[i]);
+	}
+
 	mix_ops_free(&this->ops);
 	return 0;
 }
@@ -871,6 +1156,7 @@ impl_init(const struct spa_handle_factory *factory,
 {
 	struct impl *this;
 	struct port *port;
+	const char *str, *max = NULL;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -886,6 +1172,19 @@ impl_init(const struct spa_handle_factory *factory,
 	if (this->cpu)
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 
+	this->jitter_latency = DEFAULT_JITTER_LATENCY;
+	if (info) {
+		if ((str = spa_dict_lookup(info, NAME ".jitter")) != NULL)
+			this->jitter = atoi(str);
+		if ((str = spa_dict_lookup(info, NAME ".jitter.latency")) != NULL)
+			this->jitter_latency = atoi(str);
+		max = spa_dict_lookup(info, NAME ".jitter.max");
+	}
+	/* by default, drop samples when the latency doubles */
+	this->jitter_latency = SPA_MIN(this->jitter_latency, (uint32_t) MAX_SAMPLES);
+	this->jitter_max = max ? SPA_MIN((uint32_t) atoi(max), (uint32_t) MAX_SAMPLES) :
+		this->jitter_latency;
+
 	spa_hook_list_init(&this->hooks);
 
 	this->node.iface = SPA_INTERFACE_INIT(
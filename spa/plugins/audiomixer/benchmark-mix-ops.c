@@ -0,0 +1,217 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "mix-ops.c"
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t n_src;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	8192
+#define MAX_SOURCES	512
+
+#define MAX_COUNT 100
+
+/* large enough for all formats, sources are MAX_SAMPLES doubles apart */
+static double samp_in[MAX_SOURCES * MAX_SAMPLES];
+static double samp_out[MAX_SAMPLES];
+
+static const int sample_sizes[] = { 128, 1024, 8192 };
+static const int source_counts[] = { 2, 16, 128, 512 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(source_counts) * 32
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void run_test1(const char *name, const char *impl, struct mix_ops *ops,
+		mix_func_t func, int n_src, int n_samples)
+{
+	int i, j;
+	const void *ip[n_src];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+
+	for (j = 0; j < n_src; j++)
+		ip[j] = &samp_in[j * MAX_SAMPLES];
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		func(ops, samp_out, ip, n_src, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_src = n_src,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+#define SAMPLE(i)	((double)((i) & 0xff) / 256.0 - 0.5)
+
+static void fill_samples(uint32_t fmt)
+{
+	size_t i, n_bytes = sizeof(samp_in);
+
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+		for (i = 0; i < n_bytes / sizeof(int16_t); i++)
+			((int16_t*)samp_in)[i] = SAMPLE(i) * 32767;
+		break;
+	case SPA_AUDIO_FORMAT_S32:
+		for (i = 0; i < n_bytes / sizeof(int32_t); i++)
+			((int32_t*)samp_in)[i] = SAMPLE(i) * 2147483647;
+		break;
+	case SPA_AUDIO_FORMAT_F32:
+		for (i = 0; i < n_bytes / sizeof(float); i++)
+			((float*)samp_in)[i] = SAMPLE(i);
+		break;
+	default:
+		for (i = 0; i < SPA_N_ELEMENTS(samp_in); i++)
+			samp_in[i] = SAMPLE(i);
+		break;
+	}
+}
+
+/* run the kernel directly and through mix_ops, which mixes in blocks */
+static void run_test(const char *name, const char *impl, const char *impl_blocked,
+		uint32_t fmt, uint32_t cpu_flags, mix_func_t func)
+{
+	struct mix_ops ops;
+	size_t i, j;
+
+	spa_zero(ops);
+	ops.fmt = fmt;
+	ops.n_channels = 1;
+	ops.cpu_flags = cpu_flags;
+	spa_assert(mix_ops_init(&ops) == 0);
+
+	fill_samples(fmt);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(source_counts); j++) {
+			run_test1(name, impl, &ops, func,
+					source_counts[j], sample_sizes[i]);
+			run_test1(name, impl_blocked, &ops, impl_mix_ops_process,
+					source_counts[j], sample_sizes[i]);
+		}
+	}
+	mix_ops_free(&ops);
+}
+
+static void test_s16(void)
+{
+	run_test("test_s16", "c", "c blocked", SPA_AUDIO_FORMAT_S16, 0, mix_s16_c);
+#if defined (HAVE_SSE2)
+	run_test("test_s16", "sse2", "sse2 blocked", SPA_AUDIO_FORMAT_S16,
+			SPA_CPU_FLAG_SSE2, mix_s16_sse2);
+#endif
+}
+
+static void test_s32(void)
+{
+	run_test("test_s32", "c", "c blocked", SPA_AUDIO_FORMAT_S32, 0, mix_s32_c);
+}
+
+static void test_f32(void)
+{
+	run_test("test_f32", "c", "c blocked", SPA_AUDIO_FORMAT_F32, 0, mix_f32_c);
+#if defined (HAVE_SSE)
+	run_test("test_f32", "sse", "sse blocked", SPA_AUDIO_FORMAT_F32,
+			SPA_CPU_FLAG_SSE, mix_f32_sse);
+#endif
+#if defined (HAVE_AVX)
+	run_test("test_f32", "avx", "avx blocked", SPA_AUDIO_FORMAT_F32,
+			SPA_CPU_FLAG_AVX, mix_f32_avx);
+#endif
+#if defined (HAVE_AVX512)
+	run_test("test_f32", "avx512", "avx512 blocked", SPA_AUDIO_FORMAT_F32,
+			SPA_CPU_FLAG_AVX512, mix_f32_avx512);
+#endif
+}
+
+static void test_f64(void)
+{
+	run_test("test_f64", "c", "c blocked", SPA_AUDIO_FORMAT_F64, 0, mix_f64_c);
+#if defined (HAVE_SSE2)
+	run_test("test_f64", "sse2", "sse2 blocked", SPA_AUDIO_FORMAT_F64,
+			SPA_CPU_FLAG_SSE2, mix_f64_sse2);
+#endif
+#if defined (HAVE_AVX)
+	run_test("test_f64", "avx", "avx blocked", SPA_AUDIO_FORMAT_F64,
+			SPA_CPU_FLAG_AVX, mix_f64_avx);
+#endif
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->n_src - b->n_src) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	test_s16();
+	test_s32();
+	test_f32();
+	test_f64();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, sources %d\n",
+				s->perf, s->name, s->impl, s->n_samples, s->n_src);
+	}
+	return 0;
+}
@@ -109,7 +109,7 @@ static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n
 		_mm256_store_ps(&dst[n + 8], in1[1]);
 	}
 	for (; n < n_samples; n++) {
-		__m128 in1[0], in2[0];
+		__m128 in1[1], in2[1];
 		in1[0] = _mm_load_ss(&dst[n]),
 		in2[0] = _mm_load_ss(&src[n]),
 		in1[0] = _mm_add_ss(in1[0], in2[0]);
@@ -133,3 +133,174 @@ mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 	for (; i < n_src; i++)
 		mix_2(dst, src[i], n_samples);
 }
+
+static inline void mix_gain_2(float * dst, const float * SPA_RESTRICT src,
+		const struct mix_gain *gain, bool first, uint32_t n_samples)
+{
+	uint32_t n, ramp, unrolled;
+	const float start = gain->start;
+	const float inc = gain->ramp ? (gain->end - start) / gain->ramp : 0.0f;
+	__m256 in1[2], in2[2], g, idx;
+	__m128 t;
+
+	ramp = SPA_MIN(gain->ramp, n_samples);
+
+	idx = _mm256_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f);
+	for (n = 0; n + 8 <= ramp; n += 8) {
+		g = _mm256_add_ps(_mm256_set1_ps((float)n), idx);
+		g = _mm256_add_ps(_mm256_set1_ps(start), _mm256_mul_ps(_mm256_set1_ps(inc), g));
+		in1[0] = _mm256_mul_ps(_mm256_loadu_ps(&src[n]), g);
+		if (!first)
+			in1[0] = _mm256_add_ps(in1[0], _mm256_loadu_ps(&dst[n]));
+		_mm256_storeu_ps(&dst[n], in1[0]);
+	}
+	for (; n < ramp; n++) {
+		t = _mm_mul_ss(_mm_load_ss(&src[n]), _mm_set_ss(start + inc * n));
+		if (!first)
+			t = _mm_add_ss(t, _mm_load_ss(&dst[n]));
+		_mm_store_ss(&dst[n], t);
+	}
+
+	g = _mm256_set1_ps(gain->end);
+
+	if (SPA_IS_ALIGNED(&src[n], 32) &&
+	    SPA_IS_ALIGNED(&dst[n], 32))
+		unrolled = n + ((n_samples - n) & ~15);
+	else
+		unrolled = n;
+
+	for (; n < unrolled; n += 16) {
+		in2[0] = _mm256_mul_ps(_mm256_load_ps(&src[n + 0]), g);
+		in2[1] = _mm256_mul_ps(_mm256_load_ps(&src[n + 8]), g);
+
+		if (!first) {
+			in1[0] = _mm256_load_ps(&dst[n + 0]);
+			in1[1] = _mm256_load_ps(&dst[n + 8]);
+
+			in2[0] = _mm256_add_ps(in1[0], in2[0]);
+			in2[1] = _mm256_add_ps(in1[1], in2[1]);
+		}
+		_mm256_store_ps(&dst[n + 0], in2[0]);
+		_mm256_store_ps(&dst[n + 8], in2[1]);
+	}
+	for (; n < n_samples; n++) {
+		t = _mm_mul_ss(_mm_load_ss(&src[n]), _mm256_castps256_ps128(g));
+		if (!first)
+			t = _mm_add_ss(t, _mm_load_ss(&dst[n]));
+		_mm_store_ss(&dst[n], t);
+	}
+}
+
+void
+mix_gain_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+
+	for (i = 0; i < n_src; i++)
+		mix_gain_2(dst, src[i], &gain[i], i == 0, n_samples);
+}
+
+static inline void mix_4_f64(double * dst,
+		const double * SPA_RESTRICT src0,
+		const double * SPA_RESTRICT src1,
+		const double * SPA_RESTRICT src2,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	if (SPA_IS_ALIGNED(src0, 32) &&
+	    SPA_IS_ALIGNED(src1, 32) &&
+	    SPA_IS_ALIGNED(src2, 32) &&
+	    SPA_IS_ALIGNED(dst, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 8) {
+		__m256d in1[4], in2[4];
+
+		in1[0] = _mm256_load_pd(&dst[n + 0]);
+		in2[0] = _mm256_load_pd(&dst[n + 4]);
+		in1[1] = _mm256_load_pd(&src0[n + 0]);
+		in2[1] = _mm256_load_pd(&src0[n + 4]);
+		in1[2] = _mm256_load_pd(&src1[n + 0]);
+		in2[2] = _mm256_load_pd(&src1[n + 4]);
+		in1[3] = _mm256_load_pd(&src2[n + 0]);
+		in2[3] = _mm256_load_pd(&src2[n + 4]);
+
+		in1[0] = _mm256_add_pd(in1[0], in1[1]);
+		in2[0] = _mm256_add_pd(in2[0], in2[1]);
+		in1[2] = _mm256_add_pd(in1[2], in1[3]);
+		in2[2] = _mm256_add_pd(in2[2], in2[3]);
+		in1[0] = _mm256_add_pd(in1[0], in1[2]);
+		in2[0] = _mm256_add_pd(in2[0], in2[2]);
+
+		_mm256_store_pd(&dst[n + 0], in1[0]);
+		_mm256_store_pd(&dst[n + 4], in2[0]);
+	}
+	for (; n < n_samples; n++) {
+		__m128d in[4];
+		in[0] = _mm_load_sd(&dst[n]),
+		in[1] = _mm_load_sd(&src0[n]),
+		in[2] = _mm_load_sd(&src1[n]),
+		in[3] = _mm_load_sd(&src2[n]),
+		in[0] = _mm_add_sd(in[0], in[1]);
+		in[2] = _mm_add_sd(in[2], in[3]);
+		in[0] = _mm_add_sd(in[0], in[2]);
+		_mm_store_sd(&dst[n], in[0]);
+	}
+}
+
+static inline void mix_2_f64(double * dst, const double * SPA_RESTRICT src, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	if (SPA_IS_ALIGNED(src, 32) &&
+	    SPA_IS_ALIGNED(dst, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 8) {
+		__m256d in1[2], in2[2];
+
+		in1[0] = _mm256_load_pd(&dst[n + 0]);
+		in1[1] = _mm256_load_pd(&dst[n + 4]);
+		in2[0] = _mm256_load_pd(&src[n + 0]);
+		in2[1] = _mm256_load_pd(&src[n + 4]);
+
+		in1[0] = _mm256_add_pd(in1[0], in2[0]);
+		in1[1] = _mm256_add_pd(in1[1], in2[1]);
+
+		_mm256_store_pd(&dst[n + 0], in1[0]);
+		_mm256_store_pd(&dst[n + 4], in1[1]);
+	}
+	for (; n < n_samples; n++) {
+		__m128d in1[1], in2[1];
+		in1[0] = _mm_load_sd(&dst[n]),
+		in2[0] = _mm_load_sd(&src[n]),
+		in1[0] = _mm_add_sd(in1[0], in2[0]);
+		_mm_store_sd(&dst[n], in1[0]);
+	}
+}
+
+void
+mix_f64_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(double));
+	else if (dst != src[0])
+		memcpy(dst, src[0], n_samples * sizeof(double));
+
+	for (i = 1; i + 2 < n_src; i += 3)
+		mix_4_f64(dst, src[i], src[i + 1], src[i + 2], n_samples);
+	for (; i < n_src; i++)
+		mix_2_f64(dst, src[i], n_samples);
+}
@@ -0,0 +1,189 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#include <immintrin.h>
+
+static inline void mix_4(float * dst,
+		const float * SPA_RESTRICT src0,
+		const float * SPA_RESTRICT src1,
+		const float * SPA_RESTRICT src2,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m512 in1[4], in2[4];
+	__m128 in[4];
+
+	unrolled = n_samples & ~31;
+
+	for (n = 0; n < unrolled; n += 32) {
+		in1[0] = _mm512_loadu_ps(&dst[n + 0]);
+		in2[0] = _mm512_loadu_ps(&dst[n + 16]);
+		in1[1] = _mm512_loadu_ps(&src0[n + 0]);
+		in2[1] = _mm512_loadu_ps(&src0[n + 16]);
+		in1[2] = _mm512_loadu_ps(&src1[n + 0]);
+		in2[2] = _mm512_loadu_ps(&src1[n + 16]);
+		in1[3] = _mm512_loadu_ps(&src2[n + 0]);
+		in2[3] = _mm512_loadu_ps(&src2[n + 16]);
+
+		in1[0] = _mm512_add_ps(in1[0], in1[1]);
+		in2[0] = _mm512_add_ps(in2[0], in2[1]);
+		in1[2] = _mm512_add_ps(in1[2], in1[3]);
+		in2[2] = _mm512_add_ps(in2[2], in2[3]);
+		in1[0] = _mm512_add_ps(in1[0], in1[2]);
+		in2[0] = _mm512_add_ps(in2[0], in2[2]);
+
+		_mm512_storeu_ps(&dst[n + 0], in1[0]);
+		_mm512_storeu_ps(&dst[n + 16], in2[0]);
+	}
+	for (; n < n_samples; n++) {
+		in[0] = _mm_load_ss(&dst[n]),
+		in[1] = _mm_load_ss(&src0[n]),
+		in[2] = _mm_load_ss(&src1[n]),
+		in[3] = _mm_load_ss(&src2[n]),
+		in[0] = _mm_add_ss(in[0], in[1]);
+		in[2] = _mm_add_ss(in[2], in[3]);
+		in[0] = _mm_add_ss(in[0], in[2]);
+		_mm_store_ss(&dst[n], in[0]);
+	}
+}
+
+static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m512 in1[2], in2[2];
+	__m128 in[2];
+
+	unrolled = n_samples & ~31;
+
+	for (n = 0; n < unrolled; n += 32) {
+		in1[0] = _mm512_loadu_ps(&dst[n + 0]);
+		in1[1] = _mm512_loadu_ps(&dst[n + 16]);
+		in2[0] = _mm512_loadu_ps(&src[n + 0]);
+		in2[1] = _mm512_loadu_ps(&src[n + 16]);
+
+		in1[0] = _mm512_add_ps(in1[0], in2[0]);
+		in1[1] = _mm512_add_ps(in1[1], in2[1]);
+
+		_mm512_storeu_ps(&dst[n + 0], in1[0]);
+		_mm512_storeu_ps(&dst[n + 16], in1[1]);
+	}
+	for (; n < n_samples; n++) {
+		in[0] = _mm_load_ss(&dst[n]),
+		in[1] = _mm_load_ss(&src[n]),
+		in[0] = _mm_add_ss(in[0], in[1]);
+		_mm_store_ss(&dst[n], in[0]);
+	}
+}
+
+void
+mix_f32_avx512(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+	else if (dst != src[0])
+		memcpy(dst, src[0], n_samples * sizeof(float));
+
+	for (i = 1; i + 2 < n_src; i += 3)
+		mix_4(dst, src[i], src[i + 1], src[i + 2], n_samples);
+	for (; i < n_src; i++)
+		mix_2(dst, src[i], n_samples);
+}
+
+static inline void mix_gain_2(float * dst, const float * SPA_RESTRICT src,
+		const struct mix_gain *gain, bool first, uint32_t n_samples)
+{
+	uint32_t n, ramp, unrolled;
+	const float start = gain->start;
+	const float inc = gain->ramp ? (gain->end - start) / gain->ramp : 0.0f;
+	__m512 in1[2], in2[2], g, idx;
+	__m128 t;
+
+	ramp = SPA_MIN(gain->ramp, n_samples);
+
+	idx = _mm512_setr_ps(0.0f, 1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f, 7.0f,
+			8.0f, 9.0f, 10.0f, 11.0f, 12.0f, 13.0f, 14.0f, 15.0f);
+	for (n = 0; n + 16 <= ramp; n += 16) {
+		g = _mm512_add_ps(_mm512_set1_ps((float)n), idx);
+		g = _mm512_add_ps(_mm512_set1_ps(start), _mm512_mul_ps(_mm512_set1_ps(inc), g));
+		in1[0] = _mm512_mul_ps(_mm512_loadu_ps(&src[n]), g);
+		if (!first)
+			in1[0] = _mm512_add_ps(in1[0], _mm512_loadu_ps(&dst[n]));
+		_mm512_storeu_ps(&dst[n], in1[0]);
+	}
+	for (; n < ramp; n++) {
+		t = _mm_mul_ss(_mm_load_ss(&src[n]), _mm_set_ss(start + inc * n));
+		if (!first)
+			t = _mm_add_ss(t, _mm_load_ss(&dst[n]));
+		_mm_store_ss(&dst[n], t);
+	}
+
+	g = _mm512_set1_ps(gain->end);
+
+	unrolled = n + ((n_samples - n) & ~31);
+
+	for (; n < unrolled; n += 32) {
+		in2[0] = _mm512_mul_ps(_mm512_loadu_ps(&src[n + 0]), g);
+		in2[1] = _mm512_mul_ps(_mm512_loadu_ps(&src[n + 16]), g);
+
+		if (!first) {
+			in1[0] = _mm512_loadu_ps(&dst[n + 0]);
+			in1[1] = _mm512_loadu_ps(&dst[n + 16]);
+
+			in2[0] = _mm512_add_ps(in1[0], in2[0]);
+			in2[1] = _mm512_add_ps(in1[1], in2[1]);
+		}
+		_mm512_storeu_ps(&dst[n + 0], in2[0]);
+		_mm512_storeu_ps(&dst[n + 16], in2[1]);
+	}
+	for (; n < n_samples; n++) {
+		t = _mm_mul_ss(_mm_load_ss(&src[n]), _mm_set_ss(gain->end));
+		if (!first)
+			t = _mm_add_ss(t, _mm_load_ss(&dst[n]));
+		_mm_store_ss(&dst[n], t);
+	}
+}
+
+void
+mix_gain_f32_avx512(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+
+	for (i = 0; i < n_src; i++)
+		mix_gain_2(dst, src[i], &gain[i], i == 0, n_samples);
+}
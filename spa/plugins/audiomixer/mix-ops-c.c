@@ -42,7 +42,13 @@ mix_f32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRIC
 	else if (dst != src[0])
 		memcpy(dst, src[0], n_samples * sizeof(float));
 
-	for (i = 1; i < n_src; i++) {
+	/* add 3 sources per pass to save loads and stores of dst */
+	for (i = 1; i + 2 < n_src; i += 3) {
+		const float *s0 = src[i], *s1 = src[i + 1], *s2 = src[i + 2];
+		for (n = 0; n < n_samples; n++)
+			d[n] += s0[n] + s1[n] + s2[n];
+	}
+	for (; i < n_src; i++) {
 		const float *s = src[i];
 		for (n = 0; n < n_samples; n++)
 			d[n] += s[n];
@@ -61,9 +67,223 @@ mix_f64_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRIC
 	else if (dst != src[0])
 		memcpy(dst, src[0], n_samples * sizeof(double));
 
-	for (i = 1; i < n_src; i++) {
+	/* add 3 sources per pass to save loads and stores of dst */
+	for (i = 1; i + 2 < n_src; i += 3) {
+		const double *s0 = src[i], *s1 = src[i + 1], *s2 = src[i + 2];
+		for (n = 0; n < n_samples; n++)
+			d[n] += s0[n] + s1[n] + s2[n];
+	}
+	for (; i < n_src; i++) {
 		const double *s = src[i];
 		for (n = 0; n < n_samples; n++)
 			d[n] += s[n];
 	}
 }
+
+void
+mix_gain_f32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, ramp;
+	float *d = dst, start, inc, g;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+
+	for (i = 0; i < n_src; i++) {
+		const float *s = src[i];
+
+		ramp = SPA_MIN(gain[i].ramp, n_samples);
+		start = gain[i].start;
+		inc = ramp ? (gain[i].end - start) / gain[i].ramp : 0.0;
+		g = gain[i].end;
+
+		if (i == 0) {
+			for (n = 0; n < ramp; n++)
+				d[n] = s[n] * (start + inc * n);
+			for (; n < n_samples; n++)
+				d[n] = s[n] * g;
+		} else {
+			for (n = 0; n < ramp; n++)
+				d[n] += s[n] * (start + inc * n);
+			for (; n < n_samples; n++)
+				d[n] += s[n] * g;
+		}
+	}
+}
+
+void
+mix_gain_f64_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, ramp;
+	double *d = dst, start, inc, g;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(double));
+
+	for (i = 0; i < n_src; i++) {
+		const double *s = src[i];
+
+		ramp = SPA_MIN(gain[i].ramp, n_samples);
+		start = gain[i].start;
+		inc = ramp ? (gain[i].end - start) / gain[i].ramp : 0.0;
+		g = gain[i].end;
+
+		if (i == 0) {
+			for (n = 0; n < ramp; n++)
+				d[n] = s[n] * (start + inc * n);
+			for (; n < n_samples; n++)
+				d[n] = s[n] * g;
+		} else {
+			for (n = 0; n < ramp; n++)
+				d[n] += s[n] * (start + inc * n);
+			for (; n < n_samples; n++)
+				d[n] += s[n] * g;
+		}
+	}
+}
+
+/* integer sources are summed in a wider accumulator and only saturated
+ * when the result is stored, so intermediate overflows do not clip */
+#define ACC_SAMPLES	256u
+
+void
+mix_s16_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, offs, chunk;
+	int16_t *d = dst;
+	int32_t acc[ACC_SAMPLES];
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int16_t));
+		return;
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(int16_t));
+		return;
+	}
+
+	for (offs = 0; offs < n_samples; offs += chunk, d += chunk) {
+		const int16_t *s = (const int16_t*)src[0] + offs;
+
+		chunk = SPA_MIN(n_samples - offs, ACC_SAMPLES);
+
+		for (n = 0; n < chunk; n++)
+			acc[n] = s[n];
+		for (i = 1; i < n_src; i++) {
+			s = (const int16_t*)src[i] + offs;
+			for (n = 0; n < chunk; n++)
+				acc[n] += s[n];
+		}
+		for (n = 0; n < chunk; n++)
+			d[n] = SPA_CLAMP(acc[n], INT16_MIN, INT16_MAX);
+	}
+}
+
+void
+mix_s32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, offs, chunk;
+	int32_t *d = dst;
+	int64_t acc[ACC_SAMPLES];
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int32_t));
+		return;
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(int32_t));
+		return;
+	}
+
+	for (offs = 0; offs < n_samples; offs += chunk, d += chunk) {
+		const int32_t *s = (const int32_t*)src[0] + offs;
+
+		chunk = SPA_MIN(n_samples - offs, ACC_SAMPLES);
+
+		for (n = 0; n < chunk; n++)
+			acc[n] = s[n];
+		for (i = 1; i < n_src; i++) {
+			s = (const int32_t*)src[i] + offs;
+			for (n = 0; n < chunk; n++)
+				acc[n] += s[n];
+		}
+		for (n = 0; n < chunk; n++)
+			d[n] = SPA_CLAMP(acc[n], INT32_MIN, INT32_MAX);
+	}
+}
+
+void
+mix_gain_s16_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, p, offs, chunk, ramp;
+	int16_t *d = dst;
+	float acc[ACC_SAMPLES], start, inc, g;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int16_t));
+		return;
+	}
+
+	for (offs = 0; offs < n_samples; offs += chunk) {
+		chunk = SPA_MIN(n_samples - offs, ACC_SAMPLES);
+
+		for (n = 0; n < chunk; n++)
+			acc[n] = 0.0f;
+		for (i = 0; i < n_src; i++) {
+			const int16_t *s = src[i];
+
+			ramp = gain[i].ramp;
+			start = gain[i].start;
+			inc = ramp ? (gain[i].end - start) / ramp : 0.0f;
+			g = gain[i].end;
+
+			for (n = 0; n < chunk; n++) {
+				p = offs + n;
+				acc[n] += s[p] * (p < ramp ? start + inc * p : g);
+			}
+		}
+		for (n = 0; n < chunk; n++)
+			d[offs + n] = SPA_CLAMP(acc[n], (float)INT16_MIN, (float)INT16_MAX);
+	}
+}
+
+void
+mix_gain_s32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, p, offs, chunk, ramp;
+	int32_t *d = dst;
+	double acc[ACC_SAMPLES], start, inc, g;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int32_t));
+		return;
+	}
+
+	for (offs = 0; offs < n_samples; offs += chunk) {
+		chunk = SPA_MIN(n_samples - offs, ACC_SAMPLES);
+
+		for (n = 0; n < chunk; n++)
+			acc[n] = 0.0;
+		for (i = 0; i < n_src; i++) {
+			const int32_t *s = src[i];
+
+			ramp = gain[i].ramp;
+			start = gain[i].start;
+			inc = ramp ? (gain[i].end - start) / ramp : 0.0;
+			g = gain[i].end;
+
+			for (n = 0; n < chunk; n++) {
+				p = offs + n;
+				acc[n] += s[p] * (p < ramp ? start + inc * p : g);
+			}
+		}
+		for (n = 0; n < chunk; n++)
+			d[offs + n] = SPA_CLAMP(acc[n], (double)INT32_MIN, (double)INT32_MAX);
+	}
+}
@@ -32,6 +32,57 @@
 
 #include <xmmintrin.h>
 
+static inline void mix_4(float * dst,
+		const float * SPA_RESTRICT src0,
+		const float * SPA_RESTRICT src1,
+		const float * SPA_RESTRICT src2,
+		uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+
+	if (SPA_IS_ALIGNED(src0, 16) &&
+	    SPA_IS_ALIGNED(src1, 16) &&
+	    SPA_IS_ALIGNED(src2, 16) &&
+	    SPA_IS_ALIGNED(dst, 16))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 8) {
+		__m128 in1[4], in2[4];
+
+		in1[0] = _mm_load_ps(&dst[n + 0]);
+		in2[0] = _mm_load_ps(&dst[n + 4]);
+		in1[1] = _mm_load_ps(&src0[n + 0]);
+		in2[1] = _mm_load_ps(&src0[n + 4]);
+		in1[2] = _mm_load_ps(&src1[n + 0]);
+		in2[2] = _mm_load_ps(&src1[n + 4]);
+		in1[3] = _mm_load_ps(&src2[n + 0]);
+		in2[3] = _mm_load_ps(&src2[n + 4]);
+
+		in1[0] = _mm_add_ps(in1[0], in1[1]);
+		in2[0] = _mm_add_ps(in2[0], in2[1]);
+		in1[2] = _mm_add_ps(in1[2], in1[3]);
+		in2[2] = _mm_add_ps(in2[2], in2[3]);
+		in1[0] = _mm_add_ps(in1[0], in1[2]);
+		in2[0] = _mm_add_ps(in2[0], in2[2]);
+
+		_mm_store_ps(&dst[n + 0], in1[0]);
+		_mm_store_ps(&dst[n + 4], in2[0]);
+	}
+	for (; n < n_samples; n++) {
+		__m128 in[4];
+		in[0] = _mm_load_ss(&dst[n]),
+		in[1] = _mm_load_ss(&src0[n]),
+		in[2] = _mm_load_ss(&src1[n]),
+		in[3] = _mm_load_ss(&src2[n]),
+		in[0] = _mm_add_ss(in[0], in[1]);
+		in[2] = _mm_add_ss(in[2], in[3]);
+		in[0] = _mm_add_ss(in[0], in[2]);
+		_mm_store_ss(&dst[n], in[0]);
+	}
+}
+
 static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n_samples)
 {
 	uint32_t n, unrolled;
@@ -83,7 +134,85 @@ mix_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTR
 	else if (dst != src[0])
 		memcpy(dst, src[0], n_samples * sizeof(float));
 
-	for (i = 1; i < n_src; i++) {
+	for (i = 1; i + 2 < n_src; i += 3)
+		mix_4(dst, src[i], src[i + 1], src[i + 2], n_samples);
+	for (; i < n_src; i++)
 		mix_2(dst, src[i], n_samples);
+}
+
+static inline void mix_gain_2(float * dst, const float * SPA_RESTRICT src,
+		const struct mix_gain *gain, bool first, uint32_t n_samples)
+{
+	uint32_t n, ramp, unrolled;
+	const float start = gain->start;
+	const float inc = gain->ramp ? (gain->end - start) / gain->ramp : 0.0f;
+	__m128 in1[4], in2[4], g, idx;
+
+	ramp = SPA_MIN(gain->ramp, n_samples);
+
+	idx = _mm_setr_ps(0.0f, 1.0f, 2.0f, 3.0f);
+	for (n = 0; n + 4 <= ramp; n += 4) {
+		g = _mm_add_ps(_mm_set1_ps((float)n), idx);
+		g = _mm_add_ps(_mm_set1_ps(start), _mm_mul_ps(_mm_set1_ps(inc), g));
+		in1[0] = _mm_mul_ps(_mm_loadu_ps(&src[n]), g);
+		if (!first)
+			in1[0] = _mm_add_ps(in1[0], _mm_loadu_ps(&dst[n]));
+		_mm_storeu_ps(&dst[n], in1[0]);
 	}
+	for (; n < ramp; n++) {
+		in1[0] = _mm_mul_ss(_mm_load_ss(&src[n]), _mm_set_ss(start + inc * n));
+		if (!first)
+			in1[0] = _mm_add_ss(in1[0], _mm_load_ss(&dst[n]));
+		_mm_store_ss(&dst[n], in1[0]);
+	}
+
+	g = _mm_set1_ps(gain->end);
+
+	if (SPA_IS_ALIGNED(&src[n], 16) &&
+	    SPA_IS_ALIGNED(&dst[n], 16))
+		unrolled = n + ((n_samples - n) & ~15);
+	else
+		unrolled = n;
+
+	for (; n < unrolled; n += 16) {
+		in2[0] = _mm_mul_ps(_mm_load_ps(&src[n+ 0]), g);
+		in2[1] = _mm_mul_ps(_mm_load_ps(&src[n+ 4]), g);
+		in2[2] = _mm_mul_ps(_mm_load_ps(&src[n+ 8]), g);
+		in2[3] = _mm_mul_ps(_mm_load_ps(&src[n+12]), g);
+
+		if (!first) {
+			in1[0] = _mm_load_ps(&dst[n+ 0]);
+			in1[1] = _mm_load_ps(&dst[n+ 4]);
+			in1[2] = _mm_load_ps(&dst[n+ 8]);
+			in1[3] = _mm_load_ps(&dst[n+12]);
+
+			in2[0] = _mm_add_ps(in1[0], in2[0]);
+			in2[1] = _mm_add_ps(in1[1], in2[1]);
+			in2[2] = _mm_add_ps(in1[2], in2[2]);
+			in2[3] = _mm_add_ps(in1[3], in2[3]);
+		}
+		_mm_store_ps(&dst[n+ 0], in2[0]);
+		_mm_store_ps(&dst[n+ 4], in2[1]);
+		_mm_store_ps(&dst[n+ 8], in2[2]);
+		_mm_store_ps(&dst[n+12], in2[3]);
+	}
+	for (; n < n_samples; n++) {
+		in1[0] = _mm_mul_ss(_mm_load_ss(&src[n]), g);
+		if (!first)
+			in1[0] = _mm_add_ss(in1[0], _mm_load_ss(&dst[n]));
+		_mm_store_ss(&dst[n], in1[0]);
+	}
+}
+
+void
+mix_gain_f32_sse(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		const struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	if (n_src == 0)
+		memset(dst, 0, n_samples * sizeof(float));
+
+	for (i = 0; i < n_src; i++)
+		mix_gain_2(dst, src[i], &gain[i], i == 0, n_samples);
 }
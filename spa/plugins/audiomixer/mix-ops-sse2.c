@@ -87,3 +87,68 @@ mix_f64_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_REST
 		mix_2(dst, src[i], n_samples);
 	}
 }
+
+#define ACC_SAMPLES	256u
+
+/* sign extend 8 s16 samples to 2 vectors of s32 */
+static inline void s16_to_s32(__m128i in, __m128i *lo, __m128i *hi)
+{
+	*lo = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+	*hi = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+}
+
+void
+mix_s16_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n, offs, chunk, unrolled;
+	int16_t *d = dst;
+	int32_t acc[ACC_SAMPLES] SPA_ALIGNED(16);
+	__m128i lo, hi;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int16_t));
+		return;
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(int16_t));
+		return;
+	}
+
+	for (offs = 0; offs < n_samples; offs += chunk) {
+		const int16_t *s = src[0];
+
+		chunk = SPA_MIN(n_samples - offs, ACC_SAMPLES);
+		unrolled = chunk & ~7;
+
+		for (n = 0; n < unrolled; n += 8) {
+			s16_to_s32(_mm_loadu_si128((__m128i*)&s[offs + n]), &lo, &hi);
+			_mm_store_si128((__m128i*)&acc[n + 0], lo);
+			_mm_store_si128((__m128i*)&acc[n + 4], hi);
+		}
+		for (; n < chunk; n++)
+			acc[n] = s[offs + n];
+
+		for (i = 1; i < n_src; i++) {
+			s = src[i];
+			for (n = 0; n < unrolled; n += 8) {
+				s16_to_s32(_mm_loadu_si128((__m128i*)&s[offs + n]), &lo, &hi);
+				lo = _mm_add_epi32(lo, _mm_load_si128((__m128i*)&acc[n + 0]));
+				hi = _mm_add_epi32(hi, _mm_load_si128((__m128i*)&acc[n + 4]));
+				_mm_store_si128((__m128i*)&acc[n + 0], lo);
+				_mm_store_si128((__m128i*)&acc[n + 4], hi);
+			}
+			for (; n < chunk; n++)
+				acc[n] += s[offs + n];
+		}
+
+		/* packs saturates to the s16 range */
+		for (n = 0; n < unrolled; n += 8) {
+			lo = _mm_load_si128((__m128i*)&acc[n + 0]);
+			hi = _mm_load_si128((__m128i*)&acc[n + 4]);
+			_mm_storeu_si128((__m128i*)&d[offs + n], _mm_packs_epi32(lo, hi));
+		}
+		for (; n < chunk; n++)
+			d[offs + n] = SPA_CLAMP(acc[n], INT16_MIN, INT16_MAX);
+	}
+}
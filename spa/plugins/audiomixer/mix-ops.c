@@ -34,6 +34,9 @@
 
 typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
 		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
+typedef void (*mix_gain_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], const struct mix_gain gain[],
+		uint32_t n_src, uint32_t n_samples);
 
 struct mix_info {
 	uint32_t fmt;
@@ -41,28 +44,53 @@ struct mix_info {
 	uint32_t cpu_flags;
 	uint32_t stride;
 	mix_func_t process;
+	mix_gain_func_t process_gain;
 };
 
 static struct mix_info mix_table[] =
 {
+	/* s16 */
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_SSE2, 2, mix_s16_sse2, mix_gain_s16_c },
+	{ SPA_AUDIO_FORMAT_S16P, 1, SPA_CPU_FLAG_SSE2, 2, mix_s16_sse2, mix_gain_s16_c },
+#endif
+	{ SPA_AUDIO_FORMAT_S16, 0, 0, 2, mix_s16_c, mix_gain_s16_c },
+	{ SPA_AUDIO_FORMAT_S16P, 1, 0, 2, mix_s16_c, mix_gain_s16_c },
+
+	/* s32 */
+	{ SPA_AUDIO_FORMAT_S32, 0, 0, 4, mix_s32_c, mix_gain_s32_c },
+	{ SPA_AUDIO_FORMAT_S32P, 1, 0, 4, mix_s32_c, mix_gain_s32_c },
+
 	/* f32 */
+#if defined(HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX512, 4, mix_f32_avx512, mix_gain_f32_avx512 },
+	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_AVX512, 4, mix_f32_avx512, mix_gain_f32_avx512 },
+#endif
 #if defined(HAVE_AVX)
-	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
-	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX, 4, mix_f32_avx, mix_gain_f32_avx },
+	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx, mix_gain_f32_avx },
 #endif
 #if defined (HAVE_SSE)
-	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
-	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_SSE, 4, mix_f32_sse, mix_gain_f32_sse },
+	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_SSE, 4, mix_f32_sse, mix_gain_f32_sse },
 #endif
-	{ SPA_AUDIO_FORMAT_F32, 1, 0, 4, mix_f32_c },
-	{ SPA_AUDIO_FORMAT_F32P, 1, 0, 4, mix_f32_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_NEON, 4, mix_f32_neon, mix_gain_f32_c },
+	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_NEON, 4, mix_f32_neon, mix_gain_f32_c },
+#endif
+	{ SPA_AUDIO_FORMAT_F32, 0, 0, 4, mix_f32_c, mix_gain_f32_c },
+	{ SPA_AUDIO_FORMAT_F32P, 1, 0, 4, mix_f32_c, mix_gain_f32_c },
 
+#if defined(HAVE_AVX)
+	{ SPA_AUDIO_FORMAT_F64, 0, SPA_CPU_FLAG_AVX, 8, mix_f64_avx, mix_gain_f64_c },
+	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_AVX, 8, mix_f64_avx, mix_gain_f64_c },
+#endif
 #if defined (HAVE_SSE2)
-	{ SPA_AUDIO_FORMAT_F64, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
-	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
+	{ SPA_AUDIO_FORMAT_F64, 0, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2, mix_gain_f64_c },
+	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2, mix_gain_f64_c },
 #endif
-	{ SPA_AUDIO_FORMAT_F64, 1, 0, 8, mix_f64_c },
-	{ SPA_AUDIO_FORMAT_F64P, 1, 0, 8, mix_f64_c },
+	{ SPA_AUDIO_FORMAT_F64, 0, 0, 8, mix_f64_c, mix_gain_f64_c },
+	{ SPA_AUDIO_FORMAT_F64P, 1, 0, 8, mix_f64_c, mix_gain_f64_c },
 };
 
 #define MATCH_CHAN(a,b)		((a) == 0 || (a) == (b))
@@ -82,6 +110,66 @@ static const struct mix_info *find_mix_info(uint32_t fmt,
 	return NULL;
 }
 
+/* Mix in blocks of this size. With many sources, the part of dst that is
+ * being accumulated then stays in the L1 cache while all sources are
+ * added to it instead of going through the cache once per source. */
+#define MIX_BLOCK_BYTES	4096
+
+static void impl_mix_ops_process(struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples)
+{
+	const struct mix_info *info = ops->priv;
+	uint32_t i, n, offs, block = MIX_BLOCK_BYTES / info->stride;
+
+	if (n_src <= 2 || n_samples <= block) {
+		info->process(ops, dst, src, n_src, n_samples);
+	} else {
+		const void *s[n_src];
+
+		for (offs = 0; offs < n_samples; offs += n) {
+			n = SPA_MIN(block, n_samples - offs);
+			for (i = 0; i < n_src; i++)
+				s[i] = SPA_MEMBER(src[i], offs * info->stride, void);
+			info->process(ops, SPA_MEMBER(dst, offs * info->stride, void),
+					s, n_src, n);
+		}
+	}
+}
+
+static void impl_mix_ops_process_gain(struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], const struct mix_gain gain[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const struct mix_info *info = ops->priv;
+	uint32_t i, n, offs, block = MIX_BLOCK_BYTES / info->stride;
+
+	if (n_src <= 2 || n_samples <= block) {
+		info->process_gain(ops, dst, src, gain, n_src, n_samples);
+	} else {
+		const void *s[n_src];
+		struct mix_gain g[n_src];
+
+		for (offs = 0; offs < n_samples; offs += n) {
+			n = SPA_MIN(block, n_samples - offs);
+			for (i = 0; i < n_src; i++) {
+				s[i] = SPA_MEMBER(src[i], offs * info->stride, void);
+				/* continue the ramps where the previous block ended */
+				g[i].end = gain[i].end;
+				if (offs < gain[i].ramp) {
+					g[i].start = gain[i].start + (gain[i].end - gain[i].start) *
+						offs / gain[i].ramp;
+					g[i].ramp = gain[i].ramp - offs;
+				} else {
+					g[i].start = gain[i].end;
+					g[i].ramp = 0;
+				}
+			}
+			info->process_gain(ops, SPA_MEMBER(dst, offs * info->stride, void),
+					s, g, n_src, n);
+		}
+	}
+}
+
 static void impl_mix_ops_clear(struct mix_ops *ops, void * SPA_RESTRICT dst, uint32_t n_samples)
 {
 	const struct mix_info *info = ops->priv;
@@ -104,7 +192,8 @@ int mix_ops_init(struct mix_ops *ops)
 	ops->priv = info;
 	ops->cpu_flags = info->cpu_flags;
 	ops->clear = impl_mix_ops_clear;
-	ops->process = info->process;
+	ops->process = impl_mix_ops_process;
+	ops->process_gain = impl_mix_ops_process_gain;
 	ops->free = impl_mix_ops_free;
 
 	return 0;
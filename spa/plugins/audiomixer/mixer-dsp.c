@@ -29,6 +29,7 @@
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/cpu.h>
+#include <spa/support/loop.h>
 #include <spa/utils/list.h>
 #include <spa/utils/names.h>
 #include <spa/node/node.h>
@@ -37,19 +38,23 @@
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/param.h>
 #include <spa/pod/filter.h>
+#include <spa/pod/parser.h>
 
 #include "mix-ops.h"
 
 #define NAME "mixer-dsp"
 
 #define MAX_BUFFERS	64
-#define MAX_PORTS	128
+#define MAX_PORTS	512
 #define MAX_SAMPLES	8192
 #define MAX_ALIGN	64
 
 #define PORT_DEFAULT_VOLUME	1.0
 #define PORT_DEFAULT_MUTE	false
 
+/* length of the gain ramp after a volume or mute change */
+#define PORT_RAMP_SAMPLES	256
+
 struct port_props {
 	double volume;
 	int32_t mute;
@@ -61,6 +66,11 @@ static void port_props_reset(struct port_props *props)
 	props->mute = PORT_DEFAULT_MUTE;
 }
 
+static inline float port_props_gain(struct port_props *props)
+{
+	return props->mute ? 0.0f : (float)props->volume;
+}
+
 struct buffer {
 	uint32_t id;
 #define BUFFER_FLAG_QUEUED	(1 << 0)
@@ -80,6 +90,11 @@ struct port {
 
 	struct port_props props;
 
+	/* only touched from the data loop */
+	float gain;			/* gain of the next sample */
+	float target;			/* gain at the end of the ramp */
+	uint32_t ramp;			/* samples left to reach the target */
+
 	struct spa_io_buffers *io;
 
 	uint64_t info_all;
@@ -102,6 +117,7 @@ struct impl {
 
 	struct spa_log *log;
 	struct spa_cpu *cpu;
+	struct spa_loop *data_loop;
 	uint32_t cpu_flags;
 
 	struct mix_ops ops;
@@ -114,7 +130,7 @@ struct impl {
 
 	uint32_t port_count;
 	uint32_t last_port;
-	struct port in_ports[MAX_PORTS];
+	struct port *in_ports[MAX_PORTS];
 	struct port out_ports[1];
 
 	int n_formats;
@@ -127,11 +143,12 @@ struct impl {
 	float empty[MAX_SAMPLES + MAX_ALIGN];
 };
 
-#define CHECK_FREE_IN_PORT(this,d,p) ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && !this->in_ports[(p)].valid)
-#define CHECK_IN_PORT(this,d,p)      ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && this->in_ports[(p)].valid)
+#define PORT_VALID(p)                ((p) != NULL && (p)->valid)
+#define CHECK_FREE_IN_PORT(this,d,p) ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && !PORT_VALID(this->in_ports[(p)]))
+#define CHECK_IN_PORT(this,d,p)      ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && PORT_VALID(this->in_ports[(p)]))
 #define CHECK_OUT_PORT(this,d,p)     ((d) == SPA_DIRECTION_OUTPUT && (p) == 0)
 #define CHECK_PORT(this,d,p)         (CHECK_OUT_PORT(this,d,p) || CHECK_IN_PORT (this,d,p))
-#define GET_IN_PORT(this,p)          (&this->in_ports[p])
+#define GET_IN_PORT(this,p)          (this->in_ports[p])
 #define GET_OUT_PORT(this,p)         (&this->out_ports[p])
 #define GET_PORT(this,d,p)           (d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,p) : GET_OUT_PORT(this,p))
 
@@ -210,7 +227,7 @@ static int impl_node_add_listener(void *object,
 	emit_node_info(this, true);
 	emit_port_info(this, GET_OUT_PORT(this, 0), true);
 	for (i = 0; i < this->last_port; i++) {
-		if (this->in_ports[i].valid)
+		if (PORT_VALID(this->in_ports[i]))
 			emit_port_info(this, GET_IN_PORT(this, i), true);
 	}
 
@@ -236,11 +253,19 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 	spa_return_val_if_fail(CHECK_FREE_IN_PORT(this, direction, port_id), -EINVAL);
 
-	port = GET_IN_PORT (this, port_id);
+	port = GET_IN_PORT(this, port_id);
+	if (port == NULL) {
+		port = calloc(1, sizeof(struct port));
+		if (port == NULL)
+			return -errno;
+		this->in_ports[port_id] = port;
+	}
 	port->direction = direction;
 	port->id = port_id;
 
 	port_props_reset(&port->props);
+	port->gain = port->target = port_props_gain(&port->props);
+	port->ramp = 0;
 
 	spa_list_init(&port->queue);
 	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS |
@@ -255,8 +280,9 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	port->params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
 	port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
 	port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->params[5] = SPA_PARAM_INFO(SPA_PARAM_Props, SPA_PARAM_INFO_READWRITE);
 	port->info.params = port->params;
-	port->info.n_params = 5;
+	port->info.n_params = 6;
 
 	this->port_count++;
 	if (this->last_port <= port_id)
@@ -292,7 +318,7 @@ impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_
 		int i;
 
 		for (i = this->last_port - 1; i >= 0; i--)
-			if (GET_IN_PORT (this, i)->valid)
+			if (PORT_VALID(GET_IN_PORT(this, i)))
 				break;
 
 		this->last_port = i + 1;
@@ -417,6 +443,18 @@ next:
 			return 0;
 		}
 		break;
+
+	case SPA_PARAM_Props:
+		if (direction != SPA_DIRECTION_INPUT)
+			return -ENOENT;
+		if (result.index > 0)
+			return 0;
+
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Props, id,
+			SPA_PROP_volume,	SPA_POD_Float(port->props.volume),
+			SPA_PROP_mute,		SPA_POD_Bool(port->props.mute));
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -534,6 +572,70 @@ static int port_set_format(void *object,
 	return 0;
 }
 
+struct port_gain {
+	struct port *port;
+	float target;
+};
+
+/* ramp from where we are now to the new gain, called from the data loop */
+static int do_port_set_gain(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	const struct port_gain *g = data;
+
+	g->port->target = g->target;
+	g->port->ramp = PORT_RAMP_SAMPLES;
+	return 0;
+}
+
+static int port_set_props(void *object,
+			  enum spa_direction direction,
+			  uint32_t port_id,
+			  const struct spa_pod *param)
+{
+	struct impl *this = object;
+	struct port *port;
+	struct port_props *p;
+	float volume, gain;
+	bool mute;
+
+	if (direction != SPA_DIRECTION_INPUT)
+		return -ENOENT;
+
+	port = GET_IN_PORT(this, port_id);
+	p = &port->props;
+	gain = port_props_gain(p);
+
+	if (param == NULL) {
+		port_props_reset(p);
+	} else {
+		volume = p->volume;
+		mute = p->mute;
+		if (spa_pod_parse_object(param,
+				SPA_TYPE_OBJECT_Props, NULL,
+				SPA_PROP_volume,	SPA_POD_OPT_Float(&volume),
+				SPA_PROP_mute,		SPA_POD_OPT_Bool(&mute)) < 0)
+			return -EINVAL;
+		p->volume = volume;
+		p->mute = mute;
+	}
+
+	if (port_props_gain(p) != gain) {
+		struct port_gain g = { port, port_props_gain(p) };
+
+		/* the gain and ramp are used by process() */
+		if (this->data_loop)
+			spa_loop_invoke(this->data_loop, do_port_set_gain, 0,
+					&g, sizeof(g), true, this);
+		else
+			do_port_set_gain(NULL, false, 0, &g, sizeof(g), this);
+
+		port->params[5].flags ^= SPA_PARAM_INFO_SERIAL;
+		port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
+		emit_port_info(this, port, false);
+	}
+	return 0;
+}
 
 static int
 impl_node_port_set_param(void *object,
@@ -546,11 +648,14 @@ impl_node_port_set_param(void *object,
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
 
-	if (id == SPA_PARAM_Format) {
+	switch (id) {
+	case SPA_PARAM_Format:
 		return port_set_format(this, direction, port_id, flags, param);
-	}
-	else
+	case SPA_PARAM_Props:
+		return port_set_props(this, direction, port_id, param);
+	default:
 		return -ENOENT;
+	}
 }
 
 static int
@@ -655,7 +760,10 @@ static int impl_node_process(void *object)
 	uint32_t n_samples, n_buffers, i, maxsize;
         struct buffer **buffers;
         struct buffer *outb;
+	struct port **ports;
 	const void **datas;
+	struct mix_gain *gain;
+	bool unity = true;
 
 	spa_return_val_if_fail(this != NULL, -EINVAL);
 
@@ -675,8 +783,10 @@ static int impl_node_process(void *object)
 		outio->buffer_id = SPA_ID_INVALID;
 	}
 
-        buffers = alloca(MAX_PORTS * sizeof(struct buffer *));
-        datas = alloca(MAX_PORTS * sizeof(void *));
+        buffers = alloca(this->last_port * sizeof(struct buffer *));
+        ports = alloca(this->last_port * sizeof(struct port *));
+        datas = alloca(this->last_port * sizeof(void *));
+        gain = alloca(this->last_port * sizeof(struct mix_gain));
         n_buffers = 0;
 
 	maxsize = MAX_SAMPLES * sizeof(float);
@@ -685,6 +795,10 @@ static int impl_node_process(void *object)
 		struct port *inport = GET_IN_PORT(this, i);
 		struct spa_io_buffers *inio = NULL;
 		struct buffer *inb;
+		float target;
+
+		if (inport == NULL)
+			continue;
 
 		if (!inport->valid ||
 		    (inio = inport->io) == NULL ||
@@ -699,15 +813,33 @@ static int impl_node_process(void *object)
 			continue;
 		}
 
+		inio->status = SPA_STATUS_NEED_DATA;
+
 		inb = &inport->buffers[inio->buffer_id];
 		maxsize = SPA_MIN(inb->buffer->datas[0].chunk->size, maxsize);
 
+		if (SPA_FLAG_IS_SET(inb->buffer->datas[0].chunk->flags, SPA_CHUNK_FLAG_EMPTY)) {
+			spa_log_trace_fp(this->log, NAME " %p: skip empty input %d", this, i);
+			continue;
+		}
+		target = inport->target;
+		if (target == 0.0f && inport->ramp == 0) {
+			spa_log_trace_fp(this->log, NAME " %p: skip muted input %d", this, i);
+			continue;
+		}
+
 		spa_log_trace_fp(this->log, NAME " %p: mix input %d %p->%p %d %d %d", this,
 				i, inio, outio, inio->status, inio->buffer_id, maxsize);
 
+		gain[n_buffers].start = inport->gain;
+		gain[n_buffers].end = target;
+		gain[n_buffers].ramp = inport->ramp;
+		if (inport->ramp > 0 || target != 1.0f)
+			unity = false;
+
 		datas[n_buffers] = inb->buffer->datas[0].data;
+		ports[n_buffers] = inport;
 		buffers[n_buffers++] = inb;
-		inio->status = SPA_STATUS_NEED_DATA;
 	}
 
 	outb = dequeue_buffer(this, outport);
@@ -718,7 +850,7 @@ static int impl_node_process(void *object)
 
 	n_samples = maxsize / sizeof(float);
 
-	if (n_buffers == 1) {
+	if (n_buffers == 1 && unity) {
 		*outb->buffer = *buffers[0]->buffer;
 	}
 	else {
@@ -729,8 +861,28 @@ static int impl_node_process(void *object)
 		outb->datas[0].chunk->offset = 0;
 		outb->datas[0].chunk->size = n_samples * sizeof(float);
 		outb->datas[0].chunk->stride = sizeof(float);
+		outb->datas[0].chunk->flags = n_buffers == 0 ? SPA_CHUNK_FLAG_EMPTY : 0;
+
+		if (unity)
+			mix_ops_process(&this->ops, outb->datas[0].data,
+					datas, n_buffers, n_samples);
+		else
+			mix_ops_process_gain(&this->ops, outb->datas[0].data,
+					datas, gain, n_buffers, n_samples);
+	}
 
-		mix_ops_process(&this->ops, outb->datas[0].data, datas, n_buffers, n_samples);
+	for (i = 0; i < n_buffers; i++) {
+		struct port *p = ports[i];
+
+		if (p->ramp == 0)
+			continue;
+		if (n_samples >= p->ramp) {
+			p->gain = gain[i].end;
+			p->ramp = 0;
+		} else {
+			p->gain += (gain[i].end - p->gain) * n_samples / p->ramp;
+			p->ramp -= n_samples;
+		}
 	}
 
 	outio->buffer_id = outb->id;
@@ -776,6 +928,16 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 static int impl_clear(struct spa_handle *handle)
 {
+	struct impl *this;
+	uint32_t i;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	for (i = 0; i < MAX_PORTS; i++)
+		free(this->in_ports[i]);
+
 	return 0;
 }
 
@@ -806,6 +968,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 
 	if (this->cpu)
 		this->cpu_flags = spa_cpu_get_flags(this->cpu);
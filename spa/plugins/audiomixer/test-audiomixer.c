@@ -0,0 +1,504 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <spa/utils/names.h>
+#include <spa/support/plugin.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/buffer/buffer.h>
+
+#define MAX_FRAMES	8192
+#define N_BUFFERS	2
+
+/* the inputs carry a counter per frame in the first channel, the values
+ * wrap so that they stay exact in a float */
+#define COUNTER_MASK	((1u << 20) - 1)
+
+struct buf {
+	float *data;
+	struct spa_chunk chunk;
+	struct spa_data d;
+	struct spa_buffer b;
+};
+
+struct context {
+	struct spa_handle *handle;
+	struct spa_node *node;
+
+	uint32_t channels;
+	uint32_t quantum;
+	struct spa_io_position position;
+
+	struct spa_io_buffers in_io;
+	struct buf in[N_BUFFERS];
+	uint32_t in_index;
+	uint64_t written;		/* frames given to the input */
+
+	struct spa_io_buffers out_io;
+	struct buf out[N_BUFFERS];
+	struct spa_buffer *out_bufs[N_BUFFERS];
+};
+
+static const struct spa_handle_factory *find_factory(const char *name)
+{
+	uint32_t index = 0;
+	const struct spa_handle_factory *factory;
+
+	while (spa_handle_factory_enum(&factory, &index) == 1) {
+		if (strcmp(factory->name, name) == 0)
+			return factory;
+	}
+	return NULL;
+}
+
+static void init_buf(struct buf *b, uint32_t size)
+{
+	b->data = calloc(1, size);
+	spa_assert(b->data != NULL);
+	b->d = (struct spa_data) {
+		.type = SPA_DATA_MemPtr,
+		.maxsize = size,
+		.data = b->data,
+		.chunk = &b->chunk,
+	};
+	b->b = (struct spa_buffer) { .n_datas = 1, .datas = &b->d };
+}
+
+static void setup_context(struct context *ctx, uint32_t channels, uint32_t quantum,
+		const char *latency, const char *max)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_dict_item items[3];
+	struct spa_dict info;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	struct spa_audio_info_raw raw;
+	struct spa_buffer *in_bufs[N_BUFFERS];
+	uint32_t i, size;
+	void *iface;
+	int res;
+
+	spa_zero(*ctx);
+	ctx->channels = channels;
+	ctx->quantum = quantum;
+
+	items[0] = SPA_DICT_ITEM_INIT("audiomixer.jitter", "1");
+	items[1] = SPA_DICT_ITEM_INIT("audiomixer.jitter.latency", latency);
+	items[2] = SPA_DICT_ITEM_INIT("audiomixer.jitter.max", max);
+	info = SPA_DICT_INIT(items, 3);
+
+	factory = find_factory(SPA_NAME_AUDIO_MIXER);
+	spa_assert(factory != NULL);
+
+	ctx->handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(ctx->handle != NULL);
+	res = spa_handle_factory_init(factory, ctx->handle, &info, NULL, 0);
+	spa_assert(res >= 0);
+	res = spa_handle_get_interface(ctx->handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert(res >= 0);
+	ctx->node = iface;
+
+	ctx->position.clock.duration = quantum;
+	res = spa_node_set_io(ctx->node, SPA_IO_Position, &ctx->position, sizeof(ctx->position));
+	spa_assert(res == 0);
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	raw = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_F32,
+		.rate = 48000,
+		.channels = channels,
+	};
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &raw);
+
+	res = spa_node_add_port(ctx->node, SPA_DIRECTION_INPUT, 0, NULL);
+	spa_assert(res == 0);
+	res = spa_node_port_set_param(ctx->node, SPA_DIRECTION_INPUT, 0,
+			SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+	res = spa_node_port_set_param(ctx->node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+
+	size = 2 * MAX_FRAMES * channels * sizeof(float);
+	for (i = 0; i < N_BUFFERS; i++) {
+		init_buf(&ctx->in[i], size);
+		in_bufs[i] = &ctx->in[i].b;
+		init_buf(&ctx->out[i], size);
+		ctx->out_bufs[i] = &ctx->out[i].b;
+	}
+	res = spa_node_port_use_buffers(ctx->node, SPA_DIRECTION_INPUT, 0, 0,
+			in_bufs, N_BUFFERS);
+	spa_assert(res == 0);
+	res = spa_node_port_use_buffers(ctx->node, SPA_DIRECTION_OUTPUT, 0, 0,
+			ctx->out_bufs, N_BUFFERS);
+	spa_assert(res == 0);
+
+	ctx->in_io = SPA_IO_BUFFERS_INIT;
+	ctx->out_io = SPA_IO_BUFFERS_INIT;
+	res = spa_node_port_set_io(ctx->node, SPA_DIRECTION_INPUT, 0,
+			SPA_IO_Buffers, &ctx->in_io, sizeof(ctx->in_io));
+	spa_assert(res == 0);
+	res = spa_node_port_set_io(ctx->node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_IO_Buffers, &ctx->out_io, sizeof(ctx->out_io));
+	spa_assert(res == 0);
+}
+
+static void clean_context(struct context *ctx)
+{
+	uint32_t i;
+
+	spa_handle_clear(ctx->handle);
+	free(ctx->handle);
+	for (i = 0; i < N_BUFFERS; i++) {
+		free(ctx->in[i].data);
+		free(ctx->out[i].data);
+	}
+}
+
+/* give frames of the counter to the input, only the first channel
+ * is written, the other channels keep their zeros */
+static void feed(struct context *ctx, uint32_t frames)
+{
+	struct buf *b = &ctx->in[ctx->in_index];
+	uint32_t i;
+
+	if (frames == 0)
+		return;
+
+	for (i = 0; i < frames; i++)
+		b->data[i * ctx->channels] = (ctx->written + i) & COUNTER_MASK;
+
+	b->chunk.offset = 0;
+	b->chunk.size = frames * ctx->channels * sizeof(float);
+	b->chunk.flags = 0;
+	ctx->written += frames;
+
+	ctx->in_io.buffer_id = ctx->in_index;
+	ctx->in_io.status = SPA_STATUS_HAVE_DATA;
+	ctx->in_index = (ctx->in_index + 1) % N_BUFFERS;
+}
+
+/* run a cycle, returns the output buffer */
+static struct buf *cycle(struct context *ctx)
+{
+	struct buf *b;
+	int res;
+
+	ctx->out_io.status = SPA_STATUS_NEED_DATA;
+	res = spa_node_process(ctx->node);
+	spa_assert(res == SPA_STATUS_HAVE_DATA);
+	spa_assert(ctx->in_io.status == SPA_STATUS_NEED_DATA);
+	spa_assert(ctx->out_io.buffer_id < N_BUFFERS);
+
+	b = &ctx->out[ctx->out_io.buffer_id];
+	spa_assert(b->chunk.size == ctx->quantum * ctx->channels * sizeof(float));
+	return b;
+}
+
+static float value(struct context *ctx, struct buf *b, uint32_t frame)
+{
+	return b->data[frame * ctx->channels];
+}
+
+/* check that frames [start, end) of b continue the counter from first */
+static void check_counter(struct context *ctx, struct buf *b, uint32_t start, uint32_t end,
+		uint32_t first)
+{
+	uint32_t i;
+
+	spa_assert(!SPA_FLAG_IS_SET(b->chunk.flags, SPA_CHUNK_FLAG_EMPTY));
+	for (i = start; i < end; i++)
+		spa_assert(value(ctx, b, i) == ((first + i - start) & COUNTER_MASK));
+}
+
+static void check_silence(struct context *ctx, struct buf *b, uint32_t start, uint32_t end)
+{
+	uint32_t i;
+
+	for (i = start; i < end; i++)
+		spa_assert(value(ctx, b, i) == 0.0f);
+}
+
+static void test_steady(void)
+{
+	struct context ctx;
+	struct buf *b;
+	uint32_t i;
+
+	setup_context(&ctx, 2, 256, "256", "256");
+
+	/* the input is only mixed when the latency is buffered */
+	feed(&ctx, 256);
+	b = cycle(&ctx);
+	spa_assert(SPA_FLAG_IS_SET(b->chunk.flags, SPA_CHUNK_FLAG_EMPTY));
+
+	for (i = 1; i < 64; i++) {
+		feed(&ctx, 256);
+		b = cycle(&ctx);
+		check_counter(&ctx, b, 0, 256, (i - 1) * 256);
+	}
+	clean_context(&ctx);
+}
+
+static void test_underrun(void)
+{
+	struct context ctx;
+	struct buf *b;
+
+	setup_context(&ctx, 2, 256, "256", "256");
+
+	feed(&ctx, 256);
+	cycle(&ctx);
+	feed(&ctx, 256);
+	b = cycle(&ctx);
+	check_counter(&ctx, b, 0, 256, 0);
+
+	/* one late cycle is absorbed by the latency */
+	b = cycle(&ctx);
+	check_counter(&ctx, b, 0, 256, 256);
+
+	/* a second one is not, the input is not mixed and fills up again */
+	b = cycle(&ctx);
+	spa_assert(SPA_FLAG_IS_SET(b->chunk.flags, SPA_CHUNK_FLAG_EMPTY));
+	feed(&ctx, 256);
+	b = cycle(&ctx);
+	spa_assert(SPA_FLAG_IS_SET(b->chunk.flags, SPA_CHUNK_FLAG_EMPTY));
+
+	/* no samples are lost */
+	feed(&ctx, 256);
+	b = cycle(&ctx);
+	check_counter(&ctx, b, 0, 256, 512);
+
+	/* a short cycle is padded with silence */
+	feed(&ctx, 256 + 128);
+	b = cycle(&ctx);
+	check_counter(&ctx, b, 0, 256, 768);
+	b = cycle(&ctx);
+	check_counter(&ctx, b, 0, 256, 1024);
+	b = cycle(&ctx);
+	check_counter(&ctx, b, 0, 128, 1280);
+	check_silence(&ctx, b, 128, 256);
+
+	clean_context(&ctx);
+}
+
+/* the input runs ahead, check that the latency stays bounded and that
+ * only whole chunks of the oldest samples are dropped */
+static void run_drift(uint32_t frames, uint32_t latency, uint32_t max)
+{
+	struct context ctx;
+	struct buf *b;
+	char lat_str[16], max_str[16];
+	uint32_t i, first, dropped = 0;
+	uint64_t next = 0, buffered;
+
+	snprintf(lat_str, sizeof(lat_str), "%u", latency);
+	snprintf(max_str, sizeof(max_str), "%u", max);
+	setup_context(&ctx, 2, 256, lat_str, max_str);
+
+	for (i = 0; i < 256; i++) {
+		feed(&ctx, frames);
+		b = cycle(&ctx);
+		if (SPA_FLAG_IS_SET(b->chunk.flags, SPA_CHUNK_FLAG_EMPTY))
+			continue;
+
+		first = value(&ctx, b, 0);
+		if (first != (next & COUNTER_MASK))
+			dropped++;
+		next = first + (next & ~(uint64_t)COUNTER_MASK);
+		check_counter(&ctx, b, 0, 256, first);
+		next += 256;
+
+		buffered = ctx.written - next;
+		spa_assert(buffered <= latency + max);
+	}
+	spa_assert(dropped > 0);
+
+	clean_context(&ctx);
+}
+
+static void test_drift(void)
+{
+	/* slightly fast */
+	run_drift(256 + 32, 256, 256);
+	/* twice too fast */
+	run_drift(512, 256, 256);
+	/* no extra latency allowed */
+	run_drift(256 + 1, 256, 0);
+}
+
+/* run until the 32 bits ringbuffer index wraps around */
+static void test_ring_wrap(void)
+{
+	struct context ctx;
+	struct buf *b;
+	uint64_t bytes, total = 0;
+	uint32_t first;
+
+	setup_context(&ctx, 8, MAX_FRAMES, "100", "100");
+	bytes = MAX_FRAMES * ctx.channels * sizeof(float);
+
+	feed(&ctx, MAX_FRAMES);
+	b = cycle(&ctx);
+	spa_assert(SPA_FLAG_IS_SET(b->chunk.flags, SPA_CHUNK_FLAG_EMPTY));
+
+	/* the priming overshoots the latency and the oldest samples are
+	 * dropped, after that the ring reads at an odd offset */
+	feed(&ctx, MAX_FRAMES);
+	b = cycle(&ctx);
+	first = value(&ctx, b, 0);
+	spa_assert(first != 0);
+	check_counter(&ctx, b, 0, MAX_FRAMES, first);
+	first = (first + MAX_FRAMES) & COUNTER_MASK;
+
+	while (total < (1ull << 32) + 4 * bytes) {
+		feed(&ctx, MAX_FRAMES);
+		b = cycle(&ctx);
+		check_counter(&ctx, b, 0, MAX_FRAMES, first);
+		first = (first + MAX_FRAMES) & COUNTER_MASK;
+		total += bytes;
+	}
+	clean_context(&ctx);
+}
+
+#define MIX_SAMPLES	256
+#define MIX_OFFSET	64
+
+/* three s16 inputs in the default mode whose pairwise sums overflow but
+ * whose total does not, the third input wraps around in its buffer */
+static void test_mix_s16(void)
+{
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	struct spa_node *node;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_pod *param;
+	struct spa_audio_info_raw raw;
+	int16_t in_data[3][MIX_SAMPLES], out_data[MIX_SAMPLES];
+	struct spa_chunk in_chunk[3], out_chunk;
+	struct spa_data in_d[3], out_d;
+	struct spa_buffer in_b[3], out_b, *bufs[1];
+	struct spa_io_buffers in_io[3], out_io;
+	uint32_t i, j;
+	void *iface;
+	int res;
+
+	factory = find_factory(SPA_NAME_AUDIO_MIXER);
+	spa_assert(factory != NULL);
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	res = spa_handle_factory_init(factory, handle, NULL, NULL, 0);
+	spa_assert(res >= 0);
+	res = spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_Node, &iface);
+	spa_assert(res >= 0);
+	node = iface;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	raw = (struct spa_audio_info_raw) {
+		.format = SPA_AUDIO_FORMAT_S16,
+		.rate = 48000,
+		.channels = 1,
+	};
+	param = spa_format_audio_raw_build(&b, SPA_PARAM_Format, &raw);
+
+	for (i = 0; i < 3; i++) {
+		for (j = 0; j < MIX_SAMPLES; j++)
+			in_data[i][j] = i < 2 ? 20000 : -15000 + j;
+		in_chunk[i] = (struct spa_chunk) {
+			.offset = i < 2 ? 0 : MIX_OFFSET * sizeof(int16_t),
+			.size = sizeof(in_data[i]),
+			.stride = sizeof(int16_t),
+		};
+		in_d[i] = (struct spa_data) {
+			.type = SPA_DATA_MemPtr,
+			.maxsize = sizeof(in_data[i]),
+			.data = in_data[i],
+			.chunk = &in_chunk[i],
+		};
+		in_b[i] = (struct spa_buffer) { .n_datas = 1, .datas = &in_d[i] };
+
+		res = spa_node_add_port(node, SPA_DIRECTION_INPUT, i, NULL);
+		spa_assert(res == 0);
+		res = spa_node_port_set_param(node, SPA_DIRECTION_INPUT, i,
+				SPA_PARAM_Format, 0, param);
+		spa_assert(res == 0);
+		bufs[0] = &in_b[i];
+		res = spa_node_port_use_buffers(node, SPA_DIRECTION_INPUT, i, 0, bufs, 1);
+		spa_assert(res == 0);
+		in_io[i] = SPA_IO_BUFFERS_INIT;
+		in_io[i].status = SPA_STATUS_HAVE_DATA;
+		in_io[i].buffer_id = 0;
+		res = spa_node_port_set_io(node, SPA_DIRECTION_INPUT, i,
+				SPA_IO_Buffers, &in_io[i], sizeof(in_io[i]));
+		spa_assert(res == 0);
+	}
+
+	out_d = (struct spa_data) {
+		.type = SPA_DATA_MemPtr,
+		.maxsize = sizeof(out_data),
+		.data = out_data,
+		.chunk = &out_chunk,
+	};
+	out_b = (struct spa_buffer) { .n_datas = 1, .datas = &out_d };
+	res = spa_node_port_set_param(node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_PARAM_Format, 0, param);
+	spa_assert(res == 0);
+	bufs[0] = &out_b;
+	res = spa_node_port_use_buffers(node, SPA_DIRECTION_OUTPUT, 0, 0, bufs, 1);
+	spa_assert(res == 0);
+	out_io = SPA_IO_BUFFERS_INIT;
+	out_io.status = SPA_STATUS_NEED_DATA;
+	res = spa_node_port_set_io(node, SPA_DIRECTION_OUTPUT, 0,
+			SPA_IO_Buffers, &out_io, sizeof(out_io));
+	spa_assert(res == 0);
+
+	res = spa_node_process(node);
+	spa_assert(res == SPA_STATUS_HAVE_DATA);
+	spa_assert(out_io.buffer_id == 0);
+	spa_assert(out_chunk.size == sizeof(out_data));
+
+	for (j = 0; j < MIX_SAMPLES; j++)
+		spa_assert(out_data[j] == 25000 + (int)((MIX_OFFSET + j) % MIX_SAMPLES));
+
+	spa_handle_clear(handle);
+	free(handle);
+}
+
+int main(int argc, char *argv[])
+{
+	test_steady();
+	test_underrun();
+	test_drift();
+	test_ring_wrap();
+	test_mix_s16();
+
+	return 0;
+}
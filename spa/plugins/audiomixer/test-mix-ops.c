@@ -0,0 +1,333 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "mix-ops.c"
+#include "../test-cpu.h"
+
+#define N_SAMPLES	4099
+#define MAX_SOURCES	7
+
+/* sources are N_SAMPLES + 1 doubles apart, the extra sample is used to
+ * make the pointers unaligned */
+static double samp_in[MAX_SOURCES][N_SAMPLES + 1];
+static double samp_out[N_SAMPLES + 1];
+static double samp_ref[N_SAMPLES + 1];
+
+static const uint32_t sample_counts[] = { 1, 3, 4, 7, 15, 16, 33, 255, 1021, N_SAMPLES };
+static const uint32_t source_counts[] = { 0, 1, 2, 3, 4, 5, MAX_SOURCES };
+
+static uint32_t cpu_flags;
+
+static const char *fmt_name(uint32_t fmt)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16P:
+		return "s16";
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_S32P:
+		return "s32";
+	case SPA_AUDIO_FORMAT_F32:
+	case SPA_AUDIO_FORMAT_F32P:
+		return "f32";
+	default:
+		return "f64";
+	}
+}
+
+/* random samples, the integer formats use the full range so that the
+ * sums saturate */
+static void fill_samples(uint32_t fmt)
+{
+	uint32_t i, j;
+
+	srand(0x5eed);
+	for (i = 0; i < MAX_SOURCES; i++) {
+		for (j = 0; j < N_SAMPLES + 1; j++) {
+			double v = (double)rand() / RAND_MAX * 2.0 - 1.0;
+
+			switch (fmt) {
+			case SPA_AUDIO_FORMAT_S16:
+			case SPA_AUDIO_FORMAT_S16P:
+				((int16_t*)samp_in[i])[j] = v * 32767;
+				break;
+			case SPA_AUDIO_FORMAT_S32:
+			case SPA_AUDIO_FORMAT_S32P:
+				((int32_t*)samp_in[i])[j] = v * 2147483647;
+				break;
+			case SPA_AUDIO_FORMAT_F32:
+			case SPA_AUDIO_FORMAT_F32P:
+				((float*)samp_in[i])[j] = v;
+				break;
+			default:
+				samp_in[i][j] = v;
+				break;
+			}
+		}
+	}
+}
+
+static double get_sample(uint32_t fmt, const void *data, uint32_t n)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16P:
+		return ((const int16_t*)data)[n];
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_S32P:
+		return ((const int32_t*)data)[n];
+	case SPA_AUDIO_FORMAT_F32:
+	case SPA_AUDIO_FORMAT_F32P:
+		return ((const float*)data)[n];
+	default:
+		return ((const double*)data)[n];
+	}
+}
+
+static double full_scale(uint32_t fmt)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16P:
+		return 32768.0;
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_S32P:
+		return 2147483648.0;
+	default:
+		return 1.0;
+	}
+}
+
+/* integers must match exactly, unless a gain is applied and the rounding
+ * of the float math may differ */
+static void compare(const char *name, const struct mix_info *info,
+		const void *a, const void *b, uint32_t n_samples, uint32_t n_src, bool gain)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_samples; i++) {
+		double va = get_sample(info->fmt, a, i);
+		double vb = get_sample(info->fmt, b, i);
+		double diff = fabs(va - vb);
+
+		switch (info->fmt) {
+		case SPA_AUDIO_FORMAT_F32:
+		case SPA_AUDIO_FORMAT_F32P:
+			if (diff > 1e-5 * (n_src + 1))
+				goto error;
+			break;
+		case SPA_AUDIO_FORMAT_F64:
+		case SPA_AUDIO_FORMAT_F64P:
+			if (diff > (gain ? 1e-6 : 1e-12) * (n_src + 1))
+				goto error;
+			break;
+		default:
+			/* the gains are floats, allow their precision relative
+			 * to the full scale of the sources */
+			if (diff > (gain ? 1.0 + full_scale(info->fmt) * (n_src + 1) * 1e-6 : 0.0))
+				goto error;
+			break;
+		}
+		continue;
+error:
+		fprintf(stderr, "%s %s cpu %08x: %u sources %u samples, sample %u: %f != %f\n",
+				name, fmt_name(info->fmt), info->cpu_flags,
+				n_src, n_samples, i, va, vb);
+		spa_assert_not_reached();
+	}
+}
+
+/* the sum of the sources, saturated for the integer formats */
+static void make_reference(uint32_t fmt, void *dst, const void *src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n;
+
+	for (n = 0; n < n_samples; n++) {
+		double sum = 0.0;
+
+		for (i = 0; i < n_src; i++)
+			sum += get_sample(fmt, src[i], n);
+
+		switch (fmt) {
+		case SPA_AUDIO_FORMAT_S16:
+		case SPA_AUDIO_FORMAT_S16P:
+			((int16_t*)dst)[n] = SPA_CLAMP(sum, INT16_MIN, INT16_MAX);
+			break;
+		case SPA_AUDIO_FORMAT_S32:
+		case SPA_AUDIO_FORMAT_S32P:
+			((int32_t*)dst)[n] = SPA_CLAMP(sum, INT32_MIN, INT32_MAX);
+			break;
+		case SPA_AUDIO_FORMAT_F32:
+		case SPA_AUDIO_FORMAT_F32P:
+			((float*)dst)[n] = sum;
+			break;
+		default:
+			((double*)dst)[n] = sum;
+			break;
+		}
+	}
+}
+
+static void get_sources(const struct mix_info *info, const void *src[],
+		uint32_t n_src, uint32_t align)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_src; i++)
+		src[i] = SPA_MEMBER(samp_in[i], align * info->stride, void);
+}
+
+static void set_gains(struct mix_gain gain[], uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i;
+
+	for (i = 0; i < n_src; i++) {
+		gain[i].start = 0.25f * i;
+		gain[i].end = 1.5f - 0.2f * i;
+		/* no ramp, a ramp inside and one longer than the samples */
+		gain[i].ramp = (i % 3) == 0 ? 0 : (i % 3) == 1 ? n_samples / 2 : n_samples * 2;
+	}
+}
+
+static void test_process(const struct mix_info *info, const struct mix_info *ref)
+{
+	const void *src[MAX_SOURCES];
+	struct mix_gain gain[MAX_SOURCES];
+	uint32_t i, j, align;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_counts); i++) {
+		uint32_t n_samples = sample_counts[i];
+
+		for (j = 0; j < SPA_N_ELEMENTS(source_counts); j++) {
+			uint32_t n_src = source_counts[j];
+
+			for (align = 0; align < 2; align++) {
+				void *out = SPA_MEMBER(samp_out, align * info->stride, void);
+				void *res = SPA_MEMBER(samp_ref, align * info->stride, void);
+
+				get_sources(info, src, n_src, align);
+
+				make_reference(info->fmt, res, src, n_src, n_samples);
+				info->process(NULL, out, src, n_src, n_samples);
+				compare("process", info, out, res, n_samples, n_src, false);
+
+				set_gains(gain, n_src, n_samples);
+				ref->process_gain(NULL, res, src, gain, n_src, n_samples);
+				info->process_gain(NULL, out, src, gain, n_src, n_samples);
+				compare("process_gain", info, out, res, n_samples, n_src, true);
+			}
+		}
+	}
+}
+
+/* mixing into the first source, like the mixers do for the first layer */
+static void test_in_place(const struct mix_info *info)
+{
+	const void *src[MAX_SOURCES];
+	uint32_t j;
+
+	for (j = 1; j < SPA_N_ELEMENTS(source_counts); j++) {
+		uint32_t n_src = source_counts[j];
+
+		fill_samples(info->fmt);
+		get_sources(info, src, n_src, 1);
+		make_reference(info->fmt, samp_ref, src, n_src, N_SAMPLES);
+		info->process(NULL, (void*)src[0], src, n_src, N_SAMPLES);
+		compare("in place", info, src[0], samp_ref, N_SAMPLES, n_src, false);
+	}
+	fill_samples(info->fmt);
+}
+
+/* go through mix_ops, which mixes in blocks and continues the ramps
+ * across the blocks */
+static void test_blocked(const struct mix_info *info, const struct mix_info *ref)
+{
+	struct mix_ops ops;
+	const void *src[MAX_SOURCES];
+	struct mix_gain gain[MAX_SOURCES];
+	uint32_t j;
+
+	spa_zero(ops);
+	ops.fmt = info->fmt;
+	ops.n_channels = info->n_channels ? info->n_channels : 2;
+	ops.cpu_flags = info->cpu_flags;
+	spa_assert(mix_ops_init(&ops) == 0);
+	spa_assert(ops.priv == info);
+
+	for (j = 0; j < SPA_N_ELEMENTS(source_counts); j++) {
+		uint32_t n_src = source_counts[j];
+
+		get_sources(info, src, n_src, 1);
+
+		ref->process(NULL, samp_ref, src, n_src, N_SAMPLES);
+		mix_ops_process(&ops, samp_out, src, n_src, N_SAMPLES);
+		compare("blocked process", info, samp_out, samp_ref, N_SAMPLES, n_src, false);
+
+		set_gains(gain, n_src, N_SAMPLES);
+		ref->process_gain(NULL, samp_ref, src, gain, n_src, N_SAMPLES);
+		mix_ops_process_gain(&ops, samp_out, src, gain, n_src, N_SAMPLES);
+		compare("blocked process_gain", info, samp_out, samp_ref, N_SAMPLES, n_src, true);
+	}
+	mix_ops_free(&ops);
+}
+
+static void test_mix_table(void)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(mix_table); i++) {
+		const struct mix_info *info = &mix_table[i];
+		const struct mix_info *ref;
+
+		if (!MATCH_CPU_FLAGS(info->cpu_flags, cpu_flags))
+			continue;
+
+		ref = find_mix_info(info->fmt, info->n_channels ? info->n_channels : 2, 0);
+		spa_assert(ref != NULL);
+		spa_assert(ref->cpu_flags == 0);
+
+		fprintf(stderr, "test %s %s cpu %08x\n", fmt_name(info->fmt),
+				info->n_channels ? "planar" : "interleaved", info->cpu_flags);
+
+		fill_samples(info->fmt);
+		test_process(info, ref);
+		test_in_place(info);
+		test_blocked(info, ref);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+
+	test_mix_table();
+
+	return 0;
+}
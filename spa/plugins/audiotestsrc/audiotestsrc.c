@@ -27,8 +27,10 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
+#include <spa/support/cpu.h>
 #include <spa/support/log.h>
 #include <spa/support/system.h>
 #include <spa/support/loop.h>
@@ -42,6 +44,8 @@
 #include <spa/pod/filter.h>
 #include <spa/control/control.h>
 
+#include "render-ops.h"
+
 #define NAME "audiotestsrc"
 
 #define SAMPLES_TO_TIME(this,s)   ((s) * SPA_NSEC_PER_SEC / (port)->current_format.info.raw.rate)
@@ -51,18 +55,27 @@
 enum wave_type {
 	WAVE_SINE,
 	WAVE_SQUARE,
+	WAVE_WHITE_NOISE,
+	WAVE_PINK_NOISE,
+};
+
+enum wave_mode {
+	MODE_GENERATE,
+	MODE_CONSTANT,
 };
 
 #define DEFAULT_LIVE false
 #define DEFAULT_WAVE WAVE_SINE
 #define DEFAULT_FREQ 440.0
 #define DEFAULT_VOLUME 1.0
+#define DEFAULT_MODE MODE_GENERATE
 
 struct props {
 	bool live;
 	uint32_t wave;
 	float freq;
 	float volume;
+	uint32_t mode;
 };
 
 static void reset_props(struct props *props)
@@ -71,6 +84,7 @@ static void reset_props(struct props *props)
 	props->wave = DEFAULT_WAVE;
 	props->freq = DEFAULT_FREQ;
 	props->volume = DEFAULT_VOLUME;
+	props->mode = DEFAULT_MODE;
 }
 
 #define MAX_SAMPLES	8192
@@ -87,8 +101,6 @@ struct buffer {
 
 struct impl;
 
-typedef int (*render_func_t) (struct impl *this, void *samples, size_t n_samples);
-
 struct port {
 	uint64_t info_all;
 	struct spa_port_info info;
@@ -100,8 +112,19 @@ struct port {
 	bool have_format;
 	struct spa_audio_info current_format;
 	size_t bpf;
-	render_func_t render_func;
+	struct render_ops ops;
 	float accumulator;
+	uint32_t noise[4];
+	float pink[3];
+
+	/* the constant pattern, pattern_periods periods of the wave in
+	 * pattern_frames frames, starting at pattern_phase */
+	void *pattern;
+	uint32_t pattern_frames;
+	uint32_t pattern_periods;
+	float pattern_phase;
+	uint32_t pattern_offset;
+	bool pattern_valid;
 
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
@@ -116,6 +139,8 @@ struct impl {
 	struct spa_log *log;
 	struct spa_loop *data_loop;
 	struct spa_system *data_system;
+	struct spa_cpu *cpu;
+	uint32_t cpu_flags;
 
 	uint64_t info_all;
 	struct spa_node_info info;
@@ -188,6 +213,10 @@ static int impl_node_enum_params(void *object, int seq,
 			spa_pod_builder_string(&b, "Sine wave");
 			spa_pod_builder_int(&b, WAVE_SQUARE);
 			spa_pod_builder_string(&b, "Square wave");
+			spa_pod_builder_int(&b, WAVE_WHITE_NOISE);
+			spa_pod_builder_string(&b, "White noise");
+			spa_pod_builder_int(&b, WAVE_PINK_NOISE);
+			spa_pod_builder_string(&b, "Pink noise");
 			spa_pod_builder_pop(&b, &f[1]);
 			param = spa_pod_builder_pop(&b, &f[0]);
 			break;
@@ -205,6 +234,22 @@ static int impl_node_enum_params(void *object, int seq,
 				SPA_PROP_INFO_name, SPA_POD_String("Select the volume"),
 				SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Float(p->volume, 0.0, 10.0));
 			break;
+		case 4:
+			spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_PropInfo, id);
+			spa_pod_builder_add(&b,
+				SPA_PROP_INFO_id,     SPA_POD_Id(SPA_PROP_waveMode),
+				SPA_PROP_INFO_name,   SPA_POD_String("Select how the samples are produced"),
+				SPA_PROP_INFO_type,   SPA_POD_Int(p->mode),
+				0);
+			spa_pod_builder_prop(&b, SPA_PROP_INFO_labels, 0);
+			spa_pod_builder_push_struct(&b, &f[1]);
+			spa_pod_builder_int(&b, MODE_GENERATE);
+			spa_pod_builder_string(&b, "Generate every buffer");
+			spa_pod_builder_int(&b, MODE_CONSTANT);
+			spa_pod_builder_string(&b, "Repeat a precomputed buffer");
+			spa_pod_builder_pop(&b, &f[1]);
+			param = spa_pod_builder_pop(&b, &f[0]);
+			break;
 		default:
 			return 0;
 		}
@@ -218,10 +263,11 @@ static int impl_node_enum_params(void *object, int seq,
 		case 0:
 			param = spa_pod_builder_add_object(&b,
 				SPA_TYPE_OBJECT_Props, id,
-				SPA_PROP_live,      SPA_POD_Bool(p->live),
-				SPA_PROP_waveType,  SPA_POD_Int(p->wave),
-				SPA_PROP_frequency, SPA_POD_Float(p->freq),
-				SPA_PROP_volume,    SPA_POD_Float(p->volume));
+				SPA_PROP_live,        SPA_POD_Bool(p->live),
+				SPA_PROP_waveType,    SPA_POD_Int(p->wave),
+				SPA_PROP_frequency,   SPA_POD_Float(p->freq),
+				SPA_PROP_volume,      SPA_POD_Float(p->volume),
+				SPA_PROP_waveMode,    SPA_POD_Int(p->mode));
 			break;
 		default:
 			return 0;
@@ -253,16 +299,19 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	if (id == SPA_PARAM_Props) {
 		struct props *p = &this->props;
 
+		this->port.pattern_valid = false;
+
 		if (param == NULL) {
 			reset_props(p);
 			return 0;
 		}
 		spa_pod_parse_object(param,
 			SPA_TYPE_OBJECT_Props, NULL,
-			SPA_PROP_live,      SPA_POD_OPT_Bool(&p->live),
-			SPA_PROP_waveType,  SPA_POD_OPT_Int(&p->wave),
-			SPA_PROP_frequency, SPA_POD_OPT_Float(&p->freq),
-			SPA_PROP_volume,    SPA_POD_OPT_Float(&p->volume));
+			SPA_PROP_live,        SPA_POD_OPT_Bool(&p->live),
+			SPA_PROP_waveType,    SPA_POD_OPT_Int(&p->wave),
+			SPA_PROP_frequency,   SPA_POD_OPT_Float(&p->freq),
+			SPA_PROP_volume,      SPA_POD_OPT_Float(&p->volume),
+			SPA_PROP_waveMode,    SPA_POD_OPT_Int(&p->mode));
 
 		if (p->live)
 			this->info.flags |= SPA_PORT_FLAG_LIVE;
@@ -356,9 +405,18 @@ static int make_buffer(struct impl *this)
 	l0 = SPA_MIN(n_bytes, maxsize - offset) / port->bpf;
 	l1 = n_samples - l0;
 
-	port->render_func(this, SPA_MEMBER(data, offset, void), l0);
-	if (l1 > 0)
-		port->render_func(this, data, l1);
+	if (this->props.volume == 0.0f) {
+		/* all formats are signed, zero is silence */
+		memset(SPA_MEMBER(data, offset, void), 0, l0 * port->bpf);
+		if (l1 > 0)
+			memset(data, 0, l1 * port->bpf);
+		d[0].chunk->flags = SPA_CHUNK_FLAG_EMPTY;
+	} else {
+		render(this, port, SPA_MEMBER(data, offset, void), l0);
+		if (l1 > 0)
+			render(this, port, data, l1);
+		d[0].chunk->flags = 0;
+	}
 
 	d[0].chunk->offset = index;
 	d[0].chunk->size = n_bytes;
@@ -676,6 +734,8 @@ port_set_format(struct impl *this,
 	int res;
 	struct port *port = &this->port;
 
+	port->pattern_valid = false;
+
 	if (format == NULL) {
 		port->have_format = false;
 		clear_buffers(this, port);
@@ -711,10 +771,24 @@ port_set_format(struct impl *this,
 			return -EINVAL;
 		}
 
+		if (info.info.raw.rate == 0 || info.info.raw.channels == 0)
+			return -EINVAL;
+
+		port->ops.fmt = info.info.raw.format;
+		port->ops.cpu_flags = this->cpu_flags;
+		if ((res = render_ops_init(&port->ops)) < 0)
+			return res;
+
+		free(port->pattern);
+		port->pattern = malloc(MAX_SAMPLES * sizes[idx] * info.info.raw.channels);
+		if (port->pattern == NULL) {
+			port->have_format = false;
+			return -errno;
+		}
+
 		port->bpf = sizes[idx] * info.info.raw.channels;
 		port->current_format = info;
 		port->have_format = true;
-		port->render_func = sine_funcs[idx];
 	}
 
 	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
@@ -863,6 +937,7 @@ static int process_control(struct impl *this, struct spa_pod_sequence *sequence)
 		case SPA_CONTROL_Properties:
 		{
 			struct props *p = &this->props;
+			this->port.pattern_valid = false;
 			spa_pod_parse_object(&c->value,
 				SPA_TYPE_OBJECT_Props, NULL,
 				SPA_PROP_frequency, SPA_POD_OPT_Float(&p->freq),
@@ -949,6 +1024,8 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	free(this->port.pattern);
+
 	if (this->data_loop)
 		spa_loop_remove_source(this->data_loop, &this->timer_source);
 	spa_system_close(this->data_system, this->timer_source.fd);
@@ -984,6 +1061,10 @@ impl_init(const struct spa_handle_factory *factory,
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 
 	spa_hook_list_init(&this->hooks);
 
@@ -1034,6 +1115,12 @@ impl_init(const struct spa_handle_factory *factory,
 	port->info.n_params = 5;
 	spa_list_init(&port->empty);
 
+	/* any nonzero seeds will do for the noise generators */
+	port->noise[0] = 0x9e3779b9;
+	port->noise[1] = 0x85ebca6b;
+	port->noise[2] = 0xc2b2ae35;
+	port->noise[3] = 0x27d4eb2f;
+
 	spa_log_info(this->log, NAME " %p: initialized", this);
 
 	return 0;
@@ -0,0 +1,151 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "render-ops.h"
+
+#define PI_F		((float)M_PI)
+#define PI_2_F		((float)(M_PI / 2.0))
+#define PI_M2_F		((float)(M_PI * 2.0))
+
+/* sin(x) for x in [-PI, PI). The argument is folded into [-PI/2, PI/2]
+ * and evaluated with a degree 11 odd polynomial, the error is below
+ * 1e-7, well under the resolution of 24 bit samples. The SIMD kernels
+ * use the same approximation. */
+static inline float sine_poly(float x)
+{
+	float x2;
+
+	if (x > PI_2_F)
+		x = PI_F - x;
+	else if (x < -PI_2_F)
+		x = -PI_F - x;
+
+	x2 = x * x;
+	return x * (1.0f + x2 * (-1.6666667e-1f + x2 * (8.3333333e-3f +
+		x2 * (-1.9841270e-4f + x2 * (2.7557319e-6f + x2 * -2.5052108e-8f)))));
+}
+
+void
+render_sine_c(struct render_ops *ops, float *dst, float *phase,
+		float step, float amp, uint32_t n_samples)
+{
+	uint32_t n;
+	float p = *phase;
+
+	for (n = 0; n < n_samples; n++) {
+		dst[n] = sine_poly(p) * amp;
+		p += step;
+		if (p >= PI_F)
+			p -= PI_M2_F;
+	}
+	*phase = p;
+}
+
+/* xorshift32, sample n uses generator n & 3 so that the output is the
+ * same as that of the SIMD versions which run the 4 generators in
+ * parallel */
+static inline uint32_t xorshift32(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+void
+render_noise_c(struct render_ops *ops, float *dst, uint32_t state[4],
+		float amp, uint32_t n_samples)
+{
+	uint32_t n;
+	float scale = amp / 2147483648.0f;
+
+	for (n = 0; n < n_samples; n++)
+		dst[n] = (int32_t) xorshift32(&state[n & 3]) * scale;
+}
+
+void
+render_convert_s16_c(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	int16_t *d = dst;
+
+	for (n = 0; n < n_frames; n++) {
+		int16_t v = SPA_CLAMP(lrintf(src[n] * 32767.0f), INT16_MIN, INT16_MAX);
+		for (c = 0; c < n_channels; c++)
+			*d++ = v;
+	}
+}
+
+void
+render_convert_s32_c(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	int32_t *d = dst;
+
+	for (n = 0; n < n_frames; n++) {
+		double s = SPA_CLAMP(src[n] * 2147483647.0, (double)INT32_MIN, (double)INT32_MAX);
+		int32_t v = lrint(s);
+		for (c = 0; c < n_channels; c++)
+			*d++ = v;
+	}
+}
+
+void
+render_convert_f32_c(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	float *d = dst;
+
+	if (n_channels == 1) {
+		memcpy(d, src, n_frames * sizeof(float));
+		return;
+	}
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++)
+			*d++ = src[n];
+	}
+}
+
+void
+render_convert_f64_c(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	double *d = dst;
+
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++)
+			*d++ = src[n];
+	}
+}
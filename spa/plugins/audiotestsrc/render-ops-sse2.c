@@ -0,0 +1,246 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "render-ops.h"
+
+#include <emmintrin.h>
+
+#define PI_F		((float)M_PI)
+#define PI_M2_F		((float)(M_PI * 2.0))
+
+/* same approximation as sine_poly() in render-ops-c.c */
+static inline __m128 sine_poly_sse2(__m128 x)
+{
+	const __m128 sign_mask = _mm_set1_ps(-0.0f);
+	const __m128 pi = _mm_set1_ps(PI_F);
+	const __m128 pi_2 = _mm_set1_ps((float)(M_PI / 2.0));
+	__m128 sign, fold, x2, r;
+
+	/* fold |x| > PI/2 to copysign(PI, x) - x */
+	sign = _mm_and_ps(x, sign_mask);
+	fold = _mm_cmpgt_ps(_mm_andnot_ps(sign_mask, x), pi_2);
+	x = _mm_or_ps(_mm_andnot_ps(fold, x),
+			_mm_and_ps(fold, _mm_sub_ps(_mm_or_ps(pi, sign), x)));
+
+	x2 = _mm_mul_ps(x, x);
+	r = _mm_set1_ps(-2.5052108e-8f);
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(2.7557319e-6f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-1.9841270e-4f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(8.3333333e-3f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(-1.6666667e-1f));
+	r = _mm_add_ps(_mm_mul_ps(r, x2), _mm_set1_ps(1.0f));
+	return _mm_mul_ps(r, x);
+}
+
+void
+render_sine_sse2(struct render_ops *ops, float *dst, float *phase,
+		float step, float amp, uint32_t n_samples)
+{
+	uint32_t n, k, unrolled;
+	float p = *phase, start[8];
+	__m128 a = _mm_set1_ps(amp);
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		/* the phase of each block is accumulated exactly like the C
+		 * version does, only the polynomial is vectorized. Advancing
+		 * the lanes by 8 steps at a time drifts away from the serial
+		 * phase on long runs. */
+		for (k = 0; k < 8; k++) {
+			start[k] = p;
+			p += step;
+			if (p >= PI_F)
+				p -= PI_M2_F;
+		}
+		_mm_storeu_ps(&dst[n], _mm_mul_ps(sine_poly_sse2(_mm_loadu_ps(&start[0])), a));
+		_mm_storeu_ps(&dst[n+4], _mm_mul_ps(sine_poly_sse2(_mm_loadu_ps(&start[4])), a));
+	}
+	if (n < n_samples)
+		render_sine_c(ops, &dst[n], &p, step, amp, n_samples - n);
+
+	*phase = p;
+}
+
+void
+render_noise_sse2(struct render_ops *ops, float *dst, uint32_t state[4],
+		float amp, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	__m128i x = _mm_loadu_si128((__m128i*)state);
+	__m128 scale = _mm_set1_ps(amp / 2147483648.0f);
+
+	unrolled = n_samples & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+		x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+		_mm_storeu_ps(&dst[n], _mm_mul_ps(_mm_cvtepi32_ps(x), scale));
+	}
+	_mm_storeu_si128((__m128i*)state, x);
+
+	if (n < n_samples)
+		render_noise_c(ops, &dst[n], state, amp, n_samples - n);
+}
+
+void
+render_convert_s16_sse2(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, unrolled;
+	int16_t *d = dst;
+	__m128 scale = _mm_set1_ps(32767.0f);
+	__m128i t[2], out;
+
+	if (n_channels > 2) {
+		render_convert_s16_c(ops, dst, src, n_channels, n_frames);
+		return;
+	}
+
+	unrolled = n_frames & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		t[0] = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[n]), scale));
+		t[1] = _mm_cvtps_epi32(_mm_mul_ps(_mm_loadu_ps(&src[n+4]), scale));
+		out = _mm_packs_epi32(t[0], t[1]);
+		if (n_channels == 1) {
+			_mm_storeu_si128((__m128i*)d, out);
+			d += 8;
+		} else {
+			_mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi16(out, out));
+			_mm_storeu_si128((__m128i*)(d + 8), _mm_unpackhi_epi16(out, out));
+			d += 16;
+		}
+	}
+	if (n < n_frames)
+		render_convert_s16_c(ops, d, &src[n], n_channels, n_frames - n);
+}
+
+void
+render_convert_s32_sse2(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, unrolled;
+	int32_t *d = dst;
+	__m128d scale = _mm_set1_pd(2147483647.0);
+	__m128d max = _mm_set1_pd(2147483647.0), min = _mm_set1_pd(-2147483648.0);
+	__m128d lo, hi;
+	__m128 in;
+	__m128i out;
+
+	if (n_channels > 2) {
+		render_convert_s32_c(ops, dst, src, n_channels, n_frames);
+		return;
+	}
+
+	unrolled = n_frames & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		/* scale in double precision, float can't hold INT32_MAX */
+		in = _mm_loadu_ps(&src[n]);
+		lo = _mm_cvtps_pd(in);
+		hi = _mm_cvtps_pd(_mm_movehl_ps(in, in));
+		lo = _mm_max_pd(_mm_min_pd(_mm_mul_pd(lo, scale), max), min);
+		hi = _mm_max_pd(_mm_min_pd(_mm_mul_pd(hi, scale), max), min);
+		out = _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi));
+		if (n_channels == 1) {
+			_mm_storeu_si128((__m128i*)d, out);
+			d += 4;
+		} else {
+			_mm_storeu_si128((__m128i*)d, _mm_unpacklo_epi32(out, out));
+			_mm_storeu_si128((__m128i*)(d + 4), _mm_unpackhi_epi32(out, out));
+			d += 8;
+		}
+	}
+	if (n < n_frames)
+		render_convert_s32_c(ops, d, &src[n], n_channels, n_frames - n);
+}
+
+void
+render_convert_f32_sse2(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, unrolled;
+	float *d = dst;
+	__m128 in;
+
+	if (n_channels != 2) {
+		render_convert_f32_c(ops, dst, src, n_channels, n_frames);
+		return;
+	}
+
+	unrolled = n_frames & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		in = _mm_loadu_ps(&src[n]);
+		_mm_storeu_ps(d, _mm_unpacklo_ps(in, in));
+		_mm_storeu_ps(d + 4, _mm_unpackhi_ps(in, in));
+		d += 8;
+	}
+	if (n < n_frames)
+		render_convert_f32_c(ops, d, &src[n], n_channels, n_frames - n);
+}
+
+void
+render_convert_f64_sse2(struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, unrolled;
+	double *d = dst;
+	__m128 in;
+	__m128d lo, hi;
+
+	if (n_channels > 2) {
+		render_convert_f64_c(ops, dst, src, n_channels, n_frames);
+		return;
+	}
+
+	unrolled = n_frames & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		in = _mm_loadu_ps(&src[n]);
+		lo = _mm_cvtps_pd(in);
+		hi = _mm_cvtps_pd(_mm_movehl_ps(in, in));
+		if (n_channels == 1) {
+			_mm_storeu_pd(d, lo);
+			_mm_storeu_pd(d + 2, hi);
+			d += 4;
+		} else {
+			_mm_storeu_pd(d, _mm_unpacklo_pd(lo, lo));
+			_mm_storeu_pd(d + 2, _mm_unpackhi_pd(lo, lo));
+			_mm_storeu_pd(d + 4, _mm_unpacklo_pd(hi, hi));
+			_mm_storeu_pd(d + 6, _mm_unpackhi_pd(hi, hi));
+			d += 8;
+		}
+	}
+	if (n < n_frames)
+		render_convert_f64_c(ops, d, &src[n], n_channels, n_frames - n);
+}
@@ -0,0 +1,99 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+#include <spa/param/audio/format-utils.h>
+
+#include "render-ops.h"
+
+typedef void (*sine_func_t) (struct render_ops *ops, float *dst, float *phase,
+		float step, float amp, uint32_t n_samples);
+typedef void (*noise_func_t) (struct render_ops *ops, float *dst, uint32_t state[4],
+		float amp, uint32_t n_samples);
+typedef void (*convert_func_t) (struct render_ops *ops, void *dst, const float *src,
+		uint32_t n_channels, uint32_t n_frames);
+
+struct render_info {
+	uint32_t fmt;
+	uint32_t cpu_flags;
+	sine_func_t sine;
+	noise_func_t noise;
+	convert_func_t convert;
+};
+
+static struct render_info render_table[] =
+{
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S16, SPA_CPU_FLAG_SSE2, render_sine_sse2, render_noise_sse2, render_convert_s16_sse2 },
+	{ SPA_AUDIO_FORMAT_S32, SPA_CPU_FLAG_SSE2, render_sine_sse2, render_noise_sse2, render_convert_s32_sse2 },
+	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_SSE2, render_sine_sse2, render_noise_sse2, render_convert_f32_sse2 },
+	{ SPA_AUDIO_FORMAT_F64, SPA_CPU_FLAG_SSE2, render_sine_sse2, render_noise_sse2, render_convert_f64_sse2 },
+#endif
+	{ SPA_AUDIO_FORMAT_S16, 0, render_sine_c, render_noise_c, render_convert_s16_c },
+	{ SPA_AUDIO_FORMAT_S32, 0, render_sine_c, render_noise_c, render_convert_s32_c },
+	{ SPA_AUDIO_FORMAT_F32, 0, render_sine_c, render_noise_c, render_convert_f32_c },
+	{ SPA_AUDIO_FORMAT_F64, 0, render_sine_c, render_noise_c, render_convert_f64_c },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct render_info *find_render_info(uint32_t fmt, uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(render_table); i++) {
+		if (render_table[i].fmt == fmt &&
+		    MATCH_CPU_FLAGS(render_table[i].cpu_flags, cpu_flags))
+			return &render_table[i];
+	}
+	return NULL;
+}
+
+static void impl_render_ops_free(struct render_ops *ops)
+{
+	spa_zero(*ops);
+}
+
+int render_ops_init(struct render_ops *ops)
+{
+	const struct render_info *info;
+
+	info = find_render_info(ops->fmt, ops->cpu_flags);
+	if (info == NULL)
+		return -ENOTSUP;
+
+	ops->priv = info;
+	ops->cpu_flags = info->cpu_flags;
+	ops->sine = info->sine;
+	ops->noise = info->noise;
+	ops->convert = info->convert;
+	ops->free = impl_render_ops_free;
+
+	return 0;
+}
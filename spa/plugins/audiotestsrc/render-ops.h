@@ -0,0 +1,83 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/utils/defs.h>
+
+/* Signal generator kernels. The wave kernels generate one channel of
+ * float samples, the convert kernel writes those samples to all channels
+ * of the output format. */
+struct render_ops {
+	uint32_t fmt;
+	uint32_t cpu_flags;
+
+	/* sine with amplitude amp, phase in radians is updated with step
+	 * for each sample and wrapped to [-PI, PI) */
+	void (*sine) (struct render_ops *ops, float *dst, float *phase,
+			float step, float amp, uint32_t n_samples);
+	/* uniform white noise with amplitude amp, state holds 4 nonzero
+	 * seeds for the generator */
+	void (*noise) (struct render_ops *ops, float *dst, uint32_t state[4],
+			float amp, uint32_t n_samples);
+	/* write each sample of src to n_channels interleaved samples of dst */
+	void (*convert) (struct render_ops *ops, void *dst, const float *src,
+			uint32_t n_channels, uint32_t n_frames);
+	void (*free) (struct render_ops *ops);
+
+	const void *priv;
+};
+
+int render_ops_init(struct render_ops *ops);
+
+#define render_ops_sine(ops,...)	(ops)->sine(ops, __VA_ARGS__)
+#define render_ops_noise(ops,...)	(ops)->noise(ops, __VA_ARGS__)
+#define render_ops_convert(ops,...)	(ops)->convert(ops, __VA_ARGS__)
+#define render_ops_free(ops)		(ops)->free(ops)
+
+#define DEFINE_SINE_FUNCTION(arch) \
+void render_sine_##arch(struct render_ops *ops, float *dst, float *phase,	\
+		float step, float amp, uint32_t n_samples)
+
+#define DEFINE_NOISE_FUNCTION(arch) \
+void render_noise_##arch(struct render_ops *ops, float *dst,		\
+		uint32_t state[4], float amp, uint32_t n_samples)
+
+#define DEFINE_CONVERT_FUNCTION(name,arch) \
+void render_convert_##name##_##arch(struct render_ops *ops, void *dst,	\
+		const float *src, uint32_t n_channels, uint32_t n_frames)
+
+DEFINE_SINE_FUNCTION(c);
+DEFINE_NOISE_FUNCTION(c);
+DEFINE_CONVERT_FUNCTION(s16, c);
+DEFINE_CONVERT_FUNCTION(s32, c);
+DEFINE_CONVERT_FUNCTION(f32, c);
+DEFINE_CONVERT_FUNCTION(f64, c);
+
+#if defined(HAVE_SSE2)
+DEFINE_SINE_FUNCTION(sse2);
+DEFINE_NOISE_FUNCTION(sse2);
+DEFINE_CONVERT_FUNCTION(s16, sse2);
+DEFINE_CONVERT_FUNCTION(s32, sse2);
+DEFINE_CONVERT_FUNCTION(f32, sse2);
+DEFINE_CONVERT_FUNCTION(f64, sse2);
+#endif
@@ -26,39 +26,172 @@
 
 #define M_PI_M2 ( M_PI + M_PI )
 
-#define DEFINE_SINE(type,scale)								\
-static void										\
-audio_test_src_create_sine_##type (struct impl *this, type *samples, size_t n_samples)	\
-{											\
-	size_t i;									\
-	uint32_t c, channels;								\
-	float step, amp;								\
-	float freq = this->props.freq;							\
-	float volume = this->props.volume;						\
-											\
-	channels = this->port.current_format.info.raw.channels;				\
-	step = M_PI_M2 * freq / this->port.current_format.info.raw.rate;		\
-	amp = volume * scale;								\
-											\
-	for (i = 0; i < n_samples; i++) {						\
-		type val;								\
-		this->port.accumulator += step;						\
-		if (this->port.accumulator >= M_PI_M2)					\
-			this->port.accumulator -= M_PI_M2;				\
-		val = (type) (sin (this->port.accumulator) * amp);			\
-		for (c = 0; c < channels; ++c)						\
-			*samples++ = val;						\
-	}										\
+/* frames generated per pass, the float samples live on the stack */
+#define RENDER_BLOCK	1024u
+
+/* wrap a phase into [-PI, PI), the range the wave kernels expect */
+static inline double wrap_phase(double phase)
+{
+	phase = fmod(phase + M_PI, M_PI_M2);
+	if (phase < 0.0)
+		phase += M_PI_M2;
+	return phase - M_PI;
+}
+
+static float wave_step(struct impl *this, struct port *port)
+{
+	return fmodf(M_PI_M2 * this->props.freq / port->current_format.info.raw.rate, M_PI_M2);
+}
+
+static void render_wave(struct impl *this, struct port *port, float *dst,
+		uint32_t n_samples, float step)
+{
+	uint32_t n;
+	float amp = this->props.volume;
+
+	switch (this->props.wave) {
+	case WAVE_SINE:
+	default:
+		render_ops_sine(&port->ops, dst, &port->accumulator, step, amp, n_samples);
+		break;
+	case WAVE_SQUARE:
+		for (n = 0; n < n_samples; n++) {
+			dst[n] = port->accumulator < 0.0f ? -amp : amp;
+			port->accumulator += step;
+			if (port->accumulator >= M_PI)
+				port->accumulator -= M_PI_M2;
+		}
+		break;
+	case WAVE_WHITE_NOISE:
+		render_ops_noise(&port->ops, dst, port->noise, amp, n_samples);
+		break;
+	case WAVE_PINK_NOISE:
+	{
+		/* Paul Kellet's economy filter on white noise. This is a
+		 * recursive filter, it runs one sample at a time. */
+		float *b = port->pink;
+
+		render_ops_noise(&port->ops, dst, port->noise, amp, n_samples);
+		for (n = 0; n < n_samples; n++) {
+			float w = dst[n];
+			b[0] = 0.99765f * b[0] + w * 0.0990460f;
+			b[1] = 0.96300f * b[1] + w * 0.2965164f;
+			b[2] = 0.57000f * b[2] + w * 1.0526913f;
+			dst[n] = (b[0] + b[1] + b[2] + w * 0.1848f) * 0.1f;
+		}
+		break;
+	}
+	}
+}
+
+static void render_frames(struct impl *this, struct port *port, void *dst,
+		uint32_t n_frames, float step)
+{
+	uint32_t n, channels = port->current_format.info.raw.channels;
+	float samples[RENDER_BLOCK];
+
+	while (n_frames > 0) {
+		n = SPA_MIN(n_frames, RENDER_BLOCK);
+		render_wave(this, port, samples, n, step);
+		render_ops_convert(&port->ops, dst, samples, channels, n);
+		dst = SPA_MEMBER(dst, n * port->bpf, void);
+		n_frames -= n;
+	}
+}
+
+/* find the length of the constant pattern, in at most MAX_SAMPLES frames,
+ * that holds a whole number of periods of the wave so that it repeats
+ * without a phase jump. Of the lengths that fit, the one that changes
+ * the frequency the least is used. Returns 0 when no period fits. */
+static uint32_t pattern_frames(float freq, uint32_t rate, uint32_t *periods)
+{
+	double f, period, err, best = 1.0;
+	uint32_t k, n, frames = 0;
+
+	/* the phase step wraps, only the frequency modulo the rate matters */
+	f = fmod(freq, rate);
+	if (f <= 0.0) {
+		*periods = 0;
+		return MAX_SAMPLES;
+	}
+	period = rate / f;
+
+	for (k = 1; k * period + 0.5 <= MAX_SAMPLES; k++) {
+		n = lrint(k * period);
+		err = fabs(k * period - n) / n;
+		if (err < best) {
+			best = err;
+			frames = n;
+			*periods = k;
+			/* an exact fit can not be improved */
+			if (err < 1e-12)
+				break;
+		}
+	}
+	return frames;
+}
+
+/* render the constant pattern, starting at the phase the previous pattern
+ * was at so that a change of frequency does not click */
+static void render_pattern(struct impl *this, struct port *port)
+{
+	uint32_t n, pos, periods = 0, frames = MAX_SAMPLES;
+	double phase;
+
+	if (port->pattern_frames > 0)
+		port->accumulator = wrap_phase(port->pattern_phase + M_PI_M2 *
+				fmod((double)port->pattern_periods * port->pattern_offset,
+					port->pattern_frames) / port->pattern_frames);
+
+	if (this->props.wave == WAVE_SINE || this->props.wave == WAVE_SQUARE)
+		frames = pattern_frames(this->props.freq,
+				port->current_format.info.raw.rate, &periods);
+
+	port->pattern_frames = frames;
+	port->pattern_periods = periods;
+	port->pattern_phase = port->accumulator;
+	port->pattern_offset = 0;
+	port->pattern_valid = true;
+
+	/* the phase is set exactly at the start of each block, so that float
+	 * rounding of the step does not add up over the whole pattern */
+	for (pos = 0; pos < frames; pos += n) {
+		n = SPA_MIN(frames - pos, RENDER_BLOCK);
+		phase = M_PI_M2 * fmod((double)periods * pos, frames) / frames;
+		port->accumulator = wrap_phase(port->pattern_phase + phase);
+		render_frames(this, port, SPA_MEMBER(port->pattern, pos * port->bpf, void),
+				n, M_PI_M2 * periods / frames);
+	}
 }
 
-DEFINE_SINE(int16_t, 32767.0);
-DEFINE_SINE(int32_t, 2147483647.0);
-DEFINE_SINE(float, 1.0);
-DEFINE_SINE(double, 1.0);
-
-static const render_func_t sine_funcs[] = {
-	(render_func_t) audio_test_src_create_sine_int16_t,
-	(render_func_t) audio_test_src_create_sine_int32_t,
-	(render_func_t) audio_test_src_create_sine_float,
-	(render_func_t) audio_test_src_create_sine_double
-};
+static void render(struct impl *this, struct port *port, void *dst, uint32_t n_frames)
+{
+	uint32_t n;
+
+	if (this->props.mode == MODE_GENERATE) {
+		/* a pattern rendered later starts at the generated phase */
+		port->pattern_frames = 0;
+		port->pattern_valid = false;
+	} else if (!port->pattern_valid) {
+		render_pattern(this, port);
+	}
+
+	/* a wave with a period longer than the pattern is generated */
+	if (port->pattern_frames == 0) {
+		render_frames(this, port, dst, n_frames, wave_step(this, port));
+		return;
+	}
+
+	/* repeat a pattern that is only rendered again when the format or
+	 * the properties change */
+	while (n_frames > 0) {
+		n = SPA_MIN(n_frames, port->pattern_frames - port->pattern_offset);
+		memcpy(dst, SPA_MEMBER(port->pattern, port->pattern_offset * port->bpf, void),
+				n * port->bpf);
+		port->pattern_offset += n;
+		if (port->pattern_offset == port->pattern_frames)
+			port->pattern_offset = 0;
+		dst = SPA_MEMBER(dst, n * port->bpf, void);
+		n_frames -= n;
+	}
+}
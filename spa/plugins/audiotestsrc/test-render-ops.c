@@ -0,0 +1,196 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "render-ops.c"
+#include "../test-cpu.h"
+
+#define N_SAMPLES	4099
+#define MAX_CHANNELS	3
+/* long enough for the phase of the sine to wrap many times */
+#define N_BLOCKS	64
+
+static float samp_in[N_SAMPLES + 1];
+static float samp_out[N_SAMPLES + 1];
+static float samp_ref[N_SAMPLES + 1];
+static double conv_out[MAX_CHANNELS * N_SAMPLES];
+static double conv_ref[MAX_CHANNELS * N_SAMPLES];
+
+static const uint32_t sample_counts[] = { 1, 3, 4, 7, 8, 15, 16, 33, 255, 1021, N_SAMPLES };
+static const float steps[] = { 0.0f, 0.001f, 0.0628f, 1.0f, 3.0f, 6.28f };
+
+static uint32_t cpu_flags;
+
+static const char *fmt_name(uint32_t fmt)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+		return "s16";
+	case SPA_AUDIO_FORMAT_S32:
+		return "s32";
+	case SPA_AUDIO_FORMAT_F32:
+		return "f32";
+	default:
+		return "f64";
+	}
+}
+
+static uint32_t sample_size(uint32_t fmt)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+		return 2;
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_F32:
+		return 4;
+	default:
+		return 8;
+	}
+}
+
+/* the kernels are expected to produce exactly the output of the C
+ * versions */
+static void compare(const char *name, const struct render_info *info,
+		const void *a, const void *b, size_t size, uint32_t n_samples)
+{
+	if (memcmp(a, b, size) == 0)
+		return;
+
+	fprintf(stderr, "%s %s cpu %08x: %u samples differ\n",
+			name, fmt_name(info->fmt), info->cpu_flags, n_samples);
+	spa_assert_not_reached();
+}
+
+/* render the same sine in blocks of varying sizes, the phase is carried
+ * from one block to the next */
+static void test_sine(const struct render_info *info, const struct render_info *ref)
+{
+	uint32_t i, j, n_samples;
+	float phase, ref_phase;
+
+	for (i = 0; i < SPA_N_ELEMENTS(steps); i++) {
+		phase = ref_phase = (float)-M_PI;
+
+		for (j = 0; j < N_BLOCKS; j++) {
+			n_samples = sample_counts[j % SPA_N_ELEMENTS(sample_counts)];
+
+			ref->sine(NULL, samp_ref, &ref_phase, steps[i], 0.8f, n_samples);
+			info->sine(NULL, samp_out, &phase, steps[i], 0.8f, n_samples);
+			compare("sine", info, samp_out, samp_ref,
+					n_samples * sizeof(float), n_samples);
+			spa_assert(phase == ref_phase);
+		}
+	}
+}
+
+static void test_noise(const struct render_info *info, const struct render_info *ref)
+{
+	uint32_t j, n_samples;
+	uint32_t state[4] = { 0x12345678, 0x9abcdef0, 0x0fedcba9, 0x87654321 };
+	uint32_t ref_state[4];
+
+	memcpy(ref_state, state, sizeof(state));
+
+	for (j = 0; j < N_BLOCKS; j++) {
+		n_samples = sample_counts[j % SPA_N_ELEMENTS(sample_counts)];
+
+		ref->noise(NULL, samp_ref, ref_state, 0.5f, n_samples);
+		info->noise(NULL, samp_out, state, 0.5f, n_samples);
+		compare("noise", info, samp_out, samp_ref,
+				n_samples * sizeof(float), n_samples);
+		spa_assert(memcmp(state, ref_state, sizeof(state)) == 0);
+	}
+}
+
+/* full scale samples and some out of range, the integer formats saturate */
+static void fill_samples(void)
+{
+	uint32_t i;
+
+	srand(0x5eed);
+	for (i = 0; i < N_SAMPLES + 1; i++)
+		samp_in[i] = (float)rand() / RAND_MAX * 2.4f - 1.2f;
+	samp_in[0] = 1.0f;
+	samp_in[1] = -1.0f;
+}
+
+static void test_convert(const struct render_info *info, const struct render_info *ref)
+{
+	uint32_t i, n_channels, align, n_samples;
+	size_t size;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_counts); i++) {
+		n_samples = sample_counts[i];
+
+		for (n_channels = 1; n_channels <= MAX_CHANNELS; n_channels++) {
+			size = n_samples * n_channels * sample_size(info->fmt);
+
+			for (align = 0; align < 2; align++) {
+				memset(conv_out, 0, size);
+				memset(conv_ref, 0, size);
+				ref->convert(NULL, conv_ref, &samp_in[align], n_channels, n_samples);
+				info->convert(NULL, conv_out, &samp_in[align], n_channels, n_samples);
+				compare("convert", info, conv_out, conv_ref, size, n_samples);
+			}
+		}
+	}
+}
+
+static void test_render_table(void)
+{
+	size_t i;
+
+	fill_samples();
+
+	for (i = 0; i < SPA_N_ELEMENTS(render_table); i++) {
+		const struct render_info *info = &render_table[i];
+		const struct render_info *ref;
+
+		if (!MATCH_CPU_FLAGS(info->cpu_flags, cpu_flags))
+			continue;
+
+		ref = find_render_info(info->fmt, 0);
+		spa_assert(ref != NULL);
+		spa_assert(ref->cpu_flags == 0);
+
+		fprintf(stderr, "test %s cpu %08x\n", fmt_name(info->fmt), info->cpu_flags);
+
+		test_sine(info, ref);
+		test_noise(info, ref);
+		test_convert(info, ref);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+
+	test_render_table();
+
+	return 0;
+}
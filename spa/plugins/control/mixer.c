@@ -25,6 +25,7 @@
 #include <errno.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
@@ -37,11 +38,12 @@
 #include <spa/param/audio/format-utils.h>
 #include <spa/param/param.h>
 #include <spa/pod/filter.h>
+#include <spa/control/control.h>
 
 #define NAME "control-mixer"
 
 #define MAX_BUFFERS     64
-#define MAX_PORTS       128
+#define MAX_PORTS       512
 
 struct buffer {
 	uint32_t id;
@@ -71,6 +73,13 @@ struct port {
 	struct spa_list queue;
 };
 
+/* an input sequence and its next control */
+struct merge {
+	struct spa_pod_sequence *seq;
+	struct spa_pod_control *ctrl;
+	uint32_t port;
+};
+
 struct impl {
 	struct spa_handle handle;
 	struct spa_node node;
@@ -85,20 +94,24 @@ struct impl {
 
 	uint32_t port_count;
 	uint32_t last_port;
-	struct port in_ports[MAX_PORTS];
+	struct port *in_ports[MAX_PORTS];
 	struct port out_ports[1];
 
+	/* min-heap of the inputs on the offset of their next control */
+	struct merge merge[MAX_PORTS];
+
 	int n_formats;
 
 	unsigned int have_format:1;
 	unsigned int started:1;
 };
 
-#define CHECK_FREE_IN_PORT(this,d,p) ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && !this->in_ports[(p)].valid)
-#define CHECK_IN_PORT(this,d,p)      ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && this->in_ports[(p)].valid)
+#define PORT_VALID(p)                ((p) != NULL && (p)->valid)
+#define CHECK_FREE_IN_PORT(this,d,p) ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && !PORT_VALID(this->in_ports[(p)]))
+#define CHECK_IN_PORT(this,d,p)      ((d) == SPA_DIRECTION_INPUT && (p) < MAX_PORTS && PORT_VALID(this->in_ports[(p)]))
 #define CHECK_OUT_PORT(this,d,p)     ((d) == SPA_DIRECTION_OUTPUT && (p) == 0)
 #define CHECK_PORT(this,d,p)         (CHECK_OUT_PORT(this,d,p) || CHECK_IN_PORT (this,d,p))
-#define GET_IN_PORT(this,p)          (&this->in_ports[p])
+#define GET_IN_PORT(this,p)          (this->in_ports[p])
 #define GET_OUT_PORT(this,p)         (&this->out_ports[p])
 #define GET_PORT(this,d,p)           (d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,p) : GET_OUT_PORT(this,p))
 
@@ -177,7 +190,7 @@ static int impl_node_add_listener(void *object,
 	emit_node_info(this, true);
 	emit_port_info(this, GET_OUT_PORT(this, 0), true);
 	for (i = 0; i < this->last_port; i++) {
-		if (this->in_ports[i].valid)
+		if (PORT_VALID(this->in_ports[i]))
 			emit_port_info(this, GET_IN_PORT(this, i), true);
 	}
 
@@ -204,6 +217,12 @@ static int impl_node_add_port(void *object, enum spa_direction direction, uint32
 	spa_return_val_if_fail(CHECK_FREE_IN_PORT(this, direction, port_id), -EINVAL);
 
 	port = GET_IN_PORT (this, port_id);
+	if (port == NULL) {
+		port = calloc(1, sizeof(struct port));
+		if (port == NULL)
+			return -errno;
+		this->in_ports[port_id] = port;
+	}
 	port->direction = direction;
 	port->id = port_id;
 
@@ -257,7 +276,7 @@ impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_
 		int i;
 
 		for (i = this->last_port - 1; i >= 0; i--)
-			if (GET_IN_PORT (this, i)->valid)
+			if (PORT_VALID(GET_IN_PORT(this, i)))
 				break;
 
 		this->last_port = i + 1;
@@ -561,14 +580,70 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return queue_buffer(this, port, &port->buffers[buffer_id]);
 }
 
+static inline bool merge_before(const struct merge *a, const struct merge *b)
+{
+	if (a->ctrl->offset != b->ctrl->offset)
+		return a->ctrl->offset < b->ctrl->offset;
+	/* keep the port order for controls at the same offset */
+	return a->port < b->port;
+}
+
+static void merge_sift_down(struct merge *heap, uint32_t n_heap, uint32_t i)
+{
+	struct merge tmp;
+
+	while (true) {
+		uint32_t l = 2 * i + 1, r = l + 1, min = i;
+
+		if (l < n_heap && merge_before(&heap[l], &heap[min]))
+			min = l;
+		if (r < n_heap && merge_before(&heap[r], &heap[min]))
+			min = r;
+		if (min == i)
+			break;
+
+		tmp = heap[i];
+		heap[i] = heap[min];
+		heap[min] = tmp;
+		i = min;
+	}
+}
+
+/* A Properties control is redundant when the next control is at the same
+ * offset and sets at least the same properties. */
+static bool control_is_superseded(struct spa_pod_control *c, struct spa_pod_control *next)
+{
+	struct spa_pod_object *obj, *next_obj;
+	struct spa_pod_prop *prop;
+
+	if (c->offset != next->offset ||
+	    c->type != SPA_CONTROL_Properties ||
+	    next->type != SPA_CONTROL_Properties ||
+	    !spa_pod_is_object(&c->value) ||
+	    !spa_pod_is_object(&next->value))
+		return false;
+
+	obj = (struct spa_pod_object *) &c->value;
+	next_obj = (struct spa_pod_object *) &next->value;
+
+	if (obj->body.type != next_obj->body.type)
+		return false;
+
+	SPA_POD_OBJECT_FOREACH(obj, prop) {
+		if (spa_pod_object_find_prop(next_obj, NULL, prop->key) == NULL)
+			return false;
+	}
+	return true;
+}
+
 static int impl_node_process(void *object)
 {
 	struct impl *this = object;
 	struct port *outport;
 	struct spa_io_buffers *outio;
 	uint32_t n_seq, i;
-        struct spa_pod_sequence **seq;
-        struct spa_pod_control **ctrl;
+	struct merge *heap = this->merge;
+	struct spa_pod_control *ctrl, *pending;
 	struct spa_pod_builder builder;
 	struct spa_pod_frame f;
         struct buffer *outb;
@@ -598,26 +673,25 @@ static int impl_node_process(void *object)
                 return -EPIPE;
         }
 
-	ctrl = alloca(MAX_PORTS * sizeof(struct spa_pod_control *));
-	seq = alloca(MAX_PORTS * sizeof(struct spa_pod_sequence *));
         n_seq = 0;
 
 	/* collect all sequence pod on input ports */
 	for (i = 0; i < this->last_port; i++) {
 		struct port *inport = GET_IN_PORT(this, i);
 		struct spa_io_buffers *inio = NULL;
+		struct spa_pod_sequence *seq;
 		void *pod;
 
-		if (!inport->valid ||
+		if (!PORT_VALID(inport) ||
 		    (inio = inport->io) == NULL ||
 		    inio->buffer_id >= inport->n_buffers ||
 		    inio->status != SPA_STATUS_HAVE_DATA) {
 			spa_log_trace_fp(this->log, NAME " %p: skip input idx:%d valid:%d "
 					"io:%p status:%d buf_id:%d n_buffers:%d", this,
-				i, inport->valid, inio,
+				i, PORT_VALID(inport), inio,
 				inio ? inio->status : -1,
 				inio ? inio->buffer_id : SPA_ID_INVALID,
-				inport->n_buffers);
+				inport ? inport->n_buffers : 0);
 			continue;
 		}
 
@@ -632,9 +706,16 @@ static int impl_node_process(void *object)
 		if (!spa_pod_is_sequence(pod))
 			continue;
 
-		seq[n_seq] = pod;
-		ctrl[n_seq] = spa_pod_control_first(&seq[n_seq]->body);
 		inio->status = SPA_STATUS_NEED_DATA;
+
+		seq = pod;
+		ctrl = spa_pod_control_first(&seq->body);
+		if (!spa_pod_control_is_inside(&seq->body, SPA_POD_BODY_SIZE(seq), ctrl))
+			continue;
+
+		heap[n_seq].seq = seq;
+		heap[n_seq].ctrl = ctrl;
+		heap[n_seq].port = i;
 		n_seq++;
 	}
 
@@ -644,28 +725,35 @@ static int impl_node_process(void *object)
 	spa_pod_builder_init(&builder, d->data, d->maxsize);
 	spa_pod_builder_push_sequence(&builder, &f, 0);
 
-	/* merge sort all sequences into output buffer */
-	while (true) {
-		struct spa_pod_control *next = NULL;
-		uint32_t next_index = 0;
-
-		for (i = 0; i < n_seq; i++) {
-			if (!spa_pod_control_is_inside(&seq[i]->body,
-					SPA_POD_BODY_SIZE(seq[i]), ctrl[i]))
-				continue;
-
-			if (next == NULL || ctrl[i]->offset < next->offset) {
-				next = ctrl[i];
-				next_index = i;
-			}
+	/* k-way merge of all sequences into the output buffer, the heap
+	 * always has the input with the lowest next offset on top */
+	for (i = n_seq / 2; i > 0; i--)
+		merge_sift_down(heap, n_seq, i - 1);
+
+	pending = NULL;
+	while (n_seq > 0) {
+		struct merge *m = &heap[0];
+
+		ctrl = m->ctrl;
+
+		/* hold back each control until we know the next one does
+		 * not make it redundant */
+		if (pending != NULL && !control_is_superseded(pending, ctrl)) {
+			spa_pod_builder_control(&builder, pending->offset, pending->type);
+			spa_pod_builder_primitive(&builder, &pending->value);
 		}
-		if (next == NULL)
-			break;
+		pending = ctrl;
 
-		spa_pod_builder_control(&builder, next->offset, next->type);
-		spa_pod_builder_primitive(&builder, &next->value);
+		m->ctrl = spa_pod_control_next(ctrl);
+		if (!spa_pod_control_is_inside(&m->seq->body,
+				SPA_POD_BODY_SIZE(m->seq), m->ctrl))
+			*m = heap[--n_seq];
 
-		ctrl[next_index] = spa_pod_control_next(ctrl[next_index]);
+		merge_sift_down(heap, n_seq, 0);
+	}
+	if (pending != NULL) {
+		spa_pod_builder_control(&builder, pending->offset, pending->type);
+		spa_pod_builder_primitive(&builder, &pending->value);
 	}
 	spa_pod_builder_pop(&builder, &f);
 
@@ -717,6 +805,16 @@ static int impl_get_interface(struct spa_handle *handle, const char *type, void
 
 static int impl_clear(struct spa_handle *handle)
 {
+	struct impl *this;
+	uint32_t i;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	for (i = 0; i < MAX_PORTS; i++)
+		free(this->in_ports[i]);
+
 	return 0;
 }
 
@@ -0,0 +1,84 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_PLUGINS_TEST_CPU_H
+#define SPA_PLUGINS_TEST_CPU_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <dlfcn.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/cpu.h>
+#include <spa/utils/type.h>
+#include <spa/utils/names.h>
+
+/* get the cpu flags from the cpu interface of the support plugin in
+ * SPA_PLUGIN_DIR, so that the tests select the same kernels as the
+ * plugins do */
+static inline uint32_t get_cpu_flags(void)
+{
+	const char *dir;
+	char path[PATH_MAX];
+	void *hnd;
+	spa_handle_factory_enum_func_t enum_func;
+	const struct spa_handle_factory *factory;
+	struct spa_handle *handle;
+	void *iface;
+	uint32_t index = 0, flags;
+
+	dir = getenv("SPA_PLUGIN_DIR");
+	spa_assert(dir != NULL);
+
+	snprintf(path, sizeof(path), "%s/support/libspa-support.so", dir);
+	hnd = dlopen(path, RTLD_NOW);
+	spa_assert(hnd != NULL);
+
+	enum_func = dlsym(hnd, SPA_HANDLE_FACTORY_ENUM_FUNC_NAME);
+	spa_assert(enum_func != NULL);
+
+	while (true) {
+		spa_assert(enum_func(&factory, &index) == 1);
+		if (strcmp(factory->name, SPA_NAME_SUPPORT_CPU) == 0)
+			break;
+	}
+
+	handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(handle != NULL);
+	spa_assert(spa_handle_factory_init(factory, handle, NULL, NULL, 0) == 0);
+	spa_assert(spa_handle_get_interface(handle, SPA_TYPE_INTERFACE_CPU, &iface) == 0);
+
+	flags = spa_cpu_get_flags((struct spa_cpu*)iface);
+
+	spa_handle_clear(handle);
+	free(handle);
+	dlclose(hnd);
+
+	return flags;
+}
+
+#endif /* SPA_PLUGINS_TEST_CPU_H */
@@ -0,0 +1,223 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/dict.h>
+#include <spa/utils/result.h>
+#include <spa/support/log.h>
+#include <spa/support/system.h>
+
+/* Helpers for benchmarking the graph with the fake nodes. */
+
+#define BENCH_RING_MAGIC	0x52434e42	/* "BNCR" */
+#define BENCH_RING_VERSION	0
+#define BENCH_RING_DEFAULT_SIZE	4096
+
+/* one cycle of a node, times are CLOCK_MONOTONIC in nanoseconds */
+struct bench_entry {
+	uint64_t seq;		/* cycle number */
+	uint64_t start;		/* start of process */
+	uint64_t end;		/* end of process */
+};
+
+/* A ring of the last n_entries cycles, mapped from a file so that it can
+ * be read by another process. Use a file in /dev/shm to keep it in memory.
+ * The writer fills the entry at index & (n_entries - 1) and then
+ * increments index, a reader loads index with acquire semantics and reads
+ * the entries before it. */
+struct bench_ring {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_entries;	/* power of 2 */
+	uint32_t padding;
+	uint64_t index;
+	struct bench_entry entries[];
+};
+
+static inline int bench_ring_open(const char *path, uint32_t n_entries,
+		struct bench_ring **ring, size_t *size)
+{
+	struct bench_ring *r;
+	size_t sz;
+	int fd;
+
+	if (n_entries == 0 || (n_entries & (n_entries - 1)) != 0)
+		return -EINVAL;
+
+	sz = sizeof(struct bench_ring) + n_entries * sizeof(struct bench_entry);
+
+	if ((fd = open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600)) < 0)
+		return -errno;
+	if (ftruncate(fd, sz) < 0)
+		goto error;
+	r = mmap(NULL, sz, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (r == MAP_FAILED)
+		goto error;
+	close(fd);
+
+	r->magic = BENCH_RING_MAGIC;
+	r->version = BENCH_RING_VERSION;
+	r->n_entries = n_entries;
+	r->index = 0;
+
+	*ring = r;
+	*size = sz;
+	return 0;
+
+error:
+	{
+		int res = -errno;
+		close(fd);
+		return res;
+	}
+}
+
+static inline void bench_ring_close(struct bench_ring *ring, size_t size)
+{
+	if (ring)
+		munmap(ring, size);
+}
+
+static inline void bench_ring_push(struct bench_ring *ring, uint64_t seq,
+		uint64_t start, uint64_t end)
+{
+	uint64_t index = ring->index;
+	struct bench_entry *e = &ring->entries[index & (ring->n_entries - 1)];
+
+	e->seq = seq;
+	e->start = start;
+	e->end = end;
+	__atomic_store_n(&ring->index, index + 1, __ATOMIC_RELEASE);
+}
+
+/* Do a fixed amount of work that the compiler can't remove. The cost
+ * depends only on loops, which makes the load reproducible between runs,
+ * unlike busy waiting for a time. */
+static inline uint32_t bench_burn(uint32_t seed, uint32_t loops)
+{
+	uint32_t i, x = seed | 1;
+
+	for (i = 0; i < loops; i++) {
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+	}
+	return x;
+}
+
+/* the benchmark state of a node */
+struct bench {
+	struct spa_system *system;
+	bool zero_work;
+	uint32_t burn_loops;
+	uint32_t burn_result;
+	struct bench_ring *ring;
+	size_t ring_size;
+	uint64_t cycle_count;
+};
+
+static inline const char *bench_lookup(const struct spa_dict *info,
+		const char *name, const char *key)
+{
+	char k[128];
+
+	snprintf(k, sizeof(k), "%s.%s", name, key);
+	return spa_dict_lookup(info, k);
+}
+
+/* Parse the benchmark options of the node called name. In zero-work mode
+ * the node only passes buffer ids around, it does not touch the buffer
+ * memory and ignores the live and async timers. burn-loops adds a fixed
+ * amount of work to each cycle and timestamps names a file where the
+ * start and end time of the last cycles are kept. */
+static inline int bench_init(struct bench *b, const char *name,
+		const struct spa_dict *info, struct spa_system *system,
+		struct spa_log *log)
+{
+	const char *str, *path = NULL;
+	uint32_t n_entries = BENCH_RING_DEFAULT_SIZE;
+	int res;
+
+	b->system = system;
+
+	if (info != NULL) {
+		if ((str = bench_lookup(info, name, "zero-work")) != NULL)
+			b->zero_work = atoi(str);
+		if ((str = bench_lookup(info, name, "burn-loops")) != NULL)
+			b->burn_loops = atoi(str);
+		if ((str = bench_lookup(info, name, "timestamps")) != NULL)
+			path = str;
+		if ((str = bench_lookup(info, name, "timestamps.size")) != NULL)
+			n_entries = atoi(str);
+	}
+	if (path != NULL) {
+		if ((res = bench_ring_open(path, n_entries, &b->ring, &b->ring_size)) < 0) {
+			spa_log_error(log, "%s %p: can't create timestamps %s: %s",
+					name, b, path, spa_strerror(res));
+			return res;
+		}
+	}
+	return 0;
+}
+
+static inline void bench_clear(struct bench *b)
+{
+	bench_ring_close(b->ring, b->ring_size);
+	b->ring = NULL;
+}
+
+static inline uint64_t bench_get_nsec(struct bench *b)
+{
+	struct timespec now;
+	spa_system_clock_gettime(b->system, CLOCK_MONOTONIC, &now);
+	return SPA_TIMESPEC_TO_NSEC(&now);
+}
+
+/* run one cycle of the node with process, adding the burn loops and
+ * keeping the timestamps */
+static inline int bench_process(struct bench *b, int (*process) (void *data), void *data)
+{
+	uint64_t start = 0;
+	int res;
+
+	if (b->ring)
+		start = bench_get_nsec(b);
+
+	if (b->burn_loops > 0)
+		b->burn_result = bench_burn(b->burn_result, b->burn_loops);
+
+	res = process(data);
+
+	if (b->ring)
+		bench_ring_push(b->ring, b->cycle_count++, start, bench_get_nsec(b));
+
+	return res;
+}
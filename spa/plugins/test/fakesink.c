@@ -27,11 +27,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/loop.h>
 #include <spa/utils/list.h>
+#include <spa/utils/result.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
 #include <spa/node/io.h>
@@ -40,6 +42,8 @@
 #include <spa/pod/parser.h>
 #include <spa/pod/filter.h>
 
+#include "bench.h"
+
 #define NAME "fakesink"
 
 struct props {
@@ -98,6 +102,8 @@ struct impl {
 
 	uint64_t buffer_count;
 
+	struct bench bench;
+
 	struct port port;
 };
 
@@ -191,6 +197,9 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 
 static void set_timer(struct impl *this, bool enabled)
 {
+	if (this->bench.zero_work)
+		return;
+
 	if (this->callbacks.funcs || this->props.live) {
 		if (enabled) {
 			if (this->props.live) {
@@ -624,19 +633,8 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return -ENOTSUP;
 }
 
-static int impl_node_process(void *object)
+static int process_buffers(struct impl *this, struct port *port, struct spa_io_buffers *io)
 {
-	struct impl *this = object;
-	struct port *port;
-	struct spa_io_buffers *io;
-
-	spa_return_val_if_fail(this != NULL, -EINVAL);
-
-	port = &this->port;
-
-	io = port->io;
-	spa_return_val_if_fail(io != NULL, -EIO);
-
 	if (io->status == SPA_STATUS_HAVE_DATA && io->buffer_id < port->n_buffers) {
 		struct buffer *b = &port->buffers[io->buffer_id];
 
@@ -661,6 +659,35 @@ static int impl_node_process(void *object)
 		return SPA_STATUS_OK;
 }
 
+/* give the buffer back right away, it is recycled with the id that is
+ * left in io->buffer_id */
+static int process_zero_work(struct impl *this, struct port *port, struct spa_io_buffers *io)
+{
+	io->status = SPA_STATUS_NEED_DATA;
+	return SPA_STATUS_NEED_DATA;
+}
+
+static int do_process(void *data)
+{
+	struct impl *this = data;
+	struct port *port = &this->port;
+
+	if (this->bench.zero_work)
+		return process_zero_work(this, port, port->io);
+	else
+		return process_buffers(this, port, port->io);
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(this->port.io != NULL, -EIO);
+
+	return bench_process(&this->bench, do_process, this);
+}
+
 static const struct spa_node_methods impl_node = {
 	SPA_VERSION_NODE_METHODS,
 	.add_listener = impl_node_add_listener,
@@ -704,6 +731,8 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	bench_clear(&this->bench);
+
 	if (this->data_loop)
 		spa_loop_remove_source(this->data_loop, &this->timer_source);
 	spa_system_close(this->data_system, this->timer_source.fd);
@@ -727,6 +756,7 @@ impl_init(const struct spa_handle_factory *factory,
 {
 	struct impl *this;
 	struct port *port;
+	int res;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -740,6 +770,9 @@ impl_init(const struct spa_handle_factory *factory,
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
 
+	if ((res = bench_init(&this->bench, NAME, info, this->data_system, this->log)) < 0)
+		return res;
+
 	spa_hook_list_init(&this->hooks);
 
 	this->node.iface = SPA_INTERFACE_INIT(
@@ -27,11 +27,13 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
 #include <spa/support/loop.h>
 #include <spa/utils/list.h>
+#include <spa/utils/result.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
 #include <spa/node/io.h>
@@ -40,6 +42,8 @@
 #include <spa/pod/parser.h>
 #include <spa/pod/filter.h>
 
+#include "bench.h"
+
 #define NAME "fakesrc"
 
 struct props {
@@ -98,6 +102,8 @@ struct impl {
 	uint64_t elapsed_time;
 
 	uint64_t buffer_count;
+
+	struct bench bench;
 	bool underrun;
 
 	struct port port;
@@ -209,6 +215,9 @@ static int fill_buffer(struct impl *this, struct buffer *b)
 
 static void set_timer(struct impl *this, bool enabled)
 {
+	if (this->bench.zero_work)
+		return;
+
 	if (this->callbacks.funcs || this->props.live) {
 		if (enabled) {
 			if (this->props.live) {
@@ -668,18 +677,8 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return 0;
 }
 
-static int impl_node_process(void *object)
+static int process_buffers(struct impl *this, struct port *port, struct spa_io_buffers *io)
 {
-	struct impl *this = object;
-	struct port *port;
-	struct spa_io_buffers *io;
-
-	spa_return_val_if_fail(this != NULL, -EINVAL);
-
-	port = &this->port;
-	io = port->io;
-	spa_return_val_if_fail(io != NULL, -EIO);
-
 	if (io->status == SPA_STATUS_HAVE_DATA)
 		return SPA_STATUS_HAVE_DATA;
 
@@ -694,6 +693,56 @@ static int impl_node_process(void *object)
 		return SPA_STATUS_OK;
 }
 
+/* hand out the next free buffer id without touching the buffer */
+static int process_zero_work(struct impl *this, struct port *port, struct spa_io_buffers *io)
+{
+	struct buffer *b;
+
+	if (io->status == SPA_STATUS_HAVE_DATA)
+		return SPA_STATUS_HAVE_DATA;
+
+	if (io->buffer_id < port->n_buffers) {
+		b = &port->buffers[io->buffer_id];
+		if (b->outstanding) {
+			b->outstanding = false;
+			spa_list_append(&port->empty, &b->link);
+		}
+		io->buffer_id = SPA_ID_INVALID;
+	}
+	if (spa_list_is_empty(&port->empty))
+		return -EPIPE;
+
+	b = spa_list_first(&port->empty, struct buffer, link);
+	spa_list_remove(&b->link);
+	b->outstanding = true;
+
+	io->buffer_id = b->id;
+	io->status = SPA_STATUS_HAVE_DATA;
+
+	return SPA_STATUS_HAVE_DATA;
+}
+
+static int do_process(void *data)
+{
+	struct impl *this = data;
+	struct port *port = &this->port;
+
+	if (this->bench.zero_work)
+		return process_zero_work(this, port, port->io);
+	else
+		return process_buffers(this, port, port->io);
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(this->port.io != NULL, -EIO);
+
+	return bench_process(&this->bench, do_process, this);
+}
+
 static const struct spa_node_methods impl_node = {
 	SPA_VERSION_NODE_METHODS,
 	.add_listener = impl_node_add_listener,
@@ -737,6 +786,8 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	bench_clear(&this->bench);
+
 	if (this->data_loop)
 		spa_loop_remove_source(this->data_loop, &this->timer_source);
 	spa_system_close(this->data_system, this->timer_source.fd);
@@ -760,6 +811,7 @@ impl_init(const struct spa_handle_factory *factory,
 {
 	struct impl *this;
 	struct port *port;
+	int res;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -773,6 +825,9 @@ impl_init(const struct spa_handle_factory *factory,
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
 
+	if ((res = bench_init(&this->bench, NAME, info, this->data_system, this->log)) < 0)
+		return res;
+
 	spa_hook_list_init(&this->hooks);
 
 	this->node.iface = SPA_INTERFACE_INIT(
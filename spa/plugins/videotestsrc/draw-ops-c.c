@@ -0,0 +1,91 @@
+/* Spa Video Test Source
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/utils/defs.h>
+
+#include "draw-ops.h"
+
+static inline uint32_t xorshift32(uint32_t *state)
+{
+	uint32_t x = *state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return *state = x;
+}
+
+/* Every 16 bytes are made from one step of the 4 generators, the same
+ * as the SIMD versions do. */
+void
+draw_random_c(struct draw_ops *ops, uint8_t *dst, uint32_t state[4], uint32_t n)
+{
+	uint32_t i, k, v[4];
+
+	for (i = 0; i < n; i += 16) {
+		for (k = 0; k < 4; k++)
+			v[k] = xorshift32(&state[k]);
+		memcpy(&dst[i], v, SPA_MIN(16u, n - i));
+	}
+}
+
+void
+draw_gray_rgb_c(struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		dst[3 * i + 0] = src[i];
+		dst[3 * i + 1] = src[i];
+		dst[3 * i + 2] = src[i];
+	}
+}
+
+void
+draw_gray_bgrx_c(struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i++) {
+		dst[4 * i + 0] = src[i];
+		dst[4 * i + 1] = src[i];
+		dst[4 * i + 2] = src[i];
+		dst[4 * i + 3] = 0xff;
+	}
+}
+
+void
+draw_gray_uyvy_c(struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+	uint32_t i;
+
+	for (i = 0; i < n; i += 2) {
+		dst[2 * i + 0] = 128;
+		dst[2 * i + 1] = src[i];
+		dst[2 * i + 2] = 128;
+		dst[2 * i + 3] = src[i + 1];
+	}
+}
@@ -0,0 +1,90 @@
+/* Spa Video Test Source
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+
+#include <spa/utils/defs.h>
+
+#include "draw-ops.h"
+
+#include <emmintrin.h>
+
+void
+draw_random_sse2(struct draw_ops *ops, uint8_t *dst, uint32_t state[4], uint32_t n)
+{
+	uint32_t i, unrolled;
+	__m128i x = _mm_loadu_si128((__m128i*)state);
+
+	unrolled = n & ~15;
+
+	for (i = 0; i < unrolled; i += 16) {
+		x = _mm_xor_si128(x, _mm_slli_epi32(x, 13));
+		x = _mm_xor_si128(x, _mm_srli_epi32(x, 17));
+		x = _mm_xor_si128(x, _mm_slli_epi32(x, 5));
+		_mm_storeu_si128((__m128i*)&dst[i], x);
+	}
+	_mm_storeu_si128((__m128i*)state, x);
+
+	if (i < n)
+		draw_random_c(ops, &dst[i], state, n - i);
+}
+
+void
+draw_gray_bgrx_sse2(struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+	uint32_t i, unrolled;
+	__m128i in, lo, hi, alpha = _mm_set1_epi32(0xff000000);
+
+	unrolled = n & ~15;
+
+	for (i = 0; i < unrolled; i += 16) {
+		in = _mm_loadu_si128((__m128i*)&src[i]);
+		lo = _mm_unpacklo_epi8(in, in);
+		hi = _mm_unpackhi_epi8(in, in);
+		_mm_storeu_si128((__m128i*)&dst[4 * i +  0], _mm_or_si128(_mm_unpacklo_epi16(lo, lo), alpha));
+		_mm_storeu_si128((__m128i*)&dst[4 * i + 16], _mm_or_si128(_mm_unpackhi_epi16(lo, lo), alpha));
+		_mm_storeu_si128((__m128i*)&dst[4 * i + 32], _mm_or_si128(_mm_unpacklo_epi16(hi, hi), alpha));
+		_mm_storeu_si128((__m128i*)&dst[4 * i + 48], _mm_or_si128(_mm_unpackhi_epi16(hi, hi), alpha));
+	}
+	if (i < n)
+		draw_gray_bgrx_c(ops, &dst[4 * i], &src[i], n - i);
+}
+
+void
+draw_gray_uyvy_sse2(struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n)
+{
+	uint32_t i, unrolled;
+	__m128i in, chroma = _mm_set1_epi8((char)128);
+
+	unrolled = n & ~15;
+
+	for (i = 0; i < unrolled; i += 16) {
+		in = _mm_loadu_si128((__m128i*)&src[i]);
+		_mm_storeu_si128((__m128i*)&dst[2 * i +  0], _mm_unpacklo_epi8(chroma, in));
+		_mm_storeu_si128((__m128i*)&dst[2 * i + 16], _mm_unpackhi_epi8(chroma, in));
+	}
+	if (i < n)
+		draw_gray_uyvy_c(ops, &dst[2 * i], &src[i], n - i);
+}
@@ -0,0 +1,88 @@
+/* Spa Video Test Source
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+
+#include "draw-ops.h"
+
+typedef void (*random_func_t) (struct draw_ops *ops, uint8_t *dst, uint32_t state[4], uint32_t n);
+typedef void (*gray_func_t) (struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n);
+
+struct draw_info {
+	uint32_t cpu_flags;
+	random_func_t random;
+	gray_func_t gray_rgb;
+	gray_func_t gray_bgrx;
+	gray_func_t gray_uyvy;
+};
+
+static struct draw_info draw_table[] =
+{
+#if defined (HAVE_SSE2)
+	{ SPA_CPU_FLAG_SSE2, draw_random_sse2, draw_gray_rgb_c, draw_gray_bgrx_sse2, draw_gray_uyvy_sse2 },
+#endif
+	{ 0, draw_random_c, draw_gray_rgb_c, draw_gray_bgrx_c, draw_gray_uyvy_c },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct draw_info *find_draw_info(uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(draw_table); i++) {
+		if (MATCH_CPU_FLAGS(draw_table[i].cpu_flags, cpu_flags))
+			return &draw_table[i];
+	}
+	return NULL;
+}
+
+static void impl_draw_ops_free(struct draw_ops *ops)
+{
+	spa_zero(*ops);
+}
+
+int draw_ops_init(struct draw_ops *ops)
+{
+	const struct draw_info *info;
+
+	info = find_draw_info(ops->cpu_flags);
+	if (info == NULL)
+		return -ENOTSUP;
+
+	ops->priv = info;
+	ops->cpu_flags = info->cpu_flags;
+	ops->random = info->random;
+	ops->gray_rgb = info->gray_rgb;
+	ops->gray_bgrx = info->gray_bgrx;
+	ops->gray_uyvy = info->gray_uyvy;
+	ops->free = impl_draw_ops_free;
+
+	return 0;
+}
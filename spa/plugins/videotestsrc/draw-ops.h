@@ -0,0 +1,69 @@
+/* Spa Video Test Source
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/utils/defs.h>
+
+/* Kernels for the snow patterns. Snow is gray, it is generated as one
+ * random byte per pixel and then expanded to the packed formats. */
+struct draw_ops {
+	uint32_t cpu_flags;
+
+	/* fill dst with n random bytes, state holds 4 nonzero seeds */
+	void (*random) (struct draw_ops *ops, uint8_t *dst, uint32_t state[4], uint32_t n);
+	/* expand n gray levels in src to n pixels in dst */
+	void (*gray_rgb) (struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n);
+	void (*gray_bgrx) (struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n);
+	/* n must be even */
+	void (*gray_uyvy) (struct draw_ops *ops, uint8_t *dst, const uint8_t *src, uint32_t n);
+	void (*free) (struct draw_ops *ops);
+
+	const void *priv;
+};
+
+int draw_ops_init(struct draw_ops *ops);
+
+#define draw_ops_random(ops,...)	(ops)->random(ops, __VA_ARGS__)
+#define draw_ops_gray_rgb(ops,...)	(ops)->gray_rgb(ops, __VA_ARGS__)
+#define draw_ops_gray_bgrx(ops,...)	(ops)->gray_bgrx(ops, __VA_ARGS__)
+#define draw_ops_gray_uyvy(ops,...)	(ops)->gray_uyvy(ops, __VA_ARGS__)
+#define draw_ops_free(ops)		(ops)->free(ops)
+
+#define DEFINE_RANDOM_FUNCTION(arch) \
+void draw_random_##arch(struct draw_ops *ops, uint8_t *dst,		\
+		uint32_t state[4], uint32_t n)
+
+#define DEFINE_GRAY_FUNCTION(name,arch) \
+void draw_gray_##name##_##arch(struct draw_ops *ops, uint8_t *dst,	\
+		const uint8_t *src, uint32_t n)
+
+DEFINE_RANDOM_FUNCTION(c);
+DEFINE_GRAY_FUNCTION(rgb, c);
+DEFINE_GRAY_FUNCTION(bgrx, c);
+DEFINE_GRAY_FUNCTION(uyvy, c);
+
+#if defined(HAVE_SSE2)
+DEFINE_RANDOM_FUNCTION(sse2);
+DEFINE_GRAY_FUNCTION(bgrx, sse2);
+DEFINE_GRAY_FUNCTION(uyvy, sse2);
+#endif
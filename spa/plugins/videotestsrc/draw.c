@@ -70,16 +70,24 @@ static Pixel colors[N_COLORS] = {
 
 /* YUV values are computed in init_colors() */
 
-typedef struct _DrawingData DrawingData;
+/* the color of snow before the luma is filled in */
+static Pixel snow_color = { 0, 0, 0, 0, 128, 128 };
 
-typedef void (*DrawPixelFunc) (DrawingData * dd, int x, Pixel * pixel);
+typedef struct _DrawingData DrawingData;
 
+/* Rows are drawn by filling a template line for each plane and copying the
+ * template to all rows of a band, only snow is generated for each row. */
 struct _DrawingData {
-	char *line;
+	uint32_t format;
 	int width;
 	int height;
-	int stride;
-	DrawPixelFunc draw_pixel;
+	uint32_t n_planes;
+	uint8_t *planes[3];
+	int strides[3];
+	uint8_t *lines[3];	/* template line for each plane */
+	uint8_t *gray;		/* snow for one row */
+	struct draw_ops *ops;
+	uint32_t *state;
 };
 
 static inline void update_yuv(Pixel * pixel)
@@ -115,174 +123,248 @@ static void init_colors(void)
 	}
 }
 
-static void draw_pixel_rgb(DrawingData * dd, int x, Pixel * color)
-{
-	dd->line[3 * x + 0] = color->R;
-	dd->line[3 * x + 1] = color->G;
-	dd->line[3 * x + 2] = color->B;
-}
-
-static void draw_pixel_uyvy(DrawingData * dd, int x, Pixel * color)
-{
-	if (x & 1) {
-		/* odd pixel */
-		dd->line[2 * (x - 1) + 3] = color->Y;
-	} else {
-		/* even pixel */
-		dd->line[2 * x + 0] = color->U;
-		dd->line[2 * x + 1] = color->Y;
-		dd->line[2 * x + 2] = color->V;
-	}
-}
-
-static int drawing_data_init(DrawingData * dd, struct impl *this, char *data)
+static int drawing_data_init(DrawingData * dd, struct impl *this, uint8_t *data)
 {
 	struct port *port = &this->port;
 	struct spa_video_info *format = &port->current_format;
 	struct spa_rectangle *size = &format->info.raw.size;
+	uint32_t i;
 
 	if ((format->media_type != SPA_MEDIA_TYPE_video) ||
 	    (format->media_subtype != SPA_MEDIA_SUBTYPE_raw))
 		return -ENOTSUP;
 
-	if (format->info.raw.format == SPA_VIDEO_FORMAT_RGB) {
-		dd->draw_pixel = draw_pixel_rgb;
-	} else if (format->info.raw.format == SPA_VIDEO_FORMAT_UYVY) {
-		dd->draw_pixel = draw_pixel_uyvy;
-	} else
-		return -ENOTSUP;
-
-	dd->line = data;
+	dd->format = format->info.raw.format;
 	dd->width = size->width;
 	dd->height = size->height;
-	dd->stride = port->stride;
+	dd->n_planes = port->n_planes;
+	for (i = 0; i < port->n_planes; i++) {
+		dd->planes[i] = data + port->offsets[i];
+		dd->strides[i] = port->strides[i];
+		dd->lines[i] = port->lines[i];
+	}
+	dd->gray = port->gray;
+	dd->ops = &port->ops;
+	dd->state = port->snow;
 
 	return 0;
 }
 
-static inline void draw_pixels(DrawingData * dd, int offset, Color color, int length)
+/* fill pixels [x, x + length) of the template lines with color */
+static void draw_pixels(DrawingData * dd, int x, const Pixel * c, int length)
 {
-	int x;
+	uint8_t *l = dd->lines[0];
+	int i;
 
-	for (x = offset; x < offset + length; x++) {
-		dd->draw_pixel(dd, x, &colors[color]);
+	switch (dd->format) {
+	case SPA_VIDEO_FORMAT_RGB:
+		for (i = x; i < x + length; i++) {
+			l[3 * i + 0] = c->R;
+			l[3 * i + 1] = c->G;
+			l[3 * i + 2] = c->B;
+		}
+		break;
+	case SPA_VIDEO_FORMAT_BGRx:
+		for (i = x; i < x + length; i++) {
+			l[4 * i + 0] = c->B;
+			l[4 * i + 1] = c->G;
+			l[4 * i + 2] = c->R;
+			l[4 * i + 3] = 0xff;
+		}
+		break;
+	case SPA_VIDEO_FORMAT_UYVY:
+		/* the even pixel of a pair sets the chroma */
+		for (i = x; i < x + length; i++) {
+			if (i & 1) {
+				l[2 * i + 1] = c->Y;
+			} else {
+				l[2 * i + 0] = c->U;
+				l[2 * i + 1] = c->Y;
+				l[2 * i + 2] = c->V;
+			}
+		}
+		break;
+	case SPA_VIDEO_FORMAT_NV12:
+		memset(&l[x], c->Y, length);
+		for (i = SPA_ROUND_UP_N(x, 2); i < x + length; i += 2) {
+			dd->lines[1][i + 0] = c->U;
+			dd->lines[1][i + 1] = c->V;
+		}
+		break;
+	case SPA_VIDEO_FORMAT_I420:
+		memset(&l[x], c->Y, length);
+		for (i = SPA_ROUND_UP_N(x, 2); i < x + length; i += 2) {
+			dd->lines[1][i / 2] = c->U;
+			dd->lines[2][i / 2] = c->V;
+		}
+		break;
 	}
 }
 
-static inline void next_line(DrawingData * dd)
+/* copy the template lines to rows [y1, y2). Chroma row cy of the 4:2:0
+ * formats goes with luma row 2 * cy. */
+static void copy_lines(DrawingData * dd, int y1, int y2)
 {
-	dd->line += dd->stride;
+	uint32_t i;
+	int y;
+
+	for (y = y1; y < y2; y++)
+		memcpy(dd->planes[0] + y * dd->strides[0], dd->lines[0], dd->strides[0]);
+
+	for (i = 1; i < dd->n_planes; i++) {
+		for (y = (y1 + 1) / 2; y < (y2 + 1) / 2; y++)
+			memcpy(dd->planes[i] + y * dd->strides[i], dd->lines[i], dd->strides[i]);
+	}
+}
+
+/* fill pixels [x, x + length) of row y with snow, chroma of the planar
+ * formats is already set by the template */
+static void draw_snow_line(DrawingData * dd, int y, int x, int length)
+{
+	uint8_t *line = dd->planes[0] + y * dd->strides[0];
+	uint8_t *gray = dd->gray;
+
+	if (length <= 0)
+		return;
+
+	switch (dd->format) {
+	case SPA_VIDEO_FORMAT_NV12:
+	case SPA_VIDEO_FORMAT_I420:
+		draw_ops_random(dd->ops, &line[x], dd->state, length);
+		break;
+	case SPA_VIDEO_FORMAT_RGB:
+		draw_ops_random(dd->ops, gray, dd->state, length);
+		draw_ops_gray_rgb(dd->ops, &line[3 * x], gray, length);
+		break;
+	case SPA_VIDEO_FORMAT_BGRx:
+		draw_ops_random(dd->ops, gray, dd->state, length);
+		draw_ops_gray_bgrx(dd->ops, &line[4 * x], gray, length);
+		break;
+	case SPA_VIDEO_FORMAT_UYVY:
+		draw_ops_random(dd->ops, gray, dd->state, length);
+		if (x & 1) {
+			/* odd pixel, keep the chroma of the pair */
+			line[2 * x + 1] = *gray++;
+			x++;
+			length--;
+		}
+		draw_ops_gray_uyvy(dd->ops, &line[2 * x], gray, length & ~1);
+		if (length & 1) {
+			x += length - 1;
+			line[2 * x + 0] = 128;
+			line[2 * x + 1] = gray[length - 1];
+			line[2 * x + 2] = 128;
+		}
+		break;
+	}
 }
 
-static void draw_smpte_snow(DrawingData * dd)
+/* When full is false the buffer still holds the previous frame of this
+ * pattern and only the snow is drawn again. */
+static void draw_smpte_snow(DrawingData * dd, bool full, bool snow)
 {
 	int h, w;
 	int y1, y2;
-	int i, j;
+	int i, j, x;
 
 	w = dd->width;
 	h = dd->height;
 	y1 = 2 * h / 3;
 	y2 = 3 * h / 4;
+	x = 3 * (w / 6) + 3 * (w / 12);
 
-	for (i = 0; i < y1; i++) {
+	if (full) {
 		for (j = 0; j < 7; j++) {
 			int x1 = j * w / 7;
 			int x2 = (j + 1) * w / 7;
-			draw_pixels(dd, x1, j, x2 - x1);
+			draw_pixels(dd, x1, &colors[j], x2 - x1);
 		}
-		next_line(dd);
-	}
+		copy_lines(dd, 0, y1);
 
-	for (i = y1; i < y2; i++) {
 		for (j = 0; j < 7; j++) {
 			int x1 = j * w / 7;
 			int x2 = (j + 1) * w / 7;
 			Color c = (j & 1) ? BLACK : BLUE - j;
 
-			draw_pixels(dd, x1, c, x2 - x1);
+			draw_pixels(dd, x1, &colors[c], x2 - x1);
 		}
-		next_line(dd);
-	}
+		copy_lines(dd, y1, y2);
 
-	for (i = y2; i < h; i++) {
-		int x = 0;
+		x = 0;
 
 		/* negative I */
-		draw_pixels(dd, x, NEG_I, w / 6);
+		draw_pixels(dd, x, &colors[NEG_I], w / 6);
 		x += w / 6;
 
 		/* white */
-		draw_pixels(dd, x, WHITE, w / 6);
+		draw_pixels(dd, x, &colors[WHITE], w / 6);
 		x += w / 6;
 
 		/* positive Q */
-		draw_pixels(dd, x, POS_Q, w / 6);
+		draw_pixels(dd, x, &colors[POS_Q], w / 6);
 		x += w / 6;
 
 		/* pluge */
-		draw_pixels(dd, x, DARK_BLACK, w / 12);
+		draw_pixels(dd, x, &colors[DARK_BLACK], w / 12);
 		x += w / 12;
-		draw_pixels(dd, x, BLACK, w / 12);
+		draw_pixels(dd, x, &colors[BLACK], w / 12);
 		x += w / 12;
-		draw_pixels(dd, x, LIGHT_BLACK, w / 12);
+		draw_pixels(dd, x, &colors[LIGHT_BLACK], w / 12);
 		x += w / 12;
 
-		/* war of the ants (a.k.a. snow) */
-		for (j = x; j < w; j++) {
-			Pixel p;
-			unsigned char r = rand();
-
-			p.R = r;
-			p.G = r;
-			p.B = r;
-			update_yuv(&p);
-			dd->draw_pixel(dd, j, &p);
-		}
+		draw_pixels(dd, x, snow ? &snow_color : &colors[BLACK], w - x);
+		copy_lines(dd, y2, h);
+	}
 
-		next_line(dd);
+	/* war of the ants (a.k.a. snow) */
+	if (snow) {
+		for (i = y2; i < h; i++)
+			draw_snow_line(dd, i, x, w - x);
 	}
 }
 
-static void draw_snow(DrawingData * dd)
+static void draw_snow(DrawingData * dd, bool full)
 {
-	int x, y;
-
-	for (y = 0; y < dd->height; y++) {
-		for (x = 0; x < dd->width; x++) {
-			Pixel p;
-			unsigned char r = rand();
-
-			p.R = r;
-			p.G = r;
-			p.B = r;
-			update_yuv(&p);
-			dd->draw_pixel(dd, x, &p);
-		}
+	int y;
 
-		next_line(dd);
+	if (full) {
+		draw_pixels(dd, 0, &snow_color, dd->width);
+		copy_lines(dd, 0, dd->height);
 	}
+	for (y = 0; y < dd->height; y++)
+		draw_snow_line(dd, y, 0, dd->width);
 }
 
-static int draw(struct impl *this, char *data)
+static int draw(struct impl *this, struct buffer *b)
 {
+	struct port *port = &this->port;
+	struct spa_data *d = &b->outbuf->datas[0];
 	DrawingData dd;
+	bool full;
 	int res;
 
 	init_colors();
 
-	if ((res = drawing_data_init(&dd, this, data)) < 0)
+	if ((res = drawing_data_init(&dd, this, d->data)) < 0)
 		return res;
 
+	/* only reuse the contents when the memory stays the same */
+	full = b->serial != port->serial || SPA_FLAG_IS_SET(d->flags, SPA_DATA_FLAG_DYNAMIC);
+
 	switch (this->props.pattern) {
 	case PATTERN_SMPTE_SNOW:
-		draw_smpte_snow(&dd);
+		draw_smpte_snow(&dd, full, true);
 		break;
 	case PATTERN_SNOW:
-		draw_snow(&dd);
+		draw_snow(&dd, full);
+		break;
+	case PATTERN_SMPTE:
+		draw_smpte_snow(&dd, full, false);
 		break;
 	default:
 		return -ENOTSUP;
 	}
+	b->serial = port->serial;
+
 	return 0;
 }
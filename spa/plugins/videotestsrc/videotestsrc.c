@@ -27,8 +27,10 @@
 #include <unistd.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdlib.h>
 
 #include <spa/support/plugin.h>
+#include <spa/support/cpu.h>
 #include <spa/support/log.h>
 #include <spa/support/loop.h>
 #include <spa/utils/list.h>
@@ -41,6 +43,8 @@
 #include <spa/param/param.h>
 #include <spa/pod/filter.h>
 
+#include "draw-ops.h"
+
 #define NAME "videotestsrc"
 
 #define FRAMES_TO_TIME(port,f) ((port->current_format.info.raw.framerate.denom * (f) * SPA_NSEC_PER_SEC) / \
@@ -49,6 +53,7 @@
 enum pattern {
 	PATTERN_SMPTE_SNOW,
 	PATTERN_SNOW,
+	PATTERN_SMPTE,
 };
 
 #define DEFAULT_LIVE true
@@ -74,6 +79,7 @@ struct buffer {
 	bool outstanding;
 	struct spa_meta_header *h;
 	struct spa_list link;
+	uint32_t serial;	/* port serial of the frame in the buffer */
 };
 
 struct port {
@@ -87,6 +93,18 @@ struct port {
 	struct spa_video_info current_format;
 	size_t bpp;
 	int stride;
+	uint32_t n_planes;
+	uint32_t offsets[3];
+	int strides[3];
+	uint32_t size;
+
+	struct draw_ops ops;
+	uint8_t *lines[3];
+	uint8_t *gray;
+	uint32_t snow[4];
+	/* changes when the format or pattern changes, buffers with the same
+	 * serial only need their snow drawn again */
+	uint32_t serial;
 
 	struct buffer buffers[MAX_BUFFERS];
 	uint32_t n_buffers;
@@ -101,6 +119,8 @@ struct impl {
 	struct spa_log *log;
 	struct spa_loop *data_loop;
 	struct spa_system *data_system;
+	struct spa_cpu *cpu;
+	uint32_t cpu_flags;
 
 	uint64_t info_all;
 	struct spa_node_info info;
@@ -173,6 +193,8 @@ static int impl_node_enum_params(void *object, int seq,
 			spa_pod_builder_string(&b, "SMPTE snow");
 			spa_pod_builder_int(&b, PATTERN_SNOW);
 			spa_pod_builder_string(&b, "Snow");
+			spa_pod_builder_int(&b, PATTERN_SMPTE);
+			spa_pod_builder_string(&b, "SMPTE");
 			spa_pod_builder_pop(&b, &f[1]);
 			param = spa_pod_builder_pop(&b, &f[0]);
 			break;
@@ -229,6 +251,8 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 	{
 		struct props *p = &this->props;
 
+		this->port.serial++;
+
 		if (param == NULL) {
 			reset_props(p);
 			return 0;
@@ -254,7 +278,7 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 
 static int fill_buffer(struct impl *this, struct buffer *b)
 {
-	return draw(this, b->outbuf->datas[0].data);
+	return draw(this, b);
 }
 
 static void set_timer(struct impl *this, bool enabled)
@@ -306,7 +330,7 @@ static int make_buffer(struct impl *this)
 	spa_list_remove(&b->link);
 	b->outstanding = true;
 
-	n_bytes = b->outbuf->datas[0].maxsize;
+	n_bytes = port->size;
 
 	spa_log_trace(this->log, NAME " %p: dequeue buffer %d", this, b->id);
 
@@ -484,10 +508,13 @@ static int port_enum_formats(void *object,
 			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
 			SPA_FORMAT_mediaType,       SPA_POD_Id(SPA_MEDIA_TYPE_video),
 			SPA_FORMAT_mediaSubtype,    SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-			SPA_FORMAT_VIDEO_format,    SPA_POD_CHOICE_ENUM_Id(3,
+			SPA_FORMAT_VIDEO_format,    SPA_POD_CHOICE_ENUM_Id(6,
 							SPA_VIDEO_FORMAT_RGB,
 							SPA_VIDEO_FORMAT_RGB,
-							SPA_VIDEO_FORMAT_UYVY),
+							SPA_VIDEO_FORMAT_UYVY,
+							SPA_VIDEO_FORMAT_BGRx,
+							SPA_VIDEO_FORMAT_NV12,
+							SPA_VIDEO_FORMAT_I420),
 			SPA_FORMAT_VIDEO_size,      SPA_POD_CHOICE_RANGE_Rectangle(
 							&SPA_RECTANGLE(320, 240),
 							&SPA_RECTANGLE(1, 1),
@@ -549,8 +576,6 @@ impl_node_port_enum_params(void *object, int seq,
 
 	case SPA_PARAM_Buffers:
 	{
-		struct spa_video_info_raw *raw_info = &port->current_format.info.raw;
-
 		if (!port->have_format)
 			return -EIO;
 		if (result.index > 0)
@@ -560,7 +585,7 @@ impl_node_port_enum_params(void *object, int seq,
 			SPA_TYPE_OBJECT_ParamBuffers, id,
 			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
 			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
-			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->stride * raw_info->size.height),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->size),
 			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->stride),
 			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(16));
 		break;
@@ -617,6 +642,71 @@ static int clear_buffers(struct impl *this, struct port *port)
 	return 0;
 }
 
+/* Compute the layout of the planes, they follow each other in the first
+ * data of the buffer. Also allocate the template lines for draw.c. */
+static int setup_planes(struct impl *this, struct port *port,
+		struct spa_video_info_raw *info)
+{
+	uint32_t i, width = info->size.width, height = info->size.height;
+	uint32_t chroma_height = (height + 1) / 2;
+	uint8_t *data;
+
+	if (width == 0 || height == 0)
+		return -EINVAL;
+
+	switch (info->format) {
+	case SPA_VIDEO_FORMAT_RGB:
+		port->bpp = 3;
+		port->n_planes = 1;
+		break;
+	case SPA_VIDEO_FORMAT_UYVY:
+		port->bpp = 2;
+		port->n_planes = 1;
+		break;
+	case SPA_VIDEO_FORMAT_BGRx:
+		port->bpp = 4;
+		port->n_planes = 1;
+		break;
+	case SPA_VIDEO_FORMAT_NV12:
+		port->bpp = 1;
+		port->n_planes = 2;
+		break;
+	case SPA_VIDEO_FORMAT_I420:
+		port->bpp = 1;
+		port->n_planes = 3;
+		break;
+	default:
+		return -EINVAL;
+	}
+
+	port->strides[0] = SPA_ROUND_UP_N(port->bpp * width, 4);
+	port->offsets[0] = 0;
+	port->size = port->strides[0] * height;
+
+	for (i = 1; i < port->n_planes; i++) {
+		if (info->format == SPA_VIDEO_FORMAT_NV12)
+			port->strides[i] = port->strides[0];
+		else
+			port->strides[i] = SPA_ROUND_UP_N((width + 1) / 2, 4);
+		port->offsets[i] = port->size;
+		port->size += port->strides[i] * chroma_height;
+	}
+	port->stride = port->strides[0];
+
+	/* the template lines and one row of snow */
+	data = calloc(1, port->strides[0] * 2 + port->strides[1] + port->strides[2]);
+	if (data == NULL)
+		return -errno;
+
+	free(port->lines[0]);
+	port->lines[0] = data;
+	port->lines[1] = data + port->strides[0];
+	port->lines[2] = port->lines[1] + port->strides[1];
+	port->gray = port->lines[2] + port->strides[2];
+
+	return 0;
+}
+
 static int port_set_format(struct impl *this, struct port *port,
 			   uint32_t flags,
 			   const struct spa_pod *format)
@@ -639,21 +729,16 @@ static int port_set_format(struct impl *this, struct port *port,
 		if (spa_format_video_raw_parse(format, &info.info.raw) < 0)
 			return -EINVAL;
 
-		if (info.info.raw.format == SPA_VIDEO_FORMAT_RGB)
-			port->bpp = 3;
-		else if (info.info.raw.format == SPA_VIDEO_FORMAT_UYVY)
-			port->bpp = 2;
-		else
-			return -EINVAL;
+		if ((res = setup_planes(this, port, &info.info.raw)) < 0)
+			return res;
 
 		port->current_format = info;
 		port->have_format = true;
+		port->serial++;
 	}
 
 	port->info.change_mask |= SPA_PORT_CHANGE_MASK_PARAMS;
 	if (port->have_format) {
-		struct spa_video_info_raw *raw_info = &port->current_format.info.raw;
-		port->stride = SPA_ROUND_UP_N(port->bpp * raw_info->size.width, 4);
 		port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
 		port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
 	} else {
@@ -715,12 +800,18 @@ impl_node_port_use_buffers(void *object,
 		b->outbuf = buffers[i];
 		b->outstanding = false;
 		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+		b->serial = port->serial - 1;
 
 		if (d[0].data == NULL) {
 			spa_log_error(this->log, NAME " %p: invalid memory on buffer %p", this,
 				      buffers[i]);
 			return -EINVAL;
 		}
+		if (d[0].maxsize < port->size) {
+			spa_log_error(this->log, NAME " %p: buffer %p too small %u < %u", this,
+				      buffers[i], d[0].maxsize, port->size);
+			return -EINVAL;
+		}
 		spa_list_append(&port->empty, &b->link);
 	}
 	port->n_buffers = n_buffers;
@@ -850,6 +941,8 @@ static int impl_clear(struct spa_handle *handle)
 
 	this = (struct impl *) handle;
 
+	free(this->port.lines[0]);
+
 	if (this->data_loop)
 		spa_loop_remove_source(this->data_loop, &this->timer_source);
 	spa_system_close(this->data_system, this->timer_source.fd);
@@ -885,6 +978,10 @@ impl_init(const struct spa_handle_factory *factory,
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
 	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
 	this->data_system = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataSystem);
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 
 	spa_hook_list_init(&this->hooks);
 
@@ -934,6 +1031,15 @@ impl_init(const struct spa_handle_factory *factory,
 	port->info.n_params = 5;
 	spa_list_init(&port->empty);
 
+	port->ops.cpu_flags = this->cpu_flags;
+	draw_ops_init(&port->ops);
+
+	/* any nonzero seeds will do for the snow */
+	port->snow[0] = 0x9e3779b9;
+	port->snow[1] = 0x85ebca6b;
+	port->snow[2] = 0xc2b2ae35;
+	port->snow[3] = 0x27d4eb2f;
+
 	spa_log_info(this->log, NAME " %p: initialized", this);
 
 	return 0;
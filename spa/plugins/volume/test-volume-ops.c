@@ -0,0 +1,217 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "volume-ops.c"
+#include "../test-cpu.h"
+
+#define N_SAMPLES	4099
+#define MAX_CHANNELS	8
+
+/* the extra sample is used to make the pointers unaligned */
+static int32_t samp_in[N_SAMPLES * MAX_CHANNELS + 1];
+static int32_t samp_out[N_SAMPLES * MAX_CHANNELS + 1];
+static int32_t samp_ref[N_SAMPLES * MAX_CHANNELS + 1];
+static float ramp[N_SAMPLES];
+
+static const uint32_t sample_counts[] = { 1, 3, 4, 7, 15, 16, 17, 33, 255, 1021, N_SAMPLES };
+/* 10.0 saturates the integer formats */
+static const float volumes[] = { 0.0f, 0.001f, 0.5f, 1.0f, 1.7f, 10.0f };
+
+static uint32_t cpu_flags;
+
+static const char *fmt_name(uint32_t fmt)
+{
+	switch (fmt) {
+	case SPA_AUDIO_FORMAT_S16:
+		return "s16";
+	case SPA_AUDIO_FORMAT_S32:
+		return "s32";
+	case SPA_AUDIO_FORMAT_F32:
+		return "f32";
+	default:
+		return "f32p";
+	}
+}
+
+static uint32_t sample_size(uint32_t fmt)
+{
+	return fmt == SPA_AUDIO_FORMAT_S16 ? 2 : 4;
+}
+
+/* random samples over the full range of the format */
+static void fill_samples(uint32_t fmt)
+{
+	uint32_t i;
+
+	srand(0x5eed);
+	for (i = 0; i < SPA_N_ELEMENTS(samp_in); i++) {
+		double v = (double)rand() / RAND_MAX * 2.0 - 1.0;
+
+		switch (fmt) {
+		case SPA_AUDIO_FORMAT_S16:
+			((int16_t*)samp_in)[i] = v * 32767;
+			break;
+		case SPA_AUDIO_FORMAT_S32:
+			samp_in[i] = v * 2147483647;
+			break;
+		default:
+			((float*)samp_in)[i] = v;
+			break;
+		}
+	}
+	for (i = 0; i < N_SAMPLES; i++)
+		ramp[i] = 2.0f * i / N_SAMPLES;
+}
+
+/* the kernels use the same float math as the C versions, the results
+ * must match exactly */
+static void compare(const char *name, const struct volume_info *info,
+		const void *a, const void *b, uint32_t n_samples, uint32_t n_channels)
+{
+	uint32_t size = sample_size(info->fmt);
+	uint32_t i;
+
+	for (i = 0; i < n_samples; i++) {
+		const void *pa = SPA_MEMBER(a, i * size, void);
+		const void *pb = SPA_MEMBER(b, i * size, void);
+
+		if (memcmp(pa, pb, size) == 0)
+			continue;
+
+		fprintf(stderr, "%s %s cpu %08x: %u channels %u samples, sample %u differs\n",
+				name, fmt_name(info->fmt), info->cpu_flags,
+				n_channels, n_samples, i);
+		spa_assert_not_reached();
+	}
+}
+
+static void test_process(const struct volume_info *info, const struct volume_info *ref)
+{
+	uint32_t size = sample_size(info->fmt);
+	uint32_t i, j, align;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_counts); i++) {
+		uint32_t n_samples = sample_counts[i];
+
+		for (j = 0; j < SPA_N_ELEMENTS(volumes); j++) {
+			for (align = 0; align < 2; align++) {
+				const void *src = SPA_MEMBER(samp_in, align * size, void);
+				void *out = SPA_MEMBER(samp_out, align * size, void);
+				void *res = SPA_MEMBER(samp_ref, align * size, void);
+
+				ref->process(NULL, res, src, volumes[j], n_samples);
+				info->process(NULL, out, src, volumes[j], n_samples);
+				compare("process", info, out, res, n_samples, 1);
+			}
+		}
+	}
+}
+
+static void test_process_ramp(const struct volume_info *info, const struct volume_info *ref)
+{
+	uint32_t size = sample_size(info->fmt);
+	uint32_t i, c, align;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_counts); i++) {
+		uint32_t n_frames = sample_counts[i];
+
+		for (c = 1; c <= MAX_CHANNELS; c++) {
+			for (align = 0; align < 2; align++) {
+				const void *src = SPA_MEMBER(samp_in, align * size, void);
+				void *out = SPA_MEMBER(samp_out, align * size, void);
+				void *res = SPA_MEMBER(samp_ref, align * size, void);
+				const float *vol = &ramp[N_SAMPLES - n_frames];
+
+				ref->process_ramp(NULL, res, src, vol, c, n_frames);
+				info->process_ramp(NULL, out, src, vol, c, n_frames);
+				compare("process_ramp", info, out, res, n_frames * c, c);
+			}
+		}
+	}
+}
+
+/* dst and src are the same buffer when the volume is applied in place */
+static void test_in_place(const struct volume_info *info, const struct volume_info *ref)
+{
+	uint32_t size = sample_size(info->fmt);
+	uint32_t c, n_samples = N_SAMPLES * 2;
+	void *data = SPA_MEMBER(samp_out, size, void);
+
+	memcpy(data, samp_in, n_samples * size);
+	ref->process(NULL, samp_ref, samp_in, 1.7f, n_samples);
+	info->process(NULL, data, data, 1.7f, n_samples);
+	compare("in place", info, data, samp_ref, n_samples, 1);
+
+	for (c = 1; c <= MAX_CHANNELS; c++) {
+		memcpy(data, samp_in, N_SAMPLES * c * size);
+		ref->process_ramp(NULL, samp_ref, samp_in, ramp, c, N_SAMPLES);
+		info->process_ramp(NULL, data, data, ramp, c, N_SAMPLES);
+		compare("ramp in place", info, data, samp_ref, N_SAMPLES * c, c);
+	}
+}
+
+static void test_volume_table(void)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(volume_table); i++) {
+		const struct volume_info *info = &volume_table[i];
+		const struct volume_info *ref;
+		struct volume_ops ops;
+
+		if (!MATCH_CPU_FLAGS(info->cpu_flags, cpu_flags))
+			continue;
+
+		ref = find_volume_info(info->fmt, 0);
+		spa_assert(ref != NULL);
+		spa_assert(ref->cpu_flags == 0);
+
+		spa_zero(ops);
+		ops.fmt = info->fmt;
+		ops.cpu_flags = info->cpu_flags;
+		spa_assert(volume_ops_init(&ops) == 0);
+		spa_assert(ops.priv == info);
+		volume_ops_free(&ops);
+
+		fprintf(stderr, "test %s cpu %08x\n", fmt_name(info->fmt), info->cpu_flags);
+
+		fill_samples(info->fmt);
+		test_process(info, ref);
+		test_process_ramp(info, ref);
+		test_in_place(info, ref);
+	}
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+
+	test_volume_table();
+
+	return 0;
+}
@@ -0,0 +1,128 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+/* the kernels only read src[n] before writing dst[n], so they also work
+ * when dst and src are the same buffer */
+
+static inline int16_t s16_volume(int16_t s, float v)
+{
+	return SPA_CLAMP(lrintf(s * v), INT16_MIN, INT16_MAX);
+}
+
+static inline int32_t s32_volume(int32_t s, float v)
+{
+	return SPA_CLAMP(llrint((double)s * v), INT32_MIN, INT32_MAX);
+}
+
+void
+volume_s16_c(struct volume_ops *ops, void *dst, const void *src,
+		float volume, uint32_t n_samples)
+{
+	uint32_t n;
+	int16_t *d = dst;
+	const int16_t *s = src;
+
+	for (n = 0; n < n_samples; n++)
+		d[n] = s16_volume(s[n], volume);
+}
+
+void
+volume_s32_c(struct volume_ops *ops, void *dst, const void *src,
+		float volume, uint32_t n_samples)
+{
+	uint32_t n;
+	int32_t *d = dst;
+	const int32_t *s = src;
+
+	for (n = 0; n < n_samples; n++)
+		d[n] = s32_volume(s[n], volume);
+}
+
+void
+volume_f32_c(struct volume_ops *ops, void *dst, const void *src,
+		float volume, uint32_t n_samples)
+{
+	uint32_t n;
+	float *d = dst;
+	const float *s = src;
+
+	for (n = 0; n < n_samples; n++)
+		d[n] = s[n] * volume;
+}
+
+void
+volume_ramp_s16_c(struct volume_ops *ops, void *dst, const void *src,
+		const float *volume, uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	int16_t *d = dst;
+	const int16_t *s = src;
+
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++)
+			d[c] = s16_volume(s[c], volume[n]);
+		d += n_channels;
+		s += n_channels;
+	}
+}
+
+void
+volume_ramp_s32_c(struct volume_ops *ops, void *dst, const void *src,
+		const float *volume, uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	int32_t *d = dst;
+	const int32_t *s = src;
+
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++)
+			d[c] = s32_volume(s[c], volume[n]);
+		d += n_channels;
+		s += n_channels;
+	}
+}
+
+void
+volume_ramp_f32_c(struct volume_ops *ops, void *dst, const void *src,
+		const float *volume, uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, c;
+	float *d = dst;
+	const float *s = src;
+
+	for (n = 0; n < n_frames; n++) {
+		for (c = 0; c < n_channels; c++)
+			d[c] = s[c] * volume[n];
+		d += n_channels;
+		s += n_channels;
+	}
+}
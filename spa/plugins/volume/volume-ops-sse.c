@@ -0,0 +1,102 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#include <xmmintrin.h>
+
+void
+volume_f32_sse(struct volume_ops *ops, void *dst, const void *src,
+		float volume, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	float *d = dst;
+	const float *s = src;
+	__m128 v = _mm_set1_ps(volume), in[4];
+
+	if (SPA_IS_ALIGNED(s, 16) &&
+	    SPA_IS_ALIGNED(d, 16))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	for (n = 0; n < unrolled; n += 16) {
+		in[0] = _mm_mul_ps(_mm_load_ps(&s[n + 0]), v);
+		in[1] = _mm_mul_ps(_mm_load_ps(&s[n + 4]), v);
+		in[2] = _mm_mul_ps(_mm_load_ps(&s[n + 8]), v);
+		in[3] = _mm_mul_ps(_mm_load_ps(&s[n + 12]), v);
+		_mm_store_ps(&d[n + 0], in[0]);
+		_mm_store_ps(&d[n + 4], in[1]);
+		_mm_store_ps(&d[n + 8], in[2]);
+		_mm_store_ps(&d[n + 12], in[3]);
+	}
+	for (; n < n_samples; n++)
+		_mm_store_ss(&d[n], _mm_mul_ss(_mm_load_ss(&s[n]), v));
+}
+
+void
+volume_ramp_f32_sse(struct volume_ops *ops, void *dst, const void *src,
+		const float *volume, uint32_t n_channels, uint32_t n_frames)
+{
+	uint32_t n, unrolled;
+	float *d = dst;
+	const float *s = src;
+	__m128 v[2];
+
+	switch (n_channels) {
+	case 1:
+		unrolled = n_frames & ~3;
+		for (n = 0; n < unrolled; n += 4) {
+			v[0] = _mm_loadu_ps(&volume[n]);
+			_mm_storeu_ps(&d[n], _mm_mul_ps(_mm_loadu_ps(&s[n]), v[0]));
+		}
+		for (; n < n_frames; n++)
+			d[n] = s[n] * volume[n];
+		break;
+	case 2:
+		/* duplicate the volumes of 4 frames for the 2 channels */
+		unrolled = n_frames & ~3;
+		for (n = 0; n < unrolled; n += 4) {
+			v[1] = _mm_loadu_ps(&volume[n]);
+			v[0] = _mm_unpacklo_ps(v[1], v[1]);
+			v[1] = _mm_unpackhi_ps(v[1], v[1]);
+			_mm_storeu_ps(&d[2 * n + 0], _mm_mul_ps(_mm_loadu_ps(&s[2 * n + 0]), v[0]));
+			_mm_storeu_ps(&d[2 * n + 4], _mm_mul_ps(_mm_loadu_ps(&s[2 * n + 4]), v[1]));
+		}
+		for (; n < n_frames; n++) {
+			d[2 * n + 0] = s[2 * n + 0] * volume[n];
+			d[2 * n + 1] = s[2 * n + 1] * volume[n];
+		}
+		break;
+	default:
+		volume_ramp_f32_c(ops, dst, src, volume, n_channels, n_frames);
+		break;
+	}
+}
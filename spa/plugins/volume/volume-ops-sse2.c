@@ -0,0 +1,61 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "volume-ops.h"
+
+#include <emmintrin.h>
+
+void
+volume_s16_sse2(struct volume_ops *ops, void *dst, const void *src,
+		float volume, uint32_t n_samples)
+{
+	uint32_t n, unrolled;
+	int16_t *d = dst;
+	const int16_t *s = src;
+	__m128 v = _mm_set1_ps(volume), f[2];
+	__m128i in, t[2];
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		in = _mm_loadu_si128((__m128i*)&s[n]);
+		/* sign extend to s32 and convert to float */
+		t[0] = _mm_srai_epi32(_mm_unpacklo_epi16(in, in), 16);
+		t[1] = _mm_srai_epi32(_mm_unpackhi_epi16(in, in), 16);
+		f[0] = _mm_mul_ps(_mm_cvtepi32_ps(t[0]), v);
+		f[1] = _mm_mul_ps(_mm_cvtepi32_ps(t[1]), v);
+		/* round and saturate back to s16 */
+		t[0] = _mm_cvtps_epi32(f[0]);
+		t[1] = _mm_cvtps_epi32(f[1]);
+		_mm_storeu_si128((__m128i*)&d[n], _mm_packs_epi32(t[0], t[1]));
+	}
+	for (; n < n_samples; n++)
+		d[n] = SPA_CLAMP(lrintf(s[n] * volume), INT16_MIN, INT16_MAX);
+}
@@ -0,0 +1,98 @@
+/* Spa
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+#include <spa/param/audio/format-utils.h>
+
+#include "volume-ops.h"
+
+typedef void (*volume_func_t) (struct volume_ops *ops, void *dst, const void *src,
+		float volume, uint32_t n_samples);
+typedef void (*volume_ramp_func_t) (struct volume_ops *ops, void *dst, const void *src,
+		const float *volume, uint32_t n_channels, uint32_t n_frames);
+
+struct volume_info {
+	uint32_t fmt;
+	uint32_t cpu_flags;
+	volume_func_t process;
+	volume_ramp_func_t process_ramp;
+};
+
+static struct volume_info volume_table[] =
+{
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S16, SPA_CPU_FLAG_SSE2, volume_s16_sse2, volume_ramp_s16_c },
+#endif
+	{ SPA_AUDIO_FORMAT_S16, 0, volume_s16_c, volume_ramp_s16_c },
+
+	{ SPA_AUDIO_FORMAT_S32, 0, volume_s32_c, volume_ramp_s32_c },
+
+#if defined (HAVE_SSE)
+	{ SPA_AUDIO_FORMAT_F32, SPA_CPU_FLAG_SSE, volume_f32_sse, volume_ramp_f32_sse },
+	{ SPA_AUDIO_FORMAT_F32P, SPA_CPU_FLAG_SSE, volume_f32_sse, volume_ramp_f32_sse },
+#endif
+	{ SPA_AUDIO_FORMAT_F32, 0, volume_f32_c, volume_ramp_f32_c },
+	{ SPA_AUDIO_FORMAT_F32P, 0, volume_f32_c, volume_ramp_f32_c },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct volume_info *find_volume_info(uint32_t fmt, uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(volume_table); i++) {
+		if (volume_table[i].fmt == fmt &&
+		    MATCH_CPU_FLAGS(volume_table[i].cpu_flags, cpu_flags))
+			return &volume_table[i];
+	}
+	return NULL;
+}
+
+static void impl_volume_ops_free(struct volume_ops *ops)
+{
+	spa_zero(*ops);
+}
+
+int volume_ops_init(struct volume_ops *ops)
+{
+	const struct volume_info *info;
+
+	info = find_volume_info(ops->fmt, ops->cpu_flags);
+	if (info == NULL)
+		return -ENOTSUP;
+
+	ops->priv = info;
+	ops->cpu_flags = info->cpu_flags;
+	ops->process = info->process;
+	ops->process_ramp = info->process_ramp;
+	ops->free = impl_volume_ops_free;
+
+	return 0;
+}
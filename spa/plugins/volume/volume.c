@@ -25,35 +25,54 @@
 #include <errno.h>
 #include <string.h>
 #include <stddef.h>
+#include <math.h>
 
 #include <spa/support/plugin.h>
 #include <spa/support/log.h>
+#include <spa/support/cpu.h>
+#include <spa/support/loop.h>
 #include <spa/utils/list.h>
 #include <spa/node/node.h>
 #include <spa/node/utils.h>
 #include <spa/node/io.h>
 #include <spa/param/audio/format-utils.h>
+#include <spa/param/audio/volume.h>
 #include <spa/param/param.h>
 #include <spa/pod/filter.h>
+#include <spa/control/control.h>
+
+#include "volume-ops.h"
 
 #define NAME "volume"
 
-#define DEFAULT_VOLUME 1.0
+#define DEFAULT_VOLUME 1.0f
 #define DEFAULT_MUTE false
+#define DEFAULT_RAMP_SAMPLES 256
+#define DEFAULT_RAMP_SCALE SPA_AUDIO_VOLUME_RAMP_LINEAR
 
 struct props {
-	double volume;
+	float volume;
 	bool mute;
+	int ramp_samples;
+	uint32_t ramp_scale;
 };
 
 static void reset_props(struct props *props)
 {
 	props->volume = DEFAULT_VOLUME;
 	props->mute = DEFAULT_MUTE;
+	props->ramp_samples = DEFAULT_RAMP_SAMPLES;
+	props->ramp_scale = DEFAULT_RAMP_SCALE;
 }
 
 #define MAX_SAMPLES     8192
 #define MAX_BUFFERS     16
+#define MAX_DATAS       SPA_AUDIO_MAX_CHANNELS
+
+/* gains of a ramp are computed in chunks of this many frames */
+#define RAMP_CHUNK	256u
+/* logarithmic ramps from or to silence start or end at -60dB */
+#define RAMP_LOG_MIN	0.001f
 
 struct buffer {
 	uint32_t id;
@@ -80,6 +99,7 @@ struct port {
 	uint32_t n_buffers;
 
 	struct spa_io_buffers *io;
+	struct spa_io_sequence *io_control;
 
 	struct spa_list empty;
 };
@@ -89,6 +109,9 @@ struct impl {
 	struct spa_node node;
 
 	struct spa_log *log;
+	struct spa_cpu *cpu;
+	struct spa_loop *data_loop;
+	uint32_t cpu_flags;
 
 	uint64_t info_all;
 	struct spa_node_info info;
@@ -98,8 +121,25 @@ struct impl {
 	struct spa_hook_list hooks;
 
 	struct spa_audio_info current_format;
+	uint32_t stride;
+	uint32_t blocks;
+	uint32_t channels;
 	int bpf;
 
+	struct volume_ops ops;
+
+	/* the applied volume goes from start to end in len frames, pos
+	 * is the next frame. When pos reaches len, end is the volume.
+	 * Only touched from the data loop. */
+	struct {
+		float start;
+		float end;
+		float step;
+		uint32_t scale;
+		uint32_t pos;
+		uint32_t len;
+	} ramp;
+
 	struct port in_ports[1];
 	struct port out_ports[1];
 
@@ -113,6 +153,70 @@ struct impl {
 #define GET_OUT_PORT(this,p)	 (&this->out_ports[p])
 #define GET_PORT(this,d,p)	 (d == SPA_DIRECTION_INPUT ? GET_IN_PORT(this,p) : GET_OUT_PORT(this,p))
 
+static inline float ramp_volume(struct impl *this, uint32_t pos)
+{
+	if (pos >= this->ramp.len)
+		return this->ramp.end;
+	if (this->ramp.scale == SPA_AUDIO_VOLUME_RAMP_LOG)
+		return this->ramp.start * expf(this->ramp.step * pos);
+	return this->ramp.start + this->ramp.step * pos;
+}
+
+/* start a ramp from the current volume to the one in the props */
+static void update_volume(struct impl *this)
+{
+	struct props *p = &this->props;
+	float start, end;
+
+	end = p->mute ? 0.0f : p->volume;
+	if (end == this->ramp.end)
+		return;
+
+	start = ramp_volume(this, this->ramp.pos);
+
+	this->ramp.end = end;
+	this->ramp.pos = 0;
+	this->ramp.len = SPA_MAX(p->ramp_samples, 0);
+	this->ramp.scale = p->ramp_scale;
+
+	if (this->ramp.len == 0)
+		return;
+
+	if (this->ramp.scale == SPA_AUDIO_VOLUME_RAMP_LOG) {
+		start = SPA_MAX(start, RAMP_LOG_MIN);
+		end = SPA_MAX(end, RAMP_LOG_MIN);
+		this->ramp.step = logf(end / start) / this->ramp.len;
+	} else {
+		this->ramp.step = (end - start) / this->ramp.len;
+	}
+	this->ramp.start = start;
+}
+
+/* update the props and start a ramp, called from the data loop */
+static void set_props(struct impl *this, const struct spa_pod *param)
+{
+	struct props *p = &this->props;
+
+	if (param == NULL)
+		reset_props(p);
+	else
+		spa_pod_parse_object(param,
+			SPA_TYPE_OBJECT_Props, NULL,
+			SPA_PROP_volume,            SPA_POD_OPT_Float(&p->volume),
+			SPA_PROP_mute,              SPA_POD_OPT_Bool(&p->mute),
+			SPA_PROP_volumeRampSamples, SPA_POD_OPT_Int(&p->ramp_samples),
+			SPA_PROP_volumeRampScale,   SPA_POD_OPT_Id(&p->ramp_scale));
+	update_volume(this);
+}
+
+static int do_set_props(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	set_props(this, size > 0 ? data : NULL);
+	return 0;
+}
+
 static int impl_node_enum_params(void *object, int seq,
 				 uint32_t id, uint32_t start, uint32_t num,
 				 const struct spa_pod *filter)
@@ -139,6 +243,9 @@ static int impl_node_enum_params(void *object, int seq,
 
 	switch (id) {
 	case SPA_PARAM_PropInfo:
+	{
+		struct spa_pod_frame f[2];
+
 		switch (result.index) {
 		case 0:
 			param = spa_pod_builder_add_object(&b,
@@ -154,17 +261,43 @@ static int impl_node_enum_params(void *object, int seq,
 				SPA_PROP_INFO_name, SPA_POD_String("Mute"),
 				SPA_PROP_INFO_type, SPA_POD_Bool(p->mute));
 			break;
+		case 2:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_PropInfo, id,
+				SPA_PROP_INFO_id,   SPA_POD_Id(SPA_PROP_volumeRampSamples),
+				SPA_PROP_INFO_name, SPA_POD_String("Volume ramp length in samples"),
+				SPA_PROP_INFO_type, SPA_POD_CHOICE_RANGE_Int(p->ramp_samples, 0, INT32_MAX));
+			break;
+		case 3:
+			spa_pod_builder_push_object(&b, &f[0], SPA_TYPE_OBJECT_PropInfo, id);
+			spa_pod_builder_add(&b,
+				SPA_PROP_INFO_id,     SPA_POD_Id(SPA_PROP_volumeRampScale),
+				SPA_PROP_INFO_name,   SPA_POD_String("Volume ramp scale"),
+				SPA_PROP_INFO_type,   SPA_POD_Id(p->ramp_scale),
+				0);
+			spa_pod_builder_prop(&b, SPA_PROP_INFO_labels, 0);
+			spa_pod_builder_push_struct(&b, &f[1]);
+			spa_pod_builder_id(&b, SPA_AUDIO_VOLUME_RAMP_LINEAR);
+			spa_pod_builder_string(&b, "Linear");
+			spa_pod_builder_id(&b, SPA_AUDIO_VOLUME_RAMP_LOG);
+			spa_pod_builder_string(&b, "Logarithmic");
+			spa_pod_builder_pop(&b, &f[1]);
+			param = spa_pod_builder_pop(&b, &f[0]);
+			break;
 		default:
 			return 0;
 		}
 		break;
+	}
 	case SPA_PARAM_Props:
 		switch (result.index) {
 		case 0:
 			param = spa_pod_builder_add_object(&b,
 				SPA_TYPE_OBJECT_Props, id,
-				SPA_PROP_volume, SPA_POD_Float(p->volume),
-				SPA_PROP_mute,   SPA_POD_Bool(p->mute));
+				SPA_PROP_volume,            SPA_POD_Float(p->volume),
+				SPA_PROP_mute,              SPA_POD_Bool(p->mute),
+				SPA_PROP_volumeRampSamples, SPA_POD_Int(p->ramp_samples),
+				SPA_PROP_volumeRampScale,   SPA_POD_Id(p->ramp_scale));
 			break;
 		default:
 			return 0;
@@ -199,19 +332,13 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 
 	switch (id) {
 	case SPA_PARAM_Props:
-	{
-		struct props *p = &this->props;
-
-		if (param == NULL) {
-			reset_props(p);
-			return 0;
-		}
-		spa_pod_parse_object(param,
-			SPA_TYPE_OBJECT_Props, NULL,
-			SPA_PROP_volume, SPA_POD_OPT_Float(&p->volume),
-			SPA_PROP_mute,   SPA_POD_OPT_Bool(&p->mute));
+		/* the ramp is used by process(), change it from the data loop */
+		if (this->data_loop)
+			spa_loop_invoke(this->data_loop, do_set_props, 0,
+					param, param ? SPA_POD_SIZE(param) : 0, true, this);
+		else
+			set_props(this, param);
 		break;
-	}
 	default:
 		return -ENOENT;
 	}
@@ -315,10 +442,12 @@ static int port_enum_formats(void *object,
 			SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
 			SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 			SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-			SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(3,
+			SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(5,
 							SPA_AUDIO_FORMAT_S16,
 							SPA_AUDIO_FORMAT_S16,
-							SPA_AUDIO_FORMAT_S32),
+							SPA_AUDIO_FORMAT_S32,
+							SPA_AUDIO_FORMAT_F32,
+							SPA_AUDIO_FORMAT_F32P),
 			SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(44100, 1, INT32_MAX),
 			SPA_FORMAT_AUDIO_channels, SPA_POD_CHOICE_RANGE_Int(2, 1, INT32_MAX));
 		break;
@@ -381,7 +510,7 @@ impl_node_port_enum_params(void *object, int seq,
 		param = spa_pod_builder_add_object(&b,
 			SPA_TYPE_OBJECT_ParamBuffers, id,
 			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(2, 1, MAX_BUFFERS),
-			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(this->blocks),
 			SPA_PARAM_BUFFERS_size,    SPA_POD_CHOICE_RANGE_Int(
 							MAX_SAMPLES * this->bpf,
 							16 * this->bpf,
@@ -409,6 +538,14 @@ impl_node_port_enum_params(void *object, int seq,
 				SPA_PARAM_IO_id, SPA_POD_Id(SPA_IO_Buffers),
 				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
 			break;
+		case 1:
+			if (direction != SPA_DIRECTION_INPUT)
+				return 0;
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id, SPA_POD_Id(SPA_IO_Control),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_sequence)));
+			break;
 		default:
 			return 0;
 		}
@@ -438,6 +575,16 @@ static int clear_buffers(struct impl *this, struct port *port)
 	return 0;
 }
 
+static int calc_width(struct spa_audio_info *info)
+{
+	switch (info->info.raw.format) {
+	case SPA_AUDIO_FORMAT_S16:
+		return 2;
+	default:
+		return 4;
+	}
+}
+
 static int port_set_format(void *object,
 			   enum spa_direction direction, uint32_t port_id,
 			   uint32_t flags,
@@ -465,7 +612,22 @@ static int port_set_format(void *object,
 		if (spa_format_audio_raw_parse(format, &info.info.raw) < 0)
 			return -EINVAL;
 
-		this->bpf = 2 * info.info.raw.channels;
+		this->ops.fmt = info.info.raw.format;
+		this->ops.cpu_flags = this->cpu_flags;
+		if ((res = volume_ops_init(&this->ops)) < 0)
+			return res;
+
+		this->stride = calc_width(&info);
+		if (SPA_AUDIO_FORMAT_IS_PLANAR(info.info.raw.format)) {
+			this->blocks = info.info.raw.channels;
+			this->channels = 1;
+		} else {
+			this->blocks = 1;
+			this->channels = info.info.raw.channels;
+		}
+		if (this->blocks > MAX_DATAS)
+			return -EINVAL;
+		this->bpf = this->stride * this->channels;
 		this->current_format = info;
 		port->have_format = true;
 	}
@@ -532,7 +694,7 @@ impl_node_port_use_buffers(void *object,
 		b->flags = direction == SPA_DIRECTION_INPUT ? BUFFER_FLAG_OUT : 0;
 		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
 
-		if (d[0].data == NULL) {
+		if (d[0].data != NULL) {
 			b->ptr = d[0].data;
 			b->size = d[0].maxsize;
 		} else {
@@ -567,6 +729,11 @@ impl_node_port_set_io(void *object,
 	case SPA_IO_Buffers:
 		port->io = data;
 		break;
+	case SPA_IO_Control:
+		if (direction != SPA_DIRECTION_INPUT)
+			return -ENOENT;
+		port->io_control = data;
+		break;
 	default:
 		return -ENOENT;
 	}
@@ -621,50 +788,138 @@ static struct buffer *find_free_buffer(struct impl *this, struct port *port)
 	return b;
 }
 
-static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buffer *sbuf)
+/* apply the volume to n_frames frames and advance the ramp */
+static void apply_volume(struct impl *this, void *dst[], const void *src[], uint32_t n_frames)
 {
-	uint32_t i, n_samples, n_bytes;
-	struct spa_data *sd, *dd;
-	int16_t *src, *dst;
-	double volume;
-	uint32_t written, towrite, savail, davail;
-	uint32_t sindex, dindex;
+	uint32_t i, n, blocks = this->blocks, channels = this->channels;
+	void *d[blocks];
+	const void *s[blocks];
+	float volume[RAMP_CHUNK];
+
+	for (i = 0; i < blocks; i++) {
+		d[i] = dst[i];
+		s[i] = src[i];
+	}
 
-	volume = this->props.volume;
+	while (n_frames > 0) {
+		if (this->ramp.pos < this->ramp.len) {
+			n = SPA_MIN(SPA_MIN(n_frames, this->ramp.len - this->ramp.pos), RAMP_CHUNK);
+			for (i = 0; i < n; i++)
+				volume[i] = ramp_volume(this, this->ramp.pos + i);
+			this->ramp.pos += n;
 
-	sd = sbuf->datas;
-	dd = dbuf->datas;
+			for (i = 0; i < blocks; i++)
+				volume_ops_process_ramp(&this->ops, d[i], s[i], volume, channels, n);
+		} else {
+			float v = this->ramp.end;
+
+			n = n_frames;
+			for (i = 0; i < blocks; i++) {
+				if (v == 1.0f) {
+					if (d[i] != s[i])
+						memcpy(d[i], s[i], n * this->bpf);
+				} else if (v == 0.0f) {
+					memset(d[i], 0, n * this->bpf);
+				} else {
+					volume_ops_process(&this->ops, d[i], s[i], v, n * channels);
+				}
+			}
+		}
+		for (i = 0; i < blocks; i++) {
+			d[i] = SPA_MEMBER(d[i], n * this->bpf, void);
+			s[i] = SPA_MEMBER(s[i], n * this->bpf, void);
+		}
+		n_frames -= n;
+	}
+}
 
-	savail = SPA_MIN(sd[0].chunk->size, sd[0].maxsize);
-	sindex = sd[0].chunk->offset;
-	davail = 0;
-	dindex = 0;
-	davail = dd[0].maxsize - davail;
+static void process_control(struct impl *this, struct spa_pod_control *c)
+{
+	switch (c->type) {
+	case SPA_CONTROL_Properties:
+		set_props(this, &c->value);
+		break;
+	default:
+		break;
+	}
+}
 
-	towrite = SPA_MIN(savail, davail);
-	written = 0;
+/* process the frames from pos to end. Silent input stays silent, only the
+ * ramp advances. */
+static void process_frames(struct impl *this, void *dst[], const void *src[],
+		uint32_t pos, uint32_t end, bool empty)
+{
+	uint32_t i, n_frames = end - pos;
+	void *d[MAX_DATAS];
+	const void *s[MAX_DATAS];
+
+	if (n_frames == 0)
+		return;
+
+	for (i = 0; i < this->blocks; i++) {
+		d[i] = SPA_MEMBER(dst[i], pos * this->bpf, void);
+		s[i] = SPA_MEMBER(src[i], pos * this->bpf, void);
+	}
+	if (empty) {
+		this->ramp.pos = SPA_MIN(this->ramp.pos + n_frames, this->ramp.len);
+		for (i = 0; i < this->blocks; i++)
+			if (d[i] != s[i])
+				memset(d[i], 0, n_frames * this->bpf);
+	} else {
+		apply_volume(this, d, s, n_frames);
+	}
+}
 
-	while (written < towrite) {
-		uint32_t soffset = sindex % sd[0].maxsize;
-		uint32_t doffset = dindex % dd[0].maxsize;
+static void do_volume(struct impl *this, struct spa_buffer *dbuf, struct spa_buffer *sbuf,
+		struct spa_pod_sequence *sequence)
+{
+	uint32_t i, n_frames, size, offset, pos;
+	struct spa_data *sd, *dd;
+	void *dst[MAX_DATAS];
+	const void *src[MAX_DATAS];
+	struct spa_pod_control *c;
+	bool empty, silent;
 
-		src = SPA_MEMBER(sd[0].data, soffset, int16_t);
-		dst = SPA_MEMBER(dd[0].data, doffset, int16_t);
+	sd = sbuf->datas;
+	dd = dbuf->datas;
 
-		n_bytes = SPA_MIN(towrite, sd[0].maxsize - soffset);
-		n_bytes = SPA_MIN(n_bytes, dd[0].maxsize - doffset);
+	size = SPA_MIN(sd[0].chunk->size, sd[0].maxsize);
+	n_frames = size / this->bpf;
+	for (i = 0; i < this->blocks; i++) {
+		offset = SPA_MIN(sd[i].chunk->offset, sd[i].maxsize);
+		n_frames = SPA_MIN(n_frames, (sd[i].maxsize - offset) / this->bpf);
+		n_frames = SPA_MIN(n_frames, dd[i].maxsize / this->bpf);
+		src[i] = SPA_MEMBER(sd[i].data, offset, void);
+		dst[i] = dd[i].data;
+	}
+	empty = SPA_FLAG_IS_SET(sd[0].chunk->flags, SPA_CHUNK_FLAG_EMPTY);
+	/* muted for the whole buffer unless a control changes the volume */
+	silent = this->ramp.pos >= this->ramp.len && this->ramp.end == 0.0f;
+
+	/* controls take effect at their offset in the buffer */
+	pos = 0;
+	if (sequence) {
+		SPA_POD_SEQUENCE_FOREACH(sequence, c) {
+			uint32_t offs = SPA_MIN(c->offset, n_frames);
+
+			if (offs > pos) {
+				process_frames(this, dst, src, pos, offs, empty);
+				pos = offs;
+			}
+			process_control(this, c);
+			silent = false;
+		}
+	}
+	process_frames(this, dst, src, pos, n_frames, empty);
 
-		n_samples = n_bytes / sizeof(int16_t);
-		for (i = 0; i < n_samples; i++)
-			dst[i] = src[i] * volume;
+	empty |= silent;
 
-		sindex += n_bytes;
-		dindex += n_bytes;
-		written += n_bytes;
+	for (i = 0; i < this->blocks; i++) {
+		dd[i].chunk->offset = 0;
+		dd[i].chunk->size = n_frames * this->bpf;
+		dd[i].chunk->stride = 0;
+		dd[i].chunk->flags = empty ? SPA_CHUNK_FLAG_EMPTY : 0;
 	}
-	dd[0].chunk->offset = 0;
-	dd[0].chunk->size = written;
-	dd[0].chunk->stride = 0;
 }
 
 static int impl_node_process(void *object)
@@ -709,7 +964,8 @@ static int impl_node_process(void *object)
 	sbuf = &in_port->buffers[input->buffer_id];
 
 	spa_log_trace(this->log, NAME " %p: do volume %d -> %d", this, sbuf->id, dbuf->id);
-	do_volume(this, dbuf->outbuf, sbuf->outbuf);
+	do_volume(this, dbuf->outbuf, sbuf->outbuf,
+			in_port->io_control ? &in_port->io_control->sequence : NULL);
 
 	output->buffer_id = dbuf->id;
 	output->status = SPA_STATUS_HAVE_DATA;
@@ -785,6 +1041,11 @@ impl_init(const struct spa_handle_factory *factory,
 	this = (struct impl *) handle;
 
 	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+	this->data_loop = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_DataLoop);
+
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
 
 	spa_hook_list_init(&this->hooks);
 
@@ -803,6 +1064,8 @@ impl_init(const struct spa_handle_factory *factory,
 	this->info.params = this->params;
 	this->info.n_params = 2;
 	reset_props(&this->props);
+	this->ramp.end = this->props.mute ? 0.0f : this->props.volume;
+	this->blocks = 1;
 
 	port = GET_IN_PORT(this, 0);
 	port->direction = SPA_DIRECTION_INPUT;
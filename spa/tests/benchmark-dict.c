@@ -37,6 +37,7 @@
 
 static struct spa_dict_item items[MAX_ITEMS];
 static char values[MAX_ITEMS][32];
+static char keys[MAX_ITEMS][32];
 
 static void gen_values()
 {
@@ -50,6 +51,8 @@ static void gen_values()
 		}
 		idx = random() % 16;
 		values[i][idx + 16] = 0;
+		/* lookups use a copy so that no pointer compare can succeed */
+		memcpy(keys[i], values[i], 32);
 	}
 }
 
@@ -66,6 +69,11 @@ static void gen_dict(struct spa_dict *dict, uint32_t n_items)
 	dict->flags = 0;
 }
 
+static inline const char *query_key(const struct spa_dict *dict, uint32_t idx)
+{
+	return keys[(dict->items[idx].key - values[0]) / 32];
+}
+
 static void test_query(const struct spa_dict *dict)
 {
 	uint32_t i, idx;
@@ -73,50 +81,52 @@ static void test_query(const struct spa_dict *dict)
 
 	for (i = 0; i < MAX_COUNT; i++) {
 		idx = random() % dict->n_items;
-		str = spa_dict_lookup(dict, dict->items[idx].key);
+		str = spa_dict_lookup(dict, query_key(dict, idx));
 		assert(strcmp(str, dict->items[idx].value) == 0);
 	}
 }
 
-static void test_lookup(struct spa_dict *dict)
+static inline uint64_t get_time_ns(void)
 {
 	struct timespec ts;
-	uint64_t t1, t2, t3, t4;
-
 	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
 
-	test_query(dict);
+static void report(const char *name, uint32_t n_items, uint64_t t1, uint64_t t2, uint64_t base)
+{
+	fprintf(stderr, "%d %s: elapsed %"PRIu64" count %u = %"PRIu64"/sec %f speedup\n",
+			n_items, name, t2 - t1, MAX_COUNT,
+			MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+			(double)base / (t2 - t1));
+}
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+static void test_lookup(struct spa_dict *dict)
+{
+	uint64_t t1, t2, t3, t4, linear;
 
-	fprintf(stderr, "%d elapsed %"PRIu64" count %u = %"PRIu64"/sec\n", dict->n_items,
-			t2 - t1, MAX_COUNT, MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+	t1 = get_time_ns();
+	test_query(dict);
+	t2 = get_time_ns();
+	linear = t2 - t1;
+	report("linear", dict->n_items, t1, t2, linear);
 
+	t1 = get_time_ns();
 	spa_dict_qsort(dict);
+	t2 = get_time_ns();
+	fprintf(stderr, "%d sort elapsed %"PRIu64"\n", dict->n_items, t2 - t1);
 
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t3 = SPA_TIMESPEC_TO_NSEC(&ts);
-
-	fprintf(stderr, "%d sort elapsed %"PRIu64"\n", dict->n_items, t3 - t2);
-
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t3 = SPA_TIMESPEC_TO_NSEC(&ts);
-
+	t3 = get_time_ns();
 	test_query(dict);
-
-	clock_gettime(CLOCK_MONOTONIC, &ts);
-	t4 = SPA_TIMESPEC_TO_NSEC(&ts);
-
-	fprintf(stderr, "%d elapsed %"PRIu64" count %u = %"PRIu64"/sec %f speedup\n", dict->n_items,
-			t4 - t3, MAX_COUNT, MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t4 - t3),
-			(double)(t2 - t1) / (t4 - t2));
+	t4 = get_time_ns();
+	report("sorted", dict->n_items, t3, t4, linear);
 }
 
 int main(int argc, char *argv[])
 {
 	struct spa_dict dict;
+	static const uint32_t sizes[] = { 10, 20, 50, 100, 200, 500 };
+	uint32_t i;
 
 	spa_zero(dict);
 	gen_values();
@@ -125,20 +135,9 @@ int main(int argc, char *argv[])
 	gen_dict(&dict, 1000);
 	test_query(&dict);
 
-	gen_dict(&dict, 10);
-	test_lookup(&dict);
-
-	gen_dict(&dict, 20);
-	test_lookup(&dict);
-
-	gen_dict(&dict, 50);
-	test_lookup(&dict);
-
-	gen_dict(&dict, 100);
-	test_lookup(&dict);
-
-	gen_dict(&dict, 1000);
-	test_lookup(&dict);
-
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		gen_dict(&dict, sizes[i]);
+		test_lookup(&dict);
+	}
 	return 0;
 }
@@ -41,6 +41,7 @@ static void test_io_abi(void)
 	spa_assert(SPA_IO_Position == 7);
 	spa_assert(SPA_IO_RateMatch == 8);
 	spa_assert(SPA_IO_Memory == 9);
+	spa_assert(SPA_IO_Meter == 10);
 
 #if defined(__x86_64__)
 	spa_assert(sizeof(struct spa_io_buffers) == 8);
@@ -72,9 +73,13 @@ static void test_io_abi(void)
 #if defined(__x86_64__)
 	spa_assert(sizeof(struct spa_io_position) == 1688);
 	spa_assert(sizeof(struct spa_io_rate_match) == 48);
+	spa_assert(sizeof(struct spa_io_meter_channel) == 16);
+	spa_assert(sizeof(struct spa_io_meter) == 1064);
 #else
 	fprintf(stderr, "%zd\n", sizeof(struct spa_io_position));
 	fprintf(stderr, "%zd\n", sizeof(struct spa_io_rate_match));
+	fprintf(stderr, "%zd\n", sizeof(struct spa_io_meter_channel));
+	fprintf(stderr, "%zd\n", sizeof(struct spa_io_meter));
 #endif
 }
 
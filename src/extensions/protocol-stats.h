@@ -0,0 +1,118 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#ifndef PIPEWIRE_EXT_PROTOCOL_STATS_H
+#define PIPEWIRE_EXT_PROTOCOL_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <spa/utils/defs.h>
+
+#define PW_TYPE_INTERFACE_ProtocolStats		PW_TYPE_INFO_INTERFACE_BASE "ProtocolStats"
+
+#define PW_VERSION_PROTOCOL_STATS		3
+struct pw_protocol_stats;
+
+/** The stats are emitted as a Struct pod with 2 Structs:
+ *
+ *  Struct(
+ *      Struct(   per connection, repeated for each client
+ *          Int : the client id
+ *          Long : messages received
+ *          Long : bytes received
+ *          Long : fds received
+ *          Long : nanoseconds spent in demarshal and dispatch
+ *          Long : messages sent
+ *          Long : bytes sent
+ *          Long : fds sent
+ *          Long : nanoseconds spent in marshal
+ *          ...)
+ *      Struct(   per interface and opcode, repeated for each used opcode
+ *          String : the interface type
+ *          Int : 0 for methods (received), 1 for events (sent)
+ *          Int : the opcode
+ *          Long : number of messages
+ *          Long : number of bytes
+ *          Long : number of fds
+ *          Long : nanoseconds spent in demarshal and dispatch for methods,
+ *                 in marshal for events
+ *          ...))
+ *
+ * Message, byte and fd counts are always collected. Time is only
+ * measured while there is a client bound to the stats object.
+ */
+#define PW_PROTOCOL_STATS_EVENT_STATS		0
+#define PW_PROTOCOL_STATS_EVENT_NUM		1
+
+/** \ref pw_protocol_stats events */
+struct pw_protocol_stats_events {
+#define PW_VERSION_PROTOCOL_STATS_EVENTS	0
+	uint32_t version;
+
+	void (*stats) (void *object, const struct spa_pod *stats);
+};
+
+#define PW_PROTOCOL_STATS_METHOD_ADD_LISTENER	0
+#define PW_PROTOCOL_STATS_METHOD_GET_STATS	1
+#define PW_PROTOCOL_STATS_METHOD_NUM		2
+
+/** \ref pw_protocol_stats methods */
+struct pw_protocol_stats_methods {
+#define PW_VERSION_PROTOCOL_STATS_METHODS	0
+	uint32_t version;
+
+	int (*add_listener) (void *object,
+			struct spa_hook *listener,
+			const struct pw_protocol_stats_events *events,
+			void *data);
+	/**
+	 * Request the current stats, they are emitted with the stats event
+	 *
+	 * \param flags flags for the request
+	 */
+#define PW_PROTOCOL_STATS_FLAG_RESET	(1 << 0)	/**< clear the counters after
+							  *  emitting them */
+	int (*get_stats) (void *object, uint32_t flags);
+};
+
+#define pw_protocol_stats_method(o,method,version,...)			\
+({									\
+	int _res = -ENOTSUP;						\
+	spa_interface_call_res((struct spa_interface*)o,		\
+			struct pw_protocol_stats_methods, _res,		\
+			method, version, ##__VA_ARGS__);		\
+	_res;								\
+})
+
+#define pw_protocol_stats_add_listener(c,...)	pw_protocol_stats_method(c,add_listener,0,__VA_ARGS__)
+#define pw_protocol_stats_get_stats(c,...)	pw_protocol_stats_method(c,get_stats,0,__VA_ARGS__)
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* PIPEWIRE_EXT_PROTOCOL_STATS_H */
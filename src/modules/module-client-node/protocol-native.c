@@ -33,6 +33,22 @@
 #include <extensions/protocol-native.h>
 #include <extensions/client-node.h>
 
+#include "../module-protocol-native/fixed-pod.h"
+
+static const struct fixed_pod_layout port_buffers_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int);
+static const struct fixed_pod_layout buffer_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Int);
+static const struct fixed_pod_layout buffer_data_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Id, SPA_TYPE_Fd, SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int);
+static const struct fixed_pod_layout port_set_io_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Id,
+			SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int);
+static const struct fixed_pod_layout set_activation_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Fd, SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int);
+static const struct fixed_pod_layout set_io_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Id, SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int);
+
 static inline void push_item(struct spa_pod_builder *b, const struct spa_dict_item *item)
 {
 	const char *str;
@@ -280,26 +296,24 @@ client_node_marshal_port_buffers(void *object,
 	b = pw_protocol_native_begin_proxy(proxy, PW_CLIENT_NODE_METHOD_PORT_BUFFERS, NULL);
 
 	spa_pod_builder_push_struct(b, &f[0]);
-	spa_pod_builder_add(b,
-			    SPA_POD_Int(direction),
-			    SPA_POD_Int(port_id),
-			    SPA_POD_Int(mix_id),
-			    SPA_POD_Int(n_buffers), NULL);
+	fixed_pod_builder_add(b, &port_buffers_layout,
+			(int64_t[]) { direction, port_id, mix_id, n_buffers });
 
 	for (i = 0; i < n_buffers; i++) {
 		struct spa_buffer *buf = buffers[i];
 
-		spa_pod_builder_add(b,
-				SPA_POD_Int(buf->n_datas), NULL);
+		fixed_pod_builder_add(b, &buffer_layout,
+				(int64_t[]) { buf->n_datas });
 
 		for (j = 0; j < buf->n_datas; j++) {
 			struct spa_data *d = &buf->datas[j];
-			spa_pod_builder_add(b,
-					SPA_POD_Id(d->type),
-					SPA_POD_Fd(pw_protocol_native_add_proxy_fd(proxy, d->fd)),
-					SPA_POD_Int(d->flags),
-					SPA_POD_Int(d->mapoffset),
-					SPA_POD_Int(d->maxsize), NULL);
+			fixed_pod_builder_add(b, &buffer_data_layout,
+					(int64_t[]) {
+						d->type,
+						pw_protocol_native_add_proxy_fd(proxy, d->fd),
+						d->flags,
+						d->mapoffset,
+						d->maxsize });
 		}
 	}
 	spa_pod_builder_pop(b, &f[0]);
@@ -525,17 +539,28 @@ static int client_node_demarshal_port_set_io(void *object, const struct pw_proto
 	struct pw_proxy *proxy = object;
 	struct spa_pod_parser prs;
 	uint32_t direction, port_id, mix_id, id, memid, off, sz;
-
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-			SPA_POD_Int(&direction),
-			SPA_POD_Int(&port_id),
-			SPA_POD_Int(&mix_id),
-			SPA_POD_Id(&id),
-			SPA_POD_Int(&memid),
-			SPA_POD_Int(&off),
-			SPA_POD_Int(&sz)) < 0)
-		return -EINVAL;
+	int64_t v[7];
+
+	if (fixed_pod_parse_struct(msg->data, msg->size, &port_set_io_layout, v) == 0) {
+		direction = v[0];
+		port_id = v[1];
+		mix_id = v[2];
+		id = v[3];
+		memid = v[4];
+		off = v[5];
+		sz = v[6];
+	} else {
+		spa_pod_parser_init(&prs, msg->data, msg->size);
+		if (spa_pod_parser_get_struct(&prs,
+				SPA_POD_Int(&direction),
+				SPA_POD_Int(&port_id),
+				SPA_POD_Int(&mix_id),
+				SPA_POD_Id(&id),
+				SPA_POD_Int(&memid),
+				SPA_POD_Int(&off),
+				SPA_POD_Int(&sz)) < 0)
+			return -EINVAL;
+	}
 
 	pw_proxy_notify(proxy, struct pw_client_node_events, port_set_io, 0,
 							direction, port_id, mix_id,
@@ -549,17 +574,25 @@ static int client_node_demarshal_set_activation(void *object, const struct pw_pr
 	struct pw_proxy *proxy = object;
 	struct spa_pod_parser prs;
 	uint32_t node_id, memid, off, sz;
-	int64_t sigidx;
+	int64_t sigidx, v[5];
 	int signalfd;
 
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-			SPA_POD_Int(&node_id),
-			SPA_POD_Fd(&sigidx),
-			SPA_POD_Int(&memid),
-			SPA_POD_Int(&off),
-			SPA_POD_Int(&sz)) < 0)
-		return -EINVAL;
+	if (fixed_pod_parse_struct(msg->data, msg->size, &set_activation_layout, v) == 0) {
+		node_id = v[0];
+		sigidx = v[1];
+		memid = v[2];
+		off = v[3];
+		sz = v[4];
+	} else {
+		spa_pod_parser_init(&prs, msg->data, msg->size);
+		if (spa_pod_parser_get_struct(&prs,
+				SPA_POD_Int(&node_id),
+				SPA_POD_Fd(&sigidx),
+				SPA_POD_Int(&memid),
+				SPA_POD_Int(&off),
+				SPA_POD_Int(&sz)) < 0)
+			return -EINVAL;
+	}
 
 	signalfd = pw_protocol_native_get_proxy_fd(proxy, sigidx);
 
@@ -576,14 +609,22 @@ static int client_node_demarshal_set_io(void *object, const struct pw_protocol_n
 	struct pw_proxy *proxy = object;
 	struct spa_pod_parser prs;
 	uint32_t id, memid, off, sz;
+	int64_t v[4];
 
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-			SPA_POD_Id(&id),
-			SPA_POD_Int(&memid),
-			SPA_POD_Int(&off),
-			SPA_POD_Int(&sz)) < 0)
-		return -EINVAL;
+	if (fixed_pod_parse_struct(msg->data, msg->size, &set_io_layout, v) == 0) {
+		id = v[0];
+		memid = v[1];
+		off = v[2];
+		sz = v[3];
+	} else {
+		spa_pod_parser_init(&prs, msg->data, msg->size);
+		if (spa_pod_parser_get_struct(&prs,
+				SPA_POD_Id(&id),
+				SPA_POD_Int(&memid),
+				SPA_POD_Int(&off),
+				SPA_POD_Int(&sz)) < 0)
+			return -EINVAL;
+	}
 
 	pw_proxy_notify(proxy, struct pw_client_node_events, set_io, 0,
 			id, memid, off, sz);
@@ -783,14 +824,8 @@ client_node_marshal_port_set_io(void *object,
 
 	b = pw_protocol_native_begin_resource(resource, PW_CLIENT_NODE_EVENT_PORT_SET_IO, NULL);
 
-	spa_pod_builder_add_struct(b,
-			       SPA_POD_Int(direction),
-			       SPA_POD_Int(port_id),
-			       SPA_POD_Int(mix_id),
-			       SPA_POD_Id(id),
-			       SPA_POD_Int(memid),
-			       SPA_POD_Int(offset),
-			       SPA_POD_Int(size));
+	fixed_pod_builder_add_struct(b, &port_set_io_layout,
+			(int64_t[]) { direction, port_id, mix_id, id, memid, offset, size });
 
 	return pw_protocol_native_end_resource(resource, b);
 }
@@ -809,12 +844,13 @@ client_node_marshal_set_activation(void *object,
 
 	b = pw_protocol_native_begin_resource(resource, PW_CLIENT_NODE_EVENT_SET_ACTIVATION, &msg);
 
-	spa_pod_builder_add_struct(b,
-			       SPA_POD_Int(node_id),
-			       SPA_POD_Fd(pw_protocol_native_add_resource_fd(resource, signalfd)),
-			       SPA_POD_Int(memid),
-			       SPA_POD_Int(offset),
-			       SPA_POD_Int(size));
+	fixed_pod_builder_add_struct(b, &set_activation_layout,
+			(int64_t[]) {
+				node_id,
+				pw_protocol_native_add_resource_fd(resource, signalfd),
+				memid,
+				offset,
+				size });
 
 	return pw_protocol_native_end_resource(resource, b);
 }
@@ -830,11 +866,8 @@ client_node_marshal_set_io(void *object,
 	struct spa_pod_builder *b;
 
 	b = pw_protocol_native_begin_resource(resource, PW_CLIENT_NODE_EVENT_SET_IO, NULL);
-	spa_pod_builder_add_struct(b,
-			       SPA_POD_Id(id),
-			       SPA_POD_Int(memid),
-			       SPA_POD_Int(offset),
-			       SPA_POD_Int(size));
+	fixed_pod_builder_add_struct(b, &set_io_layout,
+			(int64_t[]) { id, memid, offset, size });
 	return pw_protocol_native_end_resource(resource, b);
 }
 
@@ -1046,12 +1079,19 @@ static int client_node_demarshal_port_buffers(void *object, const struct pw_prot
 	struct spa_pod_parser prs;
 	struct spa_pod_frame f;
 	uint32_t i, j, direction, port_id, mix_id, n_buffers;
-	int64_t data_fd;
+	int64_t data_fd, v[5];
 	struct spa_buffer **buffers = NULL;
 
 	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_push_struct(&prs, &f) < 0 ||
-	    spa_pod_parser_get(&prs,
+	if (spa_pod_parser_push_struct(&prs, &f) < 0)
+		return -EINVAL;
+
+	if (fixed_pod_parser_get(&prs, &port_buffers_layout, v) == 0) {
+		direction = v[0];
+		port_id = v[1];
+		mix_id = v[2];
+		n_buffers = v[3];
+	} else if (spa_pod_parser_get(&prs,
 			SPA_POD_Int(&direction),
 			SPA_POD_Int(&port_id),
 			SPA_POD_Int(&mix_id),
@@ -1065,7 +1105,9 @@ static int client_node_demarshal_port_buffers(void *object, const struct pw_prot
 		buf->n_metas = 0;
 		buf->metas = NULL;
 
-		if (spa_pod_parser_get(&prs,
+		if (fixed_pod_parser_get(&prs, &buffer_layout, v) == 0)
+			buf->n_datas = v[0];
+		else if (spa_pod_parser_get(&prs,
 					SPA_POD_Int(&buf->n_datas), NULL) < 0)
 			return -EINVAL;
 
@@ -1073,7 +1115,13 @@ static int client_node_demarshal_port_buffers(void *object, const struct pw_prot
 		for (j = 0; j < buf->n_datas; j++) {
 			struct spa_data *d = &buf->datas[j];
 
-			if (spa_pod_parser_get(&prs,
+			if (fixed_pod_parser_get(&prs, &buffer_data_layout, v) == 0) {
+				d->type = v[0];
+				data_fd = v[1];
+				d->flags = v[2];
+				d->mapoffset = v[3];
+				d->maxsize = v[4];
+			} else if (spa_pod_parser_get(&prs,
 					      SPA_POD_Id(&d->type),
 					      SPA_POD_Fd(&data_fd),
 					      SPA_POD_Int(&d->flags),
@@ -50,6 +50,7 @@
 
 #include "modules/module-protocol-native/connection.h"
 #include "modules/module-protocol-native/defs.h"
+#include "modules/module-protocol-native/stats.h"
 
 #define NAME "protocol-native"
 
@@ -68,6 +69,13 @@ static bool debug_messages = 0;
 #define LOCK_SUFFIX     ".lock"
 #define LOCK_SUFFIXLEN  5
 
+/* max number of connections accepted in one wakeup of the listening socket */
+#define MAX_ACCEPT	64
+/* max number of accepted connections turned into clients in one main loop
+ * iteration, the remaining ones are handled in the next iteration so that
+ * other main loop work can run in between */
+#define MAX_SETUP	16
+
 void pw_protocol_native_init(struct pw_protocol *protocol);
 void pw_protocol_native0_init(struct pw_protocol *protocol);
 
@@ -77,6 +85,8 @@ struct protocol_data {
 	struct pw_protocol *protocol;
 
 	struct server *local;
+
+	struct protocol_stats *stats;
 };
 
 struct client {
@@ -104,6 +114,15 @@ struct server {
 	struct spa_source *source;
 	struct spa_hook hook;
 	unsigned int activated:1;
+
+	struct spa_list pending_list;
+	struct spa_source *pending_event;
+};
+
+/* a connection that was accepted but for which no client was made yet */
+struct pending_client {
+	struct spa_list link;
+	int fd;
 };
 
 struct client_data {
@@ -120,6 +139,12 @@ struct client_data {
 	unsigned int need_flush:1;
 
 	struct protocol_compat_v2 compat_v2;
+
+	struct protocol_stats *stats;
+	struct protocol_stats_conn conn_stats;
+	struct protocol_stats_counter *out_counter;
+	struct pw_protocol_native_message *out_msg;
+	uint64_t out_start;
 };
 
 static void debug_msg(const char *prefix, const struct pw_protocol_native_message *msg, bool hex)
@@ -164,6 +189,10 @@ process_messages(struct client_data *data)
 		if (res == 0)
 			break;
 
+		if (data->stats)
+			protocol_stats_counter_add(&data->conn_stats.in,
+					msg->size, msg->n_fds, 0);
+
 		if (client->core_resource == NULL) {
 			res = -EPROTO;
 			goto error;
@@ -206,7 +235,27 @@ process_messages(struct client_data *data)
 			continue;
 		}
 
-		if ((res = demarshal[msg->opcode].func(resource, msg)) < 0)
+		if (data->stats) {
+			struct protocol_stats_counter *counter;
+			uint32_t size = msg->size, n_fds = msg->n_fds;
+			uint64_t start = 0, time = 0;
+
+			counter = protocol_stats_get_counter(data->stats,
+					marshal, false, msg->opcode);
+			if (protocol_stats_is_timing(data->stats))
+				start = protocol_stats_now();
+
+			res = demarshal[msg->opcode].func(resource, msg);
+
+			if (start)
+				time = protocol_stats_now() - start;
+			if (counter)
+				protocol_stats_counter_add(counter, size, n_fds, time);
+			data->conn_stats.in.time += time;
+		} else {
+			res = demarshal[msg->opcode].func(resource, msg);
+		}
+		if (res < 0)
 			goto invalid_message;
 	}
 	res = 0;
@@ -293,6 +342,9 @@ static void client_free(void *data)
 
 	spa_list_remove(&this->protocol_link);
 
+	if (this->stats)
+		protocol_stats_remove_conn(this->stats, &this->conn_stats);
+
 	if (this->source)
 		pw_loop_destroy_source(client->context->main_loop, this->source);
 	if (this->connection)
@@ -397,6 +449,12 @@ static struct client_data *client_new(struct server *s, int fd)
 
 	pw_map_init(&this->compat_v2.types, 0, 32);
 
+	if (d->stats) {
+		this->stats = d->stats;
+		this->conn_stats.client = client;
+		protocol_stats_add_conn(this->stats, &this->conn_stats);
+	}
+
 	pw_protocol_native_connection_add_listener(this->connection,
 						   &this->conn_listener,
 						   &server_conn_events,
@@ -488,28 +546,72 @@ err:
 	return res;
 }
 
+static void free_pending(struct pending_client *p, bool close_fd)
+{
+	spa_list_remove(&p->link);
+	if (close_fd)
+		close(p->fd);
+	free(p);
+}
+
+static void
+setup_pending(void *data, uint64_t count)
+{
+	struct server *s = data;
+	struct pending_client *p;
+	int i;
+
+	for (i = 0; i < MAX_SETUP && !spa_list_is_empty(&s->pending_list); i++) {
+		p = spa_list_first(&s->pending_list, struct pending_client, link);
+
+		if (client_new(s, p->fd) == NULL) {
+			pw_log_error("server %p: failed to create client: %m", s);
+			free_pending(p, true);
+		} else {
+			free_pending(p, false);
+		}
+	}
+	if (!spa_list_is_empty(&s->pending_list))
+		pw_loop_signal_event(s->loop, s->pending_event);
+}
+
 static void
 socket_data(void *data, int fd, uint32_t mask)
 {
 	struct server *s = data;
-	struct client_data *client;
+	struct pending_client *p;
 	struct sockaddr_un name;
 	socklen_t length;
-	int client_fd;
+	int i, client_fd;
+
+	/* accept a batch of connections and defer the client setup to
+	 * the pending event so that a burst of connections does not
+	 * block the main loop */
+	for (i = 0; i < MAX_ACCEPT; i++) {
+		length = sizeof(name);
+		client_fd = accept4(fd, (struct sockaddr *) &name, &length,
+				SOCK_CLOEXEC | SOCK_NONBLOCK);
+		if (client_fd < 0) {
+			if (errno == EINTR)
+				continue;
+			if (errno != EAGAIN && errno != EWOULDBLOCK)
+				pw_log_error("server %p: failed to accept: %m", s);
+			break;
+		}
 
-	length = sizeof(name);
-	client_fd = accept4(fd, (struct sockaddr *) &name, &length, SOCK_CLOEXEC);
-	if (client_fd < 0) {
-		pw_log_error("server %p: failed to accept: %m", s);
-		return;
+		if ((p = calloc(1, sizeof(struct pending_client))) == NULL) {
+			pw_log_error("server %p: failed to queue client: %m", s);
+			close(client_fd);
+			continue;
+		}
+		p->fd = client_fd;
+		spa_list_append(&s->pending_list, &p->link);
 	}
+	if (i > 0)
+		pw_log_debug("server %p: accepted %d connections", s, i);
 
-	client = client_new(s, client_fd);
-	if (client == NULL) {
-		pw_log_error("server %p: failed to create client", s);
-		close(client_fd);
-		return;
-	}
+	if (!spa_list_is_empty(&s->pending_list))
+		pw_loop_signal_event(s->loop, s->pending_event);
 }
 
 static int add_socket(struct pw_protocol *protocol, struct server *s)
@@ -566,12 +668,27 @@ static int add_socket(struct pw_protocol *protocol, struct server *s)
 		}
 	}
 
+	if (activated) {
+		/* sockets are accepted in batches until EAGAIN */
+		int flags = fcntl(fd, F_GETFL);
+		if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+			res = -errno;
+			pw_log_error("server %p: can't make socket non-blocking: %m", s);
+			goto error_close;
+		}
+	}
+
 	s->activated = activated;
 	s->loop = pw_context_get_main_loop(protocol->context);
 	if (s->loop == NULL) {
 		res = -errno;
 		goto error_close;
 	}
+	s->pending_event = pw_loop_add_event(s->loop, setup_pending, s);
+	if (s->pending_event == NULL) {
+		res = -errno;
+		goto error_close;
+	}
 	s->source = pw_loop_add_io(s->loop, fd, SPA_IO_IN, true, socket_data, s);
 	if (s->source == NULL) {
 		res = -errno;
@@ -913,10 +1030,16 @@ static void destroy_server(struct pw_protocol_server *server)
 {
 	struct server *s = SPA_CONTAINER_OF(server, struct server, this);
 	struct client_data *data, *tmp;
+	struct pending_client *p;
 
 	spa_list_remove(&server->link);
 	spa_hook_remove(&s->hook);
 
+	spa_list_consume(p, &s->pending_list, link)
+		free_pending(p, true);
+	if (s->pending_event)
+		pw_loop_destroy_source(s->loop, s->pending_event);
+
 	spa_list_for_each_safe(data, tmp, &server->client_list, protocol_link)
 		pw_impl_client_destroy(data->client);
 
@@ -993,6 +1116,7 @@ create_server(struct pw_protocol *protocol,
 	this->protocol = protocol;
 	this->core = core;
 	spa_list_init(&this->client_list);
+	spa_list_init(&s->pending_list);
 	this->destroy = destroy_server;
 
 	spa_list_append(&protocol->server_list, &this->link);
@@ -1078,7 +1202,22 @@ impl_ext_begin_resource(struct pw_resource *resource,
 		uint8_t opcode, struct pw_protocol_native_message **msg)
 {
 	struct client_data *data = resource->client->user_data;
-	return pw_protocol_native_connection_begin(data->connection, resource->id, opcode, msg);
+	struct spa_pod_builder *b;
+
+	if (data->stats == NULL)
+		return pw_protocol_native_connection_begin(data->connection,
+				resource->id, opcode, msg);
+
+	b = pw_protocol_native_connection_begin(data->connection,
+			resource->id, opcode, &data->out_msg);
+	if (msg)
+		*msg = data->out_msg;
+
+	data->out_counter = protocol_stats_get_counter(data->stats,
+			pw_resource_get_marshal(resource), true, opcode);
+	data->out_start = protocol_stats_is_timing(data->stats) ?
+		protocol_stats_now() : 0;
+	return b;
 }
 
 static uint32_t impl_ext_add_resource_fd(struct pw_resource *resource, int fd)
@@ -1097,6 +1236,15 @@ static int impl_ext_end_resource(struct pw_resource *resource,
 {
 	struct client_data *data = resource->client->user_data;
 	struct pw_impl_client *client = resource->client;
+
+	if (data->stats) {
+		uint32_t size = builder->state.offset, n_fds = data->out_msg->n_fds;
+		uint64_t time = data->out_start ? protocol_stats_now() - data->out_start : 0;
+
+		if (data->out_counter)
+			protocol_stats_counter_add(data->out_counter, size, n_fds, time);
+		protocol_stats_counter_add(&data->conn_stats.out, size, n_fds, time);
+	}
 	return client->send_seq = pw_protocol_native_connection_end(data->connection, builder);
 }
 const static struct pw_protocol_native_ext protocol_ext_impl = {
@@ -1114,10 +1262,15 @@ const static struct pw_protocol_native_ext protocol_ext_impl = {
 static void module_destroy(void *data)
 {
 	struct protocol_data *d = data;
+	struct protocol_stats *stats = d->stats;
 
 	spa_hook_remove(&d->module_listener);
 
+	/* this also frees d */
 	pw_protocol_destroy(d->protocol);
+
+	if (stats)
+		protocol_stats_destroy(stats);
 }
 
 static const struct pw_impl_module_events module_events = {
@@ -1175,6 +1328,8 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 			res = -errno;
 			goto error_cleanup;
 		}
+		if ((d->stats = protocol_stats_new(context)) == NULL)
+			pw_log_warn(NAME" %p: can't create stats: %m", this);
 	}
 
 	pw_impl_module_add_listener(module, &d->module_listener, &module_events, d);
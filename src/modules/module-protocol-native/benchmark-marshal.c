@@ -0,0 +1,157 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/parser.h>
+
+#include "fixed-pod.h"
+
+#define MAX_COUNT 100000000
+
+static const struct fixed_pod_layout id_seq_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Int);
+static const struct fixed_pod_layout port_set_io_layout =
+	FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Id,
+			SPA_TYPE_Int, SPA_TYPE_Int, SPA_TYPE_Int);
+
+static volatile uint32_t sink;
+
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void report(const char *name, uint64_t t1, uint64_t t2, uint64_t count)
+{
+	fprintf(stderr, "%s: elapsed %"PRIu64" count %"PRIu64" = %"PRIu64"/sec\n",
+			name, t2 - t1, count, count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+}
+
+#define RUN_LOOP(name,body)						\
+({									\
+	uint64_t _t1, _t2, _count;					\
+	_t1 = get_time_ns();						\
+	for (_count = 0; _count < MAX_COUNT; _count++) {		\
+		body;							\
+		if ((_count & 0xfff) == 0 &&				\
+		    get_time_ns() - _t1 > 1 * SPA_NSEC_PER_SEC)		\
+			break;						\
+	}								\
+	_t2 = get_time_ns();						\
+	report(name, _t1, _t2, _count);					\
+})
+
+static void test_sync(void)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct spa_pod_parser prs;
+	uint32_t id, seq;
+	int64_t v[2];
+
+	RUN_LOOP("sync marshal vararg", ({
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		spa_pod_builder_add_struct(&b,
+				SPA_POD_Int(_count),
+				SPA_POD_Int(_count + 1));
+		sink = b.state.offset;
+	}));
+	RUN_LOOP("sync marshal fixed", ({
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		fixed_pod_builder_add_struct(&b, &id_seq_layout,
+				(int64_t[]) { _count, _count + 1 });
+		sink = b.state.offset;
+	}));
+
+	RUN_LOOP("sync demarshal vararg", ({
+		spa_pod_parser_init(&prs, buffer, sizeof(buffer));
+		spa_pod_parser_get_struct(&prs,
+				SPA_POD_Int(&id),
+				SPA_POD_Int(&seq));
+		sink = id + seq;
+	}));
+	RUN_LOOP("sync demarshal fixed", ({
+		if (fixed_pod_parse_struct(buffer, sizeof(buffer), &id_seq_layout, v) == 0)
+			sink = v[0] + v[1];
+	}));
+}
+
+static void test_port_set_io(void)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b;
+	struct spa_pod_parser prs;
+	uint32_t direction, port_id, mix_id, id, memid, off, sz;
+	int64_t v[7];
+
+	RUN_LOOP("port_set_io marshal vararg", ({
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		spa_pod_builder_add_struct(&b,
+			       SPA_POD_Int(1),
+			       SPA_POD_Int(2),
+			       SPA_POD_Int(3),
+			       SPA_POD_Id(4),
+			       SPA_POD_Int(_count),
+			       SPA_POD_Int(6),
+			       SPA_POD_Int(7));
+		sink = b.state.offset;
+	}));
+	RUN_LOOP("port_set_io marshal fixed", ({
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+		fixed_pod_builder_add_struct(&b, &port_set_io_layout,
+				(int64_t[]) { 1, 2, 3, 4, _count, 6, 7 });
+		sink = b.state.offset;
+	}));
+
+	RUN_LOOP("port_set_io demarshal vararg", ({
+		spa_pod_parser_init(&prs, buffer, sizeof(buffer));
+		spa_pod_parser_get_struct(&prs,
+				SPA_POD_Int(&direction),
+				SPA_POD_Int(&port_id),
+				SPA_POD_Int(&mix_id),
+				SPA_POD_Id(&id),
+				SPA_POD_Int(&memid),
+				SPA_POD_Int(&off),
+				SPA_POD_Int(&sz));
+		sink = direction + port_id + mix_id + id + memid + off + sz;
+	}));
+	RUN_LOOP("port_set_io demarshal fixed", ({
+		if (fixed_pod_parse_struct(buffer, sizeof(buffer), &port_set_io_layout, v) == 0)
+			sink = v[0] + v[1] + v[2] + v[3] + v[4] + v[5] + v[6];
+	}));
+}
+
+int main(int argc, char *argv[])
+{
+	test_sync();
+	test_port_set_io();
+	return 0;
+}
@@ -0,0 +1,199 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PIPEWIRE_PROTOCOL_NATIVE_FIXED_POD_H
+#define PIPEWIRE_PROTOCOL_NATIVE_FIXED_POD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/parser.h>
+
+/** \cond */
+
+/* Fixed layout marshalling of messages that only contain scalar fields.
+ *
+ * Int, Id, Long and Fd pods all occupy 16 bytes on the wire: an 8 byte
+ * header followed by an 8 byte (padded) body. A message made of only
+ * these types therefore has a layout that is known at compile time and
+ * can be written with one copy of a prebuilt template and read back with
+ * one bounds check, instead of going through the vararg builder and
+ * parser for each field.
+ *
+ * The reader only accepts the exact layout it was given and returns
+ * -EINVAL otherwise, in which case the caller should fall back to the
+ * generic parser so that all valid encodings stay accepted. */
+
+#define FIXED_POD_MAX_FIELDS	8
+
+struct fixed_pod_field {
+	struct spa_pod pod;
+	union {
+		int32_t i;
+		uint32_t id;
+		int64_t l;
+	} value;
+};
+
+struct fixed_pod_layout {
+	uint32_t n_fields;
+	uint32_t types[FIXED_POD_MAX_FIELDS];
+};
+
+#define FIXED_POD_LAYOUT(...)						\
+	{ SPA_N_ELEMENTS(((uint32_t[]) { __VA_ARGS__ })), { __VA_ARGS__ } }
+
+static inline uint32_t fixed_pod_body_size(uint32_t type)
+{
+	return (type == SPA_TYPE_Long || type == SPA_TYPE_Fd) ? 8 : 4;
+}
+
+static inline void
+fixed_pod_fill(struct fixed_pod_field *fields, const struct fixed_pod_layout *layout,
+		const int64_t *values)
+{
+	uint32_t i;
+
+	for (i = 0; i < layout->n_fields; i++) {
+		struct fixed_pod_field *f = &fields[i];
+		uint32_t type = layout->types[i];
+
+		f->pod.type = type;
+		f->pod.size = fixed_pod_body_size(type);
+		f->value.l = 0;
+		if (f->pod.size == 8)
+			f->value.l = values[i];
+		else if (type == SPA_TYPE_Id)
+			f->value.id = (uint32_t) values[i];
+		else
+			f->value.i = (int32_t) values[i];
+	}
+}
+
+/** Append the fields of \a layout to the current container of \a b */
+static inline int
+fixed_pod_builder_add(struct spa_pod_builder *b, const struct fixed_pod_layout *layout,
+		const int64_t *values)
+{
+	struct fixed_pod_field fields[FIXED_POD_MAX_FIELDS];
+
+	fixed_pod_fill(fields, layout, values);
+	return spa_pod_builder_raw(b, fields, layout->n_fields * sizeof(struct fixed_pod_field));
+}
+
+/** Write a struct containing the fields of \a layout in one copy */
+static inline int
+fixed_pod_builder_add_struct(struct spa_pod_builder *b, const struct fixed_pod_layout *layout,
+		const int64_t *values)
+{
+	struct {
+		struct spa_pod_struct s;
+		struct fixed_pod_field fields[FIXED_POD_MAX_FIELDS];
+	} t;
+	uint32_t size = layout->n_fields * sizeof(struct fixed_pod_field);
+
+	t.s = SPA_POD_INIT_Struct(size);
+	fixed_pod_fill(t.fields, layout, values);
+	return spa_pod_builder_raw(b, &t, sizeof(struct spa_pod_struct) + size);
+}
+
+static inline int
+fixed_pod_read(const struct fixed_pod_field *fields, const struct fixed_pod_layout *layout,
+		int64_t *values)
+{
+	uint32_t i;
+
+	for (i = 0; i < layout->n_fields; i++) {
+		const struct fixed_pod_field *f = &fields[i];
+		uint32_t type = layout->types[i];
+
+		if (f->pod.type != type || f->pod.size != fixed_pod_body_size(type))
+			return -EINVAL;
+	}
+	for (i = 0; i < layout->n_fields; i++) {
+		const struct fixed_pod_field *f = &fields[i];
+
+		if (f->pod.size == 8)
+			values[i] = f->value.l;
+		else if (f->pod.type == SPA_TYPE_Id)
+			values[i] = f->value.id;
+		else
+			values[i] = f->value.i;
+	}
+	return 0;
+}
+
+/** Read the fields of \a layout at the current position of \a p.
+ * On success the parser is advanced past the fields. */
+static inline int
+fixed_pod_parser_get(struct spa_pod_parser *p, const struct fixed_pod_layout *layout,
+		int64_t *values)
+{
+	struct spa_pod_frame *f = p->state.frame;
+	uint32_t end = f ? f->offset + SPA_POD_SIZE(&f->pod) : p->size;
+	uint32_t size = layout->n_fields * sizeof(struct fixed_pod_field);
+	int res;
+
+	if (end > p->size || p->state.offset + size > end)
+		return -EINVAL;
+
+	res = fixed_pod_read(SPA_MEMBER(p->data, p->state.offset, const struct fixed_pod_field),
+			layout, values);
+	if (res < 0)
+		return res;
+
+	p->state.offset += size;
+	return 0;
+}
+
+/** Read a struct that starts with the fields of \a layout from a
+ * message body */
+static inline int
+fixed_pod_parse_struct(const void *data, uint32_t size, const struct fixed_pod_layout *layout,
+		int64_t *values)
+{
+	const struct spa_pod_struct *s = data;
+	uint32_t body = layout->n_fields * sizeof(struct fixed_pod_field);
+
+	if (size < sizeof(struct spa_pod_struct) + body ||
+	    s->pod.type != SPA_TYPE_Struct ||
+	    s->pod.size < body ||
+	    s->pod.size > size - sizeof(struct spa_pod_struct))
+		return -EINVAL;
+
+	return fixed_pod_read(SPA_MEMBER(s, sizeof(struct spa_pod_struct), const struct fixed_pod_field),
+			layout, values);
+}
+
+/** \endcond */
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* PIPEWIRE_PROTOCOL_NATIVE_FIXED_POD_H */
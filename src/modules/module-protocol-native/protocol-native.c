@@ -31,8 +31,36 @@
 
 #include <pipewire/impl.h>
 #include <extensions/protocol-native.h>
+#include <extensions/protocol-stats.h>
 
 #include "connection.h"
+#include "fixed-pod.h"
+
+/* layout of the sync, done, ping and pong messages */
+static const struct fixed_pod_layout id_seq_layout = FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Int);
+
+static inline int add_id_seq(struct spa_pod_builder *b, uint32_t id, int seq)
+{
+	int64_t values[] = { id, seq };
+	return fixed_pod_builder_add_struct(b, &id_seq_layout, values);
+}
+
+static inline int parse_id_seq(const struct pw_protocol_native_message *msg,
+		uint32_t *id, uint32_t *seq)
+{
+	struct spa_pod_parser prs;
+	int64_t values[2];
+
+	if (fixed_pod_parse_struct(msg->data, msg->size, &id_seq_layout, values) == 0) {
+		*id = values[0];
+		*seq = values[1];
+		return 0;
+	}
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	return spa_pod_parser_get_struct(&prs,
+				SPA_POD_Int(id),
+				SPA_POD_Int(seq));
+}
 
 static int core_method_marshal_add_listener(void *object,
 			struct spa_hook *listener,
@@ -65,9 +93,7 @@ static int core_method_marshal_sync(void *object, uint32_t id, int seq)
 
 	b = pw_protocol_native_begin_proxy(proxy, PW_CORE_METHOD_SYNC, &msg);
 
-	spa_pod_builder_add_struct(b,
-			SPA_POD_Int(id),
-			SPA_POD_Int(SPA_RESULT_RETURN_ASYNC(msg->seq)));
+	add_id_seq(b, id, SPA_RESULT_RETURN_ASYNC(msg->seq));
 
 	return pw_protocol_native_end_proxy(proxy, b);
 }
@@ -79,9 +105,7 @@ static int core_method_marshal_pong(void *object, uint32_t id, int seq)
 
 	b = pw_protocol_native_begin_proxy(proxy, PW_CORE_METHOD_PONG, NULL);
 
-	spa_pod_builder_add_struct(b,
-			SPA_POD_Int(id),
-			SPA_POD_Int(seq));
+	add_id_seq(b, id, seq);
 
 	return pw_protocol_native_end_proxy(proxy, b);
 }
@@ -278,13 +302,9 @@ static int core_event_demarshal_info(void *object, const struct pw_protocol_nati
 static int core_event_demarshal_done(void *object, const struct pw_protocol_native_message *msg)
 {
 	struct pw_proxy *proxy = object;
-	struct spa_pod_parser prs;
 	uint32_t id, seq;
 
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-				SPA_POD_Int(&id),
-				SPA_POD_Int(&seq)) < 0)
+	if (parse_id_seq(msg, &id, &seq) < 0)
 		return -EINVAL;
 
 	return pw_proxy_notify(proxy, struct pw_core_events, done, 0, id, seq);
@@ -293,13 +313,9 @@ static int core_event_demarshal_done(void *object, const struct pw_protocol_nati
 static int core_event_demarshal_ping(void *object, const struct pw_protocol_native_message *msg)
 {
 	struct pw_proxy *proxy = object;
-	struct spa_pod_parser prs;
 	uint32_t id, seq;
 
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-				SPA_POD_Int(&id),
-				SPA_POD_Int(&seq)) < 0)
+	if (parse_id_seq(msg, &id, &seq) < 0)
 		return -EINVAL;
 
 	return pw_proxy_notify(proxy, struct pw_core_events, ping, 0, id, seq);
@@ -418,9 +434,7 @@ static void core_event_marshal_done(void *object, uint32_t id, int seq)
 
 	b = pw_protocol_native_begin_resource(resource, PW_CORE_EVENT_DONE, NULL);
 
-	spa_pod_builder_add_struct(b,
-			SPA_POD_Int(id),
-			SPA_POD_Int(seq));
+	add_id_seq(b, id, seq);
 
 	pw_protocol_native_end_resource(resource, b);
 }
@@ -433,9 +447,7 @@ static void core_event_marshal_ping(void *object, uint32_t id, int seq)
 
 	b = pw_protocol_native_begin_resource(resource, PW_CORE_EVENT_PING, &msg);
 
-	spa_pod_builder_add_struct(b,
-			SPA_POD_Int(id),
-			SPA_POD_Int(SPA_RESULT_RETURN_ASYNC(msg->seq)));
+	add_id_seq(b, id, SPA_RESULT_RETURN_ASYNC(msg->seq));
 
 	pw_protocol_native_end_resource(resource, b);
 }
@@ -529,13 +541,9 @@ static int core_method_demarshal_hello(void *object, const struct pw_protocol_na
 static int core_method_demarshal_sync(void *object, const struct pw_protocol_native_message *msg)
 {
 	struct pw_resource *resource = object;
-	struct spa_pod_parser prs;
 	uint32_t id, seq;
 
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-				SPA_POD_Int(&id),
-				SPA_POD_Int(&seq)) < 0)
+	if (parse_id_seq(msg, &id, &seq) < 0)
 		return -EINVAL;
 
 	return pw_resource_notify(resource, struct pw_core_methods, sync, 0, id, seq);
@@ -544,13 +552,9 @@ static int core_method_demarshal_sync(void *object, const struct pw_protocol_nat
 static int core_method_demarshal_pong(void *object, const struct pw_protocol_native_message *msg)
 {
 	struct pw_resource *resource = object;
-	struct spa_pod_parser prs;
 	uint32_t id, seq;
 
-	spa_pod_parser_init(&prs, msg->data, msg->size);
-	if (spa_pod_parser_get_struct(&prs,
-				SPA_POD_Int(&id),
-				SPA_POD_Int(&seq)) < 0)
+	if (parse_id_seq(msg, &id, &seq) < 0)
 		return -EINVAL;
 
 	return pw_resource_notify(resource, struct pw_core_methods, pong, 0, id, seq);
@@ -1927,6 +1931,72 @@ static int registry_marshal_destroy(void *object, uint32_t id)
 	return pw_protocol_native_end_proxy(proxy, b);
 }
 
+static int protocol_stats_method_marshal_add_listener(void *object,
+			struct spa_hook *listener,
+			const struct pw_protocol_stats_events *events,
+			void *data)
+{
+	struct pw_proxy *proxy = object;
+	pw_proxy_add_object_listener(proxy, listener, events, data);
+	return 0;
+}
+
+static int protocol_stats_method_marshal_get_stats(void *object, uint32_t flags)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_begin_proxy(proxy, PW_PROTOCOL_STATS_METHOD_GET_STATS, NULL);
+
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Int(flags));
+
+	return pw_protocol_native_end_proxy(proxy, b);
+}
+
+static int protocol_stats_method_demarshal_get_stats(void *object,
+		const struct pw_protocol_native_message *msg)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_parser prs;
+	uint32_t flags;
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+				SPA_POD_Int(&flags)) < 0)
+		return -EINVAL;
+
+	return pw_resource_notify(resource, struct pw_protocol_stats_methods, get_stats, 0, flags);
+}
+
+static void protocol_stats_event_marshal_stats(void *object, const struct spa_pod *stats)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_begin_resource(resource, PW_PROTOCOL_STATS_EVENT_STATS, NULL);
+
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Pod(stats));
+
+	pw_protocol_native_end_resource(resource, b);
+}
+
+static int protocol_stats_event_demarshal_stats(void *object,
+		const struct pw_protocol_native_message *msg)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_parser prs;
+	struct spa_pod *stats;
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+				SPA_POD_Pod(&stats)) < 0)
+		return -EINVAL;
+
+	return pw_proxy_notify(proxy, struct pw_protocol_stats_events, stats, 0, stats);
+}
+
 static const struct pw_core_methods pw_protocol_native_core_method_marshal = {
 	PW_VERSION_CORE_METHODS,
 	.add_listener = &core_method_marshal_add_listener,
@@ -2299,6 +2369,42 @@ static const struct pw_protocol_marshal pw_protocol_native_link_marshal = {
 	.client_demarshal = pw_protocol_native_link_event_demarshal,
 };
 
+static const struct pw_protocol_stats_methods pw_protocol_native_protocol_stats_method_marshal = {
+	PW_VERSION_PROTOCOL_STATS_METHODS,
+	.add_listener = &protocol_stats_method_marshal_add_listener,
+	.get_stats = &protocol_stats_method_marshal_get_stats,
+};
+
+static const struct pw_protocol_native_demarshal
+pw_protocol_native_protocol_stats_method_demarshal[PW_PROTOCOL_STATS_METHOD_NUM] =
+{
+	[PW_PROTOCOL_STATS_METHOD_ADD_LISTENER] = { NULL, 0, },
+	[PW_PROTOCOL_STATS_METHOD_GET_STATS] = { &protocol_stats_method_demarshal_get_stats, 0, },
+};
+
+static const struct pw_protocol_stats_events pw_protocol_native_protocol_stats_event_marshal = {
+	PW_VERSION_PROTOCOL_STATS_EVENTS,
+	.stats = &protocol_stats_event_marshal_stats,
+};
+
+static const struct pw_protocol_native_demarshal
+pw_protocol_native_protocol_stats_event_demarshal[PW_PROTOCOL_STATS_EVENT_NUM] =
+{
+	[PW_PROTOCOL_STATS_EVENT_STATS] = { &protocol_stats_event_demarshal_stats, 0, }
+};
+
+static const struct pw_protocol_marshal pw_protocol_native_protocol_stats_marshal = {
+	PW_TYPE_INTERFACE_ProtocolStats,
+	PW_VERSION_PROTOCOL_STATS,
+	0,
+	PW_PROTOCOL_STATS_METHOD_NUM,
+	PW_PROTOCOL_STATS_EVENT_NUM,
+	.client_marshal = &pw_protocol_native_protocol_stats_method_marshal,
+	.server_demarshal = pw_protocol_native_protocol_stats_method_demarshal,
+	.server_marshal = &pw_protocol_native_protocol_stats_event_marshal,
+	.client_demarshal = pw_protocol_native_protocol_stats_event_demarshal,
+};
+
 void pw_protocol_native_init(struct pw_protocol *protocol)
 {
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_core_marshal);
@@ -2310,4 +2416,5 @@ void pw_protocol_native_init(struct pw_protocol *protocol)
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_factory_marshal);
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_client_marshal);
 	pw_protocol_add_marshal(protocol, &pw_protocol_native_link_marshal);
+	pw_protocol_add_marshal(protocol, &pw_protocol_native_protocol_stats_marshal);
 }
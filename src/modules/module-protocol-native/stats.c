@@ -0,0 +1,378 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <spa/pod/builder.h>
+
+#include <pipewire/impl.h>
+#include <extensions/protocol-stats.h>
+
+#include "stats.h"
+
+#define NAME "protocol-stats"
+
+/* initial size of the marshal index, the protocol has fewer interfaces */
+#define IFACE_MIN_SLOTS	64u
+
+#define pw_protocol_stats_resource(r,m,v,...)	\
+	pw_resource_call(r,struct pw_protocol_stats_events,m,v,__VA_ARGS__)
+
+#define pw_protocol_stats_resource_stats(r,...)	\
+	pw_protocol_stats_resource(r,stats,0,__VA_ARGS__)
+
+/** counters of one interface marshal */
+struct iface_stats {
+	struct spa_list link;
+	const struct pw_protocol_marshal *marshal;
+	struct protocol_stats_counter *methods;
+	struct protocol_stats_counter *events;
+};
+
+struct protocol_stats {
+	struct pw_context *context;
+	struct pw_global *global;
+
+	struct spa_list conn_list;
+	struct spa_list iface_list;
+
+	/* open addressed index of iface_list by marshal, at most half full */
+	struct iface_stats **iface_index;
+	uint32_t index_mask;
+	uint32_t n_ifaces;
+
+	uint32_t n_resources;
+};
+
+struct resource_data {
+	struct protocol_stats *stats;
+
+	struct pw_resource *resource;
+	struct spa_hook resource_listener;
+	struct spa_hook object_listener;
+};
+
+static inline uint32_t marshal_hash(const struct pw_protocol_marshal *marshal)
+{
+	uintptr_t p = (uintptr_t)marshal;
+	return (uint32_t)((p >> 4) ^ (p >> 16));
+}
+
+static void index_insert(struct iface_stats **index, uint32_t mask, struct iface_stats *i)
+{
+	uint32_t h = marshal_hash(i->marshal) & mask;
+
+	while (index[h] != NULL)
+		h = (h + 1) & mask;
+	index[h] = i;
+}
+
+static int grow_index(struct protocol_stats *stats)
+{
+	struct iface_stats **index, *i;
+	uint32_t mask = stats->index_mask * 2 + 1;
+
+	index = calloc(mask + 1, sizeof(struct iface_stats *));
+	if (index == NULL)
+		return -errno;
+
+	spa_list_for_each(i, &stats->iface_list, link)
+		index_insert(index, mask, i);
+
+	free(stats->iface_index);
+	stats->iface_index = index;
+	stats->index_mask = mask;
+	return 0;
+}
+
+/* only done once for each interface, the first time one of its messages
+ * is seen */
+static struct iface_stats *add_iface(struct protocol_stats *stats,
+		const struct pw_protocol_marshal *marshal)
+{
+	struct iface_stats *i;
+
+	if ((stats->n_ifaces + 1) * 2 > stats->index_mask + 1 &&
+	    grow_index(stats) < 0)
+		return NULL;
+
+	i = calloc(1, sizeof(struct iface_stats) +
+		(marshal->n_client_methods + marshal->n_server_methods) *
+		sizeof(struct protocol_stats_counter));
+	if (i == NULL)
+		return NULL;
+
+	i->marshal = marshal;
+	i->methods = SPA_MEMBER(i, sizeof(struct iface_stats), struct protocol_stats_counter);
+	i->events = &i->methods[marshal->n_client_methods];
+	spa_list_append(&stats->iface_list, &i->link);
+	index_insert(stats->iface_index, stats->index_mask, i);
+	stats->n_ifaces++;
+	return i;
+}
+
+static struct iface_stats *find_iface(struct protocol_stats *stats,
+		const struct pw_protocol_marshal *marshal)
+{
+	struct iface_stats *i;
+	uint32_t h = marshal_hash(marshal) & stats->index_mask;
+
+	while ((i = stats->iface_index[h]) != NULL) {
+		if (i->marshal == marshal)
+			return i;
+		h = (h + 1) & stats->index_mask;
+	}
+	return add_iface(stats, marshal);
+}
+
+struct protocol_stats_counter *
+protocol_stats_get_counter(struct protocol_stats *stats,
+		const struct pw_protocol_marshal *marshal, bool event, uint32_t opcode)
+{
+	struct iface_stats *i;
+
+	if ((i = find_iface(stats, marshal)) == NULL)
+		return NULL;
+
+	if (event)
+		return opcode < marshal->n_server_methods ? &i->events[opcode] : NULL;
+	else
+		return opcode < marshal->n_client_methods ? &i->methods[opcode] : NULL;
+}
+
+bool protocol_stats_is_timing(struct protocol_stats *stats)
+{
+	return stats->n_resources > 0;
+}
+
+void protocol_stats_add_conn(struct protocol_stats *stats, struct protocol_stats_conn *conn)
+{
+	spa_list_append(&stats->conn_list, &conn->link);
+}
+
+void protocol_stats_remove_conn(struct protocol_stats *stats, struct protocol_stats_conn *conn)
+{
+	spa_list_remove(&conn->link);
+}
+
+static int builder_overflow(void *data, uint32_t size)
+{
+	struct spa_pod_builder *b = data;
+	void *d;
+
+	size = SPA_ROUND_UP_N(size, 4096);
+	if ((d = realloc(b->data, size)) == NULL)
+		return -errno;
+	b->data = d;
+	b->size = size;
+	return 0;
+}
+
+static const struct spa_pod_builder_callbacks builder_callbacks = {
+	SPA_VERSION_POD_BUILDER_CALLBACKS,
+	.overflow = builder_overflow
+};
+
+static void add_counter(struct spa_pod_builder *b, const struct protocol_stats_counter *c,
+		bool time)
+{
+	spa_pod_builder_long(b, c->messages);
+	spa_pod_builder_long(b, c->bytes);
+	spa_pod_builder_long(b, c->fds);
+	if (time)
+		spa_pod_builder_long(b, c->time);
+}
+
+static void add_opcodes(struct spa_pod_builder *b, const struct iface_stats *i,
+		bool event)
+{
+	const struct protocol_stats_counter *c = event ? i->events : i->methods;
+	uint32_t o, n = event ? i->marshal->n_server_methods : i->marshal->n_client_methods;
+
+	for (o = 0; o < n; o++) {
+		if (c[o].messages == 0)
+			continue;
+		spa_pod_builder_string(b, i->marshal->type);
+		spa_pod_builder_int(b, event ? 1 : 0);
+		spa_pod_builder_int(b, o);
+		add_counter(b, &c[o], true);
+	}
+}
+
+static int stats_get_stats(void *object, uint32_t flags)
+{
+	struct resource_data *data = object;
+	struct protocol_stats *stats = data->stats;
+	struct protocol_stats_conn *conn;
+	struct iface_stats *i;
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(NULL, 0);
+	struct spa_pod_frame f[2];
+	struct spa_pod *pod;
+
+	spa_pod_builder_set_callbacks(&b, &builder_callbacks, &b);
+
+	spa_pod_builder_push_struct(&b, &f[0]);
+
+	spa_pod_builder_push_struct(&b, &f[1]);
+	spa_list_for_each(conn, &stats->conn_list, link) {
+		struct pw_global *global = pw_impl_client_get_global(conn->client);
+		spa_pod_builder_int(&b, global ? pw_global_get_id(global) : SPA_ID_INVALID);
+		add_counter(&b, &conn->in, true);
+		add_counter(&b, &conn->out, true);
+	}
+	spa_pod_builder_pop(&b, &f[1]);
+
+	spa_pod_builder_push_struct(&b, &f[1]);
+	spa_list_for_each(i, &stats->iface_list, link) {
+		add_opcodes(&b, i, false);
+		add_opcodes(&b, i, true);
+	}
+	spa_pod_builder_pop(&b, &f[1]);
+
+	pod = spa_pod_builder_pop(&b, &f[0]);
+	if (pod == NULL) {
+		free(b.data);
+		return -ENOMEM;
+	}
+
+	pw_protocol_stats_resource_stats(data->resource, pod);
+
+	free(b.data);
+
+	if (flags & PW_PROTOCOL_STATS_FLAG_RESET) {
+		spa_list_for_each(conn, &stats->conn_list, link) {
+			spa_zero(conn->in);
+			spa_zero(conn->out);
+		}
+		spa_list_for_each(i, &stats->iface_list, link) {
+			memset(i->methods, 0, (i->marshal->n_client_methods +
+					i->marshal->n_server_methods) *
+					sizeof(struct protocol_stats_counter));
+		}
+	}
+	return 0;
+}
+
+static const struct pw_protocol_stats_methods stats_methods = {
+	PW_VERSION_PROTOCOL_STATS_METHODS,
+	.get_stats = stats_get_stats,
+};
+
+static void resource_destroy(void *data)
+{
+	struct resource_data *d = data;
+
+	spa_hook_remove(&d->resource_listener);
+	spa_hook_remove(&d->object_listener);
+
+	if (--d->stats->n_resources == 0)
+		pw_log_debug(NAME" %p: stop timing", d->stats);
+}
+
+static const struct pw_resource_events resource_events = {
+	PW_VERSION_RESOURCE_EVENTS,
+	.destroy = resource_destroy,
+};
+
+static int
+global_bind(void *_data, struct pw_impl_client *client, uint32_t permissions,
+		uint32_t version, uint32_t id)
+{
+	struct protocol_stats *stats = _data;
+	struct pw_resource *resource;
+	struct resource_data *data;
+
+	resource = pw_resource_new(client, id, permissions,
+			PW_TYPE_INTERFACE_ProtocolStats, version, sizeof(*data));
+	if (resource == NULL)
+		return -errno;
+
+	data = pw_resource_get_user_data(resource);
+	data->stats = stats;
+	data->resource = resource;
+	pw_global_add_resource(stats->global, resource);
+
+	pw_resource_add_listener(resource, &data->resource_listener,
+			&resource_events, data);
+	pw_resource_add_object_listener(resource, &data->object_listener,
+			&stats_methods, data);
+
+	if (stats->n_resources++ == 0)
+		pw_log_debug(NAME" %p: start timing", stats);
+
+	return 0;
+}
+
+struct protocol_stats *protocol_stats_new(struct pw_context *context)
+{
+	struct protocol_stats *stats;
+
+	stats = calloc(1, sizeof(struct protocol_stats));
+	if (stats == NULL)
+		return NULL;
+
+	stats->context = context;
+	spa_list_init(&stats->conn_list);
+	spa_list_init(&stats->iface_list);
+
+	stats->iface_index = calloc(IFACE_MIN_SLOTS, sizeof(struct iface_stats *));
+	if (stats->iface_index == NULL) {
+		free(stats);
+		return NULL;
+	}
+	stats->index_mask = IFACE_MIN_SLOTS - 1;
+
+	stats->global = pw_global_new(context,
+			PW_TYPE_INTERFACE_ProtocolStats,
+			PW_VERSION_PROTOCOL_STATS,
+			NULL,
+			global_bind, stats);
+	if (stats->global == NULL) {
+		free(stats->iface_index);
+		free(stats);
+		return NULL;
+	}
+	pw_global_register(stats->global);
+
+	return stats;
+}
+
+void protocol_stats_destroy(struct protocol_stats *stats)
+{
+	struct iface_stats *i;
+	struct protocol_stats_conn *conn;
+
+	pw_global_destroy(stats->global);
+
+	spa_list_consume(conn, &stats->conn_list, link)
+		spa_list_remove(&conn->link);
+	spa_list_consume(i, &stats->iface_list, link) {
+		spa_list_remove(&i->link);
+		free(i);
+	}
+	free(stats->iface_index);
+	free(stats);
+}
@@ -0,0 +1,91 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PIPEWIRE_PROTOCOL_NATIVE_STATS_H
+#define PIPEWIRE_PROTOCOL_NATIVE_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <time.h>
+
+#include <spa/utils/list.h>
+
+#include <pipewire/impl.h>
+
+struct protocol_stats_counter {
+	uint64_t messages;
+	uint64_t bytes;
+	uint64_t fds;
+	uint64_t time;
+};
+
+/** traffic on one client connection */
+struct protocol_stats_conn {
+	struct spa_list link;
+	struct pw_impl_client *client;
+	struct protocol_stats_counter in;
+	struct protocol_stats_counter out;
+};
+
+struct protocol_stats;
+
+struct protocol_stats *protocol_stats_new(struct pw_context *context);
+void protocol_stats_destroy(struct protocol_stats *stats);
+
+void protocol_stats_add_conn(struct protocol_stats *stats, struct protocol_stats_conn *conn);
+void protocol_stats_remove_conn(struct protocol_stats *stats, struct protocol_stats_conn *conn);
+
+/** get the counter for received methods (\a event false) or sent events
+ * (\a event true) of an interface, NULL when out of memory or the opcode
+ * is invalid */
+struct protocol_stats_counter *
+protocol_stats_get_counter(struct protocol_stats *stats,
+		const struct pw_protocol_marshal *marshal, bool event, uint32_t opcode);
+
+/** true when time should be measured */
+bool protocol_stats_is_timing(struct protocol_stats *stats);
+
+static inline uint64_t protocol_stats_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static inline void protocol_stats_counter_add(struct protocol_stats_counter *c,
+		uint32_t bytes, uint32_t fds, uint64_t time)
+{
+	c->messages++;
+	c->bytes += bytes;
+	c->fds += fds;
+	c->time += time;
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* PIPEWIRE_PROTOCOL_NATIVE_STATS_H */
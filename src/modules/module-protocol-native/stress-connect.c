@@ -0,0 +1,158 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+/* Connects bursts of raw sockets to a server in the same process and
+ * measures how fast the server turns them into registered clients. */
+
+#define N_CLIENTS	512
+#define N_ROUNDS	8
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct spa_hook context_listener;
+
+	char path[108];
+
+	pthread_t thread;
+	int fds[N_CLIENTS];
+
+	uint32_t n_clients;
+};
+
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void *connect_thread(void *arg)
+{
+	struct data *d = arg;
+	struct sockaddr_un addr;
+	int i;
+
+	spa_zero(addr);
+	addr.sun_family = AF_LOCAL;
+	snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", d->path);
+
+	for (i = 0; i < N_CLIENTS; i++) {
+		d->fds[i] = socket(PF_LOCAL, SOCK_STREAM | SOCK_CLOEXEC, 0);
+		spa_assert(d->fds[i] >= 0);
+		if (connect(d->fds[i], (struct sockaddr *) &addr, sizeof(addr)) < 0) {
+			fprintf(stderr, "connect to %s failed: %m\n", d->path);
+			exit(1);
+		}
+	}
+	return NULL;
+}
+
+static void global_added(void *data, struct pw_global *global)
+{
+	struct data *d = data;
+
+	if (!pw_global_is_type(global, PW_TYPE_INTERFACE_Client))
+		return;
+
+	if (++d->n_clients == N_CLIENTS)
+		pw_main_loop_quit(d->loop);
+}
+
+static const struct pw_context_events context_events = {
+	PW_VERSION_CONTEXT_EVENTS,
+	.global_added = global_added,
+};
+
+static void run_round(struct data *d, int round)
+{
+	uint64_t t1, t2;
+	int i;
+
+	d->n_clients = 0;
+
+	t1 = get_time_ns();
+	pthread_create(&d->thread, NULL, connect_thread, d);
+	pw_main_loop_run(d->loop);
+	t2 = get_time_ns();
+	pthread_join(d->thread, NULL);
+
+	fprintf(stderr, "round %d: %d clients in %"PRIu64" ns = %"PRIu64" connects/sec\n",
+			round, N_CLIENTS, t2 - t1,
+			N_CLIENTS * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1));
+
+	for (i = 0; i < N_CLIENTS; i++)
+		close(d->fds[i]);
+
+	/* let the server notice the hangups */
+	while (pw_loop_iterate(pw_main_loop_get_loop(d->loop), 100) > 0);
+}
+
+int main(int argc, char *argv[])
+{
+	struct data data = { 0, };
+	const char *runtime_dir;
+	int i;
+
+	pw_init(&argc, &argv);
+
+	runtime_dir = getenv("XDG_RUNTIME_DIR");
+	if (runtime_dir == NULL)
+		runtime_dir = "/tmp";
+
+	snprintf(data.path, sizeof(data.path), "%s/pipewire-stress-%d",
+			runtime_dir, getpid());
+
+	data.loop = pw_main_loop_new(NULL);
+	data.context = pw_context_new(pw_main_loop_get_loop(data.loop),
+			pw_properties_new(
+				PW_KEY_CORE_DAEMON, "true",
+				PW_KEY_CORE_NAME, data.path,
+				NULL), 0);
+	spa_assert(data.context != NULL);
+
+	pw_context_add_listener(data.context, &data.context_listener,
+			&context_events, &data);
+
+	for (i = 0; i < N_ROUNDS; i++)
+		run_round(&data, i);
+
+	spa_hook_remove(&data.context_listener);
+	pw_context_destroy(data.context);
+	pw_main_loop_destroy(data.loop);
+
+	return 0;
+}
@@ -31,6 +31,7 @@
 #include <pipewire/pipewire.h>
 
 #include "connection.h"
+#include "fixed-pod.h"
 
 static void test_create(struct pw_protocol_native_connection *conn)
 {
@@ -119,6 +120,54 @@ static void test_read_write(struct pw_protocol_native_connection *in,
 	spa_assert(read_message(in) == -1);
 }
 
+static void test_fixed_pod(void)
+{
+	static const struct fixed_pod_layout layout =
+		FIXED_POD_LAYOUT(SPA_TYPE_Int, SPA_TYPE_Fd, SPA_TYPE_Id, SPA_TYPE_Int);
+	uint8_t buf1[256], buf2[256];
+	struct spa_pod_builder b1 = SPA_POD_BUILDER_INIT(buf1, sizeof(buf1));
+	struct spa_pod_builder b2 = SPA_POD_BUILDER_INIT(buf2, sizeof(buf2));
+	struct spa_pod_parser prs;
+	struct spa_pod_frame f;
+	int64_t v[4];
+
+	spa_memzero(buf1, sizeof(buf1));
+	spa_memzero(buf2, sizeof(buf2));
+
+	spa_pod_builder_add_struct(&b1,
+			SPA_POD_Int(-1),
+			SPA_POD_Fd(3),
+			SPA_POD_Id(SPA_ID_INVALID),
+			SPA_POD_Int(42));
+	fixed_pod_builder_add_struct(&b2, &layout,
+			(int64_t[]) { -1, 3, SPA_ID_INVALID, 42 });
+
+	spa_assert(b1.state.offset == b2.state.offset);
+	spa_assert(memcmp(buf1, buf2, b1.state.offset) == 0);
+
+	spa_assert(fixed_pod_parse_struct(buf1, b1.state.offset, &layout, v) == 0);
+	spa_assert(v[0] == -1);
+	spa_assert(v[1] == 3);
+	spa_assert(v[2] == SPA_ID_INVALID);
+	spa_assert(v[3] == 42);
+
+	spa_pod_parser_init(&prs, buf1, b1.state.offset);
+	spa_assert(spa_pod_parser_push_struct(&prs, &f) == 0);
+	spa_assert(fixed_pod_parser_get(&prs, &layout, v) == 0);
+	spa_assert(fixed_pod_parser_get(&prs, &layout, v) == -EINVAL);
+	spa_pod_parser_pop(&prs, &f);
+
+	/* a different layout is rejected so that the caller can fall back */
+	spa_pod_builder_init(&b1, buf1, sizeof(buf1));
+	spa_pod_builder_add_struct(&b1,
+			SPA_POD_Int(1),
+			SPA_POD_Long(3),
+			SPA_POD_Id(2),
+			SPA_POD_Int(42));
+	spa_assert(fixed_pod_parse_struct(buf1, b1.state.offset, &layout, v) == -EINVAL);
+	spa_assert(fixed_pod_parse_struct(buf1, 8, &layout, v) == -EINVAL);
+}
+
 int main(int argc, char *argv[])
 {
 	struct pw_main_loop *loop;
@@ -144,6 +193,7 @@ int main(int argc, char *argv[])
 	test_create(in);
 	test_create(out);
 	test_read_write(in, out);
+	test_fixed_pod();
 
 	return 0;
 }
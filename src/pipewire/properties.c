@@ -24,49 +24,476 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <pthread.h>
 
 #include "pipewire/array.h"
 #include "pipewire/utils.h"
 #include "pipewire/properties.h"
+#include "pipewire/keys.h"
 
 /** \cond */
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	uint32_t *index;	/**< open addressing hash index, item index + 1
+				  *  or 0 for a free slot */
+	uint32_t index_mask;
+};
+
+/* The hash index is only built when there are enough items to make
+ * it faster than a scan */
+#define INDEX_MIN_ITEMS		8
+
+/* Keys are interned in a process wide table so that the same key used by
+ * many properties is only stored once. The hash of the key is stored in
+ * front of the string so that lookups can compare hashes and pointers
+ * before falling back to strcmp. */
+struct intern {
+	struct intern *next;
+	uint32_t hash;
+	uint32_t ref;
+	unsigned int is_static:1;	/**< a well-known key, never freed */
+	char str[];
 };
+
+#define INTERN_MIN_BUCKETS	256u
+
+static struct {
+	pthread_mutex_t lock;
+	struct intern **buckets;
+	uint32_t n_buckets;
+	uint32_t n_items;
+} intern_table = { PTHREAD_MUTEX_INITIALIZER, };
+
+/* The well-known keys are interned once, before any other key, in a table
+ * that does not change afterwards. Looking them up and releasing them
+ * takes no lock, only other keys use the locked table. */
+static const char * const well_known_keys[] = {
+	PW_KEY_USER_NAME,
+	PW_KEY_HOST_NAME,
+	PW_KEY_CORE_NAME,
+	PW_KEY_CORE_VERSION,
+	PW_KEY_CORE_DAEMON,
+	PW_KEY_PROTOCOL,
+	PW_KEY_ACCESS,
+	PW_KEY_SEC_PID,
+	PW_KEY_SEC_UID,
+	PW_KEY_SEC_GID,
+	PW_KEY_SEC_LABEL,
+	PW_KEY_LIBRARY_NAME_SYSTEM,
+	PW_KEY_LIBRARY_NAME_LOOP,
+	PW_KEY_LIBRARY_NAME_DBUS,
+	PW_KEY_OBJECT_PATH,
+	PW_KEY_OBJECT_ID,
+	PW_KEY_CONTEXT_PROFILE_MODULES,
+	PW_KEY_CORE_ID,
+	PW_KEY_CORE_MONITORS,
+	PW_KEY_CPU_MAX_ALIGN,
+	PW_KEY_CPU_CORES,
+	PW_KEY_PRIORITY_SESSION,
+	PW_KEY_PRIORITY_MASTER,
+	PW_KEY_REMOTE_NAME,
+	PW_KEY_REMOTE_INTENTION,
+	PW_KEY_APP_NAME,
+	PW_KEY_APP_ID,
+	PW_KEY_APP_VERSION,
+	PW_KEY_APP_ICON,
+	PW_KEY_APP_ICON_NAME,
+	PW_KEY_APP_LANGUAGE,
+	PW_KEY_APP_PROCESS_ID,
+	PW_KEY_APP_PROCESS_BINARY,
+	PW_KEY_APP_PROCESS_USER,
+	PW_KEY_APP_PROCESS_HOST,
+	PW_KEY_APP_PROCESS_MACHINE_ID,
+	PW_KEY_APP_PROCESS_SESSION_ID,
+	PW_KEY_WINDOW_X11_DISPLAY,
+	PW_KEY_CLIENT_ID,
+	PW_KEY_CLIENT_NAME,
+	PW_KEY_CLIENT_API,
+	PW_KEY_NODE_ID,
+	PW_KEY_NODE_NAME,
+	PW_KEY_NODE_NICK,
+	PW_KEY_NODE_DESCRIPTION,
+	PW_KEY_NODE_PLUGGED,
+	PW_KEY_NODE_SESSION,
+	PW_KEY_NODE_EXCLUSIVE,
+	PW_KEY_NODE_AUTOCONNECT,
+	PW_KEY_NODE_TARGET,
+	PW_KEY_NODE_LATENCY,
+	PW_KEY_NODE_DONT_RECONNECT,
+	PW_KEY_NODE_ALWAYS_PROCESS,
+	PW_KEY_NODE_PAUSE_ON_IDLE,
+	PW_KEY_NODE_DRIVER,
+	PW_KEY_NODE_STREAM,
+	PW_KEY_PORT_ID,
+	PW_KEY_PORT_NAME,
+	PW_KEY_PORT_DIRECTION,
+	PW_KEY_PORT_ALIAS,
+	PW_KEY_PORT_PHYSICAL,
+	PW_KEY_PORT_TERMINAL,
+	PW_KEY_PORT_CONTROL,
+	PW_KEY_PORT_MONITOR,
+	PW_KEY_LINK_ID,
+	PW_KEY_LINK_INPUT_NODE,
+	PW_KEY_LINK_INPUT_PORT,
+	PW_KEY_LINK_OUTPUT_NODE,
+	PW_KEY_LINK_OUTPUT_PORT,
+	PW_KEY_LINK_PASSIVE,
+	PW_KEY_DEVICE_ID,
+	PW_KEY_DEVICE_NAME,
+	PW_KEY_DEVICE_PLUGGED,
+	PW_KEY_DEVICE_NICK,
+	PW_KEY_DEVICE_STRING,
+	PW_KEY_DEVICE_API,
+	PW_KEY_DEVICE_DESCRIPTION,
+	PW_KEY_DEVICE_BUS_PATH,
+	PW_KEY_DEVICE_SERIAL,
+	PW_KEY_DEVICE_VENDOR_ID,
+	PW_KEY_DEVICE_VENDOR_NAME,
+	PW_KEY_DEVICE_PRODUCT_ID,
+	PW_KEY_DEVICE_PRODUCT_NAME,
+	PW_KEY_DEVICE_CLASS,
+	PW_KEY_DEVICE_FORM_FACTOR,
+	PW_KEY_DEVICE_BUS,
+	PW_KEY_DEVICE_SUBSYSTEM,
+	PW_KEY_DEVICE_ICON,
+	PW_KEY_DEVICE_ICON_NAME,
+	PW_KEY_DEVICE_INTENDED_ROLES,
+	PW_KEY_MODULE_ID,
+	PW_KEY_MODULE_NAME,
+	PW_KEY_MODULE_AUTHOR,
+	PW_KEY_MODULE_DESCRIPTION,
+	PW_KEY_MODULE_USAGE,
+	PW_KEY_MODULE_VERSION,
+	PW_KEY_FACTORY_ID,
+	PW_KEY_FACTORY_NAME,
+	PW_KEY_FACTORY_USAGE,
+	PW_KEY_FACTORY_TYPE_NAME,
+	PW_KEY_FACTORY_TYPE_VERSION,
+	PW_KEY_STREAM_IS_LIVE,
+	PW_KEY_STREAM_LATENCY_MIN,
+	PW_KEY_STREAM_LATENCY_MAX,
+	PW_KEY_STREAM_MONITOR,
+	PW_KEY_OBJECT_LINGER,
+	PW_KEY_MEDIA_TYPE,
+	PW_KEY_MEDIA_CATEGORY,
+	PW_KEY_MEDIA_ROLE,
+	PW_KEY_MEDIA_CLASS,
+	PW_KEY_MEDIA_NAME,
+	PW_KEY_MEDIA_TITLE,
+	PW_KEY_MEDIA_ARTIST,
+	PW_KEY_MEDIA_COPYRIGHT,
+	PW_KEY_MEDIA_SOFTWARE,
+	PW_KEY_MEDIA_LANGUAGE,
+	PW_KEY_MEDIA_FILENAME,
+	PW_KEY_MEDIA_ICON,
+	PW_KEY_MEDIA_ICON_NAME,
+	PW_KEY_FORMAT_DSP,
+	PW_KEY_AUDIO_CHANNEL,
+	PW_KEY_AUDIO_RATE,
+	PW_KEY_AUDIO_CHANNELS,
+	PW_KEY_AUDIO_FORMAT,
+	PW_KEY_VIDEO_RATE,
+	PW_KEY_VIDEO_FORMAT,
+	PW_KEY_VIDEO_SIZE,
+};
+
+#define STATIC_SLOTS	512u
+
+static pthread_once_t static_once = PTHREAD_ONCE_INIT;
+static struct intern *static_index[STATIC_SLOTS];
 /** \endcond */
 
-static int add_func(struct pw_properties *this, char *key, char *value)
+static inline uint32_t key_hash(const char *key)
+{
+	uint32_t hash = 2166136261u;
+	while (*key)
+		hash = (hash ^ (uint8_t)*key++) * 16777619u;
+	return hash;
+}
+
+static inline struct intern *key_intern(const char *key)
+{
+	return SPA_CONTAINER_OF(key, struct intern, str);
+}
+
+static int intern_resize(uint32_t n_buckets)
+{
+	struct intern **buckets, *in, *next;
+	uint32_t i;
+
+	buckets = calloc(n_buckets, sizeof(struct intern *));
+	if (buckets == NULL)
+		return -errno;
+
+	for (i = 0; i < intern_table.n_buckets; i++) {
+		for (in = intern_table.buckets[i]; in; in = next) {
+			struct intern **b = &buckets[in->hash & (n_buckets - 1)];
+			next = in->next;
+			in->next = *b;
+			*b = in;
+		}
+	}
+	free(intern_table.buckets);
+	intern_table.buckets = buckets;
+	intern_table.n_buckets = n_buckets;
+	return 0;
+}
+
+static void static_keys_init(void)
+{
+	struct intern *in;
+	uint32_t i, pos;
+	size_t len;
+
+	/* the table is kept at most half full, a key that does not fit or
+	 * can't be allocated is interned in the locked table instead */
+	for (i = 0; i < SPA_N_ELEMENTS(well_known_keys) && i * 2 < STATIC_SLOTS; i++) {
+		len = strlen(well_known_keys[i]) + 1;
+		if ((in = calloc(1, sizeof(struct intern) + len)) == NULL)
+			continue;
+
+		in->hash = key_hash(well_known_keys[i]);
+		in->is_static = true;
+		memcpy(in->str, well_known_keys[i], len);
+
+		for (pos = in->hash & (STATIC_SLOTS - 1); static_index[pos];
+		     pos = (pos + 1) & (STATIC_SLOTS - 1));
+		static_index[pos] = in;
+	}
+}
+
+static struct intern *static_find(const char *key, uint32_t hash)
+{
+	struct intern *in;
+	uint32_t pos;
+
+	pthread_once(&static_once, static_keys_init);
+
+	for (pos = hash & (STATIC_SLOTS - 1); (in = static_index[pos]);
+	     pos = (pos + 1) & (STATIC_SLOTS - 1)) {
+		if (in->hash == hash && strcmp(in->str, key) == 0)
+			return in;
+	}
+	return NULL;
+}
+
+static const char *key_ref(const char *key)
+{
+	struct intern *in = NULL, **b;
+	uint32_t hash = key_hash(key);
+	size_t len;
+
+	if ((in = static_find(key, hash)) != NULL)
+		return in->str;
+
+	pthread_mutex_lock(&intern_table.lock);
+	if (intern_table.n_items >= intern_table.n_buckets &&
+	    intern_resize(SPA_MAX(intern_table.n_buckets * 2, INTERN_MIN_BUCKETS)) < 0)
+		goto done;
+
+	b = &intern_table.buckets[hash & (intern_table.n_buckets - 1)];
+	for (in = *b; in; in = in->next) {
+		if (in->hash == hash && strcmp(in->str, key) == 0) {
+			in->ref++;
+			goto done;
+		}
+	}
+
+	len = strlen(key) + 1;
+	if ((in = malloc(sizeof(struct intern) + len)) == NULL)
+		goto done;
+
+	in->hash = hash;
+	in->ref = 1;
+	in->is_static = false;
+	memcpy(in->str, key, len);
+	in->next = *b;
+	*b = in;
+	intern_table.n_items++;
+done:
+	pthread_mutex_unlock(&intern_table.lock);
+	return in ? in->str : NULL;
+}
+
+static void key_unref(const char *key)
+{
+	struct intern *in = key_intern(key), **b;
+
+	if (in->is_static)
+		return;
+
+	pthread_mutex_lock(&intern_table.lock);
+	if (--in->ref == 0) {
+		b = &intern_table.buckets[in->hash & (intern_table.n_buckets - 1)];
+		while (*b != in)
+			b = &(*b)->next;
+		*b = in->next;
+		intern_table.n_items--;
+		free(in);
+	}
+	pthread_mutex_unlock(&intern_table.lock);
+}
+
+static inline bool key_equal(const char *k1, uint32_t hash, const char *k2)
+{
+	return k1 == k2 || (key_intern(k1)->hash == hash && strcmp(k1, k2) == 0);
+}
+
+static inline uint32_t item_hash(const struct properties *impl, uint32_t idx)
+{
+	return key_intern(pw_array_get_unchecked(&impl->items, idx, struct spa_dict_item)->key)->hash;
+}
+
+static void index_clear(struct properties *impl)
+{
+	free(impl->index);
+	impl->index = NULL;
+	impl->index_mask = 0;
+}
+
+static void index_insert(struct properties *impl, uint32_t hash, uint32_t idx)
+{
+	uint32_t pos;
+
+	for (pos = hash & impl->index_mask; impl->index[pos];
+	     pos = (pos + 1) & impl->index_mask);
+	impl->index[pos] = idx + 1;
+}
+
+static void index_rebuild(struct properties *impl)
+{
+	uint32_t i, size, n_items = impl->this.dict.n_items;
+
+	free(impl->index);
+	for (size = 16; size < n_items * 2; size <<= 1);
+
+	impl->index = calloc(size, sizeof(uint32_t));
+	if (impl->index == NULL) {
+		/* lookups fall back to a scan */
+		impl->index_mask = 0;
+		return;
+	}
+	impl->index_mask = size - 1;
+	for (i = 0; i < n_items; i++)
+		index_insert(impl, item_hash(impl, i), i);
+}
+
+/* the slot that points to item idx */
+static uint32_t index_find_slot(struct properties *impl, uint32_t idx)
+{
+	uint32_t pos;
+
+	for (pos = item_hash(impl, idx) & impl->index_mask; impl->index[pos] != idx + 1;
+	     pos = (pos + 1) & impl->index_mask);
+	return pos;
+}
+
+/* remove the slot at pos and shift back the following entries of the
+ * cluster so that no tombstones are needed */
+static void index_remove(struct properties *impl, uint32_t pos)
+{
+	uint32_t next, home, mask = impl->index_mask;
+
+	for (next = (pos + 1) & mask; impl->index[next]; next = (next + 1) & mask) {
+		home = item_hash(impl, impl->index[next] - 1) & mask;
+		if (((next - home) & mask) >= ((next - pos) & mask)) {
+			impl->index[pos] = impl->index[next];
+			pos = next;
+		}
+	}
+	impl->index[pos] = 0;
+}
+
+/* takes ownership of value */
+static int add_func(struct pw_properties *this, const char *key, char *value)
 {
 	struct spa_dict_item *item;
 	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 
-	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
-	if (item == NULL)
+	if (value == NULL)
 		return -errno;
 
+	if ((key = key_ref(key)) == NULL)
+		goto error;
+
+	item = pw_array_add(&impl->items, sizeof(struct spa_dict_item));
+	if (item == NULL) {
+		key_unref(key);
+		goto error;
+	}
+
 	item->key = key;
 	item->value = value;
 
 	this->dict.items = impl->items.data;
 	this->dict.n_items++;
+
+	if (impl->index != NULL && this->dict.n_items * 2 <= impl->index_mask + 1)
+		index_insert(impl, key_intern(key)->hash, this->dict.n_items - 1);
+	else if (this->dict.n_items >= INDEX_MIN_ITEMS)
+		index_rebuild(impl);
+
 	return 0;
+
+error:
+	free(value);
+	return -ENOMEM;
 }
 
 static void clear_item(struct spa_dict_item *item)
 {
-	free((char *) item->key);
+	key_unref(item->key);
 	free((char *) item->value);
 }
 
+static void remove_item(struct properties *impl, uint32_t idx)
+{
+	struct pw_properties *this = &impl->this;
+	uint32_t last = this->dict.n_items - 1;
+	struct spa_dict_item *item, *l;
+
+	item = pw_array_get_unchecked(&impl->items, idx, struct spa_dict_item);
+	l = pw_array_get_unchecked(&impl->items, last, struct spa_dict_item);
+
+	if (impl->index != NULL) {
+		index_remove(impl, index_find_slot(impl, idx));
+		if (idx != last)
+			impl->index[index_find_slot(impl, last)] = idx + 1;
+	}
+	clear_item(item);
+	*item = *l;
+	impl->items.size -= sizeof(struct spa_dict_item);
+	this->dict.n_items--;
+}
+
 static int find_index(const struct pw_properties *this, const char *key)
 {
+	const struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	const struct spa_dict_item *item;
-	item = spa_dict_lookup_item(&this->dict, key);
-	if (item == NULL)
+	uint32_t hash, pos;
+
+	if (key == NULL)
 		return -1;
-	return item - this->dict.items;
+
+	hash = key_hash(key);
+
+	if (impl->index != NULL) {
+		for (pos = hash & impl->index_mask; impl->index[pos];
+		     pos = (pos + 1) & impl->index_mask) {
+			item = &this->dict.items[impl->index[pos] - 1];
+			if (key_equal(item->key, hash, key))
+				return impl->index[pos] - 1;
+		}
+		return -1;
+	}
+	spa_dict_for_each(item, &this->dict) {
+		if (key_equal(item->key, hash, key))
+			return item - this->dict.items;
+	}
+	return -1;
 }
 
 static struct properties *properties_new(int prealloc)
@@ -106,7 +533,7 @@ struct pw_properties *pw_properties_new(const char *key, ...)
 	while (key != NULL) {
 		value = va_arg(varargs, char *);
 		if (value && key[0])
-			add_func(&impl->this, strdup(key), strdup(value));
+			add_func(&impl->this, key, strdup(value));
 		key = va_arg(varargs, char *);
 	}
 	va_end(varargs);
@@ -134,8 +561,7 @@ struct pw_properties *pw_properties_new_dict(const struct spa_dict *dict)
 	for (i = 0; i < dict->n_items; i++) {
 		const struct spa_dict_item *it = &dict->items[i];
 		if (it->key != NULL && it->key[0] && it->value != NULL)
-			add_func(&impl->this, strdup(it->key),
-				 strdup(it->value));
+			add_func(&impl->this, it->key, strdup(it->value));
 	}
 
 	return &impl->this;
@@ -179,6 +605,7 @@ pw_properties_new_string(const char *str)
 			*eq = '\0';
 			add_func(&impl->this, val, strdup(eq+1));
 		}
+		free(val);
 		s = pw_split_walk(str, " \t\n\r", &len, &state);
 	}
 	return &impl->this;
@@ -241,6 +668,7 @@ void pw_properties_clear(struct pw_properties *properties)
 		clear_item(item);
 	pw_array_reset(&impl->items);
 	properties->dict.n_items = 0;
+	index_clear(impl);
 }
 
 /** Update properties
@@ -348,7 +776,7 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 	if (index == -1) {
 		if (value == NULL)
 			return 0;
-		add_func(properties, strdup(key), copy ? strdup(value) : value);
+		add_func(properties, key, copy ? strdup(value) : value);
 	} else {
 		struct spa_dict_item *item =
 		    pw_array_get_unchecked(&impl->items, index, struct spa_dict_item);
@@ -360,14 +788,7 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 		}
 
 		if (value == NULL) {
-			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
-						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
-						     struct spa_dict_item);
-			clear_item(item);
-			item->key = last->key;
-			item->value = last->value;
-			impl->items.size -= sizeof(struct spa_dict_item);
-			properties->dict.n_items--;
+			remove_item(impl, index);
 		} else {
 			free((char *) item->value);
 			item->value = copy ? strdup(value) : value;
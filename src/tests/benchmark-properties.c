@@ -0,0 +1,157 @@
+/* PipeWire
+ *
+ * Copyright © 2020 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include <spa/utils/dict.h>
+
+#include <pipewire/properties.h>
+
+#define MAX_COUNT 100000
+#define MAX_ITEMS 1000
+
+static struct spa_dict_item items[MAX_ITEMS];
+static char values[MAX_ITEMS][32];
+static char keys[MAX_ITEMS][32];
+
+static void gen_values(void)
+{
+	uint32_t i, j, idx;
+	static const char chars[] = "abcdefghijklmnopqrstuvwxyz.:*ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+	for (i = 0; i < MAX_ITEMS; i++) {
+		for (j = 0; j < 32; j++) {
+			idx = random() % (sizeof(chars) - 1);
+			values[i][j] = chars[idx];
+		}
+		idx = random() % 16;
+		values[i][idx + 16] = 0;
+		/* lookups use a copy so that no pointer compare can succeed */
+		memcpy(keys[i], values[i], 32);
+	}
+}
+
+static void gen_dict(struct spa_dict *dict, uint32_t n_items)
+{
+	uint32_t i, idx;
+
+	for (i = 0; i < n_items; i++) {
+		idx = random() % MAX_ITEMS;
+		items[i] = SPA_DICT_ITEM_INIT(values[idx], values[idx]);
+	}
+	dict->items = items;
+	dict->n_items = n_items;
+	dict->flags = 0;
+}
+
+static inline const char *query_key(const struct spa_dict *dict, uint32_t idx)
+{
+	return keys[(dict->items[idx].key - values[0]) / 32];
+}
+
+static void test_query_dict(const struct spa_dict *dict)
+{
+	uint32_t i, idx;
+	const char *str;
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = random() % dict->n_items;
+		str = spa_dict_lookup(dict, query_key(dict, idx));
+		assert(strcmp(str, dict->items[idx].value) == 0);
+	}
+}
+
+static void test_query_properties(const struct spa_dict *dict, const struct pw_properties *props)
+{
+	uint32_t i, idx;
+	const char *str;
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = random() % dict->n_items;
+		str = pw_properties_get(props, query_key(dict, idx));
+		assert(strcmp(str, dict->items[idx].value) == 0);
+	}
+}
+
+static inline uint64_t get_time_ns(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void report(const char *name, uint32_t n_items, uint64_t t1, uint64_t t2, uint64_t base)
+{
+	fprintf(stderr, "%d %s: elapsed %"PRIu64" count %u = %"PRIu64"/sec %f speedup\n",
+			n_items, name, t2 - t1, MAX_COUNT,
+			MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+			(double)base / (t2 - t1));
+}
+
+static void test_lookup(struct spa_dict *dict)
+{
+	struct pw_properties *props;
+	uint64_t t1, t2, t3, linear;
+
+	t1 = get_time_ns();
+	test_query_dict(dict);
+	t2 = get_time_ns();
+	linear = t2 - t1;
+	report("spa_dict", dict->n_items, t1, t2, linear);
+
+	t1 = get_time_ns();
+	props = pw_properties_new_dict(dict);
+	t2 = get_time_ns();
+	assert(props != NULL);
+	test_query_properties(dict, props);
+	t3 = get_time_ns();
+	fprintf(stderr, "%d new_dict elapsed %"PRIu64"\n", dict->n_items, t2 - t1);
+	report("pw_properties", dict->n_items, t2, t3, linear);
+
+	pw_properties_free(props);
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_dict dict;
+	static const uint32_t sizes[] = { 4, 8, 10, 20, 50, 100, 200, 500 };
+	uint32_t i;
+
+	spa_zero(dict);
+	gen_values();
+
+	/* warmup */
+	gen_dict(&dict, 1000);
+	test_query_dict(&dict);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sizes); i++) {
+		gen_dict(&dict, sizes[i]);
+		test_lookup(&dict);
+	}
+	return 0;
+}
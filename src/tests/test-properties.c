@@ -23,6 +23,7 @@
  */
 
 #include <pipewire/properties.h>
+#include <pipewire/keys.h>
 
 static void test_abi(void)
 {
@@ -310,6 +311,97 @@ static void test_parse(void)
 	spa_assert(pw_properties_parse_double("1.234") == 1.234);
 }
 
+static void test_intern(void)
+{
+	struct pw_properties *p1, *p2;
+	const struct spa_dict_item *it1, *it2;
+	const char *key1;
+	char key[] = "node.name";
+
+	p1 = pw_properties_new("node.name", "foo", NULL);
+	spa_assert(p1 != NULL);
+	p2 = pw_properties_new_string("media.class=Audio/Sink node.name=bar");
+	spa_assert(p2 != NULL);
+	spa_assert(p2->dict.n_items == 2);
+
+	it1 = spa_dict_lookup_item(&p1->dict, "node.name");
+	it2 = spa_dict_lookup_item(&p2->dict, "node.name");
+	spa_assert(it1 != NULL && it2 != NULL);
+	spa_assert(it1->key == it2->key);
+	spa_assert(it1->key != key);
+	spa_assert(!strcmp(it1->value, "foo"));
+	spa_assert(!strcmp(it2->value, "bar"));
+
+	spa_assert(!strcmp(pw_properties_get(p1, key), "foo"));
+	spa_assert(!strcmp(pw_properties_get(p2, it1->key), "bar"));
+	spa_assert(pw_properties_get(p1, "node.nam") == NULL);
+	spa_assert(pw_properties_get(p1, "media.class") == NULL);
+
+	pw_properties_free(p1);
+	spa_assert(!strcmp(pw_properties_get(p2, "node.name"), "bar"));
+	spa_assert(pw_properties_set(p2, "node.name", NULL) == 1);
+	spa_assert(pw_properties_get(p2, "node.name") == NULL);
+	spa_assert(pw_properties_set(p2, "node.name", "baz") == 1);
+	spa_assert(!strcmp(pw_properties_get(p2, "node.name"), "baz"));
+	pw_properties_free(p2);
+
+	/* the well-known keys stay interned when no properties use them */
+	p1 = pw_properties_new(PW_KEY_MEDIA_CLASS, "Audio/Sink", "test.key", "1", NULL);
+	spa_assert(p1 != NULL);
+	it1 = spa_dict_lookup_item(&p1->dict, PW_KEY_MEDIA_CLASS);
+	spa_assert(it1 != NULL);
+	key1 = it1->key;
+	pw_properties_free(p1);
+
+	p2 = pw_properties_new("test.key", "2", PW_KEY_MEDIA_CLASS, "Video/Source", NULL);
+	spa_assert(p2 != NULL);
+	it2 = spa_dict_lookup_item(&p2->dict, PW_KEY_MEDIA_CLASS);
+	spa_assert(it2 != NULL);
+	spa_assert(it2->key == key1);
+	spa_assert(!strcmp(pw_properties_get(p2, "test.key"), "2"));
+	pw_properties_free(p2);
+}
+
+static void test_many(void)
+{
+	struct pw_properties *props;
+	char key[32], value[32];
+	const char *str;
+	int i;
+
+	props = pw_properties_new(NULL, NULL);
+	spa_assert(props != NULL);
+
+	for (i = 0; i < 500; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		spa_assert(pw_properties_setf(props, key, "%d", i) == 1);
+	}
+	spa_assert(props->dict.n_items == 500);
+
+	for (i = 0; i < 500; i += 3) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		spa_assert(pw_properties_set(props, key, NULL) == 1);
+	}
+	for (i = 0; i < 500; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		snprintf(value, sizeof(value), "%d", i);
+		str = pw_properties_get(props, key);
+		if (i % 3 == 0)
+			spa_assert(str == NULL);
+		else
+			spa_assert(str != NULL && !strcmp(str, value));
+		spa_assert(spa_dict_lookup(&props->dict, key) == str);
+	}
+	spa_assert(pw_properties_get(props, "key.500") == NULL);
+
+	pw_properties_clear(props);
+	spa_assert(pw_properties_get(props, "key.1") == NULL);
+	spa_assert(pw_properties_set(props, "key.1", "1") == 1);
+	spa_assert(!strcmp(pw_properties_get(props, "key.1"), "1"));
+
+	pw_properties_free(props);
+}
+
 int main(int argc, char *argv[])
 {
 	test_abi();
@@ -321,6 +413,8 @@ int main(int argc, char *argv[])
 	test_new_string();
 	test_update();
 	test_parse();
+	test_intern();
+	test_many();
 
 	return 0;
 }
@@ -40,6 +40,7 @@
 #include <pipewire/impl.h>
 
 #include <extensions/session-manager.h>
+#include <extensions/protocol-stats.h>
 
 static const char WHITESPACE[] = " \t";
 
@@ -265,6 +266,7 @@ static bool do_permissions(struct data *data, const char *cmd, char *args, char
 static bool do_get_permissions(struct data *data, const char *cmd, char *args, char **error);
 static bool do_dump(struct data *data, const char *cmd, char *args, char **error);
 static bool do_graph(struct data *data, const char *cmd, char *args, char **error);
+static bool do_protocol_stats(struct data *data, const char *cmd, char *args, char **error);
 
 #define DUMP_NAMES "Core|Module|Device|Node|Port|Factory|Client|Link|Session|Endpoint|EndpointStream|EndpointLink"
 
@@ -289,6 +291,7 @@ static struct command command_list[] = {
 	{ "dump", "D", "Dump objects in ways that are cleaner for humans to understand "
 		 "[short|deep|resolve|notype] [-sdrt] [all|"DUMP_NAMES"|<id>]", do_dump },
 	{ "graph", "g", "Display tree graph in YAML/JSON format. <path>", do_graph },
+	{ "protocol-stats", "ps", "Show protocol traffic statistics [reset]", do_protocol_stats },
 };
 
 static bool do_help(struct data *data, const char *cmd, char *args, char **error)
@@ -1501,6 +1504,70 @@ static const struct pw_link_events link_events = {
 	.info = link_event_info
 };
 
+static void protocol_stats_event_stats(void *object, const struct spa_pod *stats)
+{
+	struct proxy_data *pd = object;
+	struct remote_data *rd = pd->rd;
+	struct spa_pod_parser prs;
+	struct spa_pod_frame f[2];
+	int64_t c[8];
+	int32_t id, dir, opcode;
+	const char *type;
+
+	spa_pod_parser_pod(&prs, stats);
+	if (spa_pod_parser_push_struct(&prs, &f[0]) < 0)
+		goto invalid;
+
+	fprintf(stdout, "remote %d protocol stats %d\n", rd->id, pd->global->id);
+
+	if (spa_pod_parser_push_struct(&prs, &f[1]) < 0)
+		goto invalid;
+	fprintf(stdout, "  %-8s %10s %12s %6s %12s %10s %12s %6s %12s\n", "client",
+			"msg-in", "bytes-in", "fd-in", "time-in(ns)",
+			"msg-out", "bytes-out", "fd-out", "time-out(ns)");
+	while (spa_pod_parser_get(&prs,
+			SPA_POD_Int(&id),
+			SPA_POD_Long(&c[0]),
+			SPA_POD_Long(&c[1]),
+			SPA_POD_Long(&c[2]),
+			SPA_POD_Long(&c[3]),
+			SPA_POD_Long(&c[4]),
+			SPA_POD_Long(&c[5]),
+			SPA_POD_Long(&c[6]),
+			SPA_POD_Long(&c[7]), NULL) >= 0) {
+		fprintf(stdout, "  %-8d %10"PRIi64" %12"PRIi64" %6"PRIi64" %12"PRIi64
+				" %10"PRIi64" %12"PRIi64" %6"PRIi64" %12"PRIi64"\n",
+				id, c[0], c[1], c[2], c[3], c[4], c[5], c[6], c[7]);
+	}
+	spa_pod_parser_pop(&prs, &f[1]);
+
+	if (spa_pod_parser_push_struct(&prs, &f[1]) < 0)
+		goto invalid;
+	fprintf(stdout, "  %-40s %-6s %10s %12s %6s %12s\n", "interface",
+			"opcode", "count", "bytes", "fds", "time(ns)");
+	while (spa_pod_parser_get(&prs,
+			SPA_POD_String(&type),
+			SPA_POD_Int(&dir),
+			SPA_POD_Int(&opcode),
+			SPA_POD_Long(&c[0]),
+			SPA_POD_Long(&c[1]),
+			SPA_POD_Long(&c[2]),
+			SPA_POD_Long(&c[3]), NULL) >= 0) {
+		fprintf(stdout, "  %-40s %c%-5d %10"PRIi64" %12"PRIi64" %6"PRIi64" %12"PRIi64"\n",
+				type, dir ? 'e' : 'm', opcode, c[0], c[1], c[2], c[3]);
+	}
+	spa_pod_parser_pop(&prs, &f[1]);
+	return;
+
+invalid:
+	fprintf(stderr, "remote %d: invalid protocol stats\n", rd->id);
+}
+
+static const struct pw_protocol_stats_events protocol_stats_events = {
+	PW_VERSION_PROTOCOL_STATS_EVENTS,
+	.stats = protocol_stats_event_stats
+};
+
 
 static void device_event_info(void *object, const struct pw_device_info *info)
 {
@@ -1874,6 +1941,11 @@ static bool bind_global(struct remote_data *rd, struct global *global, char **er
 		client_version = PW_VERSION_ENDPOINT_LINK;
 		destroy = (pw_destroy_t) endpoint_link_info_free;
 		info_func = info_endpoint_link;
+	} else if (strcmp(global->type, PW_TYPE_INTERFACE_ProtocolStats) == 0) {
+		events = &protocol_stats_events;
+		client_version = PW_VERSION_PROTOCOL_STATS;
+		destroy = NULL;
+		info_func = NULL;
 	} else {
 		*error = spa_aprintf("unsupported type %s", global->type);
 		return false;
@@ -5263,6 +5335,48 @@ static bool do_get_permissions(struct data *data, const char *cmd, char *args, c
 	return true;
 }
 
+static int find_protocol_stats(void *obj, void *data)
+{
+	struct global *global = obj;
+	struct global **result = data;
+
+	if (global != NULL && *result == NULL &&
+	    strcmp(global->type, PW_TYPE_INTERFACE_ProtocolStats) == 0)
+		*result = global;
+	return 0;
+}
+
+static bool do_protocol_stats(struct data *data, const char *cmd, char *args, char **error)
+{
+	struct remote_data *rd = data->current;
+	struct global *global = NULL;
+	uint32_t flags = 0;
+	char *a[1];
+	int n;
+
+	n = pw_split_ip(args, WHITESPACE, 1, a);
+	if (n > 0) {
+		if (strcmp(a[0], "reset") != 0) {
+			*error = spa_aprintf("%s [reset]", cmd);
+			return false;
+		}
+		flags |= PW_PROTOCOL_STATS_FLAG_RESET;
+	}
+
+	pw_map_for_each(&rd->globals, find_protocol_stats, &global);
+	if (global == NULL) {
+		*error = spa_aprintf("%s: no protocol stats object on remote %d", cmd, rd->id);
+		return false;
+	}
+	if (global->proxy == NULL) {
+		if (!bind_global(rd, global, error))
+			return false;
+	}
+	pw_protocol_stats_get_stats((struct pw_protocol_stats*)global->proxy, flags);
+
+	return true;
+}
+
 static const char *
 pw_interface_short(const char *type)
 {